@@ -255,7 +255,7 @@ void capture_info_new_packets(int to_read)
             phdr = wtap_phdr(info_data.wtap);
             pseudo_header = &phdr->pseudo_header;
             wtap_linktype = phdr->pkt_encap;
-            buf = wtap_buf_ptr(info_data.wtap);
+            buf = wtap_buf_ptr_const(info_data.wtap);
 
             capture_info_packet(&info_data.counts, wtap_linktype, buf, phdr->caplen, pseudo_header);
 
@@ -148,9 +148,6 @@ FILE *debug_log;   /* for logging debug messages to  */
                    /*  is defined                    */
 #endif
 
-static GAsyncQueue *pcap_queue;
-static gint64 pcap_queue_bytes;
-static gint64 pcap_queue_packets;
 static gint64 pcap_queue_byte_limit = 0;
 static gint64 pcap_queue_packet_limit = 0;
 
@@ -274,6 +271,36 @@ typedef enum {
     PIPNEXIST
 } cap_pipe_err_t;
 
+/*
+ * With threads, each interface's thread queues its packets for the writer
+ * (the main thread) in a ring of its own, with only one thread putting
+ * packets in and one taking them out, so neither has to take a lock.
+ * A packet is its pcap_pkthdr, then its data, padded to 8 bytes; where
+ * there isn't room for a packet before the end of the ring, it goes at
+ * the start, and a header with a caplen of PCAP_RING_WRAP, if there's room
+ * for one, says so.
+ *
+ * head is only changed by the interface's thread, and tail only by the
+ * writer; each reads the other's with g_atomic_int_get().  The -C and -N
+ * limits are on the packets queued in all the rings together, counted in
+ * pcap_queue_bytes and pcap_queue_packets, which are added to by the
+ * interfaces' threads and taken from by the writer.
+ */
+typedef struct _pcap_ring {
+    u_char                      *buf;
+    guint32                      size;                   /**< a power of 2 */
+    volatile gint                head;                   /**< bytes put in, mod 2^32 */
+    volatile gint                tail;                   /**< bytes taken out, mod 2^32 */
+    guint32                      peak;                   /**< most of the ring used at once */
+} pcap_ring;
+
+#define PCAP_RING_ALIGN(n)      (((n) + 7) & ~7U)
+#define PCAP_RING_HDR_LEN       PCAP_RING_ALIGN((guint32)sizeof (struct pcap_pkthdr))
+#define PCAP_RING_WRAP          G_MAXUINT32
+#define PCAP_RING_DEFAULT_SIZE  (16 * 1024 * 1024)   /* if only -N was given */
+#define PCAP_RING_MAX_SIZE      (1024 * 1024 * 1024)
+#define PCAP_RING_BATCH         64                   /* packets the writer takes from a ring at a time */
+
 typedef struct _pcap_options {
     guint32                      received;
     guint32                      dropped;
@@ -285,6 +312,7 @@ typedef struct _pcap_options {
     gboolean                     pcap_err;
     guint                        interface_id;
     GThread                     *tid;
+    pcap_ring                   *ring;                   /**< Packets queued for the writer, if use_threads */
     int                          snaplen;
     int                          linktype;
     gboolean                     ts_nsec;                /**< TRUE if we're using nanosecond precision. */
@@ -328,18 +356,12 @@ typedef struct _loop_data {
 #endif
     GArray   *pcaps;
     /* output file(s) */
-    FILE     *pdh;
+    pcapio_file_t *pdh;
     int       save_file_fd;
     guint64   bytes_written;
     guint32   autostop_files;
 } loop_data;
 
-typedef struct _pcap_queue_element {
-    pcap_options       *pcap_opts;
-    struct pcap_pkthdr  phdr;
-    u_char             *pd;
-} pcap_queue_element;
-
 /*
  * Standard secondary message for unexpected errors.
  */
@@ -400,18 +422,36 @@ static gboolean quiet = FALSE;
 static gboolean use_threads = FALSE;
 static guint64 start_time;
 
+/* How the capture file is written; see capture_opts.h for why the long
+   options start where they do */
+#define LONGOPT_DIRECT_IO       (LONGOPT_NUM_CAP_COMMENT+1)
+#define LONGOPT_SYNC_INTERVAL   (LONGOPT_NUM_CAP_COMMENT+2)
+static gboolean direct_io = FALSE;
+static guint64 sync_interval = 0;       /* in bytes; 0 to leave it to the OS */
+
+/* For the writer to wait on when there's nothing in the rings */
+static GMutex *pcap_ring_mtx;
+static GCond *pcap_ring_cond;
+static volatile gint pcap_ring_writer_waiting;
+
+/* Packet data, and packets, queued in all the rings */
+static volatile gint pcap_queue_bytes;
+static volatile gint pcap_queue_packets;
+
 static void capture_loop_write_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
                                          const u_char *pd);
 static void capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
                                          const u_char *pd);
 static void capture_loop_get_errmsg(char *errmsg, int errmsglen, const char *fname,
                                     int err, gboolean is_close);
+static void pcap_ring_free(pcap_ring *ring);
 
 static void WS_MSVC_NORETURN exit_main(int err) G_GNUC_NORETURN;
 
 static void report_new_capture_file(const char *filename);
 static void report_packet_count(unsigned int packet_count);
-static void report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, gchar *name);
+static void report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop,
+                                guint32 queue_peak, guint32 queue_size, gchar *name);
 static void report_capture_error(const char *error_msg, const char *secondary_error_msg);
 static void report_cfilter_error(capture_options *capture_opts, guint i, const char *errmsg);
 
@@ -538,6 +578,10 @@ print_usage(gboolean print_ver)
     fprintf(output, "  --capture-comment <comment>\n");
     fprintf(output, "                           add a capture comment to the output file\n");
     fprintf(output, "                           (only for pcapng)\n");
+    fprintf(output, "  --direct-io              write the output file(s) bypassing the OS's cache,\n");
+    fprintf(output, "                           if supported\n");
+    fprintf(output, "  --sync-interval <KB>     have the OS write the output file(s) out to disk\n");
+    fprintf(output, "                           after every NUM KB\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -N <packet_limit>        maximum number of packets buffered within dumpcap\n");
@@ -2607,6 +2651,7 @@ capture_loop_open_input(capture_options *capture_opts, loop_data *ld,
         pcap_opts->pcap_err = FALSE;
         pcap_opts->interface_id = i;
         pcap_opts->tid = NULL;
+        pcap_opts->ring = NULL;
         pcap_opts->snaplen = 0;
         pcap_opts->linktype = -1;
         pcap_opts->ts_nsec = FALSE;
@@ -2792,6 +2837,11 @@ static void capture_loop_close_input(loop_data *ld)
             pcap_close(pcap_opts->pcap_h);
             pcap_opts->pcap_h = NULL;
         }
+        /* the interface's thread is done with its ring by now */
+        if (pcap_opts->ring != NULL) {
+            pcap_ring_free(pcap_opts->ring);
+            pcap_opts->ring = NULL;
+        }
     }
 
     ld->go = FALSE;
@@ -2845,6 +2895,7 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
     pcap_options      *pcap_opts;
     interface_options  interface_opts;
     gboolean           successful;
+    pcapio_write_options_t write_opts;
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG, "capture_loop_init_output");
 
@@ -2855,14 +2906,16 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
         return FALSE;
     }
 
-    /* Set up to write to the capture file. */
+    /* Set up to write to the capture file, from a thread of its own, so
+       that we can go on taking packets out of the rings while it waits
+       for the disk. */
+    write_opts.threaded = TRUE;
+    write_opts.direct_io = direct_io;
+    write_opts.sync_interval = sync_interval;
     if (capture_opts->multi_files_on) {
-        ld->pdh = ringbuf_init_libpcap_fdopen(&err);
+        ld->pdh = ringbuf_init_libpcap_fdopen(&write_opts);
     } else {
-        ld->pdh = ws_fdopen(ld->save_file_fd, "wb");
-        if (ld->pdh == NULL) {
-            err = errno;
-        }
+        ld->pdh = pcapio_fdopen(ld->save_file_fd, &write_opts);
     }
     if (ld->pdh) {
         if (capture_opts->use_pcapng) {
@@ -2917,7 +2970,7 @@ capture_loop_init_output(capture_options *capture_opts, loop_data *ld, char *err
                                                    pcap_opts->ts_nsec, &ld->bytes_written, &err);
         }
         if (!successful) {
-            fclose(ld->pdh);
+            pcapio_close(ld->pdh, NULL);
             ld->pdh = NULL;
         }
     }
@@ -2987,14 +3040,7 @@ capture_loop_close_output(capture_options *capture_opts, loop_data *ld, int *err
                 }
             }
         }
-        if (fclose(ld->pdh) == EOF) {
-            if (err_close != NULL) {
-                *err_close = errno;
-            }
-            return (FALSE);
-        } else {
-            return (TRUE);
-        }
+        return pcapio_close(ld->pdh, err_close);
     }
 }
 
@@ -3251,7 +3297,8 @@ capture_loop_open_output(capture_options *capture_opts, int *save_file_fd,
                 /* ringbuffer is enabled */
                 *save_file_fd = ringbuf_init(capfile_name,
                                              (capture_opts->has_ring_num_files) ? capture_opts->ring_num_files : 0,
-                                             capture_opts->group_read_access);
+                                             capture_opts->group_read_access,
+                                             (capture_opts->has_autostop_filesize) ? (guint64)capture_opts->autostop_filesize * 1000 : 0);
 
                 /* we need the ringbuf name */
                 if (*save_file_fd != -1) {
@@ -3400,7 +3447,7 @@ do_file_switch_or_stop(capture_options *capture_opts,
                                                        pcap_opts->ts_nsec, &global_ld.bytes_written, &global_ld.err);
             }
             if (!successful) {
-                fclose(global_ld.pdh);
+                pcapio_close(global_ld.pdh, NULL);
                 global_ld.pdh = NULL;
                 global_ld.go = FALSE;
                 return FALSE;
@@ -3409,7 +3456,7 @@ do_file_switch_or_stop(capture_options *capture_opts,
                 cnd_reset(cnd_autostop_size);
             if (cnd_file_duration)
                 cnd_reset(cnd_file_duration);
-            fflush(global_ld.pdh);
+            pcapio_flush(global_ld.pdh, NULL);
             if (!quiet)
                 report_packet_count(global_ld.inpkts_to_sync_pipe);
             global_ld.inpkts_to_sync_pipe = 0;
@@ -3427,6 +3474,139 @@ do_file_switch_or_stop(capture_options *capture_opts,
     return TRUE;
 }
 
+/* Set up an interface's ring, big enough for what -C and -N allow to be
+   queued (as all of it may be from the one interface), and for at least
+   two of the biggest packets; returns NULL if there isn't the memory */
+static pcap_ring *
+pcap_ring_new(int snaplen)
+{
+    pcap_ring *ring;
+    guint64    want;
+    guint32    size;
+
+    if (pcap_queue_byte_limit != 0)
+        want = (guint64)pcap_queue_byte_limit +
+               (guint64)pcap_queue_packet_limit * (PCAP_RING_HDR_LEN + 7);
+    else
+        want = PCAP_RING_DEFAULT_SIZE;
+    if (want < 2 * (PCAP_RING_HDR_LEN + PCAP_RING_ALIGN((guint32)snaplen)))
+        want = 2 * (PCAP_RING_HDR_LEN + PCAP_RING_ALIGN((guint32)snaplen));
+    if (want > PCAP_RING_MAX_SIZE)
+        want = PCAP_RING_MAX_SIZE;
+    for (size = 4096; size < want; size <<= 1)
+        ;
+
+    ring = g_new0(pcap_ring, 1);
+    ring->buf = (u_char *)g_try_malloc(size);
+    if (ring->buf == NULL) {
+        g_free(ring);
+        return NULL;
+    }
+    ring->size = size;
+    return ring;
+}
+
+static void
+pcap_ring_free(pcap_ring *ring)
+{
+    g_free(ring->buf);
+    g_free(ring);
+}
+
+/* Write out up to max of the packets queued in an interface's ring, and
+   give their space back; returns how many there were. */
+static int
+pcap_ring_write_packets(pcap_options *pcap_opts, int max)
+{
+    pcap_ring          *ring = pcap_opts->ring;
+    struct pcap_pkthdr *phdr;
+    guint32             head, tail, off, to_end, bytes = 0;
+    int                 count = 0;
+
+    head = (guint32)g_atomic_int_get(&ring->head);
+    tail = (guint32)ring->tail;
+    while (tail != head && count < max) {
+        off = tail & (ring->size - 1);
+        to_end = ring->size - off;
+        phdr = (struct pcap_pkthdr *)(void *)(ring->buf + off);
+        if (to_end < PCAP_RING_HDR_LEN || phdr->caplen == PCAP_RING_WRAP) {
+            /* the next packet is at the start */
+            tail += to_end;
+            continue;
+        }
+        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
+              "Dequeued a packet of length %d captured on interface %d.",
+              phdr->caplen, pcap_opts->interface_id);
+        capture_loop_write_packet_cb((u_char *)pcap_opts, phdr,
+                                     ring->buf + off + PCAP_RING_HDR_LEN);
+        bytes += phdr->caplen;
+        tail += PCAP_RING_HDR_LEN + PCAP_RING_ALIGN(phdr->caplen);
+        count++;
+    }
+    if (tail != (guint32)ring->tail) {
+        g_atomic_int_add(&pcap_queue_packets, -count);
+        g_atomic_int_add(&pcap_queue_bytes, -(gint)bytes);
+        g_atomic_int_set(&ring->tail, (gint)tail);
+    }
+    return count;
+}
+
+/* Write out a batch of packets from each interface's ring; returns how
+   many there were in all. */
+static int
+pcap_rings_write_packets(int max)
+{
+    guint i;
+    int   count = 0;
+
+    for (i = 0; i < global_ld.pcaps->len; i++)
+        count += pcap_ring_write_packets(g_array_index(global_ld.pcaps, pcap_options *, i), max);
+    return count;
+}
+
+static gboolean
+pcap_rings_empty(void)
+{
+    guint      i;
+    pcap_ring *ring;
+
+    for (i = 0; i < global_ld.pcaps->len; i++) {
+        ring = g_array_index(global_ld.pcaps, pcap_options *, i)->ring;
+        if (g_atomic_int_get(&ring->head) != ring->tail)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* Wait until an interface's thread queues a packet, or for
+   WRITER_THREAD_TIMEOUT, whichever comes first */
+static void
+pcap_rings_wait(void)
+{
+#if GLIB_CHECK_VERSION(2,31,0)
+    gint64   end_time = g_get_monotonic_time() + WRITER_THREAD_TIMEOUT;
+#else
+    GTimeVal end_time;
+
+    g_get_current_time(&end_time);
+    g_time_val_add(&end_time, WRITER_THREAD_TIMEOUT);
+#endif
+
+    g_mutex_lock(pcap_ring_mtx);
+    g_atomic_int_set(&pcap_ring_writer_waiting, 1);
+    /* Look again now that the threads know to wake us up, in case they
+       queued something just before that */
+    if (pcap_rings_empty()) {
+#if GLIB_CHECK_VERSION(2,31,0)
+        g_cond_wait_until(pcap_ring_cond, pcap_ring_mtx, end_time);
+#else
+        g_cond_timed_wait(pcap_ring_cond, pcap_ring_mtx, &end_time);
+#endif
+    }
+    g_atomic_int_set(&pcap_ring_writer_waiting, 0);
+    g_mutex_unlock(pcap_ring_mtx);
+}
+
 static void *
 pcap_read_handler(void* arg)
 {
@@ -3533,6 +3713,26 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
         }
     }
 
+    /* Set up the interfaces' rings, before there's a capture file to be
+       got rid of if there isn't the memory for them */
+    if (use_threads) {
+        g_atomic_int_set(&pcap_queue_bytes, 0);
+        g_atomic_int_set(&pcap_queue_packets, 0);
+        for (i = 0; i < global_ld.pcaps->len; i++) {
+            pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
+            pcap_opts->ring = pcap_ring_new(pcap_opts->snaplen);
+            if (pcap_opts->ring == NULL) {
+                interface_opts = g_array_index(capture_opts->ifaces, interface_options, i);
+                g_snprintf(errmsg, sizeof(errmsg),
+                           "Couldn't allocate a buffer for the packets captured on %s.",
+                           interface_opts.name);
+                g_snprintf(secondary_errmsg, sizeof(secondary_errmsg),
+                           "Try a smaller -C byte limit.");
+                goto error;
+            }
+        }
+    }
+
     /* If we're supposed to write to a capture file, open it for output
        (temporary/specified name/ringbuffer) */
     if (capture_opts->saving_to_file) {
@@ -3560,7 +3760,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
            message to our parent so that they'll open the capture file and
            update its windows to indicate that we have a live capture in
            progress. */
-        fflush(global_ld.pdh);
+        pcapio_flush(global_ld.pdh, NULL);
         report_new_capture_file(capture_opts->save_file);
     }
 
@@ -3600,9 +3800,17 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     /* WOW, everything is prepared! */
     /* please fasten your seat belts, we will enter now the actual capture loop */
     if (use_threads) {
-        pcap_queue = g_async_queue_new();
-        pcap_queue_bytes = 0;
-        pcap_queue_packets = 0;
+        if (pcap_ring_mtx == NULL) {
+#if GLIB_CHECK_VERSION(2,31,0)
+            pcap_ring_mtx = g_new(GMutex, 1);
+            g_mutex_init(pcap_ring_mtx);
+            pcap_ring_cond = g_new(GCond, 1);
+            g_cond_init(pcap_ring_cond);
+#else
+            pcap_ring_mtx = g_mutex_new();
+            pcap_ring_cond = g_cond_new();
+#endif
+        }
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
 #if GLIB_CHECK_VERSION(2,31,0)
@@ -3616,37 +3824,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
     while (global_ld.go) {
         /* dispatch incoming packets */
         if (use_threads) {
-            pcap_queue_element *queue_element;
-#if GLIB_CHECK_VERSION(2,31,18)
-
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_timeout_pop_unlocked(pcap_queue, WRITER_THREAD_TIMEOUT);
-#else
-            GTimeVal write_thread_time;
-
-            g_get_current_time(&write_thread_time);
-            g_time_val_add(&write_thread_time, WRITER_THREAD_TIMEOUT);
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_timed_pop_unlocked(pcap_queue, &write_thread_time);
-#endif
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element) {
-                g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                      "Dequeued a packet of length %d captured on interface %d.",
-                      queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-
-                capture_loop_write_packet_cb((u_char *) queue_element->pcap_opts,
-                                             &queue_element->phdr,
-                                             queue_element->pd);
-                g_free(queue_element->pd);
-                g_free(queue_element);
-                inpkts = 1;
-            } else {
-                inpkts = 0;
+            inpkts = pcap_rings_write_packets(PCAP_RING_BATCH);
+            if (inpkts == 0) {
+                pcap_rings_wait();
+                inpkts = pcap_rings_write_packets(PCAP_RING_BATCH);
             }
         } else {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, 0);
@@ -3681,7 +3862,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                     continue;
             } /* cnd_autostop_size */
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                pcapio_flush(global_ld.pdh, NULL);
             }
         } /* inpkts */
 
@@ -3710,7 +3891,7 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             /* Let the parent process know. */
             if (global_ld.inpkts_to_sync_pipe) {
                 /* do sync here */
-                fflush(global_ld.pdh);
+                pcapio_flush(global_ld.pdh, NULL);
 
                 /* Send our parent a message saying we've written out
                    "global_ld.inpkts_to_sync_pipe" packets to the capture file. */
@@ -3739,8 +3920,6 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
 
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Capture loop stopping ...");
     if (use_threads) {
-        pcap_queue_element *queue_element;
-
         for (i = 0; i < global_ld.pcaps->len; i++) {
             pcap_opts = g_array_index(global_ld.pcaps, pcap_options *, i);
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Waiting for thread of interface %u...",
@@ -3749,28 +3928,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
             g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO, "Thread of interface %u terminated.",
                   pcap_opts->interface_id);
         }
-        while (1) {
-            g_async_queue_lock(pcap_queue);
-            queue_element = (pcap_queue_element *)g_async_queue_try_pop_unlocked(pcap_queue);
-            if (queue_element) {
-                pcap_queue_bytes -= queue_element->phdr.caplen;
-                pcap_queue_packets -= 1;
-            }
-            g_async_queue_unlock(pcap_queue);
-            if (queue_element == NULL) {
-                break;
-            }
-            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-                  "Dequeued a packet of length %d captured on interface %d.",
-                  queue_element->phdr.caplen, queue_element->pcap_opts->interface_id);
-            capture_loop_write_packet_cb((u_char *)queue_element->pcap_opts,
-                                         &queue_element->phdr,
-                                         queue_element->pd);
-            g_free(queue_element->pd);
-            g_free(queue_element);
-            global_ld.inpkts_to_sync_pipe += 1;
+        while ((inpkts = pcap_rings_write_packets(G_MAXINT)) > 0) {
+            global_ld.inpkts_to_sync_pipe += inpkts;
             if (capture_opts->output_to_pipe) {
-                fflush(global_ld.pdh);
+                pcapio_flush(global_ld.pdh, NULL);
             }
         }
     }
@@ -3895,7 +4056,10 @@ capture_loop_start(capture_options *capture_opts, gboolean *stats_known, struct
                 report_capture_error(errmsg, please_report);
             }
         }
-        report_packet_drops(received, pcap_dropped, pcap_opts->dropped, pcap_opts->flushed, stats->ps_ifdrop, interface_opts.console_display_name);
+        report_packet_drops(received, pcap_dropped, pcap_opts->dropped, pcap_opts->flushed, stats->ps_ifdrop,
+                            pcap_opts->ring ? pcap_opts->ring->peak : 0,
+                            pcap_opts->ring ? pcap_opts->ring->size : 0,
+                            interface_opts.console_display_name);
     }
 
     /* close the input file (pcap or capture pipe) */
@@ -4063,9 +4227,9 @@ static void
 capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr,
                              const u_char *pd)
 {
-    pcap_options       *pcap_opts = (pcap_options *) (void *) pcap_opts_p;
-    pcap_queue_element *queue_element;
-    gboolean            limit_reached;
+    pcap_options *pcap_opts = (pcap_options *) (void *) pcap_opts_p;
+    pcap_ring    *ring      = pcap_opts->ring;
+    guint32       head, used, off, to_end, len, need;
 
     /* We may be called multiple times from pcap_dispatch(); if we've set
        the "stop capturing" flag, ignore this packet, as we're not
@@ -4075,49 +4239,50 @@ capture_loop_queue_packet_cb(u_char *pcap_opts_p, const struct pcap_pkthdr *phdr
         return;
     }
 
-    queue_element = (pcap_queue_element *)g_malloc(sizeof(pcap_queue_element));
-    if (queue_element == NULL) {
-       pcap_opts->dropped++;
-       return;
-    }
-    queue_element->pcap_opts = pcap_opts;
-    queue_element->phdr = *phdr;
-    queue_element->pd = (u_char *)g_malloc(phdr->caplen);
-    if (queue_element->pd == NULL) {
-        pcap_opts->dropped++;
-        g_free(queue_element);
-        return;
-    }
-    memcpy(queue_element->pd, pd, phdr->caplen);
-    g_async_queue_lock(pcap_queue);
-    if (((pcap_queue_byte_limit == 0) || (pcap_queue_bytes < pcap_queue_byte_limit)) &&
-        ((pcap_queue_packet_limit == 0) || (pcap_queue_packets < pcap_queue_packet_limit))) {
-        limit_reached = FALSE;
-        g_async_queue_push_unlocked(pcap_queue, queue_element);
-        pcap_queue_bytes += phdr->caplen;
-        pcap_queue_packets += 1;
-    } else {
-        limit_reached = TRUE;
-    }
-    g_async_queue_unlock(pcap_queue);
-    if (limit_reached) {
+    head = (guint32)ring->head;
+    used = head - (guint32)g_atomic_int_get(&ring->tail);
+    off = head & (ring->size - 1);
+    to_end = ring->size - off;
+    len = PCAP_RING_HDR_LEN + PCAP_RING_ALIGN(MIN(phdr->caplen, ring->size));
+    need = (to_end < len) ? to_end + len : len;
+    if (phdr->caplen > ring->size / 2 || need > ring->size - used ||
+        ((pcap_queue_byte_limit != 0) &&
+         (g_atomic_int_get(&pcap_queue_bytes) >= pcap_queue_byte_limit)) ||
+        ((pcap_queue_packet_limit != 0) &&
+         (g_atomic_int_get(&pcap_queue_packets) >= pcap_queue_packet_limit))) {
         pcap_opts->dropped++;
-        g_free(queue_element->pd);
-        g_free(queue_element);
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
               "Dropped a packet of length %d captured on interface %u.",
               phdr->caplen, pcap_opts->interface_id);
-    } else {
-        pcap_opts->received++;
-        g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-              "Queued a packet of length %d captured on interface %u.",
-              phdr->caplen, pcap_opts->interface_id);
+        return;
     }
-    /* I don't want to hold the mutex over the debug output. So the
-       output may be wrong */
+
+    if (to_end < len) {
+        /* no room before the end; put it at the start */
+        if (to_end >= PCAP_RING_HDR_LEN)
+            ((struct pcap_pkthdr *)(void *)(ring->buf + off))->caplen = PCAP_RING_WRAP;
+        head += to_end;
+        off = 0;
+    }
+    memcpy(ring->buf + off, phdr, sizeof (struct pcap_pkthdr));
+    memcpy(ring->buf + off + PCAP_RING_HDR_LEN, pd, phdr->caplen);
+    g_atomic_int_add(&pcap_queue_packets, 1);
+    g_atomic_int_add(&pcap_queue_bytes, (gint)phdr->caplen);
+    if (used + need > ring->peak)
+        ring->peak = used + need;
+    g_atomic_int_set(&ring->head, (gint)(head + len));
+
+    /* If the writer's waiting for packets, wake it up */
+    if (g_atomic_int_get(&pcap_ring_writer_waiting)) {
+        g_mutex_lock(pcap_ring_mtx);
+        g_cond_signal(pcap_ring_cond);
+        g_mutex_unlock(pcap_ring_mtx);
+    }
+
+    pcap_opts->received++;
     g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_INFO,
-          "Queue size is now %" G_GINT64_MODIFIER "d bytes (%" G_GINT64_MODIFIER "d packets)",
-          pcap_queue_bytes, pcap_queue_packets);
+          "Queued a packet of length %d captured on interface %u; %u bytes of its ring in use.",
+          phdr->caplen, pcap_opts->interface_id, used + need);
 }
 
 static int
@@ -4173,6 +4338,8 @@ main(int argc, char *argv[])
     int               opt;
     struct option     long_options[] = {
         {(char *)"capture-comment", required_argument, NULL, LONGOPT_NUM_CAP_COMMENT },
+        {(char *)"direct-io", no_argument, NULL, LONGOPT_DIRECT_IO },
+        {(char *)"sync-interval", required_argument, NULL, LONGOPT_SYNC_INTERVAL },
         {0, 0, 0, 0 }
     };
 
@@ -4635,6 +4802,12 @@ main(int argc, char *argv[])
         case 'N':
             pcap_queue_packet_limit = get_positive_int(optarg, "packet_limit");
             break;
+        case LONGOPT_DIRECT_IO:
+            direct_io = TRUE;
+            break;
+        case LONGOPT_SYNC_INTERVAL:
+            sync_interval = (guint64)get_positive_int(optarg, "sync interval") * 1000;
+            break;
         default:
             cmdarg_err("Invalid Option: %s", argv[optind-1]);
             /* FALLTHROUGH */
@@ -5085,8 +5258,11 @@ report_capture_error(const char *error_msg, const char *secondary_error_msg)
     }
 }
 
+/* queue_peak and queue_size are how much of the interface's ring was
+   used at most, and how big it is, if it had one */
 static void
-report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop, gchar *name)
+report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32 flushed, guint32 ps_ifdrop,
+                    guint32 queue_peak, guint32 queue_size, gchar *name)
 {
     char tmp[SP_DECISIZE+1+1];
     guint32 total_drops = pcap_drops + drops + flushed;
@@ -5097,6 +5273,10 @@ report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32
         g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
             "Packets received/dropped on interface '%s': %u/%u (pcap:%u/dumpcap:%u/flushed:%u/ps_ifdrop:%u)",
             name, received, total_drops, pcap_drops, drops, flushed, ps_ifdrop);
+        if (queue_size != 0)
+            g_log(LOG_DOMAIN_CAPTURE_CHILD, G_LOG_LEVEL_DEBUG,
+                "Queue for interface '%s': at most %u of %u bytes used",
+                name, queue_peak, queue_size);
         /* XXX: Need to provide interface id, changes to consumers required. */
         pipe_write_block(2, SP_DROPS, tmp);
     } else {
@@ -5104,6 +5284,9 @@ report_packet_drops(guint32 received, guint32 pcap_drops, guint32 drops, guint32
             "Packets received/dropped on interface '%s': %u/%u (pcap:%u/dumpcap:%u/flushed:%u/ps_ifdrop:%u) (%.1f%%)\n",
             name, received, total_drops, pcap_drops, drops, flushed, ps_ifdrop,
             received ? 100.0 * received / (received + total_drops) : 0.0);
+        if (queue_size != 0)
+            fprintf(stderr, "Queue for interface '%s': at most %u of %u bytes used (%.1f%%)\n",
+                name, queue_peak, queue_size, 100.0 * queue_peak / queue_size);
         /* stderr could be line buffered */
         fflush(stderr);
     }
@@ -151,6 +151,7 @@ static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE
 static int                    out_file_type_subtype     = WTAP_FILE_TYPE_SUBTYPE_PCAP; /* default to pcap     */
 #endif
 static int                    out_frame_type            = -2; /* Leave frame type alone */
+static wtap_compression_type  out_compression_type      = WTAP_UNCOMPRESSED;
 static int                    verbose                   = 0;  /* Not so verbose         */
 static struct time_adjustment time_adj                  = {{0, 0}, 0}; /* no adjustment */
 static nstime_t               relative_time_window      = {0, 0}; /* de-dup time window */
@@ -748,6 +749,9 @@ usage(gboolean is_error)
     fprintf(output, "  -T <encap type>        set the output file encapsulation type; default is the\n");
     fprintf(output, "                         same as the input file. An empty \"-T\" option will\n");
     fprintf(output, "                         list the encapsulation types.\n");
+    fprintf(output, "  -z <compression>       compress the output file(s) with gzip, zstd or lz4;\n");
+    fprintf(output, "                         default is none. An empty \"-z\" option will list\n");
+    fprintf(output, "                         the compression types.\n");
     fprintf(output, "\n");
     fprintf(output, "Miscellaneous:\n");
     fprintf(output, "  -h                     display this help and exit.\n");
@@ -825,6 +829,17 @@ list_encap_types(void) {
     g_free(encaps);
 }
 
+static void
+list_compression_types(void) {
+    GSList *names, *name;
+
+    fprintf(stderr, "editcap: The available compression types for the \"-z\" flag are:\n");
+    names = wtap_get_compression_type_names();
+    for (name = names; name != NULL; name = g_slist_next(name))
+        fprintf(stderr, "    %s\n", (const char *)name->data);
+    g_slist_free(names);
+}
+
 #ifdef HAVE_PLUGINS
 /*
  *  Don't report failures to load plugins because most (non-wiretap) plugins
@@ -906,7 +921,7 @@ main(int argc, char *argv[])
 #endif
 
     /* Process the options */
-    while ((opt = getopt(argc, argv, "A:B:c:C:dD:E:F:hi:Lrs:S:t:T:vw:")) != -1) {
+    while ((opt = getopt(argc, argv, "A:B:c:C:dD:E:F:hi:Lrs:S:t:T:vw:z:")) != -1) {
         switch (opt) {
         case 'A':
         {
@@ -1097,6 +1112,15 @@ main(int argc, char *argv[])
             set_rel_time(optarg);
             break;
 
+        case 'z':
+            if (!wtap_name_to_compression_type(optarg, &out_compression_type)) {
+                fprintf(stderr, "editcap: \"%s\" isn't a valid compression type\n\n",
+                        optarg);
+                list_compression_types();
+                exit(1);
+            }
+            break;
+
         case '?':              /* Bad options if GNU getopt */
             switch(optopt) {
             case'F':
@@ -1105,6 +1129,9 @@ main(int argc, char *argv[])
             case'T':
                 list_encap_types();
                 break;
+            case'z':
+                list_compression_types();
+                break;
             default:
                 usage(TRUE);
                 break;
@@ -1217,9 +1244,9 @@ main(int argc, char *argv[])
                     shb_hdr->shb_user_appl = "Editcap " VERSION;
                 }
 
-                pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                        snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                        FALSE /* compressed */, shb_hdr, idb_inf, &err);
+                pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                                snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
+                                                out_compression_type, shb_hdr, idb_inf, &err);
 
                 if (pdh == NULL) {
                     fprintf(stderr, "editcap: Can't open or create %s: %s\n",
@@ -1248,9 +1275,9 @@ main(int argc, char *argv[])
                     if (verbose)
                         fprintf(stderr, "Continuing writing in file %s\n", filename);
 
-                    pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                            snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                            FALSE /* compressed */, shb_hdr, idb_inf, &err);
+                    pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                                    snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
+                                                    out_compression_type, shb_hdr, idb_inf, &err);
 
                     if (pdh == NULL) {
                         fprintf(stderr, "editcap: Can't open or create %s: %s\n",
@@ -1276,9 +1303,9 @@ main(int argc, char *argv[])
                     if (verbose)
                         fprintf(stderr, "Continuing writing in file %s\n", filename);
 
-                    pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                            snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
-                                            FALSE /* compressed */, shb_hdr, idb_inf, &err);
+                    pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                                    snaplen ? MIN(snaplen, wtap_snapshot_length(wth)) : wtap_snapshot_length(wth),
+                                                    out_compression_type, shb_hdr, idb_inf, &err);
                     if (pdh == NULL) {
                         fprintf(stderr, "editcap: Can't open or create %s: %s\n",
                                 filename, wtap_strerror(err));
@@ -1581,9 +1608,9 @@ main(int argc, char *argv[])
             g_free (filename);
             filename = g_strdup(argv[optind+1]);
 
-            pdh = wtap_dump_open_ng(filename, out_file_type_subtype, out_frame_type,
-                                    snaplen ? MIN(snaplen, wtap_snapshot_length(wth)): wtap_snapshot_length(wth),
-                                    FALSE /* compressed */, shb_hdr, idb_inf, &err);
+            pdh = wtap_dump_open_compressed(filename, out_file_type_subtype, out_frame_type,
+                                            snaplen ? MIN(snaplen, wtap_snapshot_length(wth)): wtap_snapshot_length(wth),
+                                            out_compression_type, shb_hdr, idb_inf, &err);
             if (pdh == NULL) {
                 fprintf(stderr, "editcap: Can't open or create %s: %s\n",
                         filename, wtap_strerror(err));
@@ -0,0 +1,236 @@
+/* bitcoin_bench.c
+ * Benchmark for the Bitcoin dissector's message dispatch
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Hands the "bitcoin" dissector a segment made of many small messages,
+ * mostly "inv" and "tx" as in the chatter between peers, over and over,
+ * and reports how many messages per second it got through, without a
+ * protocol tree (as when TShark only prints a summary) and with a
+ * visible one.  Run it on builds before and after a change to the
+ * dissector to compare them.
+ *
+ * Usage: bitcoin_bench [iterations [messages per segment]]
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "register.h"
+#include "emem.h"
+#include "wmem/wmem.h"
+#include "epan.h"
+#include "frame_data.h"
+#include "packet.h"
+#include "packet_info.h"
+#include "proto.h"
+#include "tvbuff.h"
+
+#define BENCH_MAGIC		0xd9b4bef9	/* the Bitcoin main network's */
+#define BENCH_HEADER_LEN	24
+
+/* A transaction with one input and one output, both without scripts */
+static const guint8 bench_tx[] = {
+	0x01, 0x00, 0x00, 0x00,		/* version */
+	0x01,				/* inputs */
+	0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+	0x00, 0x00, 0x00, 0x00,		/* previous output */
+	0x00,				/* script length */
+	0xff, 0xff, 0xff, 0xff,		/* sequence */
+	0x01,				/* outputs */
+	0x00, 0xe1, 0xf5, 0x05, 0x00, 0x00, 0x00, 0x00,	/* value */
+	0x00,				/* script length */
+	0x00, 0x00, 0x00, 0x00		/* lock time */
+};
+
+/* One transaction announced */
+static const guint8 bench_inv[] = {
+	0x01,				/* count */
+	0x01, 0x00, 0x00, 0x00,		/* type: transaction */
+	0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22,
+	0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22,
+	0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22,
+	0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22
+};
+
+/* Mostly inv and tx, with a few others, and one that isn't a command */
+static const struct {
+	const char   *command;
+	const guint8 *payload;
+	guint32       payload_len;
+} bench_messages[] = {
+	{ "inv",   bench_inv, sizeof(bench_inv) },
+	{ "tx",    bench_tx,  sizeof(bench_tx) },
+	{ "inv",   bench_inv, sizeof(bench_inv) },
+	{ "tx",    bench_tx,  sizeof(bench_tx) },
+	{ "inv",   bench_inv, sizeof(bench_inv) },
+	{ "tx",    bench_tx,  sizeof(bench_tx) },
+	{ "getdata", bench_inv, sizeof(bench_inv) },
+	{ "verack", NULL, 0 },
+	{ "ping",  NULL, 0 },
+	{ "txfoo", NULL, 0 },
+};
+
+/* Builds a segment of num_messages messages, and returns its length */
+static guint
+build_segment(guint8 **segment, guint num_messages)
+{
+	guint8  *data;
+	guint    len = 0;
+	guint    i, m;
+
+	for (i = 0; i < num_messages; i++)
+		len += BENCH_HEADER_LEN + bench_messages[i % G_N_ELEMENTS(bench_messages)].payload_len;
+
+	data = (guint8 *)g_malloc0(len);
+	*segment = data;
+
+	for (i = 0; i < num_messages; i++) {
+		m = i % G_N_ELEMENTS(bench_messages);
+
+		data[0] = (guint8)(BENCH_MAGIC);
+		data[1] = (guint8)(BENCH_MAGIC >> 8);
+		data[2] = (guint8)(BENCH_MAGIC >> 16);
+		data[3] = (guint8)(BENCH_MAGIC >> 24);
+		memcpy(data + 4, bench_messages[m].command, strlen(bench_messages[m].command));
+		data[16] = (guint8)(bench_messages[m].payload_len);
+		data[17] = (guint8)(bench_messages[m].payload_len >> 8);
+		/* the checksum isn't checked by default */
+		if (bench_messages[m].payload_len)
+			memcpy(data + BENCH_HEADER_LEN, bench_messages[m].payload,
+			       bench_messages[m].payload_len);
+		data += BENCH_HEADER_LEN + bench_messages[m].payload_len;
+	}
+
+	return len;
+}
+
+static void
+bench(const char *name, dissector_handle_t handle, tvbuff_t *tvb,
+      gboolean with_tree, guint iterations, guint num_messages)
+{
+	frame_data   fd;
+	packet_info  pinfo;
+	proto_tree  *tree = NULL;
+	GTimer      *timer;
+	gdouble      elapsed;
+	gdouble      messages;
+	guint        i;
+
+	memset(&fd, 0, sizeof(fd));
+	fd.num = 1;
+	memset(&pinfo, 0, sizeof(pinfo));
+	pinfo.fd = &fd;
+	pinfo.pool = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+
+	if (with_tree) {
+		tree = proto_tree_create_root(&pinfo);
+		proto_tree_set_visible(tree, TRUE);
+	}
+
+	timer = g_timer_new();
+	for (i = 0; i < iterations; i++) {
+		wmem_enter_packet_scope();
+		pinfo.layers = wmem_list_new(pinfo.pool);
+
+		call_dissector(handle, tvb, &pinfo, tree);
+
+		if (tree)
+			proto_tree_reset(tree);
+		wmem_free_all(pinfo.pool);
+		ep_free_all();
+		wmem_leave_packet_scope();
+	}
+	g_timer_stop(timer);
+	elapsed = g_timer_elapsed(timer, NULL);
+
+	messages = (gdouble)iterations * num_messages;
+	printf("%-20s %8.3f s  %12.0f messages/s\n", name, elapsed,
+	       elapsed > 0.0 ? messages / elapsed : 0.0);
+
+	g_timer_destroy(timer);
+	if (tree)
+		proto_tree_free(tree);
+	wmem_destroy_allocator(pinfo.pool);
+}
+
+int
+main(int argc, char **argv)
+{
+	epan_t             *session;
+	dissector_handle_t  handle;
+	tvbuff_t           *tvb;
+	guint8             *segment;
+	guint               segment_len;
+	guint               iterations = 10000;
+	guint               num_messages = 100;
+
+	if (argc > 1)
+		iterations = (guint)strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		num_messages = (guint)strtoul(argv[2], NULL, 10);
+
+	epan_init(register_all_protocols, register_all_protocol_handoffs, NULL, NULL);
+	session = epan_new();
+
+	handle = find_dissector("bitcoin");
+	if (handle == NULL) {
+		fprintf(stderr, "bitcoin_bench: there's no \"bitcoin\" dissector\n");
+		return 1;
+	}
+
+	segment_len = build_segment(&segment, num_messages);
+	tvb = tvb_new_real_data(segment, segment_len, segment_len);
+
+	printf("%u segments of %u messages, %u bytes\n", iterations, num_messages, segment_len);
+	bench("Without a tree", handle, tvb, FALSE, iterations, num_messages);
+	bench("With a visible tree", handle, tvb, TRUE, iterations, num_messages);
+
+	tvb_free(tvb);
+	g_free(segment);
+	epan_free(session);
+	epan_cleanup();
+
+	return 0;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
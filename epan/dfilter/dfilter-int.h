@@ -29,16 +29,27 @@
 #include <epan/proto.h>
 #include <stdio.h>
 
+/* The fvalues loaded into a register */
+typedef struct {
+	fvalue_t	**fvalues;
+	guint		len;
+	guint		size;		/* allocated, kept from packet to packet */
+} df_register_t;
+
+struct _dfvm_code;
+
 /* Passed back to user */
 struct epan_dfilter {
 	GPtrArray	*insns;
 	GPtrArray	*consts;
+	struct _dfvm_code *code;	/* insns, as run by dfvm_apply() */
 	guint		num_registers;
 	guint		max_registers;
-	GList		**registers;
+	df_register_t	*registers;
 	gboolean	*attempted_load;
 	int		*interesting_fields;
 	int		num_interesting_fields;
+	guint		primed_generation;	/* of the referenced fields, 0 if never primed */
 	GPtrArray	*deprecated;
 };
 
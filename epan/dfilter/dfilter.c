@@ -149,11 +149,15 @@ dfilter_free(dfilter_t *df)
 
 	g_free(df->interesting_fields);
 
+	/* Other filters' fields are primed again when they're next used */
+	if (df->primed_generation)
+		proto_clear_referenced_fields();
+
+	g_free(df->code);
+
 	/* clear registers */
 	for (i = 0; i < df->max_registers; i++) {
-		if (df->registers[i]) {
-			g_list_free(df->registers[i]);
-		}
+		g_free(df->registers[i].fvalues);
 	}
 
 	if (df->deprecated) {
@@ -338,12 +342,15 @@ dfilter_compile(const gchar *text, dfilter_t **dfp)
 		/* Initialize run-time space */
 		dfilter->num_registers = dfw->first_constant;
 		dfilter->max_registers = dfw->next_register;
-		dfilter->registers = g_new0(GList*, dfilter->max_registers);
+		dfilter->registers = g_new0(df_register_t, dfilter->max_registers);
 		dfilter->attempted_load = g_new0(gboolean, dfilter->max_registers);
 
 		/* Initialize constants */
 		dfvm_init_const(dfilter);
 
+		/* And lay the bytecode out for running */
+		dfvm_link(dfilter);
+
 		/* Add any deprecated items */
 		dfilter->deprecated = deprecated;
 
@@ -387,10 +394,18 @@ void
 dfilter_prime_proto_tree(const dfilter_t *df, proto_tree *tree)
 {
     int i;
+    guint generation = proto_referenced_fields_generation();
+
+    /* Primed fields stay primed until the referenced fields are cleared */
+    if (df->primed_generation == generation)
+        return;
 
     for (i = 0; i < df->num_interesting_fields; i++) {
         proto_tree_prime_hfid(tree, df->interesting_fields[i]);
     }
+
+    /* Only the record of the priming changes, not the filter */
+    ((dfilter_t *)df)->primed_generation = generation;
 }
 
 GPtrArray *
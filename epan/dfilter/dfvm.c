@@ -132,6 +132,12 @@ dfvm_dump(FILE *f, dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_EQ_U32:
+			case ANY_NE_U32:
+			case ANY_GT_U32:
+			case ANY_GE_U32:
+			case ANY_LT_U32:
+			case ANY_LE_U32:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -266,6 +272,36 @@ dfvm_dump(FILE *f, dfilter_t *df)
 					id, arg1->value.numeric, arg2->value.numeric);
 				break;
 
+			case ANY_EQ_U32:
+				fprintf(f, "%05d ANY_EQ_U32\treg#%u == reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_NE_U32:
+				fprintf(f, "%05d ANY_NE_U32\treg#%u != reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GT_U32:
+				fprintf(f, "%05d ANY_GT_U32\treg#%u > reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_GE_U32:
+				fprintf(f, "%05d ANY_GE_U32\treg#%u >= reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LT_U32:
+				fprintf(f, "%05d ANY_LT_U32\treg#%u < reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
+			case ANY_LE_U32:
+				fprintf(f, "%05d ANY_LE_U32\treg#%u <= reg#%u\n",
+					id, arg1->value.numeric, arg2->value.numeric);
+				break;
+
 			case NOT:
 				fprintf(f, "%05d NOT\n", id);
 				break;
@@ -291,6 +327,27 @@ dfvm_dump(FILE *f, dfilter_t *df)
 	}
 }
 
+/* Makes room for at least len fvalues in a register. */
+static void
+register_reserve(df_register_t *reg, guint len)
+{
+	if (len <= reg->size)
+		return;
+
+	if (reg->size == 0)
+		reg->size = 4;
+	while (reg->size < len)
+		reg->size *= 2;
+	reg->fvalues = (fvalue_t **)g_realloc(reg->fvalues, reg->size * sizeof(fvalue_t *));
+}
+
+static void
+register_append(df_register_t *reg, fvalue_t *fv)
+{
+	register_reserve(reg, reg->len + 1);
+	reg->fvalues[reg->len++] = fv;
+}
+
 /* Reads a field from the proto_tree and loads the fvalues into a register,
  * if that field has not already been read. */
 static gboolean
@@ -298,18 +355,14 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 {
 	GPtrArray	*finfos;
 	field_info	*finfo;
-	int		i, len;
-	GList		*fvalues = NULL;
-	gboolean	found_something = FALSE;
+	df_register_t	*r;
+	guint		i;
+
+	r = &df->registers[reg];
 
 	/* Already loaded in this run of the dfilter? */
 	if (df->attempted_load[reg]) {
-		if (df->registers[reg]) {
-			return TRUE;
-		}
-		else {
-			return FALSE;
-		}
+		return r->len != 0;
 	}
 
 	df->attempted_load[reg] = TRUE;
@@ -320,32 +373,24 @@ read_tree(dfilter_t *df, proto_tree *tree, header_field_info *hfinfo, int reg)
 			hfinfo = hfinfo->same_name_next;
 			continue;
 		}
-		else {
-			found_something = TRUE;
-		}
 
-		len = finfos->len;
-		for (i = 0; i < len; i++) {
+		register_reserve(r, r->len + finfos->len);
+		for (i = 0; i < finfos->len; i++) {
 			finfo = (field_info *)g_ptr_array_index(finfos, i);
-			fvalues = g_list_prepend(fvalues, &finfo->value);
+			r->fvalues[r->len++] = &finfo->value;
 		}
 
 		hfinfo = hfinfo->same_name_next;
 	}
 
-	if (!found_something) {
-		return FALSE;
-	}
-
-	df->registers[reg] = fvalues;
-	return TRUE;
+	return r->len != 0;
 }
 
 
 static gboolean
 put_fvalue(dfilter_t *df, fvalue_t *fv, int reg)
 {
-	df->registers[reg] = g_list_append(NULL, fv);
+	register_append(&df->registers[reg], fv);
 	return TRUE;
 }
 
@@ -354,26 +399,88 @@ typedef gboolean (*FvalueCmpFunc)(const fvalue_t*, const fvalue_t*);
 static gboolean
 any_test(dfilter_t *df, FvalueCmpFunc cmp, int reg1, int reg2)
 {
-	GList	*list_a, *list_b;
+	df_register_t	*a, *b;
+	guint		i, j;
+
+	a = &df->registers[reg1];
+	b = &df->registers[reg2];
 
-	list_a = df->registers[reg1];
+	for (i = 0; i < a->len; i++) {
+		for (j = 0; j < b->len; j++) {
+			if (cmp(a->fvalues[i], b->fvalues[j])) {
+				return TRUE;
+			}
+		}
+	}
+	return FALSE;
+}
 
-	while (list_a) {
-		list_b = df->registers[reg2];
-		while (list_b) {
-			if (cmp((fvalue_t *)list_a->data, (fvalue_t *)list_b->data)) {
+/* any_test() of a field against a 32-bit constant, comparing the values
+ * directly; falls back on cmp for any fvalue that isn't of the
+ * constant's type (a field of the same name, but another type). */
+static gboolean
+any_test_u32(dfilter_t *df, const dfvm_code_t *code, FvalueCmpFunc cmp)
+{
+	df_register_t	*a;
+	fvalue_t	*fv, *constant;
+	guint32		val;
+	guint		i;
+
+	a = &df->registers[code->arg1];
+	constant = df->registers[code->arg2].fvalues[0];
+
+	for (i = 0; i < a->len; i++) {
+		fv = a->fvalues[i];
+		if (fv->ftype != constant->ftype ||
+		    (code->ipv4 && fv->value.ipv4.nmask != 0xFFFFFFFF)) {
+			if (cmp(fv, constant)) {
 				return TRUE;
 			}
-			list_b = g_list_next(list_b);
+			continue;
+		}
+
+		if (code->ipv4)
+			val = fv->value.ipv4.addr;
+		else
+			val = fv->value.uinteger;
+		val = (val & code->mask) ^ code->flip;
+
+		switch (code->op) {
+			case ANY_EQ_U32:
+				if (val == code->value)
+					return TRUE;
+				break;
+			case ANY_NE_U32:
+				if (val != code->value)
+					return TRUE;
+				break;
+			case ANY_GT_U32:
+				if (val > code->value)
+					return TRUE;
+				break;
+			case ANY_GE_U32:
+				if (val >= code->value)
+					return TRUE;
+				break;
+			case ANY_LT_U32:
+				if (val < code->value)
+					return TRUE;
+				break;
+			case ANY_LE_U32:
+				if (val <= code->value)
+					return TRUE;
+				break;
+			default:
+				g_assert_not_reached();
+				break;
 		}
-		list_a = g_list_next(list_a);
 	}
 	return FALSE;
 }
 
 
-/* Free the list nodes w/o freeing the memory that each
- * list node points to. */
+/* Empty the registers for the next run, keeping their storage, but not
+ * the constants. */
 static void
 free_register_overhead(dfilter_t* df)
 {
@@ -381,70 +488,98 @@ free_register_overhead(dfilter_t* df)
 
 	for (i = 0; i < df->num_registers; i++) {
 		df->attempted_load[i] = FALSE;
-		if (df->registers[i]) {
-			g_list_free(df->registers[i]);
-			df->registers[i] = NULL;
-		}
+		df->registers[i].len = 0;
 	}
 }
 
-/* Takes the list of fvalue_t's in a register, uses fvalue_slice()
- * to make a new list of fvalue_t's (which are ranges, or byte-slices),
- * and puts the new list into a new register. */
+/* Takes the fvalue_t's in a register, uses fvalue_slice()
+ * to make new fvalue_t's (which are ranges, or byte-slices),
+ * and puts them into a new register. */
 static void
 mk_range(dfilter_t *df, int from_reg, int to_reg, drange_t *d_range)
 {
-	GList		*from_list, *to_list;
-	fvalue_t	*old_fv, *new_fv;
+	df_register_t	*from, *to;
+	fvalue_t	*new_fv;
+	guint		i;
 
-	to_list = NULL;
-	from_list = df->registers[from_reg];
+	from = &df->registers[from_reg];
+	to = &df->registers[to_reg];
+	to->len = 0;
+	register_reserve(to, from->len);
 
-	while (from_list) {
-		old_fv = (fvalue_t*)from_list->data;
-		new_fv = fvalue_slice(old_fv, d_range);
+	for (i = 0; i < from->len; i++) {
+		new_fv = fvalue_slice(from->fvalues[i], d_range);
 		/* Assert here because semcheck.c should have
 		 * already caught the cases in which a slice
 		 * cannot be made. */
 		g_assert(new_fv);
-		to_list = g_list_append(to_list, new_fv);
-
-		from_list = g_list_next(from_list);
+		to->fvalues[to->len++] = new_fv;
 	}
+}
+
+/* Functions take and return GLists of fvalues; convert a register. */
+static GList *
+register_to_list(const df_register_t *reg)
+{
+	GList	*list = NULL;
+	guint	i;
 
-	df->registers[to_reg] = to_list;
+	for (i = reg->len; i > 0; i--) {
+		list = g_list_prepend(list, reg->fvalues[i - 1]);
+	}
+	return list;
 }
 
+static gboolean
+call_function(dfilter_t *df, const dfvm_code_t *code)
+{
+	GList		*param1 = NULL;
+	GList		*param2 = NULL;
+	GList		*retval = NULL;
+	GList		*l;
+	df_register_t	*to;
+	gboolean	accum;
+
+	if (code->arg3 >= 0) {
+		param1 = register_to_list(&df->registers[code->arg3]);
+	}
+	if (code->arg4 >= 0) {
+		param2 = register_to_list(&df->registers[code->arg4]);
+	}
+	accum = code->ptr.funcdef->function(param1, param2, &retval);
+
+	to = &df->registers[code->arg2];
+	to->len = 0;
+	for (l = retval; l != NULL; l = g_list_next(l)) {
+		register_append(to, (fvalue_t *)l->data);
+	}
+
+	g_list_free(param1);
+	g_list_free(param2);
+	g_list_free(retval);
+	return accum;
+}
 
 
 gboolean
 dfvm_apply(dfilter_t *df, proto_tree *tree)
 {
-	int		id, length;
+	int		id;
 	gboolean	accum = TRUE;
-	dfvm_insn_t	*insn;
-	dfvm_value_t	*arg1;
-	dfvm_value_t	*arg2;
-	dfvm_value_t	*arg3 = NULL;
-	dfvm_value_t	*arg4 = NULL;
+	dfvm_code_t	*code;
 	header_field_info	*hfinfo;
-	GList		*param1;
-	GList		*param2;
 
 	g_assert(tree);
+	g_assert(df->code);
 
-	length = df->insns->len;
-
-	for (id = 0; id < length; id++) {
+	for (id = 0; ; id++) {
 
 	  AGAIN:
-		insn = (dfvm_insn_t	*)g_ptr_array_index(df->insns, id);
-		arg1 = insn->arg1;
-		arg2 = insn->arg2;
+		code = &df->code[id];
 
-		switch (insn->op) {
+		switch (code->op) {
 			case CHECK_EXISTS:
-				hfinfo = arg1->value.hfinfo;
+				hfinfo = code->ptr.hfinfo;
 				while(hfinfo) {
 					accum = proto_check_for_protocol_or_field(tree,
 							hfinfo->id);
@@ -459,74 +594,86 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 
 			case READ_TREE:
 				accum = read_tree(df, tree,
-						arg1->value.hfinfo, arg2->value.numeric);
+						code->ptr.hfinfo, code->arg2);
 				break;
 
 			case CALL_FUNCTION:
-				arg3 = insn->arg3;
-				arg4 = insn->arg4;
-				param1 = NULL;
-				param2 = NULL;
-				if (arg3) {
-					param1 = df->registers[arg3->value.numeric];
-				}
-				if (arg4) {
-					param2 = df->registers[arg4->value.numeric];
-				}
-				accum = arg1->value.funcdef->function(param1, param2,
-						&df->registers[arg2->value.numeric]);
+				accum = call_function(df, code);
 				break;
 
 			case MK_RANGE:
-				arg3 = insn->arg3;
 				mk_range(df,
-						arg1->value.numeric, arg2->value.numeric,
-						arg3->value.drange);
+						code->arg1, code->arg2,
+						code->ptr.drange);
 				break;
 
 			case ANY_EQ:
 				accum = any_test(df, fvalue_eq,
-						arg1->value.numeric, arg2->value.numeric);
+						code->arg1, code->arg2);
 				break;
 
 			case ANY_NE:
 				accum = any_test(df, fvalue_ne,
-						arg1->value.numeric, arg2->value.numeric);
+						code->arg1, code->arg2);
 				break;
 
 			case ANY_GT:
 				accum = any_test(df, fvalue_gt,
-						arg1->value.numeric, arg2->value.numeric);
+						code->arg1, code->arg2);
 				break;
 
 			case ANY_GE:
 				accum = any_test(df, fvalue_ge,
-						arg1->value.numeric, arg2->value.numeric);
+						code->arg1, code->arg2);
 				break;
 
 			case ANY_LT:
 				accum = any_test(df, fvalue_lt,
-						arg1->value.numeric, arg2->value.numeric);
+						code->arg1, code->arg2);
 				break;
 
 			case ANY_LE:
 				accum = any_test(df, fvalue_le,
-						arg1->value.numeric, arg2->value.numeric);
+						code->arg1, code->arg2);
 				break;
 
 			case ANY_BITWISE_AND:
 				accum = any_test(df, fvalue_bitwise_and,
-						arg1->value.numeric, arg2->value.numeric);
+						code->arg1, code->arg2);
 				break;
 
 			case ANY_CONTAINS:
 				accum = any_test(df, fvalue_contains,
-						arg1->value.numeric, arg2->value.numeric);
+						code->arg1, code->arg2);
 				break;
 
 			case ANY_MATCHES:
 				accum = any_test(df, fvalue_matches,
-						arg1->value.numeric, arg2->value.numeric);
+						code->arg1, code->arg2);
+				break;
+
+			case ANY_EQ_U32:
+				accum = any_test_u32(df, code, fvalue_eq);
+				break;
+
+			case ANY_NE_U32:
+				accum = any_test_u32(df, code, fvalue_ne);
+				break;
+
+			case ANY_GT_U32:
+				accum = any_test_u32(df, code, fvalue_gt);
+				break;
+
+			case ANY_GE_U32:
+				accum = any_test_u32(df, code, fvalue_ge);
+				break;
+
+			case ANY_LT_U32:
+				accum = any_test_u32(df, code, fvalue_lt);
+				break;
+
+			case ANY_LE_U32:
+				accum = any_test_u32(df, code, fvalue_le);
 				break;
 
 			case NOT:
@@ -539,26 +686,20 @@ dfvm_apply(dfilter_t *df, proto_tree *tree)
 
 			case IF_TRUE_GOTO:
 				if (accum) {
-					id = arg1->value.numeric;
+					id = code->arg1;
 					goto AGAIN;
 				}
 				break;
 
 			case IF_FALSE_GOTO:
 				if (!accum) {
-					id = arg1->value.numeric;
+					id = code->arg1;
 					goto AGAIN;
 				}
 				break;
 
 			case PUT_FVALUE:
-#if 0
-                                /* These were handled in the constants initialization */
-				accum = put_fvalue(df,
-						arg1->value.fvalue, arg2->value.numeric);
-				break;
-#endif
-
+				/* These were handled in the constants initialization */
 			default:
 				g_assert_not_reached();
 				break;
@@ -603,6 +744,12 @@ dfvm_init_const(dfilter_t *df)
 			case ANY_BITWISE_AND:
 			case ANY_CONTAINS:
 			case ANY_MATCHES:
+			case ANY_EQ_U32:
+			case ANY_NE_U32:
+			case ANY_GT_U32:
+			case ANY_GE_U32:
+			case ANY_LT_U32:
+			case ANY_LE_U32:
 			case NOT:
 			case RETURN:
 			case IF_TRUE_GOTO:
@@ -615,3 +762,100 @@ dfvm_init_const(dfilter_t *df)
 
 	return;
 }
+
+/* Fills in the comparison of a _U32 instruction from its constant. */
+static void
+link_u32(dfilter_t *df, dfvm_code_t *code)
+{
+	fvalue_t	*constant;
+
+	constant = df->registers[code->arg2].fvalues[0];
+
+	code->mask = 0xFFFFFFFF;
+	code->flip = 0;
+	code->ipv4 = FALSE;
+
+	switch (fvalue_type_ftenum(constant)) {
+		case FT_IPv4:
+			/* Only the bits in the constant's netmask count */
+			code->ipv4 = TRUE;
+			code->mask = constant->value.ipv4.nmask;
+			code->value = constant->value.ipv4.addr & code->mask;
+			break;
+
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+			code->flip = 0x80000000;
+			code->value = constant->value.uinteger ^ code->flip;
+			break;
+
+		default:
+			code->value = constant->value.uinteger;
+			break;
+	}
+}
+
+/* Lays the instructions out as dfvm_apply() runs them; the constants
+ * must have been initialized. */
+void
+dfvm_link(dfilter_t *df)
+{
+	guint		id;
+	dfvm_insn_t	*insn;
+	dfvm_code_t	*code;
+
+	df->code = g_new0(dfvm_code_t, df->insns->len);
+
+	for (id = 0; id < df->insns->len; id++) {
+
+		insn = (dfvm_insn_t	*)g_ptr_array_index(df->insns, id);
+		code = &df->code[id];
+
+		code->op = insn->op;
+		code->arg1 = -1;
+		code->arg2 = -1;
+		code->arg3 = insn->arg3 && insn->arg3->type == REGISTER ? (int)insn->arg3->value.numeric : -1;
+		code->arg4 = insn->arg4 && insn->arg4->type == REGISTER ? (int)insn->arg4->value.numeric : -1;
+
+		if (insn->arg1) {
+			switch (insn->arg1->type) {
+				case HFINFO:
+					code->ptr.hfinfo = insn->arg1->value.hfinfo;
+					break;
+				case FUNCTION_DEF:
+					code->ptr.funcdef = insn->arg1->value.funcdef;
+					break;
+				case REGISTER:
+				case INSN_NUMBER:
+					code->arg1 = insn->arg1->value.numeric;
+					break;
+				default:
+					g_assert_not_reached();
+					break;
+			}
+		}
+		if (insn->arg2) {
+			g_assert(insn->arg2->type == REGISTER);
+			code->arg2 = insn->arg2->value.numeric;
+		}
+		if (insn->op == MK_RANGE) {
+			code->ptr.drange = insn->arg3->value.drange;
+			code->arg3 = -1;
+		}
+
+		switch (insn->op) {
+			case ANY_EQ_U32:
+			case ANY_NE_U32:
+			case ANY_GT_U32:
+			case ANY_GE_U32:
+			case ANY_LT_U32:
+			case ANY_LE_U32:
+				link_u32(df, code);
+				break;
+			default:
+				break;
+		}
+	}
+}
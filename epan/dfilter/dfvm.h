@@ -74,7 +74,16 @@ typedef enum {
 	ANY_CONTAINS,
 	ANY_MATCHES,
 	MK_RANGE,
-    CALL_FUNCTION
+    CALL_FUNCTION,
+
+	/* A field against a constant, both of a type whose values
+	 * fit in 32 bits (integers and IPv4 addresses); see dfvm_code_t */
+	ANY_EQ_U32,
+	ANY_NE_U32,
+	ANY_GT_U32,
+	ANY_GE_U32,
+	ANY_LT_U32,
+	ANY_LE_U32
 
 } dfvm_opcode_t;
 
@@ -87,6 +96,29 @@ typedef struct {
 	dfvm_value_t	*arg4;
 } dfvm_insn_t;
 
+/* An instruction as run by dfvm_apply(): laid out in one array, with the
+ * operands in place rather than behind dfvm_value_t pointers. */
+typedef struct _dfvm_code {
+	dfvm_opcode_t	op;
+	int		arg1;	/* register or instruction number */
+	int		arg2;	/* register */
+	int		arg3;	/* register, or -1 */
+	int		arg4;	/* register, or -1 */
+	union {
+		header_field_info	*hfinfo;
+		drange_t		*drange;
+		df_func_def_t		*funcdef;
+	} ptr;
+
+	/* For the _U32 comparisons: the field's value is ANDed with mask
+	 * and XORed with flip (to compare signed values as unsigned), then
+	 * compared to value, which is the constant in arg2 so treated. */
+	guint32		value;
+	guint32		mask;
+	guint32		flip;
+	gboolean	ipv4;
+} dfvm_code_t;
+
 dfvm_insn_t*
 dfvm_insn_new(dfvm_opcode_t op);
 
@@ -105,4 +137,7 @@ dfvm_apply(dfilter_t *df, proto_tree *tree);
 void
 dfvm_init_const(dfilter_t *df);
 
+void
+dfvm_link(dfilter_t *df);
+
 #endif
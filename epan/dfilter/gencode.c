@@ -246,6 +246,50 @@ dfw_append_function(dfwork_t *dfw, stnode_t *node, dfvm_value_t **p_jmp)
 }
 
 
+/* A field compared to a constant of a type that fits in 32 bits is done
+ * without going through the fvalue functions; see dfvm_code_t. */
+static dfvm_opcode_t
+specialize_relation(dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
+{
+	if (stnode_type_id(st_arg1) != STTYPE_FIELD ||
+	    stnode_type_id(st_arg2) != STTYPE_FVALUE)
+		return op;
+
+	switch (fvalue_type_ftenum((fvalue_t *)stnode_data(st_arg2))) {
+		case FT_UINT8:
+		case FT_UINT16:
+		case FT_UINT24:
+		case FT_UINT32:
+		case FT_INT8:
+		case FT_INT16:
+		case FT_INT24:
+		case FT_INT32:
+		case FT_IPXNET:
+		case FT_FRAMENUM:
+		case FT_IPv4:
+			break;
+		default:
+			return op;
+	}
+
+	switch (op) {
+		case ANY_EQ:
+			return ANY_EQ_U32;
+		case ANY_NE:
+			return ANY_NE_U32;
+		case ANY_GT:
+			return ANY_GT_U32;
+		case ANY_GE:
+			return ANY_GE_U32;
+		case ANY_LT:
+			return ANY_LT_U32;
+		case ANY_LE:
+			return ANY_LE_U32;
+		default:
+			return op;
+	}
+}
+
 static void
 gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_arg2)
 {
@@ -259,7 +303,7 @@ gen_relation(dfwork_t *dfw, dfvm_opcode_t op, stnode_t *st_arg1, stnode_t *st_ar
     reg2 = gen_entity(dfw, st_arg2, &jmp2);
 
     /* Then combine them in a DFVM insruction */
-	insn = dfvm_insn_new(op);
+	insn = dfvm_insn_new(specialize_relation(op, st_arg1, st_arg2));
 	val1 = dfvm_value_new(REGISTER);
 	val1->value.numeric = reg1;
 	val2 = dfvm_value_new(REGISTER);
@@ -3,8 +3,17 @@
  * Copyright 2011, Christian Svensson <blue@cmd.nu>
  * Bitcoin address: 15Y2EN5mLnsTt3CZBfgpnZR5SeLwu7WEHz
  *
+ * Litecoin, Dogecoin, Namecoin, Ppcoin, Primecoin, Quarkcoin and BitShares
+ * support
+ * Copyright 2014, arowser <arowser@gmail.com>
+ *
  * See https://en.bitcoin.it/wiki/Protocol_specification
  *
+ * All of the supported networks speak the Bitcoin wire protocol and
+ * differ only in their message start ("magic") values; they are described
+ * by the coin_networks[] table below and share a single set of message
+ * dissectors and fields.
+ *
  * $Id$
  *
  * Wireshark - Network traffic analyzer
@@ -36,18 +45,157 @@
 #include <epan/exceptions.h>
 #include <epan/prefs.h>
 #include <epan/expert.h>
+#include <epan/tap.h>
+#include <epan/stats_tree.h>
+#include <epan/to_str.h>
+
+#include <wsutil/pint.h>
+#include <wsutil/sha2.h>
 
 #include "packet-tcp.h"
+#include "packet-bitcoin.h"
 
 #define BITCOIN_MAIN_MAGIC_NUMBER       0xD9B4BEF9
 #define BITCOIN_TESTNET_MAGIC_NUMBER    0xDAB5BFFA
 #define BITCOIN_TESTNET3_MAGIC_NUMBER   0x0709110B
 
+#define LITECOIN_MAIN_MAGIC_NUMBER      0xDBB6C0FB
+#define LITECOIN_TESTNET_MAGIC_NUMBER   0xDCB7C1FC
+
+#define DOGECOIN_MAIN_MAGIC_NUMBER      0xC0C0C0C0
+#define DOGECOIN_TESTNET_MAGIC_NUMBER   0xDCB7C1FC
+
+#define NAMECOIN_MAIN_MAGIC_NUMBER      0xD9B4BEF9
+#define NAMECOIN_TESTNET_MAGIC_NUMBER   0xDAB5BFFA
+
+#define PPCOIN_MAIN_MAGIC_NUMBER        0xE5E9E8E6
+#define PPCOIN_TESTNET_MAGIC_NUMBER     0xEFC0F2CB
+
+#define PRIMECOIN_MAIN_MAGIC_NUMBER     0xE7E5E7E4
+#define PRIMECOIN_TESTNET_MAGIC_NUMBER  0xC3CBFEFB
+
+#define QUARKCOIN_MAIN_MAGIC_NUMBER     0xDD03A5FE
+#define QUARKCOIN_TESTNET_MAGIC_NUMBER  0xF7391A01
+
+#define BITSHARES_MAIN_MAGIC_NUMBER     0xD9B5BDF9
+#define BITSHARES_TESTNET_MAGIC_NUMBER  0xDAB5BFFA
+
+#define COIN_MAX_MAGIC_NUMBERS          3
+
+/*
+ * Every network has a dissector of its own, for its ports and "Decode As",
+ * which passes its coin_networks[] entry on to the shared code: the
+ * network is the one the traffic was handed to, as some networks share
+ * magic numbers (Namecoin and the BitShares testnet reuse Bitcoin's, and
+ * the Litecoin and Dogecoin testnets are identical).  There's a single
+ * heuristic for all of them, which looks the magic number up in
+ * coin_magic_table.
+ */
+#define COIN_NETWORK_DECLARE(net) \
+  static int dissect_##net(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data)
+
+COIN_NETWORK_DECLARE(bitcoin);
+COIN_NETWORK_DECLARE(litecoin);
+COIN_NETWORK_DECLARE(dogecoin);
+COIN_NETWORK_DECLARE(namecoin);
+COIN_NETWORK_DECLARE(ppcoin);
+COIN_NETWORK_DECLARE(primecoin);
+COIN_NETWORK_DECLARE(quarkcoin);
+COIN_NETWORK_DECLARE(bitshares);
+
+/*
+ * Description of one network speaking the Bitcoin wire protocol.
+ *
+ * Every network gets its own protocol (so it can be enabled/disabled and
+ * selected with "Decode As" on its own) but the message fields are shared
+ * and registered under "bitcoin"; the fields the other networks used to
+ * have are aliases for them.
+ *
+ * Networks have no TCP ports by default, they're found by the heuristic
+ * or "Decode As", or given ports with their "tcp.ports" preference.
+ */
+typedef struct _coin_network {
+  const gchar        *name;          /* protocol long name */
+  const gchar        *short_name;    /* protocol short name and column text */
+  const gchar        *filter_name;   /* protocol filter name */
+  guint32             magic[COIN_MAX_MAGIC_NUMBERS];  /* 0-terminated */
+  new_dissector_t     dissector;
+
+  /* filled in at registration time */
+  int                 proto;
+  header_field_info  *hfi;
+  dissector_handle_t  handle;
+  range_t            *tcp_range;              /* "tcp.ports" preference */
+  range_t            *tcp_range_registered;   /* ports in the "tcp.port" table */
+} coin_network_t;
+
+static coin_network_t coin_networks[] =
+{
+  { "Bitcoin protocol",   "Bitcoin",   "bitcoin",
+    { BITCOIN_MAIN_MAGIC_NUMBER,   BITCOIN_TESTNET_MAGIC_NUMBER, BITCOIN_TESTNET3_MAGIC_NUMBER },
+    dissect_bitcoin,   -1, NULL, NULL, NULL, NULL },
+  { "Litecoin protocol",  "Litecoin",  "litecoin",
+    { LITECOIN_MAIN_MAGIC_NUMBER,  LITECOIN_TESTNET_MAGIC_NUMBER,  0 },
+    dissect_litecoin,  -1, NULL, NULL, NULL, NULL },
+  { "Dogecoin protocol",  "Dogecoin",  "dogecoin",
+    { DOGECOIN_MAIN_MAGIC_NUMBER,  DOGECOIN_TESTNET_MAGIC_NUMBER,  0 },
+    dissect_dogecoin,  -1, NULL, NULL, NULL, NULL },
+  { "Namecoin protocol",  "Namecoin",  "namecoin",
+    { NAMECOIN_MAIN_MAGIC_NUMBER,  NAMECOIN_TESTNET_MAGIC_NUMBER,  0 },
+    dissect_namecoin,  -1, NULL, NULL, NULL, NULL },
+  { "Ppcoin protocol",    "Ppcoin",    "ppcoin",
+    { PPCOIN_MAIN_MAGIC_NUMBER,    PPCOIN_TESTNET_MAGIC_NUMBER,    0 },
+    dissect_ppcoin,    -1, NULL, NULL, NULL, NULL },
+  { "Primecoin protocol", "Primecoin", "primecoin",
+    { PRIMECOIN_MAIN_MAGIC_NUMBER, PRIMECOIN_TESTNET_MAGIC_NUMBER, 0 },
+    dissect_primecoin, -1, NULL, NULL, NULL, NULL },
+  { "Quarkcoin protocol", "Quarkcoin", "quarkcoin",
+    { QUARKCOIN_MAIN_MAGIC_NUMBER, QUARKCOIN_TESTNET_MAGIC_NUMBER, 0 },
+    dissect_quarkcoin, -1, NULL, NULL, NULL, NULL },
+  { "BitShares protocol", "BitShares", "bitshares",
+    { BITSHARES_MAIN_MAGIC_NUMBER, BITSHARES_TESTNET_MAGIC_NUMBER, 0 },
+    dissect_bitshares, -1, NULL, NULL, NULL, NULL },
+};
+
+/* The network the shared fields, expert infos and preferences are registered under */
+#define COIN_DEFAULT_NETWORK (&coin_networks[0])
+
+/*
+ * Magic number -> GSList of the coin_networks[] entries with it, in table
+ * order; the heuristic takes the first of them that's enabled.  The
+ * heuristic is registered under a protocol of its own, so that it isn't
+ * tied to any one network being enabled.
+ */
+static GHashTable *coin_magic_table = NULL;
+static int proto_coin = -1;
+
 static const value_string inv_types[] =
 {
   { 0, "ERROR" },
   { 1, "MSG_TX" },
   { 2, "MSG_BLOCK" },
+  { 3, "MSG_FILTERED_BLOCK" },
+  { 0, NULL }
+};
+
+static const value_string filterload_nflags[] =
+{
+  { 0, "BLOOM_UPDATE_NONE" },
+  { 1, "BLOOM_UPDATE_ALL" },
+  { 2, "BLOOM_UPDATE_P2PUBKEY_ONLY" },
+  { 0, NULL }
+};
+
+static const value_string reject_ccode[] =
+{
+  { 0x01, "REJECT_MALFORMED" },
+  { 0x10, "REJECT_INVALID" },
+  { 0x11, "REJECT_OBSOLETE" },
+  { 0x12, "REJECT_DUPLICATE" },
+  { 0x40, "REJECT_NONSTANDARD" },
+  { 0x41, "REJECT_DUST" },
+  { 0x42, "REJECT_INSUFFICIENTFEE" },
+  { 0x43, "REJECT_CHECKPOINT" },
   { 0, NULL }
 };
 
@@ -63,8 +211,6 @@ static const value_string inv_types[] =
 void proto_register_bitcoin(void);
 void proto_reg_handoff_bitcoin(void);
 
-static dissector_handle_t bitcoin_handle;
-
 static header_field_info *hfi_bitcoin = NULL;
 
 #define BITCOIN_HFI_INIT HFI_INIT(proto_bitcoin)
@@ -81,6 +227,14 @@ static header_field_info hfi_bitcoin_length BITCOIN_HFI_INIT =
 static header_field_info hfi_bitcoin_checksum BITCOIN_HFI_INIT =
   { "Payload checksum", "bitcoin.checksum", FT_UINT32, BASE_HEX, NULL, 0x0, NULL, HFILL };
 
+static header_field_info hfi_bitcoin_checksum_good BITCOIN_HFI_INIT =
+  { "Good Checksum", "bitcoin.checksum_good", FT_BOOLEAN, BASE_NONE, NULL, 0x0,
+    "True: checksum matches payload; False: doesn't match payload or not checked", HFILL };
+
+static header_field_info hfi_bitcoin_checksum_bad BITCOIN_HFI_INIT =
+  { "Bad Checksum", "bitcoin.checksum_bad", FT_BOOLEAN, BASE_NONE, NULL, 0x0,
+    "True: checksum doesn't match payload; False: matches payload or not checked", HFILL };
+
 /* version message */
 static header_field_info hfi_bitcoin_msg_version BITCOIN_HFI_INIT =
   { "Version message", "bitcoin.version", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
@@ -110,16 +264,7 @@ static header_field_info hfi_msg_version_start_height BITCOIN_HFI_INIT =
   { "Block start height", "bitcoin.version.start_height", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 /* addr message */
-static header_field_info hfi_msg_addr_count8 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.addr.count", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_addr_count16 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.addr.count", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_addr_count32 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.addr.count", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_addr_count64 BITCOIN_HFI_INIT =
+static header_field_info hfi_msg_addr_count BITCOIN_HFI_INIT =
   { "Count", "bitcoin.addr.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_bitcoin_msg_addr BITCOIN_HFI_INIT =
@@ -132,16 +277,7 @@ static header_field_info hfi_msg_addr_timestamp BITCOIN_HFI_INIT =
   { "Address timestamp", "bitcoin.addr.timestamp", FT_ABSOLUTE_TIME, ABSOLUTE_TIME_LOCAL, NULL, 0x0, NULL, HFILL };
 
 /* inv message */
-static header_field_info hfi_msg_inv_count8 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.inv.count", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_inv_count16 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.inv.count", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_inv_count32 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.inv.count", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_inv_count64 BITCOIN_HFI_INIT =
+static header_field_info hfi_msg_inv_count BITCOIN_HFI_INIT =
   { "Count", "bitcoin.inv.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_bitcoin_msg_inv BITCOIN_HFI_INIT =
@@ -153,17 +289,12 @@ static header_field_info hfi_msg_inv_type BITCOIN_HFI_INIT =
 static header_field_info hfi_msg_inv_hash BITCOIN_HFI_INIT =
   { "Data hash", "bitcoin.inv.hash", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
 
-/* getdata message */
-static header_field_info hfi_msg_getdata_count8 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.getdata.count", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_getdata_count16 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.getdata.count", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
+static header_field_info hfi_msg_inv_data_frame BITCOIN_HFI_INIT =
+  { "Data in frame", "bitcoin.inv.data_frame", FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+    "The frame carrying the transaction or block", HFILL };
 
-static header_field_info hfi_msg_getdata_count32 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.getdata.count", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_getdata_count64 BITCOIN_HFI_INIT =
+/* getdata message */
+static header_field_info hfi_msg_getdata_count BITCOIN_HFI_INIT =
   { "Count", "bitcoin.getdata.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_bitcoin_msg_getdata BITCOIN_HFI_INIT =
@@ -176,16 +307,7 @@ static header_field_info hfi_msg_getdata_hash BITCOIN_HFI_INIT =
   { "Data hash", "bitcoin.getdata.hash", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
 
 /* getblocks message */
-static header_field_info hfi_msg_getblocks_count8 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.getblocks.count", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_getblocks_count16 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.getblocks.count", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_getblocks_count32 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.getblocks.count", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_getblocks_count64 BITCOIN_HFI_INIT =
+static header_field_info hfi_msg_getblocks_count BITCOIN_HFI_INIT =
   { "Count", "bitcoin.getblocks.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_bitcoin_msg_getblocks BITCOIN_HFI_INIT =
@@ -198,16 +320,7 @@ static header_field_info hfi_msg_getblocks_stop BITCOIN_HFI_INIT =
   { "Stopping hash", "bitcoin.getblocks.hash_stop", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
 
 /* getheaders message */
-static header_field_info hfi_msg_getheaders_count8 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.getheaders.count", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_getheaders_count16 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.getheaders.count", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_getheaders_count32 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.getheaders.count", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_getheaders_count64 BITCOIN_HFI_INIT =
+static header_field_info hfi_msg_getheaders_count BITCOIN_HFI_INIT =
   { "Count", "bitcoin.getheaders.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_bitcoin_msg_getheaders BITCOIN_HFI_INIT =
@@ -220,34 +333,20 @@ static header_field_info hfi_msg_getheaders_stop BITCOIN_HFI_INIT =
   { "Stopping hash", "bitcoin.getheaders.hash_stop", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
 
 /* tx message */
-static header_field_info hfi_msg_tx_in_count8 BITCOIN_HFI_INIT =
-  { "Input Count", "bitcoin.tx.input_count", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_in_count16 BITCOIN_HFI_INIT =
-  { "Input Count", "bitcoin.tx.input_count", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_in_count32 BITCOIN_HFI_INIT =
-  { "Input Count", "bitcoin.tx.input_count", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_in_count64 BITCOIN_HFI_INIT =
+static header_field_info hfi_msg_tx_in_count BITCOIN_HFI_INIT =
   { "Input Count", "bitcoin.tx.input_count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_bitcoin_msg_tx BITCOIN_HFI_INIT =
   { "Tx message", "bitcoin.tx", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
 
+static header_field_info hfi_msg_tx_txid BITCOIN_HFI_INIT =
+  { "Transaction ID", "bitcoin.tx.txid", FT_BYTES, BASE_NONE, NULL, 0x0,
+    "Double SHA-256 of the transaction, in wire (inv) byte order", HFILL };
+
 static header_field_info hfi_msg_tx_version BITCOIN_HFI_INIT =
   { "Transaction version", "bitcoin.tx.version", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
-static header_field_info hfi_msg_tx_in_script8 BITCOIN_HFI_INIT =
-  { "Script Length", "bitcoin.tx.in.script_length", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_in_script16 BITCOIN_HFI_INIT =
-  { "Script Length", "bitcoin.tx.in.script_length", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_in_script32 BITCOIN_HFI_INIT =
-  { "Script Length", "bitcoin.tx.in.script_length", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_in_script64 BITCOIN_HFI_INIT =
+static header_field_info hfi_msg_tx_in_script_length BITCOIN_HFI_INIT =
   { "Script Length", "bitcoin.tx.in.script_length", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_msg_tx_in BITCOIN_HFI_INIT =
@@ -259,6 +358,10 @@ static header_field_info hfi_msg_tx_in_prev_output BITCOIN_HFI_INIT =
 static header_field_info hfi_msg_tx_in_prev_outp_hash BITCOIN_HFI_INIT =
   { "Hash", "bitcoin.tx.in.prev_output.hash", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
 
+static header_field_info hfi_msg_tx_in_prev_outp_frame BITCOIN_HFI_INIT =
+  { "Previous transaction in frame", "bitcoin.tx.in.prev_output.frame", FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+    "The frame carrying the transaction whose output is spent", HFILL };
+
 static header_field_info hfi_msg_tx_in_prev_outp_index BITCOIN_HFI_INIT =
   { "Index", "bitcoin.tx.in.prev_output.index", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
@@ -268,16 +371,7 @@ static header_field_info hfi_msg_tx_in_sig_script BITCOIN_HFI_INIT =
 static header_field_info hfi_msg_tx_in_seq BITCOIN_HFI_INIT =
   { "Sequence", "bitcoin.tx.in.seq", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
-static header_field_info hfi_msg_tx_out_count8 BITCOIN_HFI_INIT =
-  { "Output Count", "bitcoin.tx.output_count", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_out_count16 BITCOIN_HFI_INIT =
-  { "Output Count", "bitcoin.tx.output_count", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_out_count32 BITCOIN_HFI_INIT =
-  { "Output Count", "bitcoin.tx.output_count", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_out_count64 BITCOIN_HFI_INIT =
+static header_field_info hfi_msg_tx_out_count BITCOIN_HFI_INIT =
   { "Output Count", "bitcoin.tx.output_count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_msg_tx_out BITCOIN_HFI_INIT =
@@ -286,16 +380,7 @@ static header_field_info hfi_msg_tx_out BITCOIN_HFI_INIT =
 static header_field_info hfi_msg_tx_out_value BITCOIN_HFI_INIT =
   { "Value", "bitcoin.tx.out.value", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
-static header_field_info hfi_msg_tx_out_script8 BITCOIN_HFI_INIT =
-  { "Script Length", "bitcoin.tx.out.script_length", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_out_script16 BITCOIN_HFI_INIT =
-  { "Script Length", "bitcoin.tx.out.script_length", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_out_script32 BITCOIN_HFI_INIT =
-  { "Script Length", "bitcoin.tx.out.script_length", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_tx_out_script64 BITCOIN_HFI_INIT =
+static header_field_info hfi_msg_tx_out_script_length BITCOIN_HFI_INIT =
   { "Script Length", "bitcoin.tx.out.script_length", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_msg_tx_out_script BITCOIN_HFI_INIT =
@@ -305,21 +390,16 @@ static header_field_info hfi_msg_tx_lock_time BITCOIN_HFI_INIT =
   { "Block lock time or block ID", "bitcoin.tx.lock_time", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 /* block message */
-static header_field_info hfi_msg_block_transactions8 BITCOIN_HFI_INIT =
-  { "Number of transactions", "bitcoin.block.num_transactions", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_block_transactions16 BITCOIN_HFI_INIT =
-  { "Number of transactions", "bitcoin.tx.num_transactions", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_block_transactions32 BITCOIN_HFI_INIT =
-  { "Number of transactions", "bitcoin.tx.num_transactions", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
-
-static header_field_info hfi_msg_block_transactions64 BITCOIN_HFI_INIT =
+static header_field_info hfi_msg_block_transactions BITCOIN_HFI_INIT =
   { "Number of transactions", "bitcoin.tx.num_transactions", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
 static header_field_info hfi_bitcoin_msg_block BITCOIN_HFI_INIT =
   { "Block message", "bitcoin.block", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
 
+static header_field_info hfi_msg_block_hash BITCOIN_HFI_INIT =
+  { "Block hash", "bitcoin.block.hash", FT_BYTES, BASE_NONE, NULL, 0x0,
+    "Double SHA-256 of the block header, in wire (inv) byte order", HFILL };
+
 static header_field_info hfi_msg_block_version BITCOIN_HFI_INIT =
   { "Block version", "bitcoin.block.version", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
@@ -338,6 +418,187 @@ static header_field_info hfi_msg_block_bits BITCOIN_HFI_INIT =
 static header_field_info hfi_msg_block_nonce BITCOIN_HFI_INIT =
   { "Nonce", "bitcoin.block.nonce", FT_UINT32, BASE_HEX, NULL, 0x0, NULL, HFILL };
 
+/* headers message */
+static header_field_info hfi_msg_headers_count BITCOIN_HFI_INIT =
+  { "Count", "bitcoin.headers.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_bitcoin_msg_headers BITCOIN_HFI_INIT =
+  { "Headers message", "bitcoin.headers", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_headers_header BITCOIN_HFI_INIT =
+  { "Block header", "bitcoin.headers.header", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_headers_version BITCOIN_HFI_INIT =
+  { "Block version", "bitcoin.headers.version", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_headers_prev_block BITCOIN_HFI_INIT =
+  { "Previous block", "bitcoin.headers.prev_block", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_headers_merkle_root BITCOIN_HFI_INIT =
+  { "Merkle root", "bitcoin.headers.merkle_root", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_headers_time BITCOIN_HFI_INIT =
+  { "Block timestamp", "bitcoin.headers.timestamp", FT_ABSOLUTE_TIME, ABSOLUTE_TIME_LOCAL, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_headers_bits BITCOIN_HFI_INIT =
+  { "Bits", "bitcoin.headers.bits", FT_UINT32, BASE_HEX, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_headers_nonce BITCOIN_HFI_INIT =
+  { "Nonce", "bitcoin.headers.nonce", FT_UINT32, BASE_HEX, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_headers_transactions BITCOIN_HFI_INIT =
+  { "Number of transactions", "bitcoin.headers.num_transactions", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+/* notfound message */
+static header_field_info hfi_msg_notfound_count BITCOIN_HFI_INIT =
+  { "Count", "bitcoin.notfound.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_bitcoin_msg_notfound BITCOIN_HFI_INIT =
+  { "Notfound message", "bitcoin.notfound", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_notfound_type BITCOIN_HFI_INIT =
+  { "Type", "bitcoin.notfound.type", FT_UINT32, BASE_DEC, VALS(inv_types), 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_notfound_hash BITCOIN_HFI_INIT =
+  { "Data hash", "bitcoin.notfound.hash", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+/* merkleblock message */
+static header_field_info hfi_bitcoin_msg_merkleblock BITCOIN_HFI_INIT =
+  { "Merkleblock message", "bitcoin.merkleblock", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_merkleblock_version BITCOIN_HFI_INIT =
+  { "Block version", "bitcoin.merkleblock.version", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_merkleblock_prev_block BITCOIN_HFI_INIT =
+  { "Previous block", "bitcoin.merkleblock.prev_block", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_merkleblock_merkle_root BITCOIN_HFI_INIT =
+  { "Merkle root", "bitcoin.merkleblock.merkle_root", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_merkleblock_time BITCOIN_HFI_INIT =
+  { "Block timestamp", "bitcoin.merkleblock.timestamp", FT_ABSOLUTE_TIME, ABSOLUTE_TIME_LOCAL, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_merkleblock_bits BITCOIN_HFI_INIT =
+  { "Bits", "bitcoin.merkleblock.bits", FT_UINT32, BASE_HEX, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_merkleblock_nonce BITCOIN_HFI_INIT =
+  { "Nonce", "bitcoin.merkleblock.nonce", FT_UINT32, BASE_HEX, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_merkleblock_transactions BITCOIN_HFI_INIT =
+  { "Number of transactions", "bitcoin.merkleblock.num_transactions", FT_UINT32, BASE_DEC, NULL, 0x0, "Number of transactions in the block", HFILL };
+
+static header_field_info hfi_msg_merkleblock_hashes_count BITCOIN_HFI_INIT =
+  { "Count", "bitcoin.merkleblock.hashes.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_merkleblock_hashes_hash BITCOIN_HFI_INIT =
+  { "Hash", "bitcoin.merkleblock.hashes.hash", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_merkleblock_flags BITCOIN_HFI_INIT =
+  { "Flags", "bitcoin.merkleblock.flags", FT_NONE, BASE_NONE, NULL, 0x0, "Bits selecting the hashes of the partial merkle tree", HFILL };
+
+/* filterload message */
+static header_field_info hfi_bitcoin_msg_filterload BITCOIN_HFI_INIT =
+  { "Filterload message", "bitcoin.filterload", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_filterload_filter BITCOIN_HFI_INIT =
+  { "Filter", "bitcoin.filterload.filter", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_filterload_nhashfunc BITCOIN_HFI_INIT =
+  { "Hash functions", "bitcoin.filterload.nhashfunc", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_filterload_ntweak BITCOIN_HFI_INIT =
+  { "Tweak", "bitcoin.filterload.ntweak", FT_UINT32, BASE_HEX, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_filterload_nflags BITCOIN_HFI_INIT =
+  { "Flags", "bitcoin.filterload.nflags", FT_UINT8, BASE_HEX, VALS(filterload_nflags), 0x0, NULL, HFILL };
+
+/* filteradd message */
+static header_field_info hfi_bitcoin_msg_filteradd BITCOIN_HFI_INIT =
+  { "Filteradd message", "bitcoin.filteradd", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_filteradd_data BITCOIN_HFI_INIT =
+  { "Data", "bitcoin.filteradd.data", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+/* reject message */
+static header_field_info hfi_bitcoin_msg_reject BITCOIN_HFI_INIT =
+  { "Reject message", "bitcoin.reject", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_reject_message BITCOIN_HFI_INIT =
+  { "Message rejected", "bitcoin.reject.message", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_reject_ccode BITCOIN_HFI_INIT =
+  { "Code", "bitcoin.reject.ccode", FT_UINT8, BASE_HEX, VALS(reject_ccode), 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_reject_reason BITCOIN_HFI_INIT =
+  { "Reason", "bitcoin.reject.reason", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_reject_data BITCOIN_HFI_INIT =
+  { "Data", "bitcoin.reject.data", FT_BYTES, BASE_NONE, NULL, 0x0, "Hash of the rejected transaction or block", HFILL };
+
+/* alert message */
+static header_field_info hfi_bitcoin_msg_alert BITCOIN_HFI_INIT =
+  { "Alert message", "bitcoin.alert", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_payload BITCOIN_HFI_INIT =
+  { "Payload", "bitcoin.alert.payload", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_version BITCOIN_HFI_INIT =
+  { "Alert version", "bitcoin.alert.version", FT_INT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_relay_until BITCOIN_HFI_INIT =
+  { "Relay until", "bitcoin.alert.relay_until", FT_ABSOLUTE_TIME, ABSOLUTE_TIME_LOCAL, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_expiration BITCOIN_HFI_INIT =
+  { "Expiration", "bitcoin.alert.expiration", FT_ABSOLUTE_TIME, ABSOLUTE_TIME_LOCAL, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_id BITCOIN_HFI_INIT =
+  { "ID", "bitcoin.alert.id", FT_INT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_cancel BITCOIN_HFI_INIT =
+  { "Cancel", "bitcoin.alert.cancel", FT_INT32, BASE_DEC, NULL, 0x0, "Cancels all alerts with an ID up to this one", HFILL };
+
+static header_field_info hfi_msg_alert_set_cancel_count BITCOIN_HFI_INIT =
+  { "Set cancel count", "bitcoin.alert.set_cancel_count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_set_cancel BITCOIN_HFI_INIT =
+  { "Set cancel", "bitcoin.alert.set_cancel", FT_INT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_min_ver BITCOIN_HFI_INIT =
+  { "Minimum version", "bitcoin.alert.min_ver", FT_INT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_max_ver BITCOIN_HFI_INIT =
+  { "Maximum version", "bitcoin.alert.max_ver", FT_INT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_set_sub_ver_count BITCOIN_HFI_INIT =
+  { "Set sub version count", "bitcoin.alert.set_sub_ver_count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_set_sub_ver BITCOIN_HFI_INIT =
+  { "Sub version", "bitcoin.alert.set_sub_ver", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_priority BITCOIN_HFI_INIT =
+  { "Priority", "bitcoin.alert.priority", FT_INT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_comment BITCOIN_HFI_INIT =
+  { "Comment", "bitcoin.alert.comment", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_status_bar BITCOIN_HFI_INIT =
+  { "Status bar", "bitcoin.alert.status_bar", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_reserved BITCOIN_HFI_INIT =
+  { "Reserved", "bitcoin.alert.reserved", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_msg_alert_signature BITCOIN_HFI_INIT =
+  { "Signature", "bitcoin.alert.signature", FT_NONE, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+/* hash tracking */
+static header_field_info hfi_hash_first_seen BITCOIN_HFI_INIT =
+  { "First seen in frame", "bitcoin.hash.first_seen", FT_FRAMENUM, BASE_NONE, NULL, 0x0,
+    "The first frame announcing or carrying this transaction or block", HFILL };
+
+static header_field_info hfi_hash_delay BITCOIN_HFI_INIT =
+  { "Propagation delay", "bitcoin.hash.delay", FT_RELATIVE_TIME, BASE_NONE, NULL, 0x0,
+    "Time since this transaction or block was first seen", HFILL };
+
 /* services */
 static header_field_info hfi_services_network BITCOIN_HFI_INIT =
   { "Network node", "bitcoin.services.network", FT_BOOLEAN, 32, TFS(&tfs_set_notset), 0x1, NULL, HFILL };
@@ -356,21 +617,51 @@ static header_field_info hfi_address_port BITCOIN_HFI_INIT =
 static header_field_info hfi_string_value BITCOIN_HFI_INIT =
   { "String value", "bitcoin.string.value", FT_STRING, BASE_NONE, NULL, 0x0, NULL, HFILL };
 
-static header_field_info hfi_string_varint_count8 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.string.count", FT_UINT8, BASE_DEC, NULL, 0x0, NULL, HFILL };
+static header_field_info hfi_string_varint_count BITCOIN_HFI_INIT =
+  { "Count", "bitcoin.string.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
 
-static header_field_info hfi_string_varint_count16 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.string.count", FT_UINT16, BASE_DEC, NULL, 0x0, NULL, HFILL };
+/* variable data */
+static header_field_info hfi_data_value BITCOIN_HFI_INIT =
+  { "Data", "bitcoin.data.value", FT_BYTES, BASE_NONE, NULL, 0x0, NULL, HFILL };
+
+static header_field_info hfi_data_varint_count BITCOIN_HFI_INIT =
+  { "Count", "bitcoin.data.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
+
+/* The fields added for the transactions of a block, whose items aren't
+ * built when none of these is needed; the IDs are filled in at registration */
+static header_field_info * const tx_fields[] = {
+  &hfi_bitcoin_msg_tx,
+  &hfi_msg_tx_txid,
+  &hfi_msg_tx_version,
+  &hfi_msg_tx_in_count,
+  &hfi_msg_tx_in,
+  &hfi_msg_tx_in_prev_output,
+  &hfi_msg_tx_in_prev_outp_hash,
+  &hfi_msg_tx_in_prev_outp_frame,
+  &hfi_msg_tx_in_prev_outp_index,
+  &hfi_msg_tx_in_script_length,
+  &hfi_msg_tx_in_sig_script,
+  &hfi_msg_tx_in_seq,
+  &hfi_msg_tx_out_count,
+  &hfi_msg_tx_out,
+  &hfi_msg_tx_out_value,
+  &hfi_msg_tx_out_script_length,
+  &hfi_msg_tx_out_script,
+  &hfi_msg_tx_lock_time,
+  &hfi_hash_first_seen,
+  &hfi_hash_delay,
+};
 
-static header_field_info hfi_string_varint_count32 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.string.count", FT_UINT32, BASE_DEC, NULL, 0x0, NULL, HFILL };
+static int tx_field_ids[array_length(tx_fields)];
 
-static header_field_info hfi_string_varint_count64 BITCOIN_HFI_INIT =
-  { "Count", "bitcoin.string.count", FT_UINT64, BASE_DEC, NULL, 0x0, NULL, HFILL };
+/* The IDs of all the fields, filled in at registration */
+static int *bitcoin_field_ids     = NULL;
+static int  num_bitcoin_field_ids = 0;
 
 
 static gint ett_bitcoin = -1;
 static gint ett_bitcoin_msg = -1;
+static gint ett_bitcoin_checksum = -1;
 static gint ett_services = -1;
 static gint ett_address = -1;
 static gint ett_string = -1;
@@ -382,11 +673,66 @@ static gint ett_getheaders_list = -1;
 static gint ett_tx_in_list = -1;
 static gint ett_tx_in_outp = -1;
 static gint ett_tx_out_list = -1;
+static gint ett_headers_list = -1;
+static gint ett_notfound_list = -1;
+static gint ett_alert_payload = -1;
+static gint ett_data = -1;
 
 static expert_field ei_bitcoin_command_unknown = EI_INIT;
+static expert_field ei_bitcoin_checksum_bad = EI_INIT;
+static expert_field ei_bitcoin_magic_mismatch = EI_INIT;
 
 
+static int bitcoin_tap = -1;
+static int bitcoin_heur_tap = -1;
+
 static gboolean bitcoin_desegment  = TRUE;
+static gboolean bitcoin_check_checksum = FALSE;
+static gboolean bitcoin_track_hashes = FALSE;
+static guint    bitcoin_max_array_items = 100;
+static guint    bitcoin_heur_max_misses = 1000;  /* a full-size block's worth of segments */
+
+/* TRUE if the element at index of an array is to be added to the tree */
+#define BITCOIN_ARRAY_ITEM_SHOWN(index) \
+  (bitcoin_max_array_items == 0 || (index) < bitcoin_max_array_items)
+
+/*
+ * Per-capture index of transactions and blocks, keyed by their hash (as
+ * 8 guint32 words, in wire byte order).  Filled in on the first pass.
+ */
+typedef struct _bitcoin_hash_info {
+  guint32  first_frame;   /* first frame announcing or carrying the object */
+  nstime_t first_ts;
+  guint32  data_frame;    /* first frame carrying the object itself, or 0 */
+} bitcoin_hash_info_t;
+
+static wmem_tree_t *bitcoin_hash_table = NULL;
+
+/*
+ * Per-conversation state of the heuristic, created on the first miss.
+ * Only updated on the first pass.
+ */
+typedef struct _bitcoin_heur_conv {
+  guint32  misses;          /* segments without a known magic number */
+  guint32  gave_up_frame;   /* frame of the miss that used up the allowance, or 0 */
+} bitcoin_heur_conv_t;
+
+/*
+ * The complete messages of a segment, with their payload checksums computed
+ * together before tcp_dissect_pdus() hands the messages over one at a time;
+ * it's the data passed to dissect_bitcoin_tcp_pdu().
+ */
+typedef struct _bitcoin_segment {
+  coin_network_t *network;
+  tvbuff_t       *tvb;
+  guint           num_checked;
+  guint           next;         /* the next one to look at, as they're in order */
+  gint           *offsets;      /* of each message in the segment */
+  guint32        *computed;     /* the checksum of its payload */
+} bitcoin_segment_t;
+
+/* Inventory announcements are also needed for the getdata latency statistics */
+#define BITCOIN_RECORD_INV() (bitcoin_track_hashes || have_tap_listener(bitcoin_tap))
 
 static guint
 get_bitcoin_pdu_length(packet_info *pinfo _U_, tvbuff_t *tvb, int offset)
@@ -400,6 +746,218 @@ get_bitcoin_pdu_length(packet_info *pinfo _U_, tvbuff_t *tvb, int offset)
   return length;
 }
 
+#define BITCOIN_HASH_CHUNK 4096
+
+/**
+ * SHA256(SHA256(data)) of a range of the tvb
+ *
+ * Fed to the hash a chunk at a time, so that a reassembled message made up
+ * of several segments doesn't have to be copied into one buffer first.
+ */
+static void
+bitcoin_sha256d(tvbuff_t *tvb, gint offset, guint32 length, guint8 digest[SHA256_DIGEST_LEN])
+{
+  sha256_context ctx;
+  guint8         chunk[BITCOIN_HASH_CHUNK];
+  guint8         inner[SHA256_DIGEST_LEN];
+  guint32        chunk_len;
+
+  sha256_starts(&ctx);
+  while (length > 0)
+  {
+    chunk_len = MIN(length, BITCOIN_HASH_CHUNK);
+    tvb_memcpy(tvb, chunk, offset, chunk_len);
+    sha256_update(&ctx, chunk, chunk_len);
+    offset += chunk_len;
+    length -= chunk_len;
+  }
+  sha256_finish(&ctx, inner);
+
+  sha256(inner, SHA256_DIGEST_LEN, digest);
+}
+
+/**
+ * Step over the complete message at "*offset" in a segment, if there is one
+ */
+static gboolean
+bitcoin_segment_next_message(tvbuff_t *tvb, gint *offset, guint32 *payload_length)
+{
+  if (!tvb_bytes_exist(tvb, *offset, BITCOIN_HEADER_LENGTH))
+    return FALSE;
+
+  *payload_length = tvb_get_letohl(tvb, *offset + 16);
+  if (*payload_length > (guint32)(G_MAXINT - (BITCOIN_HEADER_LENGTH) - *offset) ||
+      !tvb_bytes_exist(tvb, *offset + BITCOIN_HEADER_LENGTH, (gint)*payload_length))
+    return FALSE;
+
+  return TRUE;
+}
+
+/* Largest payload hashed in a batch; bigger ones are hashed in chunks */
+#define BITCOIN_BATCH_MAX_PAYLOAD (256*1024)
+
+/**
+ * Compute the payload checksums of all the complete messages of a segment
+ *
+ * Payloads that are in one piece are hashed as one batch, so that several
+ * can be hashed at once where the processor can do that.  Large ones, and
+ * ones that straddle the segments of a reassembled message, are hashed in
+ * chunks, so that they don't have to be copied into one buffer first.
+ */
+static void
+bitcoin_segment_check_checksums(bitcoin_segment_t *segment)
+{
+  tvbuff_t       *tvb = segment->tvb;
+  const guint8  **payloads;
+  guint32        *lengths;
+  guint          *batched;
+  guint8        (*digests)[SHA256_DIGEST_LEN];
+  guint8          digest[SHA256_DIGEST_LEN];
+  guint32         payload_length;
+  gint            offset;
+  guint           count;
+  guint           num_batched;
+  guint           i;
+
+  count  = 0;
+  offset = 0;
+  while (bitcoin_segment_next_message(tvb, &offset, &payload_length))
+  {
+    offset += BITCOIN_HEADER_LENGTH + payload_length;
+    count++;
+  }
+  if (count == 0)
+    return;
+
+  segment->offsets  = wmem_alloc_array(wmem_packet_scope(), gint, count);
+  segment->computed = wmem_alloc_array(wmem_packet_scope(), guint32, count);
+  payloads = wmem_alloc_array(wmem_packet_scope(), const guint8 *, count);
+  lengths  = wmem_alloc_array(wmem_packet_scope(), guint32, count);
+  batched  = wmem_alloc_array(wmem_packet_scope(), guint, count);
+  digests  = (guint8 (*)[SHA256_DIGEST_LEN])wmem_alloc(wmem_packet_scope(), count * SHA256_DIGEST_LEN);
+
+  num_batched = 0;
+  offset = 0;
+  for (i = 0; i < count; i++)
+  {
+    bitcoin_segment_next_message(tvb, &offset, &payload_length);
+    segment->offsets[i] = offset;
+    if (payload_length <= BITCOIN_BATCH_MAX_PAYLOAD &&
+        tvb_bytes_are_contiguous(tvb, offset + BITCOIN_HEADER_LENGTH, (gint)payload_length))
+    {
+      payloads[num_batched] = tvb_get_ptr(tvb, offset + BITCOIN_HEADER_LENGTH, (gint)payload_length);
+      lengths[num_batched]  = payload_length;
+      batched[num_batched]  = i;
+      num_batched++;
+    }
+    else
+    {
+      bitcoin_sha256d(tvb, offset + BITCOIN_HEADER_LENGTH, payload_length, digest);
+      segment->computed[i] = pntoh32(digest);
+    }
+    offset += BITCOIN_HEADER_LENGTH + payload_length;
+  }
+
+  if (num_batched > 0)
+  {
+    sha256d_batch(payloads, lengths, num_batched, digests);
+    for (i = 0; i < num_batched; i++)
+      segment->computed[batched[i]] = pntoh32(digests[i]);
+  }
+  segment->num_checked = count;
+}
+
+/**
+ * Look up the checksum of a message computed with the rest of its segment
+ */
+static gboolean
+bitcoin_segment_checksum(bitcoin_segment_t *segment, tvbuff_t *tvb, guint32 *computed)
+{
+  gint offset;
+
+  if (segment->num_checked == 0)
+    return FALSE;
+
+  offset = tvb_raw_offset(tvb) - tvb_raw_offset(segment->tvb);
+  while (segment->next < segment->num_checked && segment->offsets[segment->next] < offset)
+    segment->next++;
+
+  if (segment->next == segment->num_checked || segment->offsets[segment->next] != offset)
+    return FALSE;
+
+  *computed = segment->computed[segment->next];
+  return TRUE;
+}
+
+/**
+ * Add the payload checksum, validating it if requested
+ *
+ * The checksum is the first 4 bytes of SHA256(SHA256(payload)).
+ */
+static void
+dissect_bitcoin_checksum(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
+                         bitcoin_segment_t *segment)
+{
+  proto_item *ti;
+  proto_item *item;
+  proto_tree *checksum_tree;
+  guint32     checksum;
+  guint32     computed = 0;
+  guint32     payload_length;
+  gboolean    checked = FALSE;
+  gboolean    good    = FALSE;
+  guint8      digest[SHA256_DIGEST_LEN];
+
+  checksum = tvb_get_ntohl(tvb, 20);
+
+  if (!bitcoin_check_checksum)
+  {
+    proto_tree_add_uint_format_value(tree, hfi_bitcoin_checksum.id, tvb, 20, 4, checksum,
+                                     "0x%08x [validation disabled]", checksum);
+    return;
+  }
+
+  payload_length = tvb_get_letohl(tvb, 16);
+  if (bitcoin_segment_checksum(segment, tvb, &computed))
+  {
+    checked  = TRUE;
+    good     = (computed == checksum);
+  }
+  else if ((payload_length <= G_MAXINT) &&
+           tvb_bytes_exist(tvb, BITCOIN_HEADER_LENGTH, (gint)payload_length))
+  {
+    bitcoin_sha256d(tvb, BITCOIN_HEADER_LENGTH, payload_length, digest);
+    computed = pntoh32(digest);
+    checked  = TRUE;
+    good     = (computed == checksum);
+  }
+
+  if (!checked)
+  {
+    ti = proto_tree_add_uint_format_value(tree, hfi_bitcoin_checksum.id, tvb, 20, 4, checksum,
+                                          "0x%08x [unchecked, not all data available]", checksum);
+  }
+  else if (good)
+  {
+    ti = proto_tree_add_uint_format_value(tree, hfi_bitcoin_checksum.id, tvb, 20, 4, checksum,
+                                          "0x%08x [correct]", checksum);
+  }
+  else
+  {
+    ti = proto_tree_add_uint_format_value(tree, hfi_bitcoin_checksum.id, tvb, 20, 4, checksum,
+                                          "0x%08x [incorrect, should be 0x%08x]", checksum, computed);
+  }
+
+  checksum_tree = proto_item_add_subtree(ti, ett_bitcoin_checksum);
+  item = proto_tree_add_boolean(checksum_tree, &hfi_bitcoin_checksum_good, tvb, 20, 4, checked && good);
+  PROTO_ITEM_SET_GENERATED(item);
+  item = proto_tree_add_boolean(checksum_tree, &hfi_bitcoin_checksum_bad, tvb, 20, 4, checked && !good);
+  PROTO_ITEM_SET_GENERATED(item);
+
+  if (checked && !good)
+    expert_add_info(pinfo, item, &ei_bitcoin_checksum_bad);
+}
+
 /**
  * Create a services sub-tree for bit-by-bit display
  */
@@ -458,56 +1016,8 @@ create_address_tree(tvbuff_t *tvb, proto_item *ti, guint32 offset)
 static void
 get_varint(tvbuff_t *tvb, const gint offset, gint *length, guint64 *ret)
 {
-  guint value;
-
-  /* Note: just throw an exception if not enough  bytes are available in the tvbuff */
-
-  /* calculate variable length */
-  value = tvb_get_guint8(tvb, offset);
-  if (value < 0xfd)
-  {
-    *length = 1;
-    *ret = value;
-    return;
-  }
-
-  if (value == 0xfd)
-  {
-    *length = 3;
-    *ret = tvb_get_letohs(tvb, offset+1);
-    return;
-  }
-  if (value == 0xfe)
-  {
-    *length = 5;
-    *ret = tvb_get_letohl(tvb, offset+1);
-    return;
-  }
-
-  *length = 9;
-  *ret = tvb_get_letoh64(tvb, offset+1);
-  return;
-
-}
-
-static void add_varint_item(proto_tree *tree, tvbuff_t *tvb, const gint offset, gint length,
-                            header_field_info *hfi8, header_field_info *hfi16, header_field_info *hfi32, header_field_info *hfi64)
-{
-  switch (length)
-  {
-  case 1:
-    proto_tree_add_item(tree, hfi8,  tvb, offset, 1, ENC_LITTLE_ENDIAN);
-    break;
-  case 3:
-    proto_tree_add_item(tree, hfi16, tvb, offset+1, 2, ENC_LITTLE_ENDIAN);
-    break;
-  case 5:
-    proto_tree_add_item(tree, hfi32, tvb, offset+1, 4, ENC_LITTLE_ENDIAN);
-    break;
-  case 9:
-    proto_tree_add_item(tree, hfi64, tvb, offset+1, 8, ENC_LITTLE_ENDIAN);
-    break;
-  }
+  /* Note: just throw an exception if not enough bytes are available in the tvbuff */
+  *length = tvb_get_varint(tvb, offset, FT_VARINT_MAX_LEN, ret, ENC_VARINT_COMPACTSIZE);
 }
 
 static proto_tree *
@@ -527,9 +1037,7 @@ create_string_tree(proto_tree *tree, header_field_info* hfi, tvbuff_t *tvb, guin
   subtree = proto_item_add_subtree(ti, ett_string);
 
   /* length */
-  add_varint_item(subtree, tvb, *offset, varint_length, &hfi_string_varint_count8,
-                  &hfi_string_varint_count16, &hfi_string_varint_count32,
-                  &hfi_string_varint_count64);
+  proto_tree_add_item(subtree, &hfi_string_varint_count, tvb, *offset, varint_length, ENC_VARINT_COMPACTSIZE);
   *offset += varint_length;
 
   /* string */
@@ -540,17 +1048,233 @@ create_string_tree(proto_tree *tree, header_field_info* hfi, tvbuff_t *tvb, guin
   return subtree;
 }
 
-/* Note: A number of the following message handlers include code of the form:
- *          ...
- *          guint64     count;
- *          ...
- *          for (; count > 0; count--)
- *          {
- *            proto_tree_add_item9...);
- *            offset += ...;
- *            proto_tree_add_item9...);
- *            offset += ...;
- *            ...
+static proto_tree *
+create_data_tree(proto_tree *tree, header_field_info* hfi, tvbuff_t *tvb, guint32* offset)
+{
+  proto_tree *subtree;
+  proto_item *ti;
+  gint        varint_length;
+  guint64     varint;
+  gint        data_length;
+
+  /* First is the length of the following data as a varint  */
+  get_varint(tvb, *offset, &varint_length, &varint);
+  data_length = (gint) varint;
+
+  ti = proto_tree_add_item(tree, hfi, tvb, *offset, varint_length + data_length, ENC_NA);
+  subtree = proto_item_add_subtree(ti, ett_data);
+
+  /* length */
+  proto_tree_add_item(subtree, &hfi_data_varint_count, tvb, *offset, varint_length, ENC_VARINT_COMPACTSIZE);
+  *offset += varint_length;
+
+  /* data */
+  proto_tree_add_item(subtree, &hfi_data_value, tvb, *offset, data_length, ENC_NA);
+  *offset += data_length;
+
+  return subtree;
+}
+
+/**
+ * Return the offset past count array elements of element_length bytes
+ */
+static guint32
+skip_array(guint32 offset, guint64 count, guint element_length)
+{
+  if (count > (guint64)(G_MAXINT - offset) / element_length)
+    THROW(ReportedBoundsError);  /* special check since count is guint64 */
+
+  return offset + (guint32)count * element_length;
+}
+
+/**
+ * Add a single item standing for the array elements between offset and end
+ * that are over the display limit
+ */
+static void
+add_array_summary(proto_tree *tree, tvbuff_t *tvb, guint32 offset, guint32 end, guint64 remaining)
+{
+  tvb_ensure_bytes_exist(tvb, offset, end - offset);
+  proto_tree_add_text(tree, tvb, offset, end - offset,
+                      "[%" G_GINT64_MODIFIER "u more elements not shown]", remaining);
+}
+
+static bitcoin_hash_info_t *
+bitcoin_hash_lookup(const guint8 *hash)
+{
+  guint32         key_words[SHA256_DIGEST_LEN / 4];
+  wmem_tree_key_t key[2];
+
+  memcpy(key_words, hash, SHA256_DIGEST_LEN);
+  key[0].length = SHA256_DIGEST_LEN / 4;
+  key[0].key    = key_words;
+  key[1].length = 0;
+  key[1].key    = NULL;
+
+  return (bitcoin_hash_info_t *)wmem_tree_lookup32_array(bitcoin_hash_table, key);
+}
+
+/**
+ * Look up a transaction or block hash, recording it on the first pass
+ */
+static bitcoin_hash_info_t *
+bitcoin_hash_record(packet_info *pinfo, const guint8 *hash, gboolean is_data)
+{
+  bitcoin_hash_info_t *info;
+
+  info = bitcoin_hash_lookup(hash);
+  if (pinfo->fd->flags.visited)
+    return info;
+
+  if (!info)
+  {
+    guint32         key_words[SHA256_DIGEST_LEN / 4];
+    wmem_tree_key_t key[2];
+
+    info = wmem_new0(wmem_file_scope(), bitcoin_hash_info_t);
+    info->first_frame = pinfo->fd->num;
+    info->first_ts    = pinfo->fd->abs_ts;
+
+    memcpy(key_words, hash, SHA256_DIGEST_LEN);
+    key[0].length = SHA256_DIGEST_LEN / 4;
+    key[0].key    = key_words;
+    key[1].length = 0;
+    key[1].key    = NULL;
+    wmem_tree_insert32_array(bitcoin_hash_table, key, info);
+  }
+
+  if (is_data && !info->data_frame)
+    info->data_frame = pinfo->fd->num;
+
+  return info;
+}
+
+static void
+add_hash_info_items(proto_tree *tree, tvbuff_t *tvb, packet_info *pinfo, gint offset, gint length,
+                    const bitcoin_hash_info_t *info)
+{
+  proto_item *ti;
+  nstime_t    delay;
+
+  if (!info)
+    return;
+
+  ti = proto_tree_add_uint(tree, &hfi_hash_first_seen, tvb, offset, length, info->first_frame);
+  PROTO_ITEM_SET_GENERATED(ti);
+
+  nstime_delta(&delay, &pinfo->fd->abs_ts, &info->first_ts);
+  ti = proto_tree_add_time(tree, &hfi_hash_delay, tvb, offset, length, &delay);
+  PROTO_ITEM_SET_GENERATED(ti);
+}
+
+/**
+ * Hash the transaction or block header at offset, record it and add the
+ * hash and its first sighting to the tree
+ */
+static void
+dissect_bitcoin_object_hash(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree,
+                            header_field_info *hfi, gint offset, gint length)
+{
+  proto_item          *ti;
+  bitcoin_hash_info_t *info;
+  guint8               hash[SHA256_DIGEST_LEN];
+
+  if (!bitcoin_track_hashes)
+    return;
+
+  if (!tree && pinfo->fd->flags.visited)
+    return;
+
+  bitcoin_sha256d(tvb, offset, length, hash);
+  info = bitcoin_hash_record(pinfo, hash, TRUE);
+
+  if (!tree)
+    return;
+
+  /* The item covers the hashed data; its value is just the hash */
+  ti = proto_tree_add_bytes(tree, hfi->id, tvb, offset, SHA256_DIGEST_LEN, hash);
+  proto_item_set_len(ti, length);
+  PROTO_ITEM_SET_GENERATED(ti);
+
+  add_hash_info_items(tree, tvb, pinfo, offset, length, info);
+}
+
+/**
+ * Walk the transaction at offset without adding any items and return its
+ * length, accumulating its statistics into stats if it isn't NULL
+ *
+ * Every input and output is at least 9 bytes long and is bounds checked
+ * by the varint read, so bogus counts end in an exception rather than
+ * a long loop.
+ */
+static guint32
+walk_bitcoin_tx(tvbuff_t *tvb, guint32 offset, bitcoin_tap_info_t *stats)
+{
+  guint32 start = offset;
+  gint    count_length;
+  guint64 count;
+  guint64 script_length;
+
+  /* version */
+  offset += 4;
+
+  /* TxIn[] */
+  get_varint(tvb, offset, &count_length, &count);
+  offset += count_length;
+
+  if (stats)
+    stats->in_count += (guint32)count;
+
+  for (; count > 0; count--)
+  {
+    get_varint(tvb, offset+36, &count_length, &script_length);
+    if ((offset + 36 + count_length + script_length + 4) > G_MAXINT)
+      THROW(ReportedBoundsError);  /* special check since script_length is guint64 */
+    offset += 36 + count_length + (guint)script_length + 4;
+
+    if (stats)
+      stats->script_bytes += script_length;
+  }
+
+  /* TxOut[] */
+  get_varint(tvb, offset, &count_length, &count);
+  offset += count_length;
+
+  if (stats)
+    stats->out_count += (guint32)count;
+
+  for (; count > 0; count--)
+  {
+    get_varint(tvb, offset+8, &count_length, &script_length);
+    if ((offset + 8 + count_length + script_length) > G_MAXINT)
+      THROW(ReportedBoundsError);  /* special check since script_length is guint64 */
+
+    if (stats)
+    {
+      stats->out_value    += tvb_get_letoh64(tvb, offset);
+      stats->script_bytes += script_length;
+    }
+
+    offset += 8 + count_length + (guint)script_length;
+  }
+
+  /* lock_time */
+  offset += 4;
+
+  return offset - start;
+}
+
+/* Note: A number of the following message handlers include code of the form:
+ *          ...
+ *          guint64     count;
+ *          ...
+ *          for (; count > 0; count--)
+ *          {
+ *            proto_tree_add_item9...);
+ *            offset += ...;
+ *            proto_tree_add_item9...);
+ *            offset += ...;
+ *            ...
  *          }
  *          ...
  *
@@ -625,6 +1349,7 @@ dissect_bitcoin_msg_addr(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree
   proto_item *ti;
   gint        length;
   guint64     count;
+  guint64     i;
   guint32     offset = 0;
 
   if (!tree)
@@ -634,14 +1359,19 @@ dissect_bitcoin_msg_addr(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree
   tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
 
   get_varint(tvb, offset, &length, &count);
-  add_varint_item(tree, tvb, offset, length, &hfi_msg_addr_count8, &hfi_msg_addr_count16,
-                  &hfi_msg_addr_count32, &hfi_msg_addr_count64);
+  proto_tree_add_item(tree, &hfi_msg_addr_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
   offset += length;
 
-  for (; count > 0; count--)
+  for (i = 0; i < count; i++)
   {
     proto_tree *subtree;
 
+    if (!BITCOIN_ARRAY_ITEM_SHOWN(i))
+    {
+      add_array_summary(tree, tvb, offset, skip_array(offset, count - i, 30), count - i);
+      break;
+    }
+
     ti = proto_tree_add_item(tree, &hfi_msg_addr_address, tvb, offset, 30, ENC_NA);
     subtree = create_address_tree(tvb, ti, offset+4);
 
@@ -651,33 +1381,85 @@ dissect_bitcoin_msg_addr(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree
   }
 }
 
+/**
+ * Add the sighting and data frame of an inventory vector hash
+ */
+static void
+add_inv_hash_items(proto_tree *tree, tvbuff_t *tvb, packet_info *pinfo, gint offset,
+                   const bitcoin_hash_info_t *info)
+{
+  proto_item *ti;
+
+  if (!info)
+    return;
+
+  add_hash_info_items(tree, tvb, pinfo, offset, SHA256_DIGEST_LEN, info);
+
+  if (info->data_frame)
+  {
+    ti = proto_tree_add_uint(tree, &hfi_msg_inv_data_frame, tvb, offset, SHA256_DIGEST_LEN, info->data_frame);
+    PROTO_ITEM_SET_GENERATED(ti);
+  }
+}
+
+/**
+ * Remember the first announcement of each of count inventory vectors at offset
+ */
+static void
+record_inv_hashes(tvbuff_t *tvb, packet_info *pinfo, guint32 offset, guint64 count)
+{
+  guint8 hash[SHA256_DIGEST_LEN];
+
+  for (; count > 0; count--)
+  {
+    tvb_memcpy(tvb, hash, offset+4, SHA256_DIGEST_LEN);
+    bitcoin_hash_record(pinfo, hash, FALSE);
+    offset += 36;
+  }
+}
+
 /**
  * Handler for inventory messages
  */
 static void
-dissect_bitcoin_msg_inv(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
+dissect_bitcoin_msg_inv(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 {
   proto_item *ti;
   gint        length;
   guint64     count;
+  guint64     i;
   guint32     offset = 0;
 
   if (!tree)
+  {
+    if (BITCOIN_RECORD_INV() && !pinfo->fd->flags.visited)
+    {
+      get_varint(tvb, offset, &length, &count);
+      record_inv_hashes(tvb, pinfo, offset + length, count);
+    }
     return;
+  }
 
   ti   = proto_tree_add_item(tree, &hfi_bitcoin_msg_inv, tvb, offset, -1, ENC_NA);
   tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
 
   get_varint(tvb, offset, &length, &count);
-  add_varint_item(tree, tvb, offset, length, &hfi_msg_inv_count8, &hfi_msg_inv_count16,
-                  &hfi_msg_inv_count32, &hfi_msg_inv_count64);
+  proto_tree_add_item(tree, &hfi_msg_inv_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
 
   offset += length;
 
-  for (; count > 0; count--)
+  for (i = 0; i < count; i++)
   {
     proto_tree *subtree;
 
+    if (!BITCOIN_ARRAY_ITEM_SHOWN(i))
+    {
+      if (BITCOIN_RECORD_INV() && !pinfo->fd->flags.visited)
+        record_inv_hashes(tvb, pinfo, offset, count - i);
+      add_array_summary(tree, tvb, offset, skip_array(offset, count - i, 36), count - i);
+      break;
+    }
+
     ti = proto_tree_add_text(tree, tvb, offset, 36, "Inventory vector");
     subtree = proto_item_add_subtree(ti, ett_inv_list);
 
@@ -685,6 +1467,16 @@ dissect_bitcoin_msg_inv(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
     offset += 4;
 
     proto_tree_add_item(subtree, &hfi_msg_inv_hash, tvb, offset, 32, ENC_NA);
+    if (BITCOIN_RECORD_INV())
+    {
+      bitcoin_hash_info_t *info;
+      guint8               hash[SHA256_DIGEST_LEN];
+
+      tvb_memcpy(tvb, hash, offset, SHA256_DIGEST_LEN);
+      info = bitcoin_hash_record(pinfo, hash, FALSE);
+      if (bitcoin_track_hashes)
+        add_inv_hash_items(subtree, tvb, pinfo, offset, info);
+    }
     offset += 32;
   }
 }
@@ -693,11 +1485,12 @@ dissect_bitcoin_msg_inv(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
  * Handler for getdata messages
  */
 static void
-dissect_bitcoin_msg_getdata(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
+dissect_bitcoin_msg_getdata(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 {
   proto_item *ti;
   gint        length;
   guint64     count;
+  guint64     i;
   guint32     offset = 0;
 
   if (!tree)
@@ -707,15 +1500,20 @@ dissect_bitcoin_msg_getdata(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *t
   tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
 
   get_varint(tvb, offset, &length, &count);
-  add_varint_item(tree, tvb, offset, length, &hfi_msg_getdata_count8, &hfi_msg_getdata_count16,
-                  &hfi_msg_getdata_count32, &hfi_msg_getdata_count64);
+  proto_tree_add_item(tree, &hfi_msg_getdata_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
 
   offset += length;
 
-  for (; count > 0; count--)
+  for (i = 0; i < count; i++)
   {
     proto_tree *subtree;
 
+    if (!BITCOIN_ARRAY_ITEM_SHOWN(i))
+    {
+      add_array_summary(tree, tvb, offset, skip_array(offset, count - i, 36), count - i);
+      break;
+    }
+
     ti = proto_tree_add_text(tree, tvb, offset, 36, "Inventory vector");
     subtree = proto_item_add_subtree(ti, ett_getdata_list);
 
@@ -723,6 +1521,13 @@ dissect_bitcoin_msg_getdata(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *t
     offset += 4;
 
     proto_tree_add_item(subtree, &hfi_msg_getdata_hash, tvb, offset, 32, ENC_NA);
+    if (bitcoin_track_hashes)
+    {
+      guint8 hash[SHA256_DIGEST_LEN];
+
+      tvb_memcpy(tvb, hash, offset, SHA256_DIGEST_LEN);
+      add_inv_hash_items(subtree, tvb, pinfo, offset, bitcoin_hash_lookup(hash));
+    }
     offset += 32;
   }
 }
@@ -749,8 +1554,7 @@ dissect_bitcoin_msg_getblocks(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree
   offset += 4;
 
   get_varint(tvb, offset, &length, &count);
-  add_varint_item(tree, tvb, offset, length, &hfi_msg_getblocks_count8, &hfi_msg_getblocks_count16,
-                  &hfi_msg_getblocks_count32, &hfi_msg_getblocks_count64);
+  proto_tree_add_item(tree, &hfi_msg_getblocks_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
 
   offset += length;
 
@@ -782,8 +1586,7 @@ dissect_bitcoin_msg_getheaders(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree
   tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
 
   get_varint(tvb, offset, &length, &count);
-  add_varint_item(tree, tvb, offset, length, &hfi_msg_getheaders_count8, &hfi_msg_getheaders_count16,
-                  &hfi_msg_getheaders_count32, &hfi_msg_getheaders_count64);
+  proto_tree_add_item(tree, &hfi_msg_getheaders_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
 
   offset += length;
 
@@ -801,12 +1604,13 @@ dissect_bitcoin_msg_getheaders(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree
  * Handler for tx message body
  */
 static guint32
-dissect_bitcoin_msg_tx_common(tvbuff_t *tvb, guint32 offset, packet_info *pinfo _U_, proto_tree *tree, guint msgnum)
+dissect_bitcoin_msg_tx_common(tvbuff_t *tvb, guint32 offset, packet_info *pinfo, proto_tree *tree, guint msgnum)
 {
   proto_item *rti;
   gint        count_length;
   guint64     in_count;
   guint64     out_count;
+  guint32     start = offset;
 
   DISSECTOR_ASSERT(tree != NULL);
 
@@ -822,8 +1626,7 @@ dissect_bitcoin_msg_tx_common(tvbuff_t *tvb, guint32 offset, packet_info *pinfo
 
   /* TxIn[] */
   get_varint(tvb, offset, &count_length, &in_count);
-  add_varint_item(tree, tvb, offset, count_length, &hfi_msg_tx_in_count8, &hfi_msg_tx_in_count16,
-                  &hfi_msg_tx_in_count32, &hfi_msg_tx_in_count64);
+  proto_tree_add_item(tree, &hfi_msg_tx_in_count, tvb, offset, count_length, ENC_VARINT_COMPACTSIZE);
 
   offset += count_length;
 
@@ -858,14 +1661,28 @@ dissect_bitcoin_msg_tx_common(tvbuff_t *tvb, guint32 offset, packet_info *pinfo
     prevtree = proto_item_add_subtree(pti, ett_tx_in_outp);
 
     proto_tree_add_item(prevtree, &hfi_msg_tx_in_prev_outp_hash, tvb, offset, 32, ENC_NA);
+    if (bitcoin_track_hashes)
+    {
+      bitcoin_hash_info_t *info;
+      guint8               hash[SHA256_DIGEST_LEN];
+
+      tvb_memcpy(tvb, hash, offset, SHA256_DIGEST_LEN);
+      info = bitcoin_hash_lookup(hash);
+      if (info && info->data_frame)
+      {
+        proto_item *fti;
+
+        fti = proto_tree_add_uint(prevtree, &hfi_msg_tx_in_prev_outp_frame, tvb, offset, 32, info->data_frame);
+        PROTO_ITEM_SET_GENERATED(fti);
+      }
+    }
     offset += 32;
 
     proto_tree_add_item(prevtree, &hfi_msg_tx_in_prev_outp_index, tvb, offset, 4, ENC_LITTLE_ENDIAN);
     offset += 4;
     /* end previous output */
 
-    add_varint_item(subtree, tvb, offset, count_length, &hfi_msg_tx_in_script8, &hfi_msg_tx_in_script16,
-                    &hfi_msg_tx_in_script32, &hfi_msg_tx_in_script64);
+    proto_tree_add_item(subtree, &hfi_msg_tx_in_script_length, tvb, offset, count_length, ENC_VARINT_COMPACTSIZE);
 
     offset += count_length;
 
@@ -881,8 +1698,7 @@ dissect_bitcoin_msg_tx_common(tvbuff_t *tvb, guint32 offset, packet_info *pinfo
 
   /* TxOut[] */
   get_varint(tvb, offset, &count_length, &out_count);
-  add_varint_item(tree, tvb, offset, count_length, &hfi_msg_tx_out_count8, &hfi_msg_tx_out_count16,
-                  &hfi_msg_tx_out_count32, &hfi_msg_tx_out_count64);
+  proto_tree_add_item(tree, &hfi_msg_tx_out_count, tvb, offset, count_length, ENC_VARINT_COMPACTSIZE);
 
   offset += count_length;
 
@@ -907,8 +1723,7 @@ dissect_bitcoin_msg_tx_common(tvbuff_t *tvb, guint32 offset, packet_info *pinfo
     proto_tree_add_item(subtree, &hfi_msg_tx_out_value, tvb, offset, 8, ENC_LITTLE_ENDIAN);
     offset += 8;
 
-    add_varint_item(subtree, tvb, offset, count_length, &hfi_msg_tx_out_script8, &hfi_msg_tx_out_script16,
-                    &hfi_msg_tx_out_script32, &hfi_msg_tx_out_script64);
+    proto_tree_add_item(subtree, &hfi_msg_tx_out_script_length, tvb, offset, count_length, ENC_VARINT_COMPACTSIZE);
 
     offset += count_length;
 
@@ -922,8 +1737,10 @@ dissect_bitcoin_msg_tx_common(tvbuff_t *tvb, guint32 offset, packet_info *pinfo
   proto_tree_add_item(tree, &hfi_msg_tx_lock_time, tvb, offset, 4, ENC_LITTLE_ENDIAN);
   offset += 4;
 
+  dissect_bitcoin_object_hash(tvb, pinfo, tree, &hfi_msg_tx_txid, start, offset - start);
+
   /* needed for block nesting */
-  proto_item_set_len(rti, offset);
+  proto_item_set_len(rti, offset - start);
 
   return offset;
 }
@@ -935,7 +1752,12 @@ static void
 dissect_bitcoin_msg_tx(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 {
   if (!tree)
+  {
+    /* Only the hash is of interest without a tree */
+    if (bitcoin_track_hashes && !pinfo->fd->flags.visited)
+      dissect_bitcoin_object_hash(tvb, pinfo, NULL, &hfi_msg_tx_txid, 0, walk_bitcoin_tx(tvb, 0, NULL));
     return;
+  }
 
   dissect_bitcoin_msg_tx_common(tvb, 0, pinfo, tree, 0);
 }
@@ -955,7 +1777,27 @@ dissect_bitcoin_msg_block(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
   guint32     offset = 0;
 
   if (!tree)
+  {
+    /* Only the hashes are of interest without a tree */
+    if (bitcoin_track_hashes && !pinfo->fd->flags.visited)
+    {
+      dissect_bitcoin_object_hash(tvb, pinfo, NULL, &hfi_msg_block_hash, 0, 80);
+      offset += 80;
+
+      get_varint(tvb, offset, &length, &count);
+      offset += length;
+
+      for (; count > 0; count--)
+      {
+        guint32 tx_length;
+
+        tx_length = walk_bitcoin_tx(tvb, offset, NULL);
+        dissect_bitcoin_object_hash(tvb, pinfo, NULL, &hfi_msg_tx_txid, offset, tx_length);
+        offset += tx_length;
+      }
+    }
     return;
+  }
 
   /*  Block
    *    [ 4] version         uint32_t
@@ -971,6 +1813,8 @@ dissect_bitcoin_msg_block(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
   ti   = proto_tree_add_item(tree, &hfi_bitcoin_msg_block, tvb, offset, -1, ENC_NA);
   tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
 
+  dissect_bitcoin_object_hash(tvb, pinfo, tree, &hfi_msg_block_hash, offset, 80);
+
   proto_tree_add_item(tree, &hfi_msg_block_version,     tvb, offset,  4, ENC_LITTLE_ENDIAN);
   offset += 4;
 
@@ -990,11 +1834,28 @@ dissect_bitcoin_msg_block(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
   offset += 4;
 
   get_varint(tvb, offset, &length, &count);
-  add_varint_item(tree, tvb, offset, length, &hfi_msg_block_transactions8, &hfi_msg_block_transactions16,
-                  &hfi_msg_block_transactions32, &hfi_msg_block_transactions64);
+  proto_tree_add_item(tree, &hfi_msg_block_transactions, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
 
   offset += length;
 
+  /* Blocks can hold thousands of transactions; when the tree isn't
+   * visible and nothing asked for any transaction or hash tracking field,
+   * don't build their items, just keep track of their hashes.
+   */
+  if (!proto_fields_are_referenced(tree, tx_field_ids, array_length(tx_field_ids)))
+  {
+    for (; count > 0; count--)
+    {
+      guint32 tx_length;
+
+      tx_length = walk_bitcoin_tx(tvb, offset, NULL);
+      if (!pinfo->fd->flags.visited)
+        dissect_bitcoin_object_hash(tvb, pinfo, NULL, &hfi_msg_tx_txid, offset, tx_length);
+      offset += tx_length;
+    }
+    return;
+  }
+
   msgnum = 0;
   for (; count > 0; count--)
   {
@@ -1004,138 +1865,916 @@ dissect_bitcoin_msg_block(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree)
 }
 
 /**
- * Handler for unimplemented or payload-less messages
+ * Handler for headers messages
  */
 static void
-dissect_bitcoin_msg_empty(tvbuff_t *tvb _U_, packet_info *pinfo _U_, proto_tree *tree _U_)
-{
-  return;
-}
-
-typedef void (*msg_dissector_func_t)(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree);
-
-typedef struct msg_dissector
-{
-  const gchar *command;
-  msg_dissector_func_t function;
-} msg_dissector_t;
-
-static msg_dissector_t msg_dissectors[] =
-{
-  {"version",     dissect_bitcoin_msg_version},
-  {"addr",        dissect_bitcoin_msg_addr},
-  {"inv",         dissect_bitcoin_msg_inv},
-  {"getdata",     dissect_bitcoin_msg_getdata},
-  {"getblocks",   dissect_bitcoin_msg_getblocks},
-  {"getheaders",  dissect_bitcoin_msg_getheaders},
-  {"tx",          dissect_bitcoin_msg_tx},
-  {"block",       dissect_bitcoin_msg_block},
-
-  /* messages with no payload */
-  {"verack",      dissect_bitcoin_msg_empty},
-  {"getaddr",     dissect_bitcoin_msg_empty},
-  {"ping",        dissect_bitcoin_msg_empty},
-  {"pong",        dissect_bitcoin_msg_empty},
-
-  /* messages not implemented */
-  {"notfound",    dissect_bitcoin_msg_empty},
-  {"headers",     dissect_bitcoin_msg_empty},
-  {"mempool",     dissect_bitcoin_msg_empty},
-  {"checkorder",  dissect_bitcoin_msg_empty},
-  {"submitorder", dissect_bitcoin_msg_empty},
-  {"reply",       dissect_bitcoin_msg_empty},
-  {"filterload",  dissect_bitcoin_msg_empty},
-  {"filteradd",   dissect_bitcoin_msg_empty},
-  {"filterclear", dissect_bitcoin_msg_empty},
-  {"merkleblock", dissect_bitcoin_msg_empty},
-  {"reject",      dissect_bitcoin_msg_empty},
-  {"alert",       dissect_bitcoin_msg_empty}
-};
-
-static int dissect_bitcoin_tcp_pdu(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data _U_)
+dissect_bitcoin_msg_headers(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
 {
   proto_item *ti;
-  guint32     i;
+  gint        length;
+  guint64     count;
+  guint64     i;
   guint32     offset = 0;
 
-  col_set_str(pinfo->cinfo, COL_PROTOCOL, "Bitcoin");
+  if (!tree)
+    return;
 
-  ti   = proto_tree_add_item(tree, hfi_bitcoin, tvb, 0, -1, ENC_NA);
-  tree = proto_item_add_subtree(ti, ett_bitcoin);
+  ti   = proto_tree_add_item(tree, &hfi_bitcoin_msg_headers, tvb, offset, -1, ENC_NA);
+  tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
 
-  /* add basic protocol data */
-  proto_tree_add_item(tree, &hfi_bitcoin_magic,   tvb,  0,  4, ENC_BIG_ENDIAN);
-  proto_tree_add_item(tree, &hfi_bitcoin_command, tvb,  4, 12, ENC_ASCII|ENC_NA);
-  proto_tree_add_item(tree, &hfi_bitcoin_length,  tvb, 16,  4, ENC_LITTLE_ENDIAN);
-  proto_tree_add_item(tree, &hfi_bitcoin_checksum, tvb, 20,  4, ENC_BIG_ENDIAN);
+  get_varint(tvb, offset, &length, &count);
+  proto_tree_add_item(tree, &hfi_msg_headers_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
 
-  offset = 24;
+  offset += length;
 
-  /* handle command specific message part */
-  for (i = 0; i < array_length(msg_dissectors); i++)
+  /*  Header
+   *    [80] block header (as in a block message)
+   *    [1+] txn_count       var_int, always 0
+   */
+  for (i = 0; i < count; i++)
   {
-    if (tvb_memeql(tvb, 4, msg_dissectors[i].command,
-          strlen(msg_dissectors[i].command)) == 0)
-    {
-      tvbuff_t *tvb_sub;
-
-      col_append_sep_str(pinfo->cinfo, COL_INFO, ", ", msg_dissectors[i].command);
+    proto_tree *subtree;
+    gint        txn_length;
+    guint64     txn_count;
 
-      tvb_sub = tvb_new_subset_remaining(tvb, offset);
-      msg_dissectors[i].function(tvb_sub, pinfo, tree);
-      return tvb_length(tvb);
+    if (!BITCOIN_ARRAY_ITEM_SHOWN(i))
+    {
+      guint32 end = offset;
+      guint64 j;
+
+      /* Just step over the rest */
+      for (j = i; j < count; j++)
+      {
+        get_varint(tvb, end + 80, &txn_length, &txn_count);
+        end += 80 + txn_length;
+      }
+      add_array_summary(tree, tvb, offset, end, count - i);
+      break;
     }
-  }
 
-  /* no handler found */
-  col_append_sep_str(pinfo->cinfo, COL_INFO, ", ", "[unknown command]");
+    get_varint(tvb, offset + 80, &txn_length, &txn_count);
 
-  expert_add_info(pinfo, ti, &ei_bitcoin_command_unknown);
-  return tvb_length(tvb);
-}
+    ti = proto_tree_add_item(tree, &hfi_msg_headers_header, tvb, offset, 80 + txn_length, ENC_NA);
+    subtree = proto_item_add_subtree(ti, ett_headers_list);
 
-static int
-dissect_bitcoin(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data)
-{
-  col_clear(pinfo->cinfo, COL_INFO);
-  tcp_dissect_pdus(tvb, pinfo, tree, bitcoin_desegment, BITCOIN_HEADER_LENGTH,
-      get_bitcoin_pdu_length, dissect_bitcoin_tcp_pdu, data);
+    proto_tree_add_item(subtree, &hfi_msg_headers_version,     tvb, offset,  4, ENC_LITTLE_ENDIAN);
+    offset += 4;
 
-  return tvb_reported_length(tvb);
-}
+    proto_tree_add_item(subtree, &hfi_msg_headers_prev_block,  tvb, offset, 32, ENC_NA);
+    offset += 32;
 
-static gboolean
-dissect_bitcoin_heur(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data)
-{
-  guint32 magic_number;
-  conversation_t *conversation;
+    proto_tree_add_item(subtree, &hfi_msg_headers_merkle_root, tvb, offset, 32, ENC_NA);
+    offset += 32;
 
-  if (tvb_length(tvb) < 4)
-      return FALSE;
+    proto_tree_add_item(subtree, &hfi_msg_headers_time,        tvb, offset,  4, ENC_TIME_TIMESPEC|ENC_LITTLE_ENDIAN);
+    offset += 4;
 
-  magic_number = tvb_get_letohl(tvb, 0);
-  if ((magic_number != BITCOIN_MAIN_MAGIC_NUMBER) &&
-      (magic_number != BITCOIN_TESTNET_MAGIC_NUMBER) &&
-      (magic_number != BITCOIN_TESTNET3_MAGIC_NUMBER))
-     return FALSE;
+    proto_tree_add_item(subtree, &hfi_msg_headers_bits,        tvb, offset,  4, ENC_LITTLE_ENDIAN);
+    offset += 4;
 
-  /* Ok: This connection should always use the bitcoin dissector */
-  conversation = find_or_create_conversation(pinfo);
-  conversation_set_dissector(conversation, bitcoin_handle);
+    proto_tree_add_item(subtree, &hfi_msg_headers_nonce,       tvb, offset,  4, ENC_LITTLE_ENDIAN);
+    offset += 4;
 
-  dissect_bitcoin(tvb, pinfo, tree, data);
-  return TRUE;
+    proto_tree_add_item(subtree, &hfi_msg_headers_transactions, tvb, offset, txn_length, ENC_VARINT_COMPACTSIZE);
+    offset += txn_length;
+  }
 }
 
-void
-proto_register_bitcoin(void)
+/**
+ * Handler for notfound messages
+ */
+static void
+dissect_bitcoin_msg_notfound(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
 {
-#ifndef HAVE_HFI_SECTION_INIT
+  proto_item *ti;
+  gint        length;
+  guint64     count;
+  guint64     i;
+  guint32     offset = 0;
+
+  if (!tree)
+    return;
+
+  ti   = proto_tree_add_item(tree, &hfi_bitcoin_msg_notfound, tvb, offset, -1, ENC_NA);
+  tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
+
+  get_varint(tvb, offset, &length, &count);
+  proto_tree_add_item(tree, &hfi_msg_notfound_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
+
+  offset += length;
+
+  for (i = 0; i < count; i++)
+  {
+    proto_tree *subtree;
+
+    if (!BITCOIN_ARRAY_ITEM_SHOWN(i))
+    {
+      add_array_summary(tree, tvb, offset, skip_array(offset, count - i, 36), count - i);
+      break;
+    }
+
+    ti = proto_tree_add_text(tree, tvb, offset, 36, "Inventory vector");
+    subtree = proto_item_add_subtree(ti, ett_notfound_list);
+
+    proto_tree_add_item(subtree, &hfi_msg_notfound_type, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+    offset += 4;
+
+    proto_tree_add_item(subtree, &hfi_msg_notfound_hash, tvb, offset, 32, ENC_NA);
+    offset += 32;
+  }
+}
+
+/**
+ * Handler for merkleblock messages
+ */
+static void
+dissect_bitcoin_msg_merkleblock(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
+{
+  proto_item *ti;
+  gint        length;
+  guint64     count;
+  guint64     i;
+  guint32     offset = 0;
+
+  if (!tree)
+    return;
+
+  /*  Merkleblock
+   *    [80] block header (as in a block message)
+   *    [ 4] total_transactions  uint32_t
+   *    [1+] hash_count          var_int
+   *    [ ?] hashes              char[32][]
+   *    [1+] flag_bytes          var_int
+   *    [ ?] flags               uchar[]
+   */
+
+  ti   = proto_tree_add_item(tree, &hfi_bitcoin_msg_merkleblock, tvb, offset, -1, ENC_NA);
+  tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
+
+  proto_tree_add_item(tree, &hfi_msg_merkleblock_version,     tvb, offset,  4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  proto_tree_add_item(tree, &hfi_msg_merkleblock_prev_block,  tvb, offset, 32, ENC_NA);
+  offset += 32;
+
+  proto_tree_add_item(tree, &hfi_msg_merkleblock_merkle_root, tvb, offset, 32, ENC_NA);
+  offset += 32;
+
+  proto_tree_add_item(tree, &hfi_msg_merkleblock_time,        tvb, offset,  4, ENC_TIME_TIMESPEC|ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  proto_tree_add_item(tree, &hfi_msg_merkleblock_bits,        tvb, offset,  4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  proto_tree_add_item(tree, &hfi_msg_merkleblock_nonce,       tvb, offset,  4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  proto_tree_add_item(tree, &hfi_msg_merkleblock_transactions, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  get_varint(tvb, offset, &length, &count);
+  proto_tree_add_item(tree, &hfi_msg_merkleblock_hashes_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
+
+  offset += length;
+
+  for (i = 0; i < count; i++)
+  {
+    if (!BITCOIN_ARRAY_ITEM_SHOWN(i))
+    {
+      guint32 end = skip_array(offset, count - i, 32);
+
+      add_array_summary(tree, tvb, offset, end, count - i);
+      offset = end;
+      break;
+    }
+
+    proto_tree_add_item(tree, &hfi_msg_merkleblock_hashes_hash, tvb, offset, 32, ENC_NA);
+    offset += 32;
+  }
+
+  create_data_tree(tree, &hfi_msg_merkleblock_flags, tvb, &offset);
+}
+
+/**
+ * Handler for filterload messages
+ */
+static void
+dissect_bitcoin_msg_filterload(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
+{
+  proto_item *ti;
+  guint32     offset = 0;
+
+  if (!tree)
+    return;
+
+  ti   = proto_tree_add_item(tree, &hfi_bitcoin_msg_filterload, tvb, offset, -1, ENC_NA);
+  tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
+
+  create_data_tree(tree, &hfi_msg_filterload_filter, tvb, &offset);
+
+  proto_tree_add_item(tree, &hfi_msg_filterload_nhashfunc, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  proto_tree_add_item(tree, &hfi_msg_filterload_ntweak, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  proto_tree_add_item(tree, &hfi_msg_filterload_nflags, tvb, offset, 1, ENC_LITTLE_ENDIAN);
+}
+
+/**
+ * Handler for filteradd messages
+ */
+static void
+dissect_bitcoin_msg_filteradd(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
+{
+  proto_item *ti;
+  guint32     offset = 0;
+
+  if (!tree)
+    return;
+
+  ti   = proto_tree_add_item(tree, &hfi_bitcoin_msg_filteradd, tvb, offset, -1, ENC_NA);
+  tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
+
+  create_data_tree(tree, &hfi_msg_filteradd_data, tvb, &offset);
+}
+
+/**
+ * Handler for reject messages
+ */
+static void
+dissect_bitcoin_msg_reject(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
+{
+  proto_item *ti;
+  gint        length;
+  guint32     offset = 0;
+
+  if (!tree)
+    return;
+
+  ti   = proto_tree_add_item(tree, &hfi_bitcoin_msg_reject, tvb, offset, -1, ENC_NA);
+  tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
+
+  create_string_tree(tree, &hfi_msg_reject_message, tvb, &offset);
+
+  proto_tree_add_item(tree, &hfi_msg_reject_ccode, tvb, offset, 1, ENC_LITTLE_ENDIAN);
+  offset += 1;
+
+  create_string_tree(tree, &hfi_msg_reject_reason, tvb, &offset);
+
+  /* rejected tx and block messages are followed by the hash of the object */
+  length = tvb_reported_length_remaining(tvb, offset);
+  if (length > 0)
+    proto_tree_add_item(tree, &hfi_msg_reject_data, tvb, offset, length, ENC_NA);
+}
+
+/**
+ * Handler for alert messages
+ */
+static void
+dissect_bitcoin_msg_alert(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree)
+{
+  proto_item *ti;
+  proto_tree *subtree;
+  gint        length;
+  guint64     count;
+  guint64     payload_length;
+  guint32     payload_end;
+  guint32     offset = 0;
+
+  if (!tree)
+    return;
+
+  ti   = proto_tree_add_item(tree, &hfi_bitcoin_msg_alert, tvb, offset, -1, ENC_NA);
+  tree = proto_item_add_subtree(ti, ett_bitcoin_msg);
+
+  /* The payload is a serialised alert, signed by the signature that follows it */
+  get_varint(tvb, offset, &length, &payload_length);
+  if ((offset + length + payload_length) > G_MAXINT)
+    THROW(ReportedBoundsError);  /* special check since payload_length is guint64 */
+
+  ti = proto_tree_add_item(tree, &hfi_msg_alert_payload, tvb, offset,
+                           length + (gint)payload_length, ENC_NA);
+  subtree = proto_item_add_subtree(ti, ett_alert_payload);
+
+  proto_tree_add_item(subtree, &hfi_data_varint_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
+  offset += length;
+  payload_end = offset + (guint32)payload_length;
+
+  proto_tree_add_item(subtree, &hfi_msg_alert_version, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  proto_tree_add_item(subtree, &hfi_msg_alert_relay_until, tvb, offset, 8, ENC_TIME_TIMESPEC|ENC_LITTLE_ENDIAN);
+  offset += 8;
+
+  proto_tree_add_item(subtree, &hfi_msg_alert_expiration, tvb, offset, 8, ENC_TIME_TIMESPEC|ENC_LITTLE_ENDIAN);
+  offset += 8;
+
+  proto_tree_add_item(subtree, &hfi_msg_alert_id, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  proto_tree_add_item(subtree, &hfi_msg_alert_cancel, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  get_varint(tvb, offset, &length, &count);
+  proto_tree_add_item(subtree, &hfi_msg_alert_set_cancel_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
+  offset += length;
+
+  for (; count > 0; count--)
+  {
+    proto_tree_add_item(subtree, &hfi_msg_alert_set_cancel, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+    offset += 4;
+  }
+
+  proto_tree_add_item(subtree, &hfi_msg_alert_min_ver, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  proto_tree_add_item(subtree, &hfi_msg_alert_max_ver, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  get_varint(tvb, offset, &length, &count);
+  proto_tree_add_item(subtree, &hfi_msg_alert_set_sub_ver_count, tvb, offset, length, ENC_VARINT_COMPACTSIZE);
+  offset += length;
+
+  for (; count > 0; count--)
+    create_string_tree(subtree, &hfi_msg_alert_set_sub_ver, tvb, &offset);
+
+  proto_tree_add_item(subtree, &hfi_msg_alert_priority, tvb, offset, 4, ENC_LITTLE_ENDIAN);
+  offset += 4;
+
+  create_string_tree(subtree, &hfi_msg_alert_comment, tvb, &offset);
+  create_string_tree(subtree, &hfi_msg_alert_status_bar, tvb, &offset);
+  create_string_tree(subtree, &hfi_msg_alert_reserved, tvb, &offset);
+
+  /* the signature follows the payload, whatever its contents */
+  offset = payload_end;
+  create_data_tree(tree, &hfi_msg_alert_signature, tvb, &offset);
+}
+
+/**
+ * Statistics for version messages
+ */
+static void
+bitcoin_msg_version_stats(tvbuff_t *tvb, packet_info *pinfo _U_, bitcoin_tap_info_t *stats)
+{
+  gint    length;
+  guint64 string_length;
+  guint32 offset = 4 + 8 + 8 + 26 + 26 + 8;  /* up to the user agent */
+
+  if (tvb_get_letohl(tvb, 0) < 106)
+    return;
+
+  get_varint(tvb, offset, &length, &string_length);
+  if (string_length > G_MAXINT)
+    THROW(ReportedBoundsError);
+
+  stats->user_agent = (const gchar *)tvb_get_string(wmem_packet_scope(), tvb,
+                                                    offset + length, (gint)string_length);
+}
+
+/**
+ * Statistics for getdata messages
+ */
+static void
+bitcoin_msg_getdata_stats(tvbuff_t *tvb, packet_info *pinfo, bitcoin_tap_info_t *stats)
+{
+  const bitcoin_hash_info_t *info;
+  nstime_t delay;
+  guint8   hash[SHA256_DIGEST_LEN];
+  gint     length;
+  guint64  count;
+  guint32  offset = 0;
+
+  get_varint(tvb, offset, &length, &count);
+  offset += length;
+
+  /* Measure from the first requested object that was announced earlier */
+  for (; count > 0; count--)
+  {
+    tvb_memcpy(tvb, hash, offset+4, SHA256_DIGEST_LEN);
+
+    info = bitcoin_hash_lookup(hash);
+    if (info && info->first_frame < pinfo->fd->num)
+    {
+      nstime_delta(&delay, &pinfo->fd->abs_ts, &info->first_ts);
+      stats->getdata_latency = (gint)nstime_to_msec(&delay);
+      return;
+    }
+    offset += 36;
+  }
+}
+
+/**
+ * Statistics for tx messages
+ */
+static void
+bitcoin_msg_tx_stats(tvbuff_t *tvb, packet_info *pinfo _U_, bitcoin_tap_info_t *stats)
+{
+  stats->tx_count = 1;
+  walk_bitcoin_tx(tvb, 0, stats);
+}
+
+/**
+ * Statistics for block messages
+ */
+static void
+bitcoin_msg_block_stats(tvbuff_t *tvb, packet_info *pinfo _U_, bitcoin_tap_info_t *stats)
+{
+  gint     length;
+  guint64  count;
+  guint32  offset = 80;  /* block header */
+
+  get_varint(tvb, offset, &length, &count);
+  offset += length;
+
+  stats->tx_count = (guint32)count;
+
+  for (; count > 0; count--)
+    offset += walk_bitcoin_tx(tvb, offset, stats);
+}
+
+/**
+ * Handler for unimplemented or payload-less messages
+ */
+static void
+dissect_bitcoin_msg_empty(tvbuff_t *tvb _U_, packet_info *pinfo _U_, proto_tree *tree _U_)
+{
+  return;
+}
+
+typedef void (*msg_dissector_func_t)(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree);
+typedef void (*msg_stats_func_t)(tvbuff_t *tvb, packet_info *pinfo, bitcoin_tap_info_t *stats);
+
+/*
+ * The command is a NUL padded 12 byte ASCII string.  It is looked up as
+ * one 64-bit and one 32-bit little endian word, so that dispatch is a
+ * single hash probe and only exact (NUL padded) names match.
+ */
+typedef struct msg_command_key
+{
+  guint64 lo;
+  guint32 hi;
+} msg_command_key_t;
+
+typedef struct msg_dissector
+{
+  const gchar *command;
+  msg_dissector_func_t function;
+  msg_stats_func_t stats;           /* fills in the tap statistics, may be NULL */
+  msg_command_key_t key;            /* filled in at registration time */
+} msg_dissector_t;
+
+static msg_dissector_t msg_dissectors[] =
+{
+  {"version",   dissect_bitcoin_msg_version,     bitcoin_msg_version_stats, {0, 0}},
+  {"addr",      dissect_bitcoin_msg_addr,        NULL,                      {0, 0}},
+  {"inv",       dissect_bitcoin_msg_inv,         NULL,                      {0, 0}},
+  {"getdata",   dissect_bitcoin_msg_getdata,     bitcoin_msg_getdata_stats, {0, 0}},
+  {"getblocks", dissect_bitcoin_msg_getblocks,   NULL,                      {0, 0}},
+  {"getheaders",dissect_bitcoin_msg_getheaders,  NULL,                      {0, 0}},
+  {"tx",        dissect_bitcoin_msg_tx,          bitcoin_msg_tx_stats,      {0, 0}},
+  {"block",     dissect_bitcoin_msg_block,       bitcoin_msg_block_stats,   {0, 0}},
+  {"headers",   dissect_bitcoin_msg_headers,     NULL,                      {0, 0}},
+  {"notfound",  dissect_bitcoin_msg_notfound,    NULL,                      {0, 0}},
+  {"merkleblock",dissect_bitcoin_msg_merkleblock,NULL,                      {0, 0}},
+  {"filterload",dissect_bitcoin_msg_filterload,  NULL,                      {0, 0}},
+  {"filteradd", dissect_bitcoin_msg_filteradd,   NULL,                      {0, 0}},
+  {"reject",    dissect_bitcoin_msg_reject,      NULL,                      {0, 0}},
+  {"alert",     dissect_bitcoin_msg_alert,       NULL,                      {0, 0}},
+
+  /* messages with no payload */
+  {"verack",    dissect_bitcoin_msg_empty,       NULL,                      {0, 0}},
+  {"getaddr",   dissect_bitcoin_msg_empty,       NULL,                      {0, 0}},
+  {"ping",      dissect_bitcoin_msg_empty,       NULL,                      {0, 0}},
+  {"pong",      dissect_bitcoin_msg_empty,       NULL,                      {0, 0}},
+  {"mempool",   dissect_bitcoin_msg_empty,       NULL,                      {0, 0}},
+  {"filterclear",dissect_bitcoin_msg_empty,      NULL,                      {0, 0}},
+
+  /* messages not implemented */
+  {"checkorder",dissect_bitcoin_msg_empty,       NULL,                      {0, 0}},
+  {"submitorder",dissect_bitcoin_msg_empty,      NULL,                      {0, 0}},
+  {"reply",     dissect_bitcoin_msg_empty,       NULL,                      {0, 0}}
+};
+
+/* msg_command_key_t -> msg_dissector_t, built once at registration time */
+static GHashTable *msg_dissector_table = NULL;
+
+static guint
+msg_command_key_hash(gconstpointer k)
+{
+  const msg_command_key_t *key = (const msg_command_key_t *)k;
+
+  return (guint)(key->lo ^ (key->lo >> 29) ^ ((guint64)key->hi * 0x9E3779B1U));
+}
+
+static gboolean
+msg_command_key_equal(gconstpointer k1, gconstpointer k2)
+{
+  const msg_command_key_t *key1 = (const msg_command_key_t *)k1;
+  const msg_command_key_t *key2 = (const msg_command_key_t *)k2;
+
+  return (key1->lo == key2->lo) && (key1->hi == key2->hi);
+}
+
+static void
+msg_dissector_table_init(void)
+{
+  guint i;
+
+  msg_dissector_table = g_hash_table_new(msg_command_key_hash, msg_command_key_equal);
+
+  for (i = 0; i < array_length(msg_dissectors); i++)
+  {
+    guint8 command[12];
+
+    memset(command, 0, sizeof command);
+    memcpy(command, msg_dissectors[i].command,
+           MIN(strlen(msg_dissectors[i].command), sizeof command));
+
+    msg_dissectors[i].key.lo = pletoh64(command);
+    msg_dissectors[i].key.hi = pletoh32(command + 8);
+    g_hash_table_insert(msg_dissector_table, &msg_dissectors[i].key, &msg_dissectors[i]);
+  }
+}
+
+/**
+ * Find the handler for the command at offset 4 of the message header
+ */
+static msg_dissector_t *
+msg_dissector_lookup(tvbuff_t *tvb)
+{
+  msg_command_key_t key;
+
+  key.lo = tvb_get_letoh64(tvb, 4);
+  key.hi = tvb_get_letohl(tvb, 12);
+
+  return (msg_dissector_t *)g_hash_table_lookup(msg_dissector_table, &key);
+}
+
+/**
+ * Whether a magic number is one of the network's
+ */
+static gboolean
+coin_network_has_magic(const coin_network_t *network, guint32 magic_number)
+{
+  guint i;
+
+  for (i = 0; i < COIN_MAX_MAGIC_NUMBERS && network->magic[i] != 0; i++)
+  {
+    if (network->magic[i] == magic_number)
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
+static int dissect_bitcoin_tcp_pdu(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data)
+{
+  proto_item         *ti;
+  proto_item         *ti_magic;
+  bitcoin_segment_t  *segment = (bitcoin_segment_t *)data;
+  coin_network_t     *network = segment->network;
+  msg_dissector_t    *msg;
+  bitcoin_tap_info_t *tap_info;
+  guint32             offset = 0;
+
+  col_set_str(pinfo->cinfo, COL_PROTOCOL, network->short_name);
+
+  tap_info = wmem_new0(wmem_packet_scope(), bitcoin_tap_info_t);
+  tap_info->network        = network->short_name;
+  tap_info->payload_length = tvb_get_letohl(tvb, 16);
+  tap_info->getdata_latency = -1;
+
+  ti   = proto_tree_add_item(tree, network->hfi, tvb, 0, -1, ENC_NA);
+  tree = proto_item_add_subtree(ti, ett_bitcoin);
+
+  /* add basic protocol data */
+  ti_magic = proto_tree_add_item(tree, &hfi_bitcoin_magic, tvb,  0,  4, ENC_BIG_ENDIAN);
+  if (!coin_network_has_magic(network, tvb_get_letohl(tvb, 0)))
+    expert_add_info(pinfo, ti_magic, &ei_bitcoin_magic_mismatch);
+  proto_tree_add_item(tree, &hfi_bitcoin_command, tvb,  4, 12, ENC_ASCII|ENC_NA);
+  proto_tree_add_item(tree, &hfi_bitcoin_length,  tvb, 16,  4, ENC_LITTLE_ENDIAN);
+  dissect_bitcoin_checksum(tvb, pinfo, tree, segment);
+
+  offset = 24;
+
+  /* handle command specific message part */
+  msg = msg_dissector_lookup(tvb);
+  if (msg)
+  {
+    tvbuff_t *tvb_sub;
+
+    col_append_sep_str(pinfo->cinfo, COL_INFO, ", ", msg->command);
+    tap_info->command = msg->command;
+
+    tvb_sub = tvb_new_subset_remaining(tvb, offset);
+
+    /* Don't build the message items if neither the display nor a filter needs them */
+    msg->function(tvb_sub, pinfo,
+                  proto_fields_are_referenced(tree, bitcoin_field_ids, num_bitcoin_field_ids) ? tree : NULL);
+
+    if (msg->stats && have_tap_listener(bitcoin_tap))
+      msg->stats(tvb_sub, pinfo, tap_info);
+
+    tap_queue_packet(bitcoin_tap, pinfo, tap_info);
+    return tvb_length(tvb);
+  }
+
+  /* no handler found */
+  col_append_sep_str(pinfo->cinfo, COL_INFO, ", ", "[unknown command]");
+
+  expert_add_info(pinfo, ti, &ei_bitcoin_command_unknown);
+
+  tap_queue_packet(bitcoin_tap, pinfo, tap_info);
+  return tvb_length(tvb);
+}
+
+/*
+ * Statistics trees, fed by the "bitcoin" tap
+ */
+static const gchar *st_str_messages    = "Coin Messages";
+static const gchar *st_str_latency     = "getdata Latency (ms)";
+static const gchar *st_str_user_agents = "Version User Agents";
+static const gchar *st_str_peers       = "Coin Messages by Peer";
+
+static int st_node_messages    = -1;
+static int st_node_user_agents = -1;
+static int st_node_peers       = -1;
+
+static void
+bitcoin_stats_tree_init(stats_tree *st)
+{
+  st_node_messages    = stats_tree_create_node(st, st_str_messages, 0, TRUE);
+  stats_tree_create_range_node(st, st_str_latency, 0,
+                               "0-49", "50-99", "100-249", "250-499", "500-999",
+                               "1000-4999", "5000-", NULL);
+  st_node_user_agents = stats_tree_create_node(st, st_str_user_agents, 0, TRUE);
+}
+
+/* Messages (with payload sizes) by network and command, getdata latency and user agents */
+static int
+bitcoin_stats_tree_packet(stats_tree *st, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *p)
+{
+  const bitcoin_tap_info_t *info = (const bitcoin_tap_info_t *)p;
+  int                       network_node;
+
+  tick_stat_node(st, st_str_messages, 0, FALSE);
+  network_node = tick_stat_node(st, info->network, st_node_messages, TRUE);
+  avg_stat_node_add_value(st, info->command ? info->command : "(unknown)", network_node, FALSE,
+                          (gint)info->payload_length);
+
+  if (info->getdata_latency >= 0)
+    stats_tree_tick_range(st, st_str_latency, 0, info->getdata_latency);
+
+  if (info->user_agent)
+  {
+    tick_stat_node(st, st_str_user_agents, 0, FALSE);
+    network_node = tick_stat_node(st, info->network, st_node_user_agents, TRUE);
+    tick_stat_node(st, *info->user_agent ? info->user_agent : "(none)", network_node, FALSE);
+  }
+
+  return 1;
+}
+
+static void
+bitcoin_peers_stats_tree_init(stats_tree *st)
+{
+  st_node_peers = stats_tree_create_node(st, st_str_peers, 0, TRUE);
+}
+
+/* Messages (with payload sizes) by sending peer and command */
+static int
+bitcoin_peers_stats_tree_packet(stats_tree *st, packet_info *pinfo, epan_dissect_t *edt _U_, const void *p)
+{
+  const bitcoin_tap_info_t *info = (const bitcoin_tap_info_t *)p;
+  int                       peer_node;
+
+  tick_stat_node(st, st_str_peers, 0, FALSE);
+  peer_node = tick_stat_node(st, ep_address_to_str(&pinfo->src), st_node_peers, TRUE);
+  avg_stat_node_add_value(st, info->command ? info->command : "(unknown)", peer_node, FALSE,
+                          (gint)info->payload_length);
+
+  return 1;
+}
+
+static const gchar *st_str_heur          = "Coin Heuristic Calls";
+static const gchar *st_str_heur_match    = "Magic number found";
+static const gchar *st_str_heur_miss     = "No magic number";
+static const gchar *st_str_heur_none     = "No network";
+static const gchar *st_str_heur_gave_up  = "Gave up on conversation";
+static const gchar *st_str_heur_rejected = "Magic number found after giving up";
+
+static int st_node_heur = -1;
+
+static void
+bitcoin_heur_stats_tree_init(stats_tree *st)
+{
+  st_node_heur = stats_tree_create_node(st, st_str_heur, 0, TRUE);
+}
+
+/* Outcomes of the heuristic, by network; misses are under "No network" */
+static int
+bitcoin_heur_stats_tree_packet(stats_tree *st, packet_info *pinfo _U_, epan_dissect_t *edt _U_, const void *p)
+{
+  const bitcoin_heur_tap_info_t *info = (const bitcoin_heur_tap_info_t *)p;
+  int                            network_node;
+
+  tick_stat_node(st, st_str_heur, 0, FALSE);
+  network_node = tick_stat_node(st, info->network ? info->network : st_str_heur_none,
+                                st_node_heur, TRUE);
+
+  switch (info->result)
+  {
+  case BITCOIN_HEUR_MATCH:
+    tick_stat_node(st, st_str_heur_match, network_node, FALSE);
+    break;
+  case BITCOIN_HEUR_MISS:
+    tick_stat_node(st, st_str_heur_miss, network_node, FALSE);
+    break;
+  case BITCOIN_HEUR_GAVE_UP:
+    tick_stat_node(st, st_str_heur_miss, network_node, FALSE);
+    tick_stat_node(st, st_str_heur_gave_up, network_node, FALSE);
+    break;
+  case BITCOIN_HEUR_REJECTED:
+    tick_stat_node(st, st_str_heur_rejected, network_node, FALSE);
+    break;
+  }
+
+  return 1;
+}
+
+static int
+dissect_coin(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, coin_network_t *network)
+{
+  bitcoin_segment_t *segment;
+
+  segment = wmem_new0(wmem_packet_scope(), bitcoin_segment_t);
+  segment->network = network;
+  segment->tvb     = tvb;
+  if (bitcoin_check_checksum)
+    bitcoin_segment_check_checksums(segment);
+
+  col_clear(pinfo->cinfo, COL_INFO);
+  tcp_dissect_pdus(tvb, pinfo, tree, bitcoin_desegment, BITCOIN_HEADER_LENGTH,
+      get_bitcoin_pdu_length, dissect_bitcoin_tcp_pdu, segment);
+
+  return tvb_reported_length(tvb);
+}
+
+/**
+ * Report the outcome of the heuristic to the "bitcoin_heur" tap; the
+ * network is NULL if there's no magic number of an enabled network
+ */
+static void
+bitcoin_heur_result(packet_info *pinfo, const coin_network_t *network, bitcoin_heur_result_t result)
+{
+  bitcoin_heur_tap_info_t *tap_info;
+
+  if (!have_tap_listener(bitcoin_heur_tap))
+    return;
+
+  tap_info = wmem_new(wmem_packet_scope(), bitcoin_heur_tap_info_t);
+  tap_info->network = network ? network->short_name : NULL;
+  tap_info->result  = result;
+  tap_queue_packet(bitcoin_heur_tap, pinfo, tap_info);
+}
+
+/**
+ * The first enabled network with a magic number, or NULL
+ */
+static coin_network_t *
+coin_network_by_magic(guint32 magic_number)
+{
+  GSList         *entry;
+  coin_network_t *network;
+
+  entry = (GSList *)g_hash_table_lookup(coin_magic_table, GUINT_TO_POINTER(magic_number));
+  for (; entry != NULL; entry = g_slist_next(entry))
+  {
+    network = (coin_network_t *)entry->data;
+    if (proto_is_protocol_enabled(find_protocol_by_id(network->proto)))
+      return network;
+  }
+
+  return NULL;
+}
+
+/**
+ * Count a segment of the conversation without the magic number of an
+ * enabled network, and give up on the conversation once it has had too
+ * many
+ *
+ * Only conversations that already exist (TCP has normally created them)
+ * are counted, and only on the first pass: a miss never creates one.
+ */
+static void
+bitcoin_heur_miss(packet_info *pinfo, conversation_t *conversation, bitcoin_heur_conv_t *heur_conv)
+{
+  if (!conversation)
+  {
+    bitcoin_heur_result(pinfo, NULL, BITCOIN_HEUR_MISS);
+    return;
+  }
+
+  if (!pinfo->fd->flags.visited)
+  {
+    if (!heur_conv)
+    {
+      heur_conv = wmem_new0(wmem_file_scope(), bitcoin_heur_conv_t);
+      conversation_add_proto_data(conversation, proto_coin, heur_conv);
+    }
+
+    if (!heur_conv->gave_up_frame && ++heur_conv->misses >= bitcoin_heur_max_misses)
+      heur_conv->gave_up_frame = pinfo->fd->num;
+  }
+
+  if (heur_conv && heur_conv->gave_up_frame == pinfo->fd->num)
+    bitcoin_heur_result(pinfo, NULL, BITCOIN_HEUR_GAVE_UP);
+  else
+    bitcoin_heur_result(pinfo, NULL, BITCOIN_HEUR_MISS);
+}
+
+/**
+ * The heuristic of all the networks: the network is the first enabled one
+ * with the segment's magic number
+ *
+ * A conversation that started with enough non-coin segments isn't coin
+ * traffic, whatever a later segment happens to start with; that's checked
+ * first, with the one conversation lookup, so a conversation given up on
+ * costs nothing more.
+ */
+static gboolean
+dissect_coin_heur(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data _U_)
+{
+  conversation_t      *conversation = NULL;
+  bitcoin_heur_conv_t *heur_conv    = NULL;
+  coin_network_t      *network;
+
+  if (tvb_length(tvb) < 4)
+      return FALSE;
+
+  if (bitcoin_heur_max_misses)
+  {
+    conversation = find_conversation(pinfo->fd->num, &pinfo->src, &pinfo->dst,
+                                     pinfo->ptype, pinfo->srcport, pinfo->destport, 0);
+    if (conversation)
+      heur_conv = (bitcoin_heur_conv_t *)conversation_get_proto_data(conversation, proto_coin);
+
+    if (heur_conv && heur_conv->gave_up_frame && pinfo->fd->num > heur_conv->gave_up_frame)
+    {
+      if (have_tap_listener(bitcoin_heur_tap) &&
+          (network = coin_network_by_magic(tvb_get_letohl(tvb, 0))) != NULL)
+        bitcoin_heur_result(pinfo, network, BITCOIN_HEUR_REJECTED);
+      return FALSE;
+    }
+  }
+
+  network = coin_network_by_magic(tvb_get_letohl(tvb, 0));
+  if (!network)
+  {
+    bitcoin_heur_miss(pinfo, conversation, heur_conv);
+    return FALSE;
+  }
+
+  if (!conversation)
+    conversation = find_or_create_conversation(pinfo);
+
+  /* Ok: This connection should always use this network's dissector */
+  conversation_set_dissector(conversation, network->handle);
+  bitcoin_heur_result(pinfo, network, BITCOIN_HEUR_MATCH);
+
+  dissect_coin(tvb, pinfo, tree, network);
+  return TRUE;
+}
+
+#define COIN_NETWORK_DEFINE(net, index) \
+  static int \
+  dissect_##net(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, void *data _U_) \
+  { \
+    return dissect_coin(tvb, pinfo, tree, &coin_networks[index]); \
+  }
+
+/* in coin_networks[] order */
+COIN_NETWORK_DEFINE(bitcoin,   0)
+COIN_NETWORK_DEFINE(litecoin,  1)
+COIN_NETWORK_DEFINE(dogecoin,  2)
+COIN_NETWORK_DEFINE(namecoin,  3)
+COIN_NETWORK_DEFINE(ppcoin,    4)
+COIN_NETWORK_DEFINE(primecoin, 5)
+COIN_NETWORK_DEFINE(quarkcoin, 6)
+COIN_NETWORK_DEFINE(bitshares, 7)
+
+void
+proto_register_bitcoin(void)
+{
+#ifndef HAVE_HFI_SECTION_INIT
   static header_field_info *hfi[] = {
     &hfi_bitcoin_magic,
     &hfi_bitcoin_command,
     &hfi_bitcoin_length,
     &hfi_bitcoin_checksum,
+    &hfi_bitcoin_checksum_good,
+    &hfi_bitcoin_checksum_bad,
 
     /* version message */
     &hfi_bitcoin_msg_version,
@@ -1149,94 +2788,68 @@ proto_register_bitcoin(void)
     &hfi_msg_version_start_height,
 
     /* addr message */
-    &hfi_msg_addr_count8,
-    &hfi_msg_addr_count16,
-    &hfi_msg_addr_count32,
-    &hfi_msg_addr_count64,
+    &hfi_msg_addr_count,
     &hfi_bitcoin_msg_addr,
     &hfi_msg_addr_address,
     &hfi_msg_addr_timestamp,
 
     /* inv message */
-    &hfi_msg_inv_count8,
-    &hfi_msg_inv_count16,
-    &hfi_msg_inv_count32,
-    &hfi_msg_inv_count64,
+    &hfi_msg_inv_count,
     &hfi_bitcoin_msg_inv,
     &hfi_msg_inv_type,
     &hfi_msg_inv_hash,
+    &hfi_msg_inv_data_frame,
 
     /* getdata message */
-    &hfi_msg_getdata_count8,
-    &hfi_msg_getdata_count16,
-    &hfi_msg_getdata_count32,
-    &hfi_msg_getdata_count64,
+    &hfi_msg_getdata_count,
     &hfi_bitcoin_msg_getdata,
     &hfi_msg_getdata_type,
     &hfi_msg_getdata_hash,
 
     /* getblocks message */
-    &hfi_msg_getblocks_count8,
-    &hfi_msg_getblocks_count16,
-    &hfi_msg_getblocks_count32,
-    &hfi_msg_getblocks_count64,
+    &hfi_msg_getblocks_count,
     &hfi_bitcoin_msg_getblocks,
     &hfi_msg_getblocks_start,
     &hfi_msg_getblocks_stop,
 
     /* getheaders message */
-    &hfi_msg_getheaders_count8,
-    &hfi_msg_getheaders_count16,
-    &hfi_msg_getheaders_count32,
-    &hfi_msg_getheaders_count64,
+    &hfi_msg_getheaders_count,
     &hfi_bitcoin_msg_getheaders,
     &hfi_msg_getheaders_start,
     &hfi_msg_getheaders_stop,
 
     /* tx message */
     &hfi_bitcoin_msg_tx,
+    &hfi_msg_tx_txid,
     &hfi_msg_tx_version,
 
     /* tx message - input */
-    &hfi_msg_tx_in_count8,
-    &hfi_msg_tx_in_count16,
-    &hfi_msg_tx_in_count32,
-    &hfi_msg_tx_in_count64,
+    &hfi_msg_tx_in_count,
 
     &hfi_msg_tx_in,
     &hfi_msg_tx_in_prev_output,
 
     &hfi_msg_tx_in_prev_outp_hash,
+    &hfi_msg_tx_in_prev_outp_frame,
     &hfi_msg_tx_in_prev_outp_index,
 
-    &hfi_msg_tx_in_script8,
-    &hfi_msg_tx_in_script16,
-    &hfi_msg_tx_in_script32,
-    &hfi_msg_tx_in_script64,
+    &hfi_msg_tx_in_script_length,
     &hfi_msg_tx_in_sig_script,
     &hfi_msg_tx_in_seq,
 
     /* tx message - output */
-    &hfi_msg_tx_out_count8,
-    &hfi_msg_tx_out_count16,
-    &hfi_msg_tx_out_count32,
-    &hfi_msg_tx_out_count64,
+    &hfi_msg_tx_out_count,
     &hfi_msg_tx_out,
     &hfi_msg_tx_out_value,
-    &hfi_msg_tx_out_script8,
-    &hfi_msg_tx_out_script16,
-    &hfi_msg_tx_out_script32,
-    &hfi_msg_tx_out_script64,
+    &hfi_msg_tx_out_script_length,
     &hfi_msg_tx_out_script,
 
     &hfi_msg_tx_lock_time,
 
     /* block message */
-    &hfi_msg_block_transactions8,
-    &hfi_msg_block_transactions16,
-    &hfi_msg_block_transactions32,
-    &hfi_msg_block_transactions64,
+    &hfi_msg_block_transactions,
     &hfi_bitcoin_msg_block,
+    &hfi_msg_block_hash,
     &hfi_msg_block_version,
     &hfi_msg_block_prev_block,
     &hfi_msg_block_merkle_root,
@@ -1244,6 +2857,79 @@ proto_register_bitcoin(void)
     &hfi_msg_block_bits,
     &hfi_msg_block_nonce,
 
+    /* headers message */
+    &hfi_msg_headers_count,
+    &hfi_bitcoin_msg_headers,
+    &hfi_msg_headers_header,
+    &hfi_msg_headers_version,
+    &hfi_msg_headers_prev_block,
+    &hfi_msg_headers_merkle_root,
+    &hfi_msg_headers_time,
+    &hfi_msg_headers_bits,
+    &hfi_msg_headers_nonce,
+    &hfi_msg_headers_transactions,
+
+    /* notfound message */
+    &hfi_msg_notfound_count,
+    &hfi_bitcoin_msg_notfound,
+    &hfi_msg_notfound_type,
+    &hfi_msg_notfound_hash,
+
+    /* merkleblock message */
+    &hfi_bitcoin_msg_merkleblock,
+    &hfi_msg_merkleblock_version,
+    &hfi_msg_merkleblock_prev_block,
+    &hfi_msg_merkleblock_merkle_root,
+    &hfi_msg_merkleblock_time,
+    &hfi_msg_merkleblock_bits,
+    &hfi_msg_merkleblock_nonce,
+    &hfi_msg_merkleblock_transactions,
+    &hfi_msg_merkleblock_hashes_count,
+    &hfi_msg_merkleblock_hashes_hash,
+    &hfi_msg_merkleblock_flags,
+
+    /* filterload message */
+    &hfi_bitcoin_msg_filterload,
+    &hfi_msg_filterload_filter,
+    &hfi_msg_filterload_nhashfunc,
+    &hfi_msg_filterload_ntweak,
+    &hfi_msg_filterload_nflags,
+
+    /* filteradd message */
+    &hfi_bitcoin_msg_filteradd,
+    &hfi_msg_filteradd_data,
+
+    /* reject message */
+    &hfi_bitcoin_msg_reject,
+    &hfi_msg_reject_message,
+    &hfi_msg_reject_ccode,
+    &hfi_msg_reject_reason,
+    &hfi_msg_reject_data,
+
+    /* alert message */
+    &hfi_bitcoin_msg_alert,
+    &hfi_msg_alert_payload,
+    &hfi_msg_alert_version,
+    &hfi_msg_alert_relay_until,
+    &hfi_msg_alert_expiration,
+    &hfi_msg_alert_id,
+    &hfi_msg_alert_cancel,
+    &hfi_msg_alert_set_cancel_count,
+    &hfi_msg_alert_set_cancel,
+    &hfi_msg_alert_min_ver,
+    &hfi_msg_alert_max_ver,
+    &hfi_msg_alert_set_sub_ver_count,
+    &hfi_msg_alert_set_sub_ver,
+    &hfi_msg_alert_priority,
+    &hfi_msg_alert_comment,
+    &hfi_msg_alert_status_bar,
+    &hfi_msg_alert_reserved,
+    &hfi_msg_alert_signature,
+
+    /* hash tracking */
+    &hfi_hash_first_seen,
+    &hfi_hash_delay,
+
     /* services */
     &hfi_services_network,
 
@@ -1254,16 +2940,18 @@ proto_register_bitcoin(void)
 
     /* variable string */
     &hfi_string_value,
-    &hfi_string_varint_count8,
-    &hfi_string_varint_count16,
-    &hfi_string_varint_count32,
-    &hfi_string_varint_count64,
+    &hfi_string_varint_count,
+
+    /* variable data */
+    &hfi_data_value,
+    &hfi_data_varint_count,
   };
 #endif
 
   static gint *ett[] = {
     &ett_bitcoin,
     &ett_bitcoin_msg,
+    &ett_bitcoin_checksum,
     &ett_services,
     &ett_address,
     &ett_string,
@@ -1275,44 +2963,165 @@ proto_register_bitcoin(void)
     &ett_tx_in_list,
     &ett_tx_in_outp,
     &ett_tx_out_list,
+    &ett_headers_list,
+    &ett_notfound_list,
+    &ett_alert_payload,
+    &ett_data,
   };
 
   static ei_register_info ei[] = {
      { &ei_bitcoin_command_unknown, { "bitcoin.command.unknown", PI_PROTOCOL, PI_WARN, "Unknown command", EXPFILL }},
+     { &ei_bitcoin_checksum_bad, { "bitcoin.checksum_bad.expert", PI_CHECKSUM, PI_ERROR, "Bad checksum", EXPFILL }},
+     { &ei_bitcoin_magic_mismatch, { "bitcoin.magic.mismatch", PI_PROTOCOL, PI_WARN, "Not a magic number of this network", EXPFILL }},
   };
 
-  module_t *bitcoin_module;
+  module_t *bitcoin_module = NULL;
   expert_module_t* expert_bitcoin;
 
   int proto_bitcoin;
+  header_field_info *hfinfo;
+  void *cookie;
+  guint i, j;
+
+
+  for (i = 0; i < array_length(coin_networks); i++)
+  {
+    coin_network_t *network = &coin_networks[i];
+    module_t       *network_module;
+
+    network->proto  = proto_register_protocol(network->name, network->short_name, network->filter_name);
+    network->hfi    = proto_registrar_get_nth(network->proto);
+    network->handle = new_register_dissector(network->filter_name, network->dissector, network->proto);
+
+    /* Keep the fields of the networks' former dissectors */
+    if (network != COIN_DEFAULT_NETWORK)
+      proto_register_prefix_alias(network->filter_name, COIN_DEFAULT_NETWORK->filter_name);
+
+    range_convert_str(&network->tcp_range, "", MAX_TCP_PORT);
+    network_module = prefs_register_protocol(network->proto, proto_reg_handoff_bitcoin);
+    prefs_register_range_preference(network_module, "tcp.ports",
+                                    g_strdup_printf("%s TCP ports", network->short_name),
+                                    g_strdup_printf("TCP ports to be decoded as %s (default: none)",
+                                                    network->short_name),
+                                    &network->tcp_range, MAX_TCP_PORT);
+
+    if (network == COIN_DEFAULT_NETWORK)
+      bitcoin_module = network_module;
+  }
 
+  /* The heuristic's own protocol, and its table of magic numbers */
+  proto_coin = proto_register_protocol("Coin networks heuristic", "Coin", "coin");
 
-  proto_bitcoin = proto_register_protocol("Bitcoin protocol", "Bitcoin", "bitcoin");
-  hfi_bitcoin = proto_registrar_get_nth(proto_bitcoin);
+  coin_magic_table = g_hash_table_new(g_direct_hash, g_direct_equal);
+  for (i = 0; i < array_length(coin_networks); i++)
+  {
+    for (j = 0; j < COIN_MAX_MAGIC_NUMBERS && coin_networks[i].magic[j] != 0; j++)
+    {
+      gpointer key = GUINT_TO_POINTER(coin_networks[i].magic[j]);
+      GSList  *networks = (GSList *)g_hash_table_lookup(coin_magic_table, key);
+
+      /* another of this network's magic numbers may be the same */
+      if (g_slist_find(networks, &coin_networks[i]) == NULL)
+        g_hash_table_insert(coin_magic_table, key, g_slist_append(networks, &coin_networks[i]));
+    }
+  }
+
+  msg_dissector_table_init();
+
+  proto_bitcoin = COIN_DEFAULT_NETWORK->proto;
+  hfi_bitcoin = COIN_DEFAULT_NETWORK->hfi;
 
   proto_register_subtree_array(ett, array_length(ett));
   proto_register_fields(proto_bitcoin, hfi, array_length(hfi));
 
+  for (i = 0; i < array_length(tx_fields); i++)
+    tx_field_ids[i] = tx_fields[i]->id;
+
+  for (hfinfo = proto_get_first_protocol_field(proto_bitcoin, &cookie); hfinfo != NULL;
+       hfinfo = proto_get_next_protocol_field(&cookie))
+    num_bitcoin_field_ids++;
+
+  bitcoin_field_ids = g_new(int, num_bitcoin_field_ids);
+  num_bitcoin_field_ids = 0;
+  for (hfinfo = proto_get_first_protocol_field(proto_bitcoin, &cookie); hfinfo != NULL;
+       hfinfo = proto_get_next_protocol_field(&cookie))
+    bitcoin_field_ids[num_bitcoin_field_ids++] = hfinfo->id;
+
   expert_bitcoin = expert_register_protocol(proto_bitcoin);
   expert_register_field_array(expert_bitcoin, ei, array_length(ei));
 
-  bitcoin_handle = new_register_dissector("bitcoin", dissect_bitcoin, proto_bitcoin);
-
-  bitcoin_module = prefs_register_protocol(proto_bitcoin, NULL);
   prefs_register_bool_preference(bitcoin_module, "desegment",
                                  "Desegment all Bitcoin messages spanning multiple TCP segments",
                                  "Whether the Bitcoin dissector should desegment all messages"
                                  " spanning multiple TCP segments",
                                  &bitcoin_desegment);
+  prefs_register_bool_preference(bitcoin_module, "check_checksum",
+                                 "Validate the payload checksum if possible",
+                                 "Whether to validate the double SHA-256 checksum of"
+                                 " Bitcoin message payloads",
+                                 &bitcoin_check_checksum);
+  prefs_register_bool_preference(bitcoin_module, "track_hashes",
+                                 "Compute and track transaction and block hashes",
+                                 "Whether to compute transaction IDs and block hashes and link"
+                                 " inventory vectors and transaction inputs to the frames they refer to",
+                                 &bitcoin_track_hashes);
+  prefs_register_uint_preference(bitcoin_module, "max_array_items",
+                                 "Maximum number of array elements to show",
+                                 "Arrays with more elements (e.g. the block headers of a headers"
+                                 " message) are summarised after this many; 0 means no limit",
+                                 10, &bitcoin_max_array_items);
+  prefs_register_uint_preference(bitcoin_module, "heur_max_misses",
+                                 "Give up on a conversation after this many non-coin segments",
+                                 "Once this many TCP segments of a conversation have failed the"
+                                 " heuristic's magic number check it no longer claims the conversation;"
+                                 " set this high enough for captures joining connections in the middle"
+                                 " of large messages. 0 means never give up (default: 1000)",
+                                 10, &bitcoin_heur_max_misses);
+
+  bitcoin_hash_table = wmem_tree_new_autoreset(wmem_epan_scope(), wmem_file_scope());
+
+  bitcoin_tap = register_tap("bitcoin");
+  bitcoin_heur_tap = register_tap("bitcoin_heur");
 
 }
 
 void
 proto_reg_handoff_bitcoin(void)
 {
-  dissector_add_handle("tcp.port", bitcoin_handle);  /* for 'decode-as' */
+  static gboolean initialized = FALSE;
+  guint i;
+
+  for (i = 0; i < array_length(coin_networks); i++)
+  {
+    coin_network_t *network = &coin_networks[i];
+
+    if (!initialized)
+    {
+      dissector_add_handle("tcp.port", network->handle);  /* for 'decode-as' */
+    }
+    else
+    {
+      dissector_delete_uint_range("tcp.port", network->tcp_range_registered, network->handle);
+      g_free(network->tcp_range_registered);
+    }
+
+    network->tcp_range_registered = range_copy(network->tcp_range);
+    dissector_add_uint_range("tcp.port", network->tcp_range_registered, network->handle);
+  }
+
+  if (initialized)
+    return;
+
+  heur_dissector_add("tcp", dissect_coin_heur, proto_coin);
+
+  stats_tree_register("bitcoin", "coin",       "Coin/Messages",         0,
+                      bitcoin_stats_tree_packet, bitcoin_stats_tree_init, NULL);
+  stats_tree_register("bitcoin", "coin_peers", "Coin/Messages by Peer", 0,
+                      bitcoin_peers_stats_tree_packet, bitcoin_peers_stats_tree_init, NULL);
+  stats_tree_register("bitcoin_heur", "coin_heur", "Coin/Heuristic", 0,
+                      bitcoin_heur_stats_tree_packet, bitcoin_heur_stats_tree_init, NULL);
 
-  heur_dissector_add( "tcp", dissect_bitcoin_heur, hfi_bitcoin->id);
+  initialized = TRUE;
 }
 
 /*
@@ -0,0 +1,76 @@
+/* packet-bitcoin.h
+ * Definitions for the Bitcoin (and derived networks) dissector
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __PACKET_BITCOIN_H__
+#define __PACKET_BITCOIN_H__
+
+/* Used for Bitcoin statistics; one is queued to the "bitcoin" tap per message */
+typedef struct _bitcoin_tap_info_t {
+  const gchar *network;        /* network short name, e.g. "Litecoin" */
+  const gchar *command;        /* command name, NULL if unknown */
+  guint32      payload_length;
+
+  /* Filled in for "version" messages, NULL otherwise */
+  const gchar *user_agent;
+
+  /* Filled in for "getdata" messages: milliseconds since the first
+   * requested object was announced in the capture, -1 if unknown */
+  gint         getdata_latency;
+
+  /* Filled in for "tx" and "block" messages */
+  guint32      tx_count;       /* number of transactions */
+  guint32      in_count;       /* total number of transaction inputs */
+  guint32      out_count;      /* total number of transaction outputs */
+  guint64      script_bytes;   /* total size of input and output scripts */
+  guint64      out_value;      /* total output value, in base units */
+} bitcoin_tap_info_t;
+
+/* Outcome of the coin heuristic for a TCP segment */
+typedef enum {
+  BITCOIN_HEUR_MATCH,     /* one of the network's magic numbers, the conversation is claimed */
+  BITCOIN_HEUR_MISS,      /* no magic number of an enabled network */
+  BITCOIN_HEUR_GAVE_UP,   /* a miss that used up the conversation's allowance */
+  BITCOIN_HEUR_REJECTED   /* magic number in a conversation given up on */
+} bitcoin_heur_result_t;
+
+/* Queued to the "bitcoin_heur" tap by the heuristic */
+typedef struct _bitcoin_heur_tap_info_t {
+  const gchar           *network;   /* network short name, NULL for a miss */
+  bitcoin_heur_result_t  result;
+} bitcoin_heur_tap_info_t;
+
+#endif /* __PACKET_BITCOIN_H__ */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
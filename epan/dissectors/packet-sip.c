@@ -74,6 +74,10 @@ static gint exported_pdu_tap = -1;
 static dissector_handle_t sigcomp_handle;
 static dissector_handle_t sip_diag_handle;
 
+/* Needle sets searched for in every message, compiled once */
+static ws_mempbrk_pattern pbrk_comma_semi;
+static ws_mempbrk_pattern pbrk_whitespace;
+
 /* Initialize the protocol and registered fields */
 static gint proto_sip                     = -1;
 static gint proto_raw_sip                 = -1;
@@ -1479,7 +1483,7 @@ display_sip_uri (tvbuff_t *tvb, proto_tree *sip_element_tree, uri_offset_info* u
         /* Put the contact parameters in the tree */
 
         while (current_offset < uri_offsets->name_addr_end) {
-            queried_offset = tvb_pbrk_guint8(tvb, current_offset, uri_offsets->name_addr_end - current_offset, ",;", &c);
+            queried_offset = tvb_ws_mempbrk_pattern_guint8(tvb, current_offset, uri_offsets->name_addr_end - current_offset, &pbrk_comma_semi, &c);
 
             if (queried_offset == -1) {
                 /* Reached line end */
@@ -1589,7 +1593,7 @@ dissect_sip_contact_item(tvbuff_t *tvb, packet_info *pinfo, proto_tree *tree, gi
 				/* We have an opening quote but no closing quote. */
 				current_offset = line_end_offset;
 			} else {
-				current_offset = tvb_pbrk_guint8(tvb, queried_offset+1, line_end_offset - queried_offset, ",;", &c);
+				current_offset = tvb_ws_mempbrk_pattern_guint8(tvb, queried_offset+1, line_end_offset - queried_offset, &pbrk_comma_semi, &c);
 				if(current_offset==-1){
 					/* Last parameter, line end */
 					current_offset = line_end_offset;
@@ -3112,7 +3116,7 @@ dissect_sip_common(tvbuff_t *tvb, int offset, packet_info *pinfo, proto_tree *tr
 							if (hf_index != POS_AUTHENTICATION_INFO)
 							{
 								/* The first time comma_offset is "start of parameters" */
-								comma_offset = tvb_pbrk_guint8(tvb, value_offset, line_end_offset - value_offset, " \t\r\n", NULL);
+								comma_offset = tvb_ws_mempbrk_pattern_guint8(tvb, value_offset, line_end_offset - value_offset, &pbrk_whitespace, NULL);
 								proto_tree_add_item(sip_element_tree, hf_sip_auth_scheme,
 													tvb, value_offset, comma_offset - value_offset,
 													ENC_ASCII|ENC_NA);
@@ -5465,6 +5469,9 @@ void proto_register_sip(void)
 
 	ext_hdr_subdissector_table = register_dissector_table("sip.hdr", "SIP Extension header", FT_STRING, BASE_NONE);
 
+	/* compile patterns */
+	ws_mempbrk_compile(&pbrk_comma_semi, ",;");
+	ws_mempbrk_compile(&pbrk_whitespace, " \t\r\n");
 }
 
 void
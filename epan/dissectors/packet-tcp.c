@@ -1666,6 +1666,9 @@ static reassembly_table tcp_reassembly_table;
 /* Enable desegmenting of TCP streams */
 static gboolean tcp_desegment = TRUE;
 
+/* Keep reassembled PDUs as a composite of their segments rather than copying them */
+static gboolean tcp_reassemble_composite = FALSE;
+
 static void
 desegment_tcp(tvbuff_t *tvb, packet_info *pinfo, int offset,
               guint32 seq, guint32 nxtseq,
@@ -4839,6 +4842,7 @@ static void
 tcp_init(void)
 {
     tcp_stream_count = 0;
+    tcp_reassembly_table.composite_data = tcp_reassemble_composite;
     reassembly_table_init(&tcp_reassembly_table,
                           &addresses_ports_reassembly_table_functions);
 }
@@ -5676,6 +5680,12 @@ proto_register_tcp(void)
         "Allow subdissector to reassemble TCP streams",
         "Whether subdissector can request TCP streams to be reassembled",
         &tcp_desegment);
+    prefs_register_bool_preference(tcp_module, "reassemble_composite",
+        "Reassemble TCP streams without copying",
+        "Whether reassembled PDUs should be made up of the segments' data as they are, "
+        "rather than copied into one buffer. This saves memory and time on large PDUs, "
+        "at the cost of slightly slower access to data that spans segments.",
+        &tcp_reassemble_composite);
     prefs_register_bool_preference(tcp_module, "analyze_sequence_numbers",
         "Analyze TCP sequence numbers",
         "Make the TCP dissector analyze TCP sequence numbers to find and flag segment retransmissions, missing segments and RTT",
@@ -108,6 +108,7 @@ epan_init(void (*register_all_protocols_func)(register_cb cb, gpointer client_da
         addr_resolv_init();
 
 	except_init();
+	tvbuff_init();
 #ifdef HAVE_LIBGCRYPT
 	/* initialize libgcrypt (beware, it won't be thread-safe) */
 	gcry_check_version(NULL);
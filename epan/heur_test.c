@@ -0,0 +1,210 @@
+/* heur_test.c
+ * Standalone program to test the ordering of heuristic dissectors by hit
+ * rate, with a heuristic dissector that takes a packet and then throws.
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "register.h"
+#include "emem.h"
+#include "wmem/wmem.h"
+#include "epan.h"
+#include "exceptions.h"
+#include "frame_data.h"
+#include "packet.h"
+#include "packet_info.h"
+#include "prefs.h"
+#include "tvbuff.h"
+
+/* More than the number of tries between reorderings of a list */
+#define TEST_PACKETS	2048
+
+static gboolean failed = FALSE;
+
+static heur_dissector_list_t test_heur_list;
+
+static int proto_thrower = -1;
+static int proto_taker = -1;
+
+static guint thrower_calls;
+static guint taker_calls;
+
+/* Takes packets starting with 0x42, and then throws, as on a short PDU */
+static gboolean
+dissect_thrower(tvbuff_t *tvb, packet_info *pinfo _U_, proto_tree *tree _U_, void *data _U_)
+{
+	if (tvb_get_guint8(tvb, 0) != 0x42)
+		return FALSE;
+
+	thrower_calls++;
+	tvb_get_ntohl(tvb, tvb_length(tvb));
+	return TRUE;
+}
+
+/* Takes anything */
+static gboolean
+dissect_taker(tvbuff_t *tvb _U_, packet_info *pinfo _U_, proto_tree *tree _U_, void *data _U_)
+{
+	taker_calls++;
+	return TRUE;
+}
+
+static void
+register_test_protocols(register_cb cb, gpointer client_data)
+{
+	register_all_protocols(cb, client_data);
+
+	proto_thrower = proto_register_protocol("Heuristic test, thrower", "HEURTHROW", "heurthrow");
+	proto_taker = proto_register_protocol("Heuristic test, taker", "HEURTAKE", "heurtake");
+	register_heur_dissector_list("heurtest", &test_heur_list);
+}
+
+static void
+register_test_handoffs(register_cb cb, gpointer client_data)
+{
+	register_all_protocol_handoffs(cb, client_data);
+
+	/* Added at the front; the thrower's tried first */
+	heur_dissector_add("heurtest", dissect_taker, proto_taker);
+	heur_dissector_add("heurtest", dissect_thrower, proto_thrower);
+}
+
+/* Hand a frame to the list as a dissector would; returns TRUE if it threw */
+static gboolean
+try_frame(frame_data *fd, tvbuff_t *tvb)
+{
+	packet_info        pinfo;
+	volatile gboolean  thrown = FALSE;
+
+	memset(&pinfo, 0, sizeof(pinfo));
+	pinfo.fd = fd;
+	pinfo.pool = wmem_allocator_new(WMEM_ALLOCATOR_SIMPLE);
+	pinfo.layers = wmem_list_new(pinfo.pool);
+
+	wmem_enter_packet_scope();
+	TRY {
+		dissector_try_heuristic(test_heur_list, tvb, &pinfo, NULL, NULL);
+	}
+	CATCH_ALL {
+		thrown = TRUE;
+	}
+	ENDTRY;
+	ep_free_all();
+	wmem_leave_packet_scope();
+
+	fd->flags.visited = 1;
+	g_slist_free(pinfo.proto_data);
+	wmem_destroy_allocator(pinfo.pool);
+	return thrown;
+}
+
+static void
+check(gboolean ok, const char *what)
+{
+	if (!ok) {
+		printf("Failed: %s\n", what);
+		failed = TRUE;
+	}
+}
+
+static void
+run_tests(void)
+{
+	static const guint8 magic[4] = { 0x42, 0x00, 0x00, 0x00 };
+	static const guint8 other[4] = { 0x00, 0x00, 0x00, 0x00 };
+	frame_data  *frames;
+	tvbuff_t    *tvb_magic, *tvb_other;
+	gboolean     thrown;
+	guint        i;
+
+	frames = g_new0(frame_data, TEST_PACKETS + 2);
+	for (i = 0; i < TEST_PACKETS + 2; i++)
+		frames[i].num = i + 1;
+	tvb_magic = tvb_new_real_data(magic, sizeof(magic), sizeof(magic));
+	tvb_other = tvb_new_real_data(other, sizeof(other), sizeof(other));
+
+	/* The thrower takes the first frame, and throws */
+	thrown = try_frame(&frames[0], tvb_magic);
+	check(thrown, "first pass didn't throw");
+	check(thrower_calls == 1 && taker_calls == 0, "first pass went to the wrong heuristic");
+
+	/* A revisit goes to the thrower again, and throws again */
+	thrown = try_frame(&frames[0], tvb_magic);
+	check(thrown, "revisit didn't throw");
+	check(thrower_calls == 2 && taker_calls == 0, "revisit went to the wrong heuristic");
+
+	/* The thrower turns the rest down and the taker takes them, so the
+	   list gets reordered, which it only is once the throw has been
+	   unwound past dissector_try_heuristic() */
+	for (i = 1; i <= TEST_PACKETS; i++)
+		try_frame(&frames[i], tvb_other);
+	check(taker_calls == TEST_PACKETS, "the taker didn't take the other frames");
+
+	/* So the taker's now tried first, and takes a 0x42 frame too */
+	thrower_calls = taker_calls = 0;
+	thrown = try_frame(&frames[TEST_PACKETS + 1], tvb_magic);
+	check(!thrown, "the list wasn't reordered after the throw");
+	check(thrower_calls == 0 && taker_calls == 1, "the reordered list went to the wrong heuristic");
+
+	tvb_free(tvb_magic);
+	tvb_free(tvb_other);
+	for (i = 0; i < TEST_PACKETS + 2; i++)
+		g_slist_free(frames[i].pfd);
+	g_free(frames);
+}
+
+int
+main(void)
+{
+	epan_t *session;
+
+	epan_init(register_test_protocols, register_test_handoffs, NULL, NULL);
+	session = epan_new();
+	prefs.heur_adaptive_order = TRUE;
+
+	run_tests();
+
+	epan_free(session);
+	epan_cleanup();
+
+	exit(failed?1:0);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
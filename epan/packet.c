@@ -57,6 +57,8 @@
 #include <epan/stream.h>
 #include <epan/expert.h>
 #include <epan/range.h>
+#include <epan/prefs.h>
+#include <epan/conversation.h>
 
 static gint proto_malformed = -1;
 static dissector_handle_t frame_handle = NULL;
@@ -79,6 +81,13 @@ struct data_source {
  * a "struct dtbl_entry"; it records what dissector is assigned to
  * that uint or string value in that table.
  *
+ * "direct" indexes the same entries for uint values below
+ * DTBL_DIRECT_LIMIT - which, for 8-bit and 16-bit tables, is all of
+ * them - so that looking them up doesn't need hashing; it's an array of
+ * pages of DTBL_DIRECT_PAGE_SIZE entries, a page being allocated only
+ * once something is put in it, so sparse port tables stay small.  It's
+ * NULL for string tables.
+ *
  * "dissector_handles" is a list of all dissectors that *could* be
  * used in that table; not all of them are necessarily in the table,
  * as they may be for protocols that don't have a fixed uint value,
@@ -93,8 +102,14 @@ struct data_source {
  * "base" is the base in which to display the uint value for that
  * dissector table, if it's a uint dissector table.
  */
+#define DTBL_DIRECT_PAGE_BITS	8
+#define DTBL_DIRECT_PAGE_SIZE	(1 << DTBL_DIRECT_PAGE_BITS)
+#define DTBL_DIRECT_LIMIT	0x10000
+#define DTBL_DIRECT_PAGES	(DTBL_DIRECT_LIMIT / DTBL_DIRECT_PAGE_SIZE)
+
 struct dissector_table {
 	GHashTable	*hash_table;
+	dtbl_entry_t	***direct;
 	GSList		*dissector_handles;
 	const char	*ui_name;
 	ftenum_t	type;
@@ -110,6 +125,47 @@ static GHashTable *registered_dissectors = NULL;
 
 static GHashTable *heur_dissector_lists = NULL;
 
+/*
+ * With the "protocols.heuristic_adaptive_order" preference, heuristic
+ * lists are reordered by hit rate every HEUR_REORDER_INTERVAL calls of
+ * their first dissector, and the dissector that last took a packet in a
+ * conversation is tried first for that conversation's later packets.
+ * The counters, order and memo are reset whenever dissection is
+ * (re)initialized, so a given capture is always dissected the same way.
+ * As they keep changing during the first pass, which dissector took a
+ * packet in each call is recorded with the frame, and a revisited frame
+ * (e.g. when it's selected, refiltered or in a second pass) is given to
+ * the same dissectors; revisits don't count towards the hit rates.
+ */
+#define HEUR_REORDER_INTERVAL	1024
+
+/* For registration order */
+static guint heur_serial = 0;
+
+/* Conversation index and list -> heur_dtbl_entry_t that last took one of
+   the conversation's packets */
+static wmem_tree_t *heur_memo = NULL;
+
+/* How deep we are in dissector_try_heuristic(), as a list mustn't be
+   reordered under a caller that's walking it */
+static guint heur_try_depth = 0;
+
+/* The outcome of one dissector_try_heuristic() call for a frame on the
+   first pass; they're kept in a file scoped array, in call order, as the
+   frame's "frame" protocol data */
+typedef struct {
+	heur_dissector_list_t  sub_dissectors;
+	heur_dtbl_entry_t     *winner;	/* NULL if none took the packet; the one
+					   that threw, if one did */
+} heur_frame_call_t;
+
+#define HEUR_FRAME_KEY	0x68657572	/* "heur"; the number of calls so far is
+					   kept in packet scope under it too */
+
+static gint proto_frame = -1;
+
+static void heur_dissector_lists_reset(void);
+
 static void
 destroy_heuristic_dissector_entry(gpointer data, gpointer user_data _U_)
 {
@@ -130,8 +186,14 @@ static void
 destroy_dissector_table(void *data)
 {
 	struct dissector_table *table = (struct dissector_table *)data;
+	guint i;
 
 	g_hash_table_destroy(table->hash_table);
+	if (table->direct) {
+		for (i = 0; i < DTBL_DIRECT_PAGES; i++)
+			g_free(table->direct[i]);
+		g_free(table->direct);
+	}
 	g_slist_free(table->dissector_handles);
 	g_slice_free(struct dissector_table, data);
 }
@@ -147,6 +209,8 @@ packet_init(void)
 
 	heur_dissector_lists = g_hash_table_new_full(g_str_hash, g_str_equal,
 			NULL, destroy_heuristic_dissector_list);
+
+	heur_memo = wmem_tree_new_autoreset(wmem_epan_scope(), wmem_file_scope());
 }
 
 void
@@ -163,6 +227,8 @@ packet_cache_proto_handles(void)
 
 	proto_malformed = proto_get_id_by_filter_name("_ws.malformed");
 	g_assert(proto_malformed != -1);
+
+	proto_frame = dissector_handle_get_protocol_index(frame_handle);
 }
 
 void
@@ -249,6 +315,9 @@ init_dissection(void)
 
 	/* Initialize the expert infos */
 	expert_packet_init();
+
+	/* Put the heuristic dissectors back in registration order */
+	heur_dissector_lists_reset();
 }
 
 void
@@ -846,10 +915,56 @@ find_uint_dtbl_entry(dissector_table_t sub_dissectors, const guint32 pattern)
 	/*
 	 * Find the entry.
 	 */
+	if (pattern < DTBL_DIRECT_LIMIT) {
+		dtbl_entry_t **page = sub_dissectors->direct[pattern >> DTBL_DIRECT_PAGE_BITS];
+
+		return page ? page[pattern & (DTBL_DIRECT_PAGE_SIZE - 1)] : NULL;
+	}
 	return (dtbl_entry_t *)g_hash_table_lookup(sub_dissectors->hash_table,
 				   GUINT_TO_POINTER(pattern));
 }
 
+/* Set (or, if dtbl_entry is NULL, clear) the direct index slot for a
+   pattern, if it has one. */
+static void
+set_uint_dtbl_direct(dissector_table_t sub_dissectors, const guint32 pattern,
+		     dtbl_entry_t *dtbl_entry)
+{
+	dtbl_entry_t **page;
+
+	if (pattern >= DTBL_DIRECT_LIMIT)
+		return;
+
+	page = sub_dissectors->direct[pattern >> DTBL_DIRECT_PAGE_BITS];
+	if (page == NULL) {
+		if (dtbl_entry == NULL)
+			return;
+		page = g_new0(dtbl_entry_t *, DTBL_DIRECT_PAGE_SIZE);
+		sub_dissectors->direct[pattern >> DTBL_DIRECT_PAGE_BITS] = page;
+	}
+	page[pattern & (DTBL_DIRECT_PAGE_SIZE - 1)] = dtbl_entry;
+}
+
+/* Put an entry into a uint dissector table, replacing (and freeing) any
+   entry already there for that pattern. */
+static void
+insert_uint_dtbl_entry(dissector_table_t sub_dissectors, const guint32 pattern,
+		       dtbl_entry_t *dtbl_entry)
+{
+	g_hash_table_insert(sub_dissectors->hash_table,
+			    GUINT_TO_POINTER(pattern), (gpointer)dtbl_entry);
+	set_uint_dtbl_direct(sub_dissectors, pattern, dtbl_entry);
+}
+
+/* Remove (and free) the entry for a pattern in a uint dissector table. */
+static void
+remove_uint_dtbl_entry(dissector_table_t sub_dissectors, const guint32 pattern)
+{
+	set_uint_dtbl_direct(sub_dissectors, pattern, NULL);
+	g_hash_table_remove(sub_dissectors->hash_table,
+			    GUINT_TO_POINTER(pattern));
+}
+
 #if 0
 static void
 dissector_add_uint_sanity_check(const char *name, guint32 pattern, dissector_handle_t handle, dissector_table_t sub_dissectors)
@@ -922,8 +1037,7 @@ dissector_add_uint(const char *name, const guint32 pattern, dissector_handle_t h
 	dtbl_entry->initial = dtbl_entry->current;
 
 	/* do the table insertion */
-	g_hash_table_insert( sub_dissectors->hash_table,
-			     GUINT_TO_POINTER( pattern), (gpointer)dtbl_entry);
+	insert_uint_dtbl_entry(sub_dissectors, pattern, dtbl_entry);
 
 	/*
 	 * Now add it to the list of handles that could be used with this
@@ -974,8 +1088,7 @@ dissector_delete_uint(const char *name, const guint32 pattern,
 		/*
 		 * Found - remove it.
 		 */
-		g_hash_table_remove(sub_dissectors->hash_table,
-				    GUINT_TO_POINTER(pattern));
+		remove_uint_dtbl_entry(sub_dissectors, pattern);
 	}
 }
 
@@ -992,22 +1105,36 @@ void dissector_delete_uint_range(const char *abbrev, range_t *range,
 	}
 }
 
+typedef struct {
+	dissector_table_t  sub_dissectors;
+	dissector_handle_t handle;
+} delete_all_info_t;
+
 static gboolean
-dissector_delete_all_check (gpointer key _U_, gpointer value, gpointer user_data)
+dissector_delete_all_check (gpointer key, gpointer value, gpointer user_data)
 {
 	dtbl_entry_t *dtbl_entry = (dtbl_entry_t *) value;
-	dissector_handle_t handle = (dissector_handle_t) user_data;
+	delete_all_info_t *info = (delete_all_info_t *) user_data;
+
+	if (proto_get_id (dtbl_entry->current->protocol) != proto_get_id (info->handle->protocol))
+		return FALSE;
 
-	return (proto_get_id (dtbl_entry->current->protocol) == proto_get_id (handle->protocol));
+	if (info->sub_dissectors->direct)
+		set_uint_dtbl_direct(info->sub_dissectors, GPOINTER_TO_UINT(key), NULL);
+	return TRUE;
 }
 
 /* Delete all entries from a dissector table. */
 void dissector_delete_all(const char *name, dissector_handle_t handle)
 {
 	dissector_table_t sub_dissectors = find_dissector_table(name);
+	delete_all_info_t info;
+
 	g_assert (sub_dissectors);
 
-	g_hash_table_foreach_remove (sub_dissectors->hash_table, dissector_delete_all_check, handle);
+	info.sub_dissectors = sub_dissectors;
+	info.handle = handle;
+	g_hash_table_foreach_remove (sub_dissectors->hash_table, dissector_delete_all_check, &info);
 }
 
 /* Change the entry for a dissector in a uint dissector table
@@ -1043,8 +1170,7 @@ dissector_change_uint(const char *name, const guint32 pattern, dissector_handle_
 	dtbl_entry->current = handle;
 
 	/* do the table insertion */
-	g_hash_table_insert( sub_dissectors->hash_table,
-			     GUINT_TO_POINTER( pattern), (gpointer)dtbl_entry);
+	insert_uint_dtbl_entry(sub_dissectors, pattern, dtbl_entry);
 }
 
 /* Reset an entry in a uint dissector table to its initial value. */
@@ -1071,8 +1197,7 @@ dissector_reset_uint(const char *name, const guint32 pattern)
 	if (dtbl_entry->initial != NULL) {
 		dtbl_entry->current = dtbl_entry->initial;
 	} else {
-		g_hash_table_remove(sub_dissectors->hash_table,
-				    GUINT_TO_POINTER(pattern));
+		remove_uint_dtbl_entry(sub_dissectors, pattern);
 	}
 }
 
@@ -1778,6 +1903,7 @@ register_dissector_table(const char *name, const char *ui_name, const ftenum_t t
 							       g_direct_equal,
 							       NULL,
 							       &g_free );
+		sub_dissectors->direct = g_new0(dtbl_entry_t **, DTBL_DIRECT_PAGES);
 		break;
 
 	case FT_STRING:
@@ -1786,6 +1912,7 @@ register_dissector_table(const char *name, const char *ui_name, const ftenum_t t
 							       g_str_equal,
 							       &g_free,
 							       &g_free );
+		sub_dissectors->direct = NULL;
 		break;
 
 	default:
@@ -1862,6 +1989,9 @@ heur_dissector_add(const char *name, heur_dissector_t dissector, const int proto
 	hdtbl_entry->dissector = dissector;
 	hdtbl_entry->protocol  = find_protocol_by_id(proto);
 	hdtbl_entry->enabled   = TRUE;
+	hdtbl_entry->serial    = heur_serial++;
+	hdtbl_entry->tries     = 0;
+	hdtbl_entry->accepts   = 0;
 
 	/* do the table insertion */
 	*sub_dissectors = g_slist_prepend(*sub_dissectors, (gpointer)hdtbl_entry);
@@ -1921,6 +2051,206 @@ heur_dissector_set_enabled(const char *name, heur_dissector_t dissector, const i
 	}
 }
 
+/* Higher hit rate first; ties, including never tried, in registration
+   order, so that the order only depends on the packets seen */
+static int
+compare_heur_hit_rate(const void *a, const void *b)
+{
+	const heur_dtbl_entry_t *hdtbl_entry_a = *(const heur_dtbl_entry_t * const *) a;
+	const heur_dtbl_entry_t *hdtbl_entry_b = *(const heur_dtbl_entry_t * const *) b;
+	guint64 rate_a = hdtbl_entry_a->accepts * hdtbl_entry_b->tries;
+	guint64 rate_b = hdtbl_entry_b->accepts * hdtbl_entry_a->tries;
+
+	if (rate_a != rate_b)
+		return rate_a > rate_b ? -1 : 1;
+	if (hdtbl_entry_a->serial != hdtbl_entry_b->serial)
+		return hdtbl_entry_a->serial > hdtbl_entry_b->serial ? -1 : 1;
+	return 0;
+}
+
+static int
+compare_heur_serial(const void *a, const void *b)
+{
+	const heur_dtbl_entry_t *hdtbl_entry_a = *(const heur_dtbl_entry_t * const *) a;
+	const heur_dtbl_entry_t *hdtbl_entry_b = *(const heur_dtbl_entry_t * const *) b;
+
+	if (hdtbl_entry_a->serial != hdtbl_entry_b->serial)
+		return hdtbl_entry_a->serial > hdtbl_entry_b->serial ? -1 : 1;
+	return 0;
+}
+
+/* Sort the entries of a heuristic list. The entries are moved between the
+   list's links, rather than relinking it, as callers hold on to its head. */
+static void
+sort_heur_dissector_list(heur_dissector_list_t sub_dissectors,
+			 int (*compare)(const void *, const void *))
+{
+	heur_dtbl_entry_t **entries;
+	GSList             *entry;
+	guint               n, i;
+
+	n = g_slist_length(sub_dissectors);
+	if (n < 2)
+		return;
+
+	entries = g_new(heur_dtbl_entry_t *, n);
+	for (i = 0, entry = sub_dissectors; entry != NULL; i++, entry = g_slist_next(entry))
+		entries[i] = (heur_dtbl_entry_t *)entry->data;
+
+	qsort(entries, n, sizeof entries[0], compare);
+
+	for (i = 0, entry = sub_dissectors; entry != NULL; i++, entry = g_slist_next(entry))
+		entry->data = entries[i];
+	g_free(entries);
+}
+
+static void
+reset_heur_dissector_list(gpointer key _U_, gpointer value, gpointer user_data _U_)
+{
+	heur_dissector_list_t  sub_dissectors = *(heur_dissector_list_t *)value;
+	GSList                *entry;
+	heur_dtbl_entry_t     *hdtbl_entry;
+
+	for (entry = sub_dissectors; entry != NULL; entry = g_slist_next(entry)) {
+		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+		hdtbl_entry->tries   = 0;
+		hdtbl_entry->accepts = 0;
+	}
+	sort_heur_dissector_list(sub_dissectors, compare_heur_serial);
+}
+
+/* Zero the counters of all the heuristic lists and put them back in
+   registration order. (The memo is file scoped, so goes by itself.) */
+static void
+heur_dissector_lists_reset(void)
+{
+	g_hash_table_foreach(heur_dissector_lists, reset_heur_dissector_list, NULL);
+}
+
+/* The memo is keyed by the conversation and the list's head */
+static void
+heur_memo_key(wmem_tree_key_t *key, guint32 *key_data,
+	      const conversation_t *conversation, heur_dissector_list_t sub_dissectors)
+{
+	guint64 list = (guint64)GPOINTER_TO_SIZE(sub_dissectors);
+
+	key_data[0] = conversation->index;
+	key_data[1] = (guint32)list;
+	key_data[2] = (guint32)(list >> 32);
+	key[0].length = 3;
+	key[0].key    = key_data;
+	key[1].length = 0;
+	key[1].key    = NULL;
+}
+
+static gboolean
+heur_dissector_is_enabled(const heur_dtbl_entry_t *hdtbl_entry)
+{
+	return hdtbl_entry->protocol == NULL ||
+		(proto_is_protocol_enabled(hdtbl_entry->protocol) && hdtbl_entry->enabled);
+}
+
+/* Call one heuristic dissector; returns TRUE if it took the packet */
+static gboolean
+call_heur_dissector(heur_dtbl_entry_t *hdtbl_entry, tvbuff_t *tvb,
+		    packet_info *pinfo, proto_tree *tree, void *data,
+		    const guint saved_layers_len)
+{
+	if (hdtbl_entry->protocol != NULL) {
+		pinfo->current_proto =
+			proto_get_protocol_short_name(hdtbl_entry->protocol);
+
+		/*
+		 * Add the protocol name to the layers; we'll remove it
+		 * if the dissector fails.
+		 */
+		wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_get_id(hdtbl_entry->protocol)));
+	}
+	EP_CHECK_CANARY(("before calling heuristic dissector for protocol: %s",
+			 proto_get_protocol_filter_name(proto_get_id(hdtbl_entry->protocol))));
+	if (!pinfo->fd->flags.visited)
+		hdtbl_entry->tries++;
+	if ((*hdtbl_entry->dissector)(tvb, pinfo, tree, data)) {
+		EP_CHECK_CANARY(("after heuristic dissector for protocol: %s has accepted and dissected packet",
+				 proto_get_protocol_filter_name(proto_get_id(hdtbl_entry->protocol))));
+		if (!pinfo->fd->flags.visited)
+			hdtbl_entry->accepts++;
+		return TRUE;
+	}
+
+	EP_CHECK_CANARY(("after heuristic dissector for protocol: %s has returned false",
+			 proto_get_protocol_filter_name(proto_get_id(hdtbl_entry->protocol))));
+
+	/*
+	 * That dissector didn't accept the packet, so
+	 * remove its protocol's name from the list
+	 * of protocols.
+	 */
+	while (wmem_list_count(pinfo->layers) > saved_layers_len) {
+		wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+	}
+	return FALSE;
+}
+
+/* Number this dissector_try_heuristic() call among the frame's calls.
+   On the first pass, make room for its outcome (calls are numbered as
+   they start, but nested ones end first) and return NULL; on a revisit,
+   return what the call with that number did on the first pass, if it was
+   on the same list, or NULL */
+static heur_frame_call_t *
+heur_frame_call(heur_dissector_list_t sub_dissectors, packet_info *pinfo, guint *call_num)
+{
+	guint             *num_calls;
+	wmem_array_t      *calls;
+	heur_frame_call_t *call;
+	heur_frame_call_t  new_call;
+
+	num_calls = (guint *)p_get_proto_data(pinfo->pool, pinfo, proto_frame, HEUR_FRAME_KEY);
+	if (num_calls == NULL) {
+		num_calls = wmem_new0(pinfo->pool, guint);
+		p_add_proto_data(pinfo->pool, pinfo, proto_frame, HEUR_FRAME_KEY, num_calls);
+	}
+	*call_num = (*num_calls)++;
+
+	calls = (wmem_array_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto_frame, HEUR_FRAME_KEY);
+
+	if (!pinfo->fd->flags.visited) {
+		if (calls == NULL) {
+			calls = wmem_array_new(wmem_file_scope(), sizeof(heur_frame_call_t));
+			p_add_proto_data(wmem_file_scope(), pinfo, proto_frame, HEUR_FRAME_KEY, calls);
+		}
+		if (*call_num == wmem_array_get_count(calls)) {
+			new_call.sub_dissectors = sub_dissectors;
+			new_call.winner         = NULL;
+			wmem_array_append(calls, &new_call, 1);
+		}
+		return NULL;
+	}
+
+	if (calls == NULL || *call_num >= wmem_array_get_count(calls))
+		return NULL;
+
+	call = (heur_frame_call_t *)wmem_array_index(calls, *call_num);
+	return call->sub_dissectors == sub_dissectors ? call : NULL;
+}
+
+/* Record what a dissector_try_heuristic() call did on the first pass */
+static void
+heur_frame_call_record(heur_dissector_list_t sub_dissectors, packet_info *pinfo,
+		       guint call_num, heur_dtbl_entry_t *winner)
+{
+	wmem_array_t      *calls;
+	heur_frame_call_t *call;
+
+	calls = (wmem_array_t *)p_get_proto_data(wmem_file_scope(), pinfo, proto_frame, HEUR_FRAME_KEY);
+	if (calls == NULL || call_num >= wmem_array_get_count(calls))
+		return;
+
+	call = (heur_frame_call_t *)wmem_array_index(calls, call_num);
+	if (call->sub_dissectors == sub_dissectors)
+		call->winner = winner;
+}
+
 gboolean
 dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 			packet_info *pinfo, proto_tree *tree, void *data)
@@ -1929,6 +2259,15 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 	const char        *saved_proto;
 	GSList            *entry;
 	heur_dtbl_entry_t *hdtbl_entry;
+	heur_dtbl_entry_t *memo_entry   = NULL;
+	heur_dtbl_entry_t * volatile first_tried = NULL;
+	heur_dtbl_entry_t * volatile winner      = NULL;
+	heur_dtbl_entry_t * volatile trying      = NULL;
+	heur_frame_call_t *frame_call   = NULL;
+	guint              call_num     = 0;
+	conversation_t    *conversation = NULL;
+	wmem_tree_key_t    memo_key[2];
+	guint32            memo_key_data[3];
 	guint16            saved_can_desegment;
 	guint              saved_layers_len = 0;
 
@@ -1950,50 +2289,93 @@ dissector_try_heuristic(heur_dissector_list_t sub_dissectors, tvbuff_t *tvb,
 
 	saved_layers_len = wmem_list_count(pinfo->layers);
 
-	for (entry = sub_dissectors; entry != NULL; entry = g_slist_next(entry)) {
-		/* XXX - why set this now and above? */
-		pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
-		hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+	if (prefs.heur_adaptive_order)
+		frame_call = heur_frame_call(sub_dissectors, pinfo, &call_num);
 
-		if (hdtbl_entry->protocol != NULL &&
-		    (!proto_is_protocol_enabled(hdtbl_entry->protocol)||(hdtbl_entry->enabled==FALSE))) {
-			/*
-			 * No - don't try this dissector.
-			 */
-			continue;
-		}
+	/* It may have been removed from the list or disabled since */
+	if (frame_call != NULL && frame_call->winner != NULL &&
+	    (g_slist_find(sub_dissectors, frame_call->winner) == NULL ||
+	     !heur_dissector_is_enabled(frame_call->winner)))
+		frame_call = NULL;
 
-		if (hdtbl_entry->protocol != NULL) {
-			pinfo->current_proto =
-				proto_get_protocol_short_name(hdtbl_entry->protocol);
+	if (frame_call != NULL) {
+		/* A revisit: the order and memo have moved on since the first
+		   pass, so hand the packet to what took it then, if anything */
+		if (frame_call->winner != NULL)
+			status = call_heur_dissector(frame_call->winner, tvb, pinfo, tree, data, saved_layers_len);
+		pinfo->current_proto = saved_proto;
+		pinfo->can_desegment=saved_can_desegment;
+		return status;
+	}
 
-			/*
-			 * Add the protocol name to the layers; we'll remove it
-			 * if the dissector fails.
-			 */
-			wmem_list_append(pinfo->layers, GINT_TO_POINTER(proto_get_id(hdtbl_entry->protocol)));
+	heur_try_depth++;
+
+	/* A heuristic dissector that takes the packet may then throw, on a
+	   short or malformed PDU; the depth has to be put back, and what it
+	   did recorded, either way.  trying is the one being called, if it
+	   hasn't returned (yet). */
+	TRY {
+		/* Try whatever took this conversation's last packet first */
+		if (prefs.heur_adaptive_order && !pinfo->fd->flags.visited) {
+			conversation = find_conversation(pinfo->fd->num, &pinfo->src, &pinfo->dst,
+							 pinfo->ptype, pinfo->srcport, pinfo->destport, 0);
+			if (conversation != NULL) {
+				heur_memo_key(memo_key, memo_key_data, conversation, sub_dissectors);
+				memo_entry = (heur_dtbl_entry_t *)wmem_tree_lookup32_array(heur_memo, memo_key);
+				/* It may have been removed from the list since */
+				if (memo_entry != NULL && g_slist_find(sub_dissectors, memo_entry) == NULL)
+					memo_entry = NULL;
+			}
+			if (memo_entry != NULL && heur_dissector_is_enabled(memo_entry)) {
+				trying = memo_entry;
+				status = call_heur_dissector(memo_entry, tvb, pinfo, tree, data, saved_layers_len);
+				trying = NULL;
+				if (status)
+					winner = memo_entry;
+			}
 		}
-		EP_CHECK_CANARY(("before calling heuristic dissector for protocol: %s",
-				 proto_get_protocol_filter_name(proto_get_id(hdtbl_entry->protocol))));
-		if ((*hdtbl_entry->dissector)(tvb, pinfo, tree, data)) {
-			EP_CHECK_CANARY(("after heuristic dissector for protocol: %s has accepted and dissected packet",
-					 proto_get_protocol_filter_name(proto_get_id(hdtbl_entry->protocol))));
-			status = TRUE;
-			break;
-		} else {
-			EP_CHECK_CANARY(("after heuristic dissector for protocol: %s has returned false",
-					 proto_get_protocol_filter_name(proto_get_id(hdtbl_entry->protocol))));
 
-			/*
-			 * That dissector didn't accept the packet, so
-			 * remove its protocol's name from the list
-			 * of protocols.
-			 */
-			while (wmem_list_count(pinfo->layers) > saved_layers_len) {
-				wmem_list_remove_frame(pinfo->layers, wmem_list_tail(pinfo->layers));
+		for (entry = sub_dissectors; !status && entry != NULL; entry = g_slist_next(entry)) {
+			/* XXX - why set this now and above? */
+			pinfo->can_desegment = saved_can_desegment-(saved_can_desegment>0);
+			hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+
+			if (hdtbl_entry == memo_entry || !heur_dissector_is_enabled(hdtbl_entry)) {
+				/*
+				 * No - don't try this dissector (again).
+				 */
+				continue;
+			}
+
+			if (first_tried == NULL)
+				first_tried = hdtbl_entry;
+
+			trying = hdtbl_entry;
+			if (call_heur_dissector(hdtbl_entry, tvb, pinfo, tree, data, saved_layers_len)) {
+				status = TRUE;
+				winner = hdtbl_entry;
+				if (conversation != NULL)
+					wmem_tree_insert32_array(heur_memo, memo_key, hdtbl_entry);
 			}
+			trying = NULL;
 		}
 	}
+	FINALLY {
+		heur_try_depth--;
+
+		if (prefs.heur_adaptive_order && !pinfo->fd->flags.visited) {
+			/* If one threw, a revisit goes to it again, so that it
+			   dissects (and throws) as it did this time */
+			heur_frame_call_record(sub_dissectors, pinfo, call_num,
+					       winner != NULL ? winner : trying);
+
+			if (heur_try_depth == 0 &&
+			    first_tried != NULL && first_tried->tries % HEUR_REORDER_INTERVAL == 0)
+				sort_heur_dissector_list(sub_dissectors, compare_heur_hit_rate);
+		}
+	}
+	ENDTRY;
+
 	pinfo->current_proto = saved_proto;
 	pinfo->can_desegment=saved_can_desegment;
 	return status;
@@ -342,6 +342,9 @@ typedef struct {
 	heur_dissector_t dissector;
 	protocol_t *protocol;
 	gboolean enabled;
+	guint serial;		/* registration order, later ones first in the list */
+	guint64 tries;		/* times called since the capture was opened */
+	guint64 accepts;	/* times it took the packet */
 } heur_dtbl_entry_t;
 
 /** A protocol uses this function to register a heuristic sub-dissector list.
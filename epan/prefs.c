@@ -2581,6 +2581,17 @@ prefs_register_modules(void)
                                    "Display all hidden protocol items in the packet list.",
                                    &prefs.display_hidden_proto_items);
 
+    prefs_register_bool_preference(protocols_module, "heuristic_adaptive_order",
+                                   "Try heuristic dissectors by hit rate",
+                                   "Try the heuristic sub-dissectors that most often recognize "
+                                   "packets first, and the one that recognized a conversation's "
+                                   "last packet before any other, instead of always trying them "
+                                   "in the same order. This is faster, but if more than one of "
+                                   "them would recognize a packet, which one gets it depends on "
+                                   "the packets before it (the same ones each time the capture "
+                                   "is dissected).",
+                                   &prefs.heur_adaptive_order);
+
     /* Obsolete preferences
      * These "modules" were reorganized/renamed to correspond to their GUI
      * configuration screen within the preferences dialog
@@ -3024,6 +3035,7 @@ pre_init_prefs(void)
   prefs.st_sort_defdescending = TRUE;
   prefs.st_sort_showfullname = FALSE;
   prefs.display_hidden_proto_items = FALSE;
+  prefs.heur_adaptive_order = FALSE;
 
   prefs_pre_initialized = TRUE;
 }
@@ -204,6 +204,7 @@ typedef struct _e_prefs {
   guint        rtp_player_max_visible;
   guint        tap_update_interval;
   gboolean     display_hidden_proto_items;
+  gboolean     heur_adaptive_order;
   gpointer     filter_expressions;	/* Actually points to &head */
   gboolean     gui_update_enabled;
   software_update_channel_e gui_update_channel;
@@ -304,6 +304,31 @@ static gpa_hfinfo_t gpa_hfinfo;
 
 /* Balanced tree of abbreviations and IDs */
 static GTree *gpa_name_tree = NULL;
+
+/*
+ * Fields primed as referenced, as a bitset indexed by field ID, and
+ * for each of them its slot in a tree's interesting_hfids (plus one, so
+ * that 0 means none). Slots are handed out once and kept, so a tree
+ * need only have an array as long as the number of fields ever primed.
+ *
+ * Primed fields stay referenced from one tree to the next, until
+ * proto_clear_referenced_fields() is called (e.g. when a filter is freed)
+ * and bumps the generation, so that a filter's fields need only be
+ * primed once per generation rather than for every packet.
+ */
+static guint32 *referenced_hfids     = NULL;
+static gint    *interesting_slots    = NULL;
+static guint    referenced_hfids_len = 0;	/* in field IDs */
+static gint    *slot_hfids           = NULL;	/* field ID of each slot */
+static guint    num_slots            = 0;
+static guint    referenced_generation = 1;
+
+/*
+ * The pool of the last tree freed, kept for the next one, as trees are
+ * typically created and freed for every packet.
+ */
+static wmem_allocator_t *tree_pool_cache = NULL;
+
 static header_field_info *same_name_hfinfo;
 
 static void save_same_name_hfinfo(gpointer data)
@@ -324,6 +349,9 @@ static GHashTable* proto_names        = NULL;
 static GHashTable* proto_short_names  = NULL;
 static GHashTable* proto_filter_names = NULL;
 
+/* indexed by alias prefix, contains the prefix it stands for */
+static GHashTable* prefix_aliases = NULL;
+
 static gint
 proto_compare_name(gconstpointer p1_arg, gconstpointer p2_arg)
 {
@@ -529,6 +557,11 @@ proto_cleanup(void)
 		proto_filter_names = NULL;
 	}
 
+	if (prefix_aliases) {
+		g_hash_table_destroy(prefix_aliases);
+		prefix_aliases = NULL;
+	}
+
 	if (gpa_hfinfo.allocated_len) {
 		gpa_hfinfo.len           = 0;
 		gpa_hfinfo.allocated_len = 0;
@@ -537,6 +570,21 @@ proto_cleanup(void)
 	}
 	g_free(tree_is_expanded);
 	tree_is_expanded = NULL;
+
+	g_free(referenced_hfids);
+	referenced_hfids = NULL;
+	g_free(interesting_slots);
+	interesting_slots = NULL;
+	referenced_hfids_len = 0;
+	g_free(slot_hfids);
+	slot_hfids = NULL;
+	num_slots = 0;
+	referenced_generation++;
+
+	if (tree_pool_cache) {
+		wmem_destroy_allocator(tree_pool_cache);
+		tree_pool_cache = NULL;
+	}
 }
 
 static gboolean
@@ -611,27 +659,88 @@ proto_tree_children_foreach(proto_tree *tree, proto_tree_foreach_func func,
 }
 
 static void
-free_GPtrArray_value(gpointer key, gpointer value, gpointer user_data _U_)
+referenced_hfids_set(const gint hfid, const gboolean referenced)
 {
-	GPtrArray         *ptrs = (GPtrArray *)value;
-	gint               hfid = (gint)(long)key;
-	header_field_info *hfinfo;
+	guint new_len;
 
-	PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
-	if (hfinfo->ref_type != HF_REF_TYPE_NONE) {
-		/* when a field is referenced by a filter this also
-		   affects the refcount for the parent protocol so we need
-		   to adjust the refcount for the parent as well
-		*/
-		if (hfinfo->parent != -1) {
-			header_field_info *parent_hfinfo;
-			PROTO_REGISTRAR_GET_NTH(hfinfo->parent, parent_hfinfo);
-			parent_hfinfo->ref_type = HF_REF_TYPE_NONE;
+	if ((guint)hfid >= referenced_hfids_len) {
+		if (!referenced)
+			return;
+
+		new_len = referenced_hfids_len ? referenced_hfids_len : 1024;
+		while (new_len <= (guint)hfid)
+			new_len *= 2;
+
+		referenced_hfids = (guint32 *)g_realloc(referenced_hfids, new_len / 8);
+		memset(referenced_hfids + referenced_hfids_len / 32, 0,
+		       (new_len - referenced_hfids_len) / 8);
+		interesting_slots = (gint *)g_realloc(interesting_slots, new_len * sizeof(gint));
+		memset(interesting_slots + referenced_hfids_len, 0,
+		       (new_len - referenced_hfids_len) * sizeof(gint));
+		referenced_hfids_len = new_len;
+	}
+
+	if (referenced) {
+		referenced_hfids[hfid >> 5] |= 1U << (hfid & 31);
+		if (!interesting_slots[hfid]) {
+			slot_hfids = (gint *)g_realloc(slot_hfids, (num_slots + 1) * sizeof(gint));
+			slot_hfids[num_slots++] = hfid;
+			interesting_slots[hfid] = num_slots;
 		}
-		hfinfo->ref_type = HF_REF_TYPE_NONE;
+	} else {
+		referenced_hfids[hfid >> 5] &= ~(1U << (hfid & 31));
 	}
+}
 
-	g_ptr_array_free(ptrs, TRUE);
+/* Forget all the fields primed so far; they have to be primed again */
+void
+proto_clear_referenced_fields(void)
+{
+	gint               hfid;
+	header_field_info *hfinfo;
+	guint              i;
+
+	for (i = 0; i < num_slots; i++) {
+		hfid = slot_hfids[i];
+		PROTO_REGISTRAR_GET_NTH(hfid, hfinfo);
+		if (hfinfo->ref_type != HF_REF_TYPE_NONE) {
+			/* when a field is referenced by a filter this also
+			   affects the refcount for the parent protocol so we need
+			   to adjust the refcount for the parent as well
+			*/
+			if (hfinfo->parent != -1) {
+				header_field_info *parent_hfinfo;
+				PROTO_REGISTRAR_GET_NTH(hfinfo->parent, parent_hfinfo);
+				parent_hfinfo->ref_type = HF_REF_TYPE_NONE;
+				referenced_hfids_set(hfinfo->parent, FALSE);
+			}
+			hfinfo->ref_type = HF_REF_TYPE_NONE;
+			referenced_hfids_set(hfid, FALSE);
+		}
+	}
+
+	referenced_generation++;
+}
+
+guint
+proto_referenced_fields_generation(void)
+{
+	return referenced_generation;
+}
+
+static void
+free_interesting_hfids(tree_data_t *tree_data)
+{
+	guint i;
+
+	for (i = 0; i < tree_data->num_interesting_hfids; i++) {
+		if (tree_data->interesting_hfids[i])
+			g_ptr_array_free(tree_data->interesting_hfids[i], TRUE);
+	}
+
+	g_free(tree_data->interesting_hfids);
+	tree_data->interesting_hfids = NULL;
+	tree_data->num_interesting_hfids = 0;
 }
 
 static void
@@ -652,20 +761,15 @@ proto_tree_reset(proto_tree *tree)
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
-
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
-
-		tree_data->interesting_hfids = NULL;
-	}
+	if (tree_data->interesting_hfids)
+		free_interesting_hfids(tree_data);
 
 	/* Reset track of the number of children */
 	tree_data->count = 0;
 
+	/* All the nodes are gone, so their memory can go in one go */
+	wmem_free_all(tree_data->pool);
+
 	PROTO_NODE_INIT(tree);
 }
 
@@ -678,13 +782,15 @@ proto_tree_free(proto_tree *tree)
 	proto_tree_children_foreach(tree, proto_tree_free_node, NULL);
 
 	/* free tree data */
-	if (tree_data->interesting_hfids) {
-		/* Free all the GPtrArray's in the interesting_hfids hash. */
-		g_hash_table_foreach(tree_data->interesting_hfids,
-			free_GPtrArray_value, NULL);
+	if (tree_data->interesting_hfids)
+		free_interesting_hfids(tree_data);
 
-		/* And then destroy the hash. */
-		g_hash_table_destroy(tree_data->interesting_hfids);
+	if (tree_pool_cache == NULL) {
+		wmem_free_all(tree_data->pool);
+		tree_pool_cache = tree_data->pool;
+	}
+	else {
+		wmem_destroy_allocator(tree_data->pool);
 	}
 
 	g_slice_free(tree_data_t, tree_data);
@@ -741,6 +847,30 @@ proto_field_is_referenced(proto_tree *tree, int proto_id)
 	return FALSE;
 }
 
+gboolean
+proto_fields_are_referenced(proto_tree *tree, const int *field_ids, int num_fields)
+{
+	guint hfid;
+	int   i;
+
+	if (!tree)
+		return FALSE;
+
+	if (PTREE_DATA(tree)->visible)
+		return TRUE;
+
+	for (i = 0; i < num_fields; i++) {
+		DISSECTOR_ASSERT(field_ids[i] >= 0);
+
+		hfid = field_ids[i];
+		if (hfid < referenced_hfids_len &&
+		    (referenced_hfids[hfid >> 5] & (1U << (hfid & 31))))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 
 /* Finds a record in the hfinfo array by id. */
 header_field_info *
@@ -828,9 +958,20 @@ proto_initialize_all_prefixes(void) {
 	g_hash_table_foreach_remove(prefixes, initialize_prefix, NULL);
 }
 
+/* Make the fields under one prefix also reachable under another */
+void
+proto_register_prefix_alias(const char *alias, const char *prefix) {
+	if (! prefix_aliases ) {
+		prefix_aliases = g_hash_table_new(prefix_hash, prefix_equal);
+	}
+
+	g_hash_table_insert(prefix_aliases, (gpointer)alias, (gpointer)prefix);
+}
+
 /* Finds a record in the hfinfo array by name.
  * If it fails to find it in the already registered fields,
- * it tries to find and call an initializer in the prefixes
+ * it tries the prefix the field's prefix is an alias for, if any,
+ * then tries to find and call an initializer in the prefixes
  * table and if so it looks again.
  */
 header_field_info *
@@ -838,6 +979,8 @@ proto_registrar_get_byname(const char *field_name)
 {
 	header_field_info    *hfinfo;
 	prefix_initializer_t  pi;
+	const char           *prefix;
+	const char           *dot;
 
 	if (!field_name)
 		return NULL;
@@ -847,6 +990,15 @@ proto_registrar_get_byname(const char *field_name)
 	if (hfinfo)
 		return hfinfo;
 
+	if (prefix_aliases && (dot = strchr(field_name, '.')) != NULL &&
+	    (prefix = (const char *)g_hash_table_lookup(prefix_aliases, field_name)) != NULL) {
+		gchar *aliased_name = g_strconcat(prefix, dot, NULL);
+
+		hfinfo = proto_registrar_get_byname(aliased_name);
+		g_free(aliased_name);
+		return hfinfo;
+	}
+
 	if (!prefixes)
 		return NULL;
 
@@ -1266,20 +1418,28 @@ tree_data_add_maybe_interesting_field(tree_data_t *tree_data, field_info *fi)
 	const header_field_info *hfinfo = fi->hfinfo;
 
 	if (hfinfo->ref_type == HF_REF_TYPE_DIRECT) {
-		GPtrArray *ptrs = NULL;
+		GPtrArray *ptrs;
+		guint      slot;
 
-		if (tree_data->interesting_hfids == NULL) {
-			/* Initialize the hash because we now know that it is needed */
-			tree_data->interesting_hfids =
-				g_hash_table_new(g_direct_hash, NULL /* g_direct_equal */);
-		} else
-			ptrs = (GPtrArray *)g_hash_table_lookup(tree_data->interesting_hfids,
-					   GINT_TO_POINTER(hfinfo->id));
+		/* Primed fields all have a slot; the array may predate it */
+		slot = (guint)hfinfo->id < referenced_hfids_len ? interesting_slots[hfinfo->id] : 0;
+		if (slot == 0)
+			return;
+		slot--;
+
+		if (slot >= tree_data->num_interesting_hfids) {
+			tree_data->interesting_hfids = (GPtrArray **)g_realloc(tree_data->interesting_hfids,
+				num_slots * sizeof(GPtrArray *));
+			memset(tree_data->interesting_hfids + tree_data->num_interesting_hfids, 0,
+			       (num_slots - tree_data->num_interesting_hfids) * sizeof(GPtrArray *));
+			tree_data->num_interesting_hfids = num_slots;
+		}
+
+		ptrs = tree_data->interesting_hfids[slot];
 		if (!ptrs) {
 			/* First element triggers the creation of pointer array */
 			ptrs = g_ptr_array_new();
-			g_hash_table_insert(tree_data->interesting_hfids,
-					    GINT_TO_POINTER(hfinfo->id), ptrs);
+			tree_data->interesting_hfids[slot] = ptrs;
 		}
 
 		g_ptr_array_add(ptrs, fi);
@@ -1295,6 +1455,7 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 {
 	proto_item *pi;
 	guint32	    value, n;
+	guint64	    value64;
 	float	    floatval;
 	double	    doubleval;
 	const char *string;
@@ -1359,6 +1520,19 @@ proto_tree_new_item(field_info *new_fi, proto_tree *tree,
 
 		case FT_INT64:
 		case FT_UINT64:
+			if (new_fi->hfinfo->type == FT_UINT64 &&
+			    (encoding & ENC_VARINT_MASK)) {
+				/*
+				 * The length is only the most the integer
+				 * may take; the item gets what it does take.
+				 */
+				n = tvb_get_varint(tvb, start, length, &value64, encoding);
+				if (n == 0)
+					report_type_length_mismatch(tree, "a variable-length integer", length, TRUE);
+				proto_tree_set_uint64(new_fi, value64);
+				new_fi->length = n;
+				break;
+			}
 			/*
 			 * Map all non-zero values to little-endian for
 			 * backwards compatibility.
@@ -1856,6 +2030,7 @@ ptvcursor_add(ptvcursor_t *ptvc, int hfindex, gint length,
 	header_field_info *hfinfo;
 	gint		   item_length;
 	guint32		   n;
+	guint64		   value64;
 	int		   offset;
 
 	/* We can't fake it just yet. We have to advance the cursor
@@ -1864,6 +2039,15 @@ ptvcursor_add(ptvcursor_t *ptvc, int hfindex, gint length,
 	offset = ptvc->offset;
 	PROTO_REGISTRAR_GET_NTH(hfindex, hfinfo);
 	get_hfi_length(hfinfo, ptvc->tvb, offset, &length, &item_length);
+	if (hfinfo->type == FT_UINT64 && (encoding & ENC_VARINT_MASK)) {
+		/*
+		 * The length is only the most the integer may take;
+		 * advance by what it does take.
+		 */
+		n = tvb_get_varint(ptvc->tvb, offset, length, &value64, encoding);
+		if (n)
+			length = item_length = n;
+	}
 	ptvc->offset += length;
 	if (hfinfo->type == FT_UINT_BYTES || hfinfo->type == FT_UINT_STRING) {
 		/*
@@ -1889,13 +2073,21 @@ ptvcursor_add(ptvcursor_t *ptvc, int hfindex, gint length,
  */
 static void
 test_length(header_field_info *hfinfo, tvbuff_t *tvb,
-	    gint start, gint length)
+	    gint start, gint length, const guint encoding)
 {
 	gint size = length;
 
 	if (!tvb)
 		return;
 
+	if (hfinfo->type == FT_UINT64 && (encoding & ENC_VARINT_MASK)) {
+		/* The length is only the most a variable-length integer may
+		 * take, so just check that it starts within range; reading it
+		 * checks the rest.
+		 */
+		size = 1;
+	}
+
 	if (hfinfo->type == FT_STRINGZ) {
 		/* If we're fetching until the end of the TVB, only validate
 		 * that the offset is within range.
@@ -1919,7 +2111,7 @@ proto_tree_add_item_new(proto_tree *tree, header_field_info *hfinfo, tvbuff_t *t
 	DISSECTOR_ASSERT_HINT(hfinfo != NULL, "Not passed hfi!");
 
 	get_hfi_length(hfinfo, tvb, start, &length, &item_length);
-	test_length(hfinfo, tvb, start, item_length);
+	test_length(hfinfo, tvb, start, item_length, encoding);
 
 	TRY_TO_FAKE_THIS_ITEM(tree, hfinfo->id, hfinfo);
 
@@ -4313,8 +4505,19 @@ proto_tree_create_root(packet_info *pinfo)
 	/* Make sure we can access pinfo everywhere */
 	pnode->tree_data->pinfo = pinfo;
 
+	/* The nodes are only ever freed all together, when the tree is
+	 * reset or freed, so they can be bump-allocated */
+	if (tree_pool_cache != NULL) {
+		pnode->tree_data->pool = tree_pool_cache;
+		tree_pool_cache = NULL;
+	}
+	else {
+		pnode->tree_data->pool = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK_FAST);
+	}
+
 	/* Don't initialize the tree_data_t. Wait until we know we need it */
 	pnode->tree_data->interesting_hfids = NULL;
+	pnode->tree_data->num_interesting_hfids = 0;
 
 	/* Set the default to FALSE so it's easier to
 	 * find errors; if we expect to see the protocol tree
@@ -4344,6 +4547,7 @@ proto_tree_prime_hfid(proto_tree *tree _U_, const gint hfid)
 	   also increase the refcount for the parent, i.e the protocol.
 	*/
 	hfinfo->ref_type = HF_REF_TYPE_DIRECT;
+	referenced_hfids_set(hfid, TRUE);
 	/* only increase the refcount if there is a parent.
 	   if this is a protocol and not a field then parent will be -1
 	   and there is no parent to add any refcounting for.
@@ -6213,14 +6417,19 @@ proto_check_for_protocol_or_field(const proto_tree* tree, const int id)
 GPtrArray *
 proto_get_finfo_ptr_array(const proto_tree *tree, const int id)
 {
+	guint slot;
+
 	if (!tree)
 		return NULL;
 
-	if (PTREE_DATA(tree)->interesting_hfids != NULL)
-		return (GPtrArray *)g_hash_table_lookup(PTREE_DATA(tree)->interesting_hfids,
-					   GINT_TO_POINTER(id));
-	else
+	if (PTREE_DATA(tree)->interesting_hfids == NULL)
 		return NULL;
+
+	slot = (guint)id < referenced_hfids_len ? interesting_slots[id] : 0;
+	if (slot == 0 || slot > PTREE_DATA(tree)->num_interesting_hfids)
+		return NULL;
+
+	return PTREE_DATA(tree)->interesting_hfids[slot - 1];
 }
 
 gboolean
@@ -7274,7 +7483,7 @@ proto_tree_add_bits_item(proto_tree *tree, const int hfindex, tvbuff_t *tvb,
 
 	octet_length = (no_of_bits + 7) >> 3;
 	octet_offset = bit_offset >> 3;
-	test_length(hfinfo, tvb, octet_offset, octet_length);
+	test_length(hfinfo, tvb, octet_offset, octet_length, ENC_NA);
 
 	/* Yes, we try to fake this item again in proto_tree_add_bits_ret_val()
 	 * but only after doing a bunch more work (which we can, in the common
@@ -323,6 +323,24 @@ WS_DLL_PUBLIC WS_MSVC_NORETURN void proto_report_dissector_bug(const char *messa
  * to use them.
  */
 
+/*
+ * Variable-length integers, for FT_UINT64 fields and tvb_get_varint().
+ * The length handed to proto_tree_add_item() is the most bytes the
+ * integer may take; the item gets the length it actually takes.
+ *
+ * ENC_VARINT_PROTOBUF is seven bits per byte, least significant group
+ * first, with the top bit set on all but the last byte (also known as
+ * LEB128).  ENC_VARINT_COMPACTSIZE is Bitcoin's: a single byte below
+ * 0xfd, otherwise 0xfd, 0xfe or 0xff followed by a 16-, 32- or 64-bit
+ * little-endian value.
+ */
+#define ENC_VARINT_PROTOBUF		0x00000002
+#define ENC_VARINT_COMPACTSIZE		0x00000004
+#define ENC_VARINT_MASK			(ENC_VARINT_PROTOBUF|ENC_VARINT_COMPACTSIZE)
+
+/* Maximum length of a variable-length integer */
+#define FT_VARINT_MAX_LEN		10
+
 /*
  * For protocols (FT_PROTOCOL), aggregate items with subtrees (FT_NONE),
  * opaque byte-array fields (FT_BYTES), and other fields where there
@@ -506,11 +524,13 @@ typedef struct
 /** One of these exists for the entire protocol tree. Each proto_node
  * in the protocol tree points to the same copy. */
 typedef struct {
-    GHashTable  *interesting_hfids;
+    GPtrArray  **interesting_hfids;     /**< field_infos of each primed field, by its slot */
+    guint        num_interesting_hfids; /**< number of slots in interesting_hfids */
     gboolean     visible;
     gboolean     fake_protocols;
     gint         count;
     struct _packet_info *pinfo;
+    wmem_allocator_t *pool;             /**< nodes, field_infos and labels of the tree */
 } tree_data_t;
 
 /** Each proto_tree, proto_item is one of these. */
@@ -635,7 +655,7 @@ WS_DLL_PUBLIC void proto_tree_children_foreach(proto_tree *tree,
 #define PTREE_DATA(proto_tree)   ((proto_tree)->tree_data)
 
 /** Retrieve the wmem_allocator_t from a proto_node */
-#define PNODE_POOL(proto_node)   ((proto_node)->tree_data->pinfo->pool)
+#define PNODE_POOL(proto_node)   ((proto_node)->tree_data->pool)
 
 #ifdef HAVE_PLUGINS
 /** Register dissector plugin type with the plugin system.
@@ -667,6 +687,19 @@ extern void proto_cleanup(void);
 */
 WS_DLL_PUBLIC gboolean proto_field_is_referenced(proto_tree *tree, int proto_id);
 
+/** Check whether any of a set of fields is needed, that is whether the
+    tree is visible or any of the fields has been primed by a filter, tap
+    or column.
+
+    A dissector can use this to skip a whole subtree, such as a list of
+    options, when nothing in it would be looked at; it should still do
+    whatever else it does for the data (e.g. tracking state) as usual.
+ @param tree the tree to be checked
+ @param field_ids the IDs of the fields
+ @param num_fields the number of field IDs
+ @return TRUE if any of them is needed */
+WS_DLL_PUBLIC gboolean proto_fields_are_referenced(proto_tree *tree, const int *field_ids, int num_fields);
+
 /** Create a subtree under an existing item.
  @param ti the parent item of the new subtree
  @param idx one of the ett_ array elements registered with proto_register_subtree_array()
@@ -768,6 +801,17 @@ proto_tree_set_fake_protocols(proto_tree *tree, gboolean fake_protocols);
 extern void
 proto_tree_prime_hfid(proto_tree *tree, const int hfid);
 
+/** Forget which fields have been primed, e.g. as the filter that primed
+    them is gone; whoever needs them must prime them again. */
+WS_DLL_PUBLIC void
+proto_clear_referenced_fields(void);
+
+/** Get the number of times proto_clear_referenced_fields() has been
+    called (plus one); fields primed while it returns the same value are
+    still primed. */
+WS_DLL_PUBLIC guint
+proto_referenced_fields_generation(void);
+
 /** Get a parent item of a subtree.
  @param tree the tree to get the parent from
  @return parent item */
@@ -1702,6 +1746,13 @@ proto_register_prefix(const char *prefix,  prefix_initializer_t initializer);
 /** Initialize every remaining uninitialized prefix. */
 WS_DLL_PUBLIC void proto_initialize_all_prefixes(void);
 
+/** Make the fields registered under one prefix also known by another one,
+    e.g. for the fields of a protocol folded into another one
+@param alias the prefix the fields are also to be known by
+@param prefix the prefix the fields are registered under */
+WS_DLL_PUBLIC void
+proto_register_prefix_alias(const char *alias, const char *prefix);
+
 WS_DLL_PUBLIC void proto_register_fields_manual(const int parent, header_field_info **hfi, const int num_records);
 WS_DLL_PUBLIC void proto_register_fields_section(const int parent, header_field_info *hfi, const int num_records);
 
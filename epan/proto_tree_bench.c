@@ -0,0 +1,196 @@
+/* proto_tree_bench.c
+ * Micro-benchmark for building protocol trees
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Builds a synthetic visible tree, as for PDML export, over and over,
+ * resetting it in between as epan_dissect_reset() does, and reports how
+ * many nodes per second were added.
+ *
+ * Usage: proto_tree_bench [iterations [depth [fanout]]]
+ *
+ * Run it with WIRESHARK_DEBUG_WMEM_OVERRIDE set to compare the tree's
+ * allocator with the others.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "emem.h"
+#include "wmem/wmem.h"
+#include "exceptions.h"
+#include "packet_info.h"
+#include "proto.h"
+#include "tvbuff.h"
+
+#define BENCH_DATA_LEN	1024
+
+static int proto_bench = -1;
+static int hf_bench_u32 = -1;
+static int hf_bench_u8 = -1;
+static int hf_bench_bytes = -1;
+static int hf_bench_label = -1;
+static gint ett_bench = -1;
+
+static void
+register_bench(register_cb cb _U_, gpointer client_data _U_)
+{
+	static hf_register_info hf[] = {
+		{ &hf_bench_u32,
+		  { "UInt32", "bench.u32", FT_UINT32, BASE_HEX, NULL, 0x0,
+		    NULL, HFILL }},
+		{ &hf_bench_u8,
+		  { "UInt8", "bench.u8", FT_UINT8, BASE_DEC, NULL, 0x0,
+		    NULL, HFILL }},
+		{ &hf_bench_bytes,
+		  { "Bytes", "bench.bytes", FT_BYTES, BASE_NONE, NULL, 0x0,
+		    NULL, HFILL }},
+		{ &hf_bench_label,
+		  { "Level", "bench.level", FT_UINT32, BASE_DEC, NULL, 0x0,
+		    NULL, HFILL }},
+	};
+	static gint *ett[] = {
+		&ett_bench,
+	};
+
+	proto_bench = proto_register_protocol("Tree Benchmark", "BENCH", "bench");
+	proto_register_field_array(proto_bench, hf, G_N_ELEMENTS(hf));
+	proto_register_subtree_array(ett, G_N_ELEMENTS(ett));
+}
+
+static void
+register_nothing(register_cb cb _U_, gpointer client_data _U_)
+{
+}
+
+/* Adds fanout items, each with a subtree down to depth, and returns the
+ * number of nodes added */
+static guint
+build_subtree(proto_tree *tree, tvbuff_t *tvb, guint depth, guint fanout)
+{
+	proto_item *ti;
+	proto_tree *subtree;
+	guint       offset = (depth * 8) % (BENCH_DATA_LEN - 16);
+	guint       nodes = 0;
+	guint       i;
+
+	for (i = 0; i < fanout; i++) {
+		ti = proto_tree_add_uint_format(tree, hf_bench_label, tvb, offset, 16,
+						depth, "Level %u, item %u", depth, i);
+		nodes++;
+		if (depth == 0)
+			continue;
+
+		subtree = proto_item_add_subtree(ti, ett_bench);
+		proto_tree_add_item(subtree, hf_bench_u32, tvb, offset, 4, ENC_BIG_ENDIAN);
+		proto_tree_add_item(subtree, hf_bench_u8, tvb, offset + 4, 1, ENC_NA);
+		proto_tree_add_item(subtree, hf_bench_bytes, tvb, offset + 5, 11, ENC_NA);
+		nodes += 3;
+
+		nodes += build_subtree(subtree, tvb, depth - 1, fanout);
+	}
+
+	return nodes;
+}
+
+int
+main(int argc, char **argv)
+{
+	guint8       data[BENCH_DATA_LEN];
+	packet_info  pinfo;
+	proto_tree  *tree;
+	proto_item  *ti;
+	tvbuff_t    *tvb;
+	GTimer      *timer;
+	gdouble      elapsed;
+	guint        iterations = 1000;
+	guint        depth = 4;
+	guint        fanout = 4;
+	guint64      nodes = 0;
+	guint        i;
+
+	if (argc > 1)
+		iterations = (guint)strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		depth = (guint)strtoul(argv[2], NULL, 10);
+	if (argc > 3)
+		fanout = (guint)strtoul(argv[3], NULL, 10);
+
+	emem_init();
+	wmem_init();
+	except_init();
+	proto_init(register_bench, register_nothing, NULL, NULL);
+
+	for (i = 0; i < BENCH_DATA_LEN; i++)
+		data[i] = (guint8)i;
+
+	memset(&pinfo, 0, sizeof(pinfo));
+	pinfo.pool = wmem_allocator_new(WMEM_ALLOCATOR_BLOCK);
+
+	tvb  = tvb_new_real_data(data, BENCH_DATA_LEN, BENCH_DATA_LEN);
+	tree = proto_tree_create_root(&pinfo);
+	proto_tree_set_visible(tree, TRUE);
+
+	timer = g_timer_new();
+	for (i = 0; i < iterations; i++) {
+		ti = proto_tree_add_item(tree, proto_bench, tvb, 0, -1, ENC_NA);
+		nodes += 1 + build_subtree(proto_item_add_subtree(ti, ett_bench), tvb, depth, fanout);
+
+		proto_tree_reset(tree);
+		wmem_free_all(pinfo.pool);
+	}
+	g_timer_stop(timer);
+	elapsed = g_timer_elapsed(timer, NULL);
+
+	printf("%u trees of depth %u, fanout %u: %" G_GINT64_MODIFIER "u nodes in %.3f s, %.0f nodes/s\n",
+	       iterations, depth, fanout, nodes, elapsed,
+	       elapsed > 0.0 ? (gdouble)nodes / elapsed : 0.0);
+
+	g_timer_destroy(timer);
+	proto_tree_free(tree);
+	tvb_free(tvb);
+	wmem_destroy_allocator(pinfo.pool);
+	proto_cleanup();
+	except_deinit();
+	wmem_cleanup();
+
+	return 0;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
@@ -838,6 +838,56 @@ LINK_FRAG(fragment_head *fd_head,fragment_item *fd)
 	fd_i->next=fd;
 }
 
+/*
+ * Build the reassembled data of a complete fd_head as a composite of its
+ * fragments' data instead of copying it all into a new buffer.
+ *
+ * Returns FALSE, leaving everything untouched, if the fragments aren't
+ * laid out simply enough for that.
+ */
+static gboolean
+fragment_defragment_composite(fragment_head *fd_head)
+{
+	fragment_item *fd_i;
+	guint32 dfpos;
+	tvbuff_t *composite_tvb;
+
+	/*
+	 * Only do this for the simple case: fragments that follow each other
+	 * exactly, with no overlaps or gaps, and each with its own data.
+	 * Anything else (including data already pointing into an earlier
+	 * reassembly) goes through the copying path, which knows how to
+	 * deal with it.
+	 */
+	for (dfpos=0,fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
+		if (!fd_i->len)
+			continue;
+		if (fd_i->offset != dfpos || !fd_i->tvb_data ||
+		    (fd_i->flags & FD_SUBSET_TVB))
+			return FALSE;
+		dfpos += fd_i->len;
+	}
+	if (dfpos != fd_head->datalen)
+		return FALSE;
+
+	/*
+	 * The fragments' data are already copies of their own, so they can
+	 * become the members of the reassembled tvb as they are.
+	 */
+	composite_tvb = tvb_new_composite();
+	tvb_composite_set_owns_members(composite_tvb);
+	for (fd_i=fd_head->next;fd_i;fd_i=fd_i->next) {
+		if (fd_i->len) {
+			tvb_composite_append(composite_tvb, fd_i->tvb_data);
+			fd_i->tvb_data=NULL;
+		}
+	}
+	tvb_composite_finalize(composite_tvb);
+
+	fd_head->tvb_data = composite_tvb;
+	return TRUE;
+}
+
 /*
  * This function adds a new fragment to the fragment hash table.
  * If this is the first fragment seen for this datagram, a new entry
@@ -862,7 +912,8 @@ LINK_FRAG(fragment_head *fd_head,fragment_item *fd)
 static gboolean
 fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 		 const packet_info *pinfo, const guint32 frag_offset,
-		 const guint32 frag_data_len, const gboolean more_frags)
+		 const guint32 frag_data_len, const gboolean more_frags,
+		 const gboolean composite_data)
 {
 	fragment_item *fd;
 	fragment_item *fd_i;
@@ -1062,6 +1113,15 @@ fragment_add_work(fragment_head *fd_head, tvbuff_t *tvb, const int offset,
 	 */
 	/* store old data just in case */
 	old_tvb_data=fd_head->tvb_data;
+
+	if (composite_data && fragment_defragment_composite(fd_head)) {
+		if (old_tvb_data)
+			tvb_add_to_chain(tvb, old_tvb_data);
+		fd_head->flags |= FD_DEFRAGMENTED;
+		fd_head->reassembled_in=pinfo->fd->num;
+		return TRUE;
+	}
+
 	data = (guint8 *) g_malloc(fd_head->datalen);
 	fd_head->tvb_data = tvb_new_real_data(data, fd_head->datalen, fd_head->datalen);
 	tvb_set_free_cb(fd_head->tvb_data, g_free);
@@ -1370,7 +1430,7 @@ fragment_add_common(reassembly_table *table, tvbuff_t *tvb, const int offset,
 	}
 
 	if (fragment_add_work(fd_head, tvb, offset, pinfo, frag_offset,
-		frag_data_len, more_frags)) {
+		frag_data_len, more_frags, table->composite_data)) {
 		/*
 		 * Reassembly is complete.
 		 */
@@ -1453,7 +1513,7 @@ fragment_add_check(reassembly_table *table, tvbuff_t *tvb, const int offset,
 		return NULL;
 
 	if (fragment_add_work(fd_head, tvb, offset, pinfo, frag_offset,
-		frag_data_len, more_frags)) {
+		frag_data_len, more_frags, table->composite_data)) {
 		/*
 		 * Reassembly is complete.
 		 * Remove this from the table of in-progress
@@ -135,6 +135,7 @@ typedef struct {
 	fragment_temporary_key temporary_key_func;
 	fragment_persistent_key persistent_key_func;
 	GDestroyNotify free_temporary_key_func;		/* temporary key destruction function */
+	gboolean composite_data;			/* hand out reassembled data as a composite of the fragments, where possible */
 } reassembly_table;
 
 /*
@@ -48,11 +48,13 @@ typedef struct _tap_dissector_t {
 static tap_dissector_t *tap_dissector_list=NULL;
 
 /*
- * This is the list of free and used packets queued for a tap.
+ * This is the list of packets queued for a tap.
  * It is implemented here explicitly instead of using GLib objects
  * in order to be as fast as possible as we need to build and tear down the
  * queued list at least once for each packet we see and thus we must be able
  * to build and tear it down as fast as possible.
+ * The array is allocated once, and only ever grows (doubling) if a packet
+ * queues more than it has room for, so nothing gets dropped.
  */
 typedef struct _tap_packet_t {
 	int tap_id;
@@ -61,22 +63,48 @@ typedef struct _tap_packet_t {
 } tap_packet_t;
 
 #define TAP_PACKET_QUEUE_LEN 100
-static tap_packet_t tap_packet_array[TAP_PACKET_QUEUE_LEN];
+static tap_packet_t *tap_packet_array=NULL;
+static guint tap_packet_array_len=0;
 static guint tap_packet_index;
 
+/*
+ * Listeners with the same filter string share one compiled filter, which
+ * is evaluated at most once per packet however many of them there are.
+ */
+typedef struct _tap_filter_t {
+	struct _tap_filter_t *next;
+	char *fstring;
+	dfilter_t *code;
+	guint refcount;
+	guint generation;	/* tap_generation when last evaluated */
+	gboolean passed;	/* result of that evaluation */
+	gdouble filter_time;	/* seconds spent evaluating it, if timing */
+} tap_filter_t;
+static tap_filter_t *tap_filter_list=NULL;
+
+/* Bumped for every packet pushed, so that cached filter results go stale */
+static guint tap_generation=0;
+
 typedef struct _tap_listener_t {
 	struct _tap_listener_t *next;
 	int tap_id;
 	gboolean needs_redraw;
 	guint flags;
-	dfilter_t *code;
+	tap_filter_t *filter;
 	void *tapdata;
 	tap_reset_cb reset;
 	tap_packet_cb packet;
 	tap_draw_cb draw;
+	guint64 tapped;		/* tapped packets seen */
+	guint64 passed;		/* of those, passed to the packet callback */
+	gdouble packet_time;	/* seconds spent in it, if timing */
 } tap_listener_t;
 static volatile tap_listener_t *tap_listener_queue=NULL;
 
+/* Time the filters and packet callbacks; off unless asked for, as it
+   costs a couple of clock reads per call */
+static GTimer *tap_timer=NULL;
+
 #ifdef HAVE_PLUGINS
 
 #include <gmodule.h>
@@ -158,6 +186,10 @@ void
 tap_init(void)
 {
 	tap_packet_index=0;
+	if(!tap_packet_array){
+		tap_packet_array_len=TAP_PACKET_QUEUE_LEN;
+		tap_packet_array=g_new(tap_packet_t, tap_packet_array_len);
+	}
 }
 
 /* **********************************************************************
@@ -236,13 +268,9 @@ tap_queue_packet(int tap_id, packet_info *pinfo, const void *tap_specific_data)
 	if(!tapping_is_active){
 		return;
 	}
-	/*
-	 * XXX - should we allocate this with an ep_allocator,
-	 * rather than having a fixed maximum number of entries?
-	 */
-	if(tap_packet_index >= TAP_PACKET_QUEUE_LEN){
-		g_warning("Too many taps queued");
-		return;
+	if(tap_packet_index >= tap_packet_array_len){
+		tap_packet_array_len=tap_packet_array_len ? tap_packet_array_len*2 : TAP_PACKET_QUEUE_LEN;
+		tap_packet_array=g_renew(tap_packet_t, tap_packet_array, tap_packet_array_len);
 	}
 
 	tpt=&tap_packet_array[tap_packet_index];
@@ -256,25 +284,105 @@ tap_queue_packet(int tap_id, packet_info *pinfo, const void *tap_specific_data)
 
 
 
+/* **********************************************************************
+ * Shared tap filters
+ * ********************************************************************** */
+/* Returns the shared filter for fstring, compiling it if no other listener
+   uses it yet, or NULL with an error message if it doesn't compile. */
+static tap_filter_t *
+tap_filter_get(const char *fstring, GString **error_string)
+{
+	tap_filter_t *tf;
+	dfilter_t *code;
+
+	for(tf=tap_filter_list;tf;tf=tf->next){
+		if(!strcmp(tf->fstring, fstring)){
+			tf->refcount++;
+			return tf;
+		}
+	}
+
+	if(!dfilter_compile(fstring, &code)){
+		*error_string = g_string_new("");
+		g_string_printf(*error_string,
+		    "Filter \"%s\" is invalid - %s",
+		    fstring, dfilter_error_msg);
+		return NULL;
+	}
+
+	/* An empty filter compiles to nothing and passes everything */
+	if(!code){
+		return NULL;
+	}
+
+	tf=g_new(tap_filter_t, 1);
+	tf->fstring=g_strdup(fstring);
+	tf->code=code;
+	tf->refcount=1;
+	tf->generation=tap_generation-1;
+	tf->passed=FALSE;
+	tf->filter_time=0.0;
+	tf->next=tap_filter_list;
+	tap_filter_list=tf;
+
+	return tf;
+}
+
+static void
+tap_filter_release(tap_filter_t *tf)
+{
+	tap_filter_t **tfp;
+
+	if(--tf->refcount){
+		return;
+	}
+
+	for(tfp=&tap_filter_list;*tfp;tfp=&(*tfp)->next){
+		if(*tfp==tf){
+			*tfp=tf->next;
+			break;
+		}
+	}
+	dfilter_free(tf->code);
+	g_free(tf->fstring);
+	g_free(tf);
+}
+
+static gboolean
+tap_filter_apply(tap_filter_t *tf, epan_dissect_t *edt)
+{
+	gdouble start;
+
+	if(tf->generation!=tap_generation){
+		tf->generation=tap_generation;
+		if(tap_timer){
+			start=g_timer_elapsed(tap_timer, NULL);
+			tf->passed=dfilter_apply_edt(tf->code, edt);
+			tf->filter_time+=g_timer_elapsed(tap_timer, NULL)-start;
+		} else {
+			tf->passed=dfilter_apply_edt(tf->code, edt);
+		}
+	}
+	return tf->passed;
+}
+
 /* **********************************************************************
  * Functions used by file.c to drive the tap subsystem
  * ********************************************************************** */
 
 void tap_build_interesting (epan_dissect_t *edt)
 {
-	tap_listener_t *tl;
+	tap_filter_t *tf;
 
 	/* nothing to do, just return */
 	if(!tap_listener_queue){
 		return;
 	}
 
-	/* loop over all tap listeners and build the list of all
+	/* loop over all the distinct tap filters and build the list of all
 	   interesting hf_fields */
-	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
-		if(tl->code){
-			epan_dissect_prime_dfilter(edt, tl->code);
-		}
+	for(tf=tap_filter_list;tf;tf=tf->next){
+		epan_dissect_prime_dfilter(edt, tf->code);
 	}
 }
 
@@ -305,6 +413,7 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 {
 	tap_packet_t *tp;
 	tap_listener_t *tl;
+	gdouble start;
 	guint i;
 
 	/* nothing to do, just return */
@@ -319,18 +428,30 @@ tap_push_tapped_queue(epan_dissect_t *edt)
 		return;
 	}
 
+	/* filter results only depend on the packet, not on which of its
+	   tapped entries we are looking at */
+	tap_generation++;
+
 	/* loop over all tap listeners and call the listener callback
 	   for all packets that match the filter. */
 	for(i=0;i<tap_packet_index;i++){
+		tp=&tap_packet_array[i];
 		for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
-			tp=&tap_packet_array[i];
 			if(tp->tap_id==tl->tap_id){
 				gboolean passed=TRUE;
-				if(tl->code){
-					passed=dfilter_apply_edt(tl->code, edt);
+				tl->tapped++;
+				if(tl->filter){
+					passed=tap_filter_apply(tl->filter, edt);
 				}
 				if(passed && tl->packet){
-					tl->needs_redraw|=tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
+					tl->passed++;
+					if(tap_timer){
+						start=g_timer_elapsed(tap_timer, NULL);
+						tl->needs_redraw|=tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
+						tl->packet_time+=g_timer_elapsed(tap_timer, NULL)-start;
+					} else {
+						tl->needs_redraw|=tl->packet(tl->tapdata, tp->pinfo, edt, tp->tap_specific_data);
+					}
 				}
 			}
 		}
@@ -388,12 +509,19 @@ void
 reset_tap_listeners(void)
 {
 	tap_listener_t *tl;
+	tap_filter_t *tf;
 
 	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
 		if(tl->reset){
 			tl->reset(tl->tapdata);
 		}
 		tl->needs_redraw=TRUE;
+		tl->tapped=0;
+		tl->passed=0;
+		tl->packet_time=0.0;
+	}
+	for(tf=tap_filter_list;tf;tf=tf->next){
+		tf->filter_time=0.0;
 	}
 
 }
@@ -469,15 +597,16 @@ register_tap_listener(const char *tapname, void *tapdata, const char *fstring,
 	}
 
 	tl=(tap_listener_t *)g_malloc(sizeof(tap_listener_t));
-	tl->code=NULL;
+	tl->filter=NULL;
 	tl->needs_redraw=TRUE;
 	tl->flags=flags;
+	tl->tapped=0;
+	tl->passed=0;
+	tl->packet_time=0.0;
 	if(fstring){
-		if(!dfilter_compile(fstring, &tl->code)){
-			error_string = g_string_new("");
-			g_string_printf(error_string,
-			    "Filter \"%s\" is invalid - %s",
-			    fstring, dfilter_error_msg);
+		error_string=NULL;
+		tl->filter=tap_filter_get(fstring, &error_string);
+		if(error_string){
 			g_free(tl);
 			return error_string;
 		}
@@ -520,17 +649,15 @@ set_tap_dfilter(void *tapdata, const char *fstring)
 	}
 
 	if(tl){
-		if(tl->code){
-			dfilter_free(tl->code);
-			tl->code=NULL;
+		if(tl->filter){
+			tap_filter_release(tl->filter);
+			tl->filter=NULL;
 		}
 		tl->needs_redraw=TRUE;
 		if(fstring){
-			if(!dfilter_compile(fstring, &tl->code)){
-				error_string = g_string_new("");
-				g_string_printf(error_string,
-						 "Filter \"%s\" is invalid - %s",
-						 fstring, dfilter_error_msg);
+			error_string=NULL;
+			tl->filter=tap_filter_get(fstring, &error_string);
+			if(error_string){
 				return error_string;
 			}
 		}
@@ -565,8 +692,8 @@ remove_tap_listener(void *tapdata)
 	}
 
 	if(tl){
-		if(tl->code){
-			dfilter_free(tl->code);
+		if(tl->filter){
+			tap_filter_release(tl->filter);
 		}
 		g_free(tl);
 	}
@@ -619,7 +746,7 @@ have_filtering_tap_listeners(void)
 	tap_listener_t *tl;
 
 	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
-		if(tl->code)
+		if(tl->filter)
 			return TRUE;
 	}
 	return FALSE;
@@ -641,3 +768,65 @@ union_of_tap_listener_flags(void)
 	}
 	return flags;
 }
+
+/*
+ * Turn timing of the tap filters and listener callbacks on or off.
+ */
+void
+tap_listener_timing(gboolean enable)
+{
+	if(enable && !tap_timer){
+		tap_timer=g_timer_new();
+	} else if(!enable && tap_timer){
+		g_timer_destroy(tap_timer);
+		tap_timer=NULL;
+	}
+}
+
+/*
+ * Call func for each tap listener that has a packet callback, with what
+ * it has cost so far.
+ */
+void
+tap_listener_stats_foreach(tap_listener_stats_cb func, void *user_data)
+{
+	tap_listener_t *tl, *prev;
+	tap_dissector_t *td;
+	tap_listener_stats_t stats;
+	int i;
+
+	for(tl=(tap_listener_t *)tap_listener_queue;tl;tl=tl->next){
+		if(!tl->packet){
+			continue;
+		}
+
+		/* A shared filter's time is counted once, for the first of
+		   its listeners, so that the times add up to the total */
+		stats.filter_time=0.0;
+		if(tl->filter){
+			for(prev=(tap_listener_t *)tap_listener_queue;prev!=tl;prev=prev->next){
+				if(prev->packet && prev->filter==tl->filter){
+					break;
+				}
+			}
+			if(prev==tl){
+				stats.filter_time=tl->filter->filter_time;
+			}
+		}
+
+		stats.tap_name=NULL;
+		for(i=1,td=tap_dissector_list;td;i++,td=td->next){
+			if(i==tl->tap_id){
+				stats.tap_name=td->name;
+				break;
+			}
+		}
+		stats.filter=tl->filter ? tl->filter->fstring : NULL;
+		stats.filter_shared=tl->filter && tl->filter->refcount>1;
+		stats.tapped=tl->tapped;
+		stats.passed=tl->passed;
+		stats.packet_time=tl->packet_time;
+
+		func(&stats, user_data);
+	}
+}
@@ -254,6 +254,28 @@ WS_DLL_PUBLIC guint union_of_tap_listener_flags(void);
  */
 WS_DLL_PUBLIC const void *fetch_tapped_data(int tap_id, int idx);
 
+/** What a tap listener has cost so far, as passed to tap_listener_stats_foreach() */
+typedef struct {
+	const char *tap_name;	/**< the tap it listens to */
+	const char *filter;	/**< its filter, or NULL if none */
+	gboolean filter_shared;	/**< other listeners use the same filter, evaluated once for all */
+	guint64 tapped;		/**< tapped packets seen */
+	guint64 passed;		/**< those that passed the filter and went to the packet callback */
+	gdouble filter_time;	/**< seconds spent evaluating the filter, if timing;
+				     a shared filter's are given for the first of its listeners only */
+	gdouble packet_time;	/**< seconds spent in the packet callback, if timing */
+} tap_listener_stats_t;
+
+typedef void (*tap_listener_stats_cb)(const tap_listener_stats_t *stats, void *user_data);
+
+/** Turn timing of the tap filters and listener packet callbacks on or off.
+ *  The packet counts are always kept. */
+WS_DLL_PUBLIC void tap_listener_timing(gboolean enable);
+
+/** Call func for each tap listener with a packet callback, with its counts
+ *  and times since it was registered or the listeners were last reset. */
+WS_DLL_PUBLIC void tap_listener_stats_foreach(tap_listener_stats_cb func, void *user_data);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
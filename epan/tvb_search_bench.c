@@ -0,0 +1,175 @@
+/* tvb_search_bench.c
+ * Micro-benchmark for the tvbuff search routines
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/*
+ * Searches a buffer of text with the tvbuff search routines, and with the
+ * byte-at-a-time table for comparison, and reports how fast each of them
+ * went through the data.
+ *
+ * Usage: tvb_search_bench [megabytes [line length]]
+ *
+ * The buffer is made of lines of the given length (80 by default) ending
+ * in CR LF, as in HTTP or SIP headers; the single needle and needle set
+ * searches are for bytes that aren't in it, so they go through all of it.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib.h>
+
+#include "tvbuff.h"
+#include "exceptions.h"
+
+#define BENCH_BUFFER_LEN	(1024 * 1024)
+
+typedef gint (*bench_func)(tvbuff_t *tvb);
+
+static ws_mempbrk_pattern pbrk_absent;
+
+static gint
+bench_find_guint8(tvbuff_t *tvb)
+{
+	return tvb_find_guint8(tvb, 0, -1, '\0');
+}
+
+static gint
+bench_pbrk_guint8(tvbuff_t *tvb)
+{
+	return tvb_pbrk_guint8(tvb, 0, -1, "<>{}", NULL);
+}
+
+static gint
+bench_pbrk_pattern(tvbuff_t *tvb)
+{
+	return tvb_ws_mempbrk_pattern_guint8(tvb, 0, -1, &pbrk_absent, NULL);
+}
+
+static gint
+bench_pbrk_portable(tvbuff_t *tvb)
+{
+	const guint8 *data = tvb_get_ptr(tvb, 0, -1);
+	const guint8 *result;
+
+	result = ws_mempbrk_portable_exec(data, tvb_length(tvb), &pbrk_absent, NULL);
+	return result ? (gint)(result - data) : -1;
+}
+
+static gint
+bench_find_line_end(tvbuff_t *tvb)
+{
+	gint offset = 0;
+	gint next_offset;
+	gint lines = 0;
+
+	while (tvb_length_remaining(tvb, offset) > 0) {
+		tvb_find_line_end(tvb, offset, -1, &next_offset, FALSE);
+		offset = next_offset;
+		lines++;
+	}
+	return lines;
+}
+
+static void
+bench(const char *name, bench_func func, tvbuff_t *tvb, guint iterations)
+{
+	GTimer  *timer;
+	gdouble  elapsed;
+	gdouble  bytes;
+	guint    i;
+
+	timer = g_timer_new();
+	for (i = 0; i < iterations; i++)
+		func(tvb);
+	g_timer_stop(timer);
+	elapsed = g_timer_elapsed(timer, NULL);
+
+	bytes = (gdouble)tvb_length(tvb) * iterations;
+	printf("%-30s %8.3f s  %8.3f GB/s\n", name, elapsed,
+	       elapsed > 0.0 ? bytes / elapsed / 1e9 : 0.0);
+
+	g_timer_destroy(timer);
+}
+
+int
+main(int argc, char **argv)
+{
+	guint8   *data;
+	tvbuff_t *tvb;
+	guint     megabytes = 1024;
+	guint     line_len = 80;
+	guint     i;
+
+	if (argc > 1)
+		megabytes = (guint)strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		line_len = (guint)strtoul(argv[2], NULL, 10);
+	if (line_len < 3)
+		line_len = 3;
+
+	except_init();
+	tvbuff_init();
+
+	data = (guint8 *)g_malloc(BENCH_BUFFER_LEN);
+	for (i = 0; i < BENCH_BUFFER_LEN; i++) {
+		if (i % line_len == line_len - 2)
+			data[i] = '\r';
+		else if (i % line_len == line_len - 1)
+			data[i] = '\n';
+		else
+			data[i] = 'a' + (i % 26);
+	}
+	tvb = tvb_new_real_data(data, BENCH_BUFFER_LEN, BENCH_BUFFER_LEN);
+
+	ws_mempbrk_compile(&pbrk_absent, "<>{}");
+
+	printf("%u MB, lines of %u bytes\n", megabytes, line_len);
+	bench("tvb_find_guint8", bench_find_guint8, tvb, megabytes);
+	bench("tvb_pbrk_guint8", bench_pbrk_guint8, tvb, megabytes);
+	bench("tvb_ws_mempbrk_pattern_guint8", bench_pbrk_pattern, tvb, megabytes);
+	bench("ws_mempbrk_portable_exec", bench_pbrk_portable, tvb, megabytes);
+	bench("tvb_find_line_end", bench_find_line_end, tvb, megabytes);
+
+	tvb_free(tvb);
+	g_free(data);
+	except_deinit();
+
+	return 0;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
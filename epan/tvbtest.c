@@ -30,6 +30,7 @@
 
 #include "tvbuff.h"
 #include "exceptions.h"
+#include "wmem/wmem.h"
 #include "wsutil/pint.h"
 
 gboolean failed = FALSE;
@@ -46,7 +47,10 @@ test(tvbuff_t *tvb, const gchar* name,
 	volatile gboolean	ex_thrown;
 	volatile guint32	val32;
 	guint32			expected32;
-	guint			incr, i;
+	guint			incr, i, j;
+	guint8			needles[3];
+	guchar			found_needle;
+	gint			found_offset, expected_offset;
 
 	length = tvb_length(tvb);
 
@@ -280,6 +284,57 @@ test(tvbuff_t *tvb, const gchar* name,
 	}
 	g_free(ptr);
 
+	/* Search for a couple of the bytes from everywhere, checking
+	 * tvb_pbrk_guint8() against a plain search */
+	if (length > 0) {
+		j = 0;
+		if (expected_data[length / 2])
+			needles[j++] = expected_data[length / 2];
+		if (expected_data[length - 1])
+			needles[j++] = expected_data[length - 1];
+		needles[j] = '\0';
+
+		for (i = 0; i < length; i++) {
+			expected_offset = -1;
+			for (j = i; j < length; j++) {
+				if (expected_data[j] && strchr((const char *)needles, expected_data[j])) {
+					expected_offset = j;
+					break;
+				}
+			}
+
+			found_needle = 0;
+			found_offset = tvb_pbrk_guint8(tvb, i, -1, needles, &found_needle);
+			if (found_offset != expected_offset ||
+			    (found_offset != -1 && found_needle != expected_data[found_offset])) {
+				printf("13: Failed TVB=%s Offset=%d pbrk found %d, "
+						"expected %d\n",
+						name, i, found_offset, expected_offset);
+				failed = TRUE;
+				return FALSE;
+			}
+
+			if (needles[0] == '\0')
+				continue;
+
+			expected_offset = -1;
+			for (j = i; j < length; j++) {
+				if (expected_data[j] == needles[0]) {
+					expected_offset = j;
+					break;
+				}
+			}
+
+			found_offset = tvb_find_guint8(tvb, i, -1, needles[0]);
+			if (found_offset != expected_offset) {
+				printf("14: Failed TVB=%s Offset=%d find found %d, "
+						"expected %d\n",
+						name, i, found_offset, expected_offset);
+				failed = TRUE;
+				return FALSE;
+			}
+		}
+	}
 
 	printf("Passed TVB=%s\n", name);
 
@@ -314,10 +369,10 @@ run_tests(void)
 	guint		subset_length[6];
 	guint		subset_reported_length[6];
 	guint8		temp;
-	guint8		*comp[6];
-	tvbuff_t	*tvb_comp[6];
-	guint		comp_length[6];
-	guint		comp_reported_length[6];
+	guint8		*comp[7];
+	tvbuff_t	*tvb_comp[7];
+	guint		comp_length[7];
+	guint		comp_reported_length[7];
 	int		len;
 
 	tvb_parent = tvb_new_real_data("", 0, 0);
@@ -477,6 +532,21 @@ run_tests(void)
 	tvb_composite_append(tvb_comp[5], tvb_comp[3]);
 	tvb_composite_finalize(tvb_comp[5]);
 
+	/* Owning its (unchained) members, as reassembly does */
+	printf("Making Composite 6\n");
+	tvb_comp[6]		= tvb_new_composite();
+	comp_length[6]		= small_length[1] + large_length[0] + small_length[2];
+	comp_reported_length[6]	= comp_length[6];
+	comp[6]			= g_malloc(comp_length[6]);
+	memcpy(&comp[6][0], small[1], small_length[1]);
+	memcpy(&comp[6][small_length[1]], large[0], large_length[0]);
+	memcpy(&comp[6][small_length[1] + large_length[0]], small[2], small_length[2]);
+	tvb_composite_set_owns_members(tvb_comp[6]);
+	tvb_composite_append(tvb_comp[6], tvb_clone(tvb_small[1]));
+	tvb_composite_append(tvb_comp[6], tvb_clone(tvb_large[0]));
+	tvb_composite_append(tvb_comp[6], tvb_clone(tvb_small[2]));
+	tvb_composite_finalize(tvb_comp[6]);
+
 	/* Test the TVBUFF_COMPOSITE objects. */
 	test(tvb_comp[0], "Composite 0", comp[0], comp_length[0], comp_reported_length[0]);
 	test(tvb_comp[1], "Composite 1", comp[1], comp_length[1], comp_reported_length[1]);
@@ -484,6 +554,7 @@ run_tests(void)
 	test(tvb_comp[3], "Composite 3", comp[3], comp_length[3], comp_reported_length[3]);
 	test(tvb_comp[4], "Composite 4", comp[4], comp_length[4], comp_reported_length[4]);
 	test(tvb_comp[5], "Composite 5", comp[5], comp_length[5], comp_reported_length[5]);
+	test(tvb_comp[6], "Composite 6", comp[6], comp_length[6], comp_reported_length[6]);
 
 	/* free memory. */
 	/* Don't free: comp[0] */
@@ -492,7 +563,9 @@ run_tests(void)
 	g_free(comp[3]);
 	g_free(comp[4]);
 	g_free(comp[5]);
+	g_free(comp[6]);
 
+	tvb_free(tvb_comp[6]);	/* not chained; frees its members */
 	tvb_free_chain(tvb_parent);  /* should free all tvb's and associated data */
 }
 
@@ -505,7 +578,10 @@ main(void)
 	g_setenv("G_SLICE", "always-malloc", 1);
 
 	except_init();
+	/* Composites copy ranges that straddle members into packet scope */
+	wmem_init();
 	run_tests();
+	wmem_cleanup();
 	except_deinit();
 	exit(failed?1:0);
 }
@@ -53,6 +53,18 @@
 static guint64
 _tvb_get_bits64(tvbuff_t *tvb, guint bit_offset, const gint total_no_of_bits);
 
+/* Needle sets searched for by tvb_find_line_end() and
+   tvb_find_line_end_unquoted() */
+static ws_mempbrk_pattern pbrk_crlf;
+static ws_mempbrk_pattern pbrk_crlf_dquote;
+
+void
+tvbuff_init(void)
+{
+	ws_mempbrk_compile(&pbrk_crlf, "\r\n");
+	ws_mempbrk_compile(&pbrk_crlf_dquote, "\r\n\"");
+}
+
 tvbuff_t *
 tvb_new(const struct tvb_ops *ops)
 {
@@ -694,29 +706,6 @@ fast_ensure_contiguous(tvbuff_t *tvb, const gint offset, const guint length)
 	return NULL;
 }
 
-static const guint8*
-guint8_pbrk(const guint8* haystack, size_t haystacklen, const guint8 *needles, guchar *found_needle)
-{
-	gchar         tmp[256] = { 0 };
-	const guint8 *haystack_end;
-
-	while (*needles)
-		tmp[*needles++] = 1;
-
-	haystack_end = haystack + haystacklen;
-	while (haystack < haystack_end) {
-		if (tmp[*haystack]) {
-			if (found_needle)
-				*found_needle = *haystack;
-			return haystack;
-		}
-		haystack++;
-	}
-
-	return NULL;
-}
-
-
 
 /************** ACCESSORS **************/
 
@@ -792,6 +781,24 @@ tvb_get_ptr(tvbuff_t *tvb, const gint offset, const gint length)
 	return ensure_contiguous(tvb, offset, length);
 }
 
+gboolean
+tvb_bytes_are_contiguous(tvbuff_t *tvb, const gint offset, const gint length)
+{
+	guint abs_offset, abs_length;
+
+	DISSECTOR_ASSERT(tvb && tvb->initialized);
+
+	check_offset_length(tvb, offset, length, &abs_offset, &abs_length);
+
+	if (tvb->real_data)
+		return TRUE;
+
+	if (tvb->ops->tvb_is_contiguous)
+		return tvb->ops->tvb_is_contiguous(tvb, abs_offset, abs_length);
+
+	return TRUE;
+}
+
 /* ---------------- */
 guint8
 tvb_get_guint8(tvbuff_t *tvb, const gint offset)
@@ -1191,6 +1198,84 @@ tvb_get_letoh64(tvbuff_t *tvb, const gint offset)
 	return pletoh64(ptr);
 }
 
+/*
+ * Fetches a variable-length integer of at most maxlen bytes, in the
+ * encoding given by the ENC_VARINT_ value in encoding, and returns the
+ * number of bytes it took up; the value is put in *value.
+ *
+ * Returns 0, with *value set to 0, if the integer would take more than
+ * maxlen bytes. Throws an exception if the tvbuff runs out first.
+ */
+guint
+tvb_get_varint(tvbuff_t *tvb, const gint offset, const guint maxlen, guint64 *value, const guint encoding)
+{
+	const guint8 *ptr;
+	guint	      i, len;
+
+	*value = 0;
+	if (maxlen == 0)
+		return 0;
+
+	switch (encoding & ENC_VARINT_MASK) {
+
+	case ENC_VARINT_COMPACTSIZE:
+		/*
+		 * One byte if less than 0xfd, otherwise that byte says
+		 * whether a 16-, 32- or 64-bit little-endian value follows.
+		 */
+		ptr = fast_ensure_contiguous(tvb, offset, 1);
+		switch (*ptr) {
+		case 0xfd:
+			len = 3;
+			break;
+		case 0xfe:
+			len = 5;
+			break;
+		case 0xff:
+			len = 9;
+			break;
+		default:
+			*value = *ptr;
+			return 1;
+		}
+		if (len > maxlen)
+			return 0;
+
+		ptr = fast_ensure_contiguous(tvb, offset, len);
+		switch (len) {
+		case 3:
+			*value = pletoh16(ptr + 1);
+			break;
+		case 5:
+			*value = pletoh32(ptr + 1);
+			break;
+		default:
+			*value = pletoh64(ptr + 1);
+			break;
+		}
+		return len;
+
+	case ENC_VARINT_PROTOBUF:
+		/*
+		 * Seven bits at a time, least significant group first,
+		 * the top bit set on all but the last byte.
+		 */
+		len = MIN(maxlen, FT_VARINT_MAX_LEN);
+		for (i = 0; i < len; i++) {
+			ptr = fast_ensure_contiguous(tvb, offset + i, 1);
+			*value |= ((guint64)(*ptr & 0x7F)) << (i * 7);
+			if (!(*ptr & 0x80))
+				return i + 1;
+		}
+		*value = 0;
+		return 0;
+
+	default:
+		DISSECTOR_ASSERT_NOT_REACHED();
+		return 0;
+	}
+}
+
 /*
  * Fetches an IEEE single-precision floating-point number, in
  * little-endian form, and returns a "float".
@@ -1504,18 +1589,18 @@ tvb_find_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 	if (tvb->ops->tvb_find_guint8)
 		return tvb->ops->tvb_find_guint8(tvb, abs_offset, limit, needle);
 
-	return tvb_find_guint8_generic(tvb, offset, limit, needle);
+	return tvb_find_guint8_generic(tvb, abs_offset, limit, needle);
 }
 
 static gint
-tvb_pbrk_guint8_generic(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needles, guchar *found_needle)
+tvb_pbrk_guint8_generic(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern *pattern, guchar *found_needle)
 {
 	const guint8 *ptr;
 	const guint8 *result;
 
 	ptr = tvb_get_ptr(tvb, abs_offset, limit);
 
-	result = guint8_pbrk(ptr, limit, needles, found_needle);
+	result = ws_mempbrk_exec(ptr, limit, pattern, found_needle);
 	if (!result)
 		return -1;
 
@@ -1531,6 +1616,16 @@ tvb_pbrk_guint8_generic(tvbuff_t *tvb, guint abs_offset, guint limit, const guin
  * finding needle. */
 gint
 tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const guint8 *needles, guchar *found_needle)
+{
+	ws_mempbrk_pattern pattern;
+
+	ws_mempbrk_compile(&pattern, (const gchar *)needles);
+
+	return tvb_ws_mempbrk_pattern_guint8(tvb, offset, maxlength, &pattern, found_needle);
+}
+
+gint
+tvb_ws_mempbrk_pattern_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const ws_mempbrk_pattern *pattern, guchar *found_needle)
 {
 	const guint8 *result;
 	guint	      abs_offset;
@@ -1559,7 +1654,7 @@ tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 
 	/* If we have real data, perform our search now. */
 	if (tvb->real_data) {
-		result = guint8_pbrk(tvb->real_data + abs_offset, limit, needles, found_needle);
+		result = ws_mempbrk_exec(tvb->real_data + abs_offset, limit, pattern, found_needle);
 		if (result == NULL) {
 			return -1;
 		}
@@ -1569,9 +1664,9 @@ tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset, const gint maxlength, const gu
 	}
 
 	if (tvb->ops->tvb_pbrk_guint8)
-		return tvb->ops->tvb_pbrk_guint8(tvb, abs_offset, limit, needles, found_needle);
+		return tvb->ops->tvb_pbrk_guint8(tvb, abs_offset, limit, pattern, found_needle);
 
-	return tvb_pbrk_guint8_generic(tvb, abs_offset, limit, needles, found_needle);
+	return tvb_pbrk_guint8_generic(tvb, abs_offset, limit, pattern, found_needle);
 }
 
 /* Find size of stringz (NUL-terminated string) by looking for terminating
@@ -2959,7 +3054,7 @@ tvb_find_line_end(tvbuff_t *tvb, const gint offset, int len, gint *next_offset,
 	/*
 	 * Look either for a CR or an LF.
 	 */
-	eol_offset = tvb_pbrk_guint8(tvb, offset, len, "\r\n", &found_needle);
+	eol_offset = tvb_ws_mempbrk_pattern_guint8(tvb, offset, len, &pbrk_crlf, &found_needle);
 	if (eol_offset == -1) {
 		/*
 		 * No CR or LF - line is presumably continued in next packet.
@@ -3088,7 +3183,7 @@ tvb_find_line_end_unquoted(tvbuff_t *tvb, const gint offset, int len, gint *next
 			/*
 			 * Look either for a CR, an LF, or a '"'.
 			 */
-			char_offset = tvb_pbrk_guint8(tvb, cur_offset, len, "\r\n\"", &c);
+			char_offset = tvb_ws_mempbrk_pattern_guint8(tvb, cur_offset, len, &pbrk_crlf_dquote, &c);
 		}
 		if (char_offset == -1) {
 			/*
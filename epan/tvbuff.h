@@ -38,6 +38,7 @@
 #include <glib.h>
 #include <epan/guid-utils.h>
 #include <epan/wmem/wmem.h>
+#include <wsutil/ws_mempbrk.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -114,6 +115,10 @@ struct e_in6_addr; /* ipv6-utils.h */
 
 typedef void (*tvbuff_free_cb_t)(void*);
 
+/** Compile the needle sets the line-finding routines search for;
+ * called by epan_init(), and by programs using tvbuffs without it. */
+WS_DLL_PUBLIC void tvbuff_init(void);
+
 /** Extracts 'number of bits' starting at 'bit offset'.
  * Returns a pointer to a newly initialized g_malloc'd REAL_DATA
  * tvbuff with the bits octet aligned.
@@ -216,6 +221,11 @@ extern void tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member);
 /** Create an empty composite tvbuff. */
 WS_DLL_PUBLIC tvbuff_t *tvb_new_composite(void);
 
+/** Have a composite tvbuff free its members when it is freed, rather than
+ * chaining it to its first member on finalization. The members must not be
+ * part of any chain. Must be called before tvb_composite_finalize(). */
+WS_DLL_PUBLIC void tvb_composite_set_owns_members(tvbuff_t *tvb);
+
 /** Mark a composite tvbuff as initialized. No further appends or prepends
  * occur, data access can finally happen after this finalization. */
 WS_DLL_PUBLIC void tvb_composite_finalize(tvbuff_t *tvb);
@@ -309,6 +319,16 @@ WS_DLL_PUBLIC gfloat tvb_get_letohieee_float(tvbuff_t *tvb, const gint offset);
 WS_DLL_PUBLIC gdouble tvb_get_letohieee_double(tvbuff_t *tvb,
     const gint offset);
 
+/**
+ * Fetch a variable-length integer, encoded as given by the ENC_VARINT_
+ * value in encoding, taking at most maxlen bytes.  The value is put in
+ * *value and the number of bytes it took up is returned; 0 is returned
+ * if it would take more than maxlen bytes.  Throws an exception if the
+ * tvbuff runs out.
+ */
+WS_DLL_PUBLIC guint tvb_get_varint(tvbuff_t *tvb, const gint offset,
+    const guint maxlen, guint64 *value, const guint encoding);
+
 /**
  * Fetch an IPv4 address, in network byte order.
  * We do *not* convert it to host byte order; we leave it in
@@ -395,6 +415,13 @@ WS_DLL_PUBLIC void *tvb_memdup(wmem_allocator_t *scope, tvbuff_t *tvb,
 WS_DLL_PUBLIC const guint8 *tvb_get_ptr(tvbuff_t *tvb, const gint offset,
     const gint length);
 
+/** Returns TRUE if tvb_get_ptr() can return a pointer to the data asked for
+ * via 'offset'/'length' without copying it, i.e. if it doesn't straddle
+ * members of a TVBUFF_COMPOSITE. Throws an exception if the data isn't
+ * all there. */
+WS_DLL_PUBLIC gboolean tvb_bytes_are_contiguous(tvbuff_t *tvb, const gint offset,
+    const gint length);
+
 /** Find first occurrence of needle in tvbuff, starting at offset. Searches
  * at most maxlength number of bytes; if maxlength is -1, searches to
  * end of tvbuff.
@@ -414,6 +441,13 @@ WS_DLL_PUBLIC gint tvb_find_guint8(tvbuff_t *tvb, const gint offset,
 WS_DLL_PUBLIC gint tvb_pbrk_guint8(tvbuff_t *tvb, const gint offset,
     const gint maxlength, const guint8 *needles, guchar *found_needle);
 
+/** The same as tvb_pbrk_guint8(), with the needles compiled beforehand by
+ * ws_mempbrk_compile(). Use this for sets that are searched for often,
+ * compiling them once; small sets are then searched using the processor's
+ * vector instructions, where it has them. */
+WS_DLL_PUBLIC gint tvb_ws_mempbrk_pattern_guint8(tvbuff_t *tvb, const gint offset,
+    const gint maxlength, const ws_mempbrk_pattern *pattern, guchar *found_needle);
+
 /** Find size of stringz (NUL-terminated string) by looking for terminating
  * NUL.  The size of the string includes the terminating NUL.
  *
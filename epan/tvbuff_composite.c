@@ -26,6 +26,7 @@
 #include "config.h"
 
 #include <epan/emem.h>
+#include <epan/wmem/wmem.h>
 
 #include "tvbuff.h"
 #include "tvbuff-int.h"
@@ -34,11 +35,26 @@
 typedef struct {
 	GSList		*tvbs;
 
-	/* Used for quick testing to see if this
-	 * is the tvbuff that a COMPOSITE is
-	 * interested in. */
+	/* Filled in on finalization, for direct access to the members
+	 * and for quick testing to see if this is the tvbuff that a
+	 * COMPOSITE is interested in. */
+	tvbuff_t	**members;
+	guint		num_members;
 	guint		*start_offsets;
-	guint		*end_offsets;
+	guint		*end_offsets;	/* exclusive, so that an empty member
+					 * doesn't end before it starts */
+
+	/* Copies of ranges straddling members, handed out by get_ptr, are
+	 * allocated in packet scope. The last one is remembered, as the
+	 * same field tends to be asked for more than once, until the
+	 * packet scope is freed. */
+	guint		last_straddle_offset;
+	guint		last_straddle_length;
+	const guint8	*last_straddle;
+	guint		last_straddle_cb_id;
+
+	/* The members are freed along with the composite */
+	gboolean	owns_members;
 
 } tvb_comp_t;
 
@@ -53,17 +69,20 @@ composite_free(tvbuff_t *tvb)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
 	tvb_comp_t *composite = &composite_tvb->composite;
+	GSList	   *slist;
 
+	if (composite->owns_members) {
+		for (slist = composite->tvbs; slist != NULL; slist = slist->next)
+			tvb_free((tvbuff_t *)slist->data);
+	}
 	g_slist_free(composite->tvbs);
 
+	if (composite->last_straddle)
+		wmem_unregister_callback(wmem_packet_scope(), composite->last_straddle_cb_id);
+
+	g_free(composite->members);
 	g_free(composite->start_offsets);
 	g_free(composite->end_offsets);
-	if (tvb->real_data) {
-		/*
-		 * XXX - do this with a union?
-		 */
-		g_free((gpointer)tvb->real_data);
-	}
 }
 
 static guint
@@ -75,117 +94,221 @@ composite_offset(const tvbuff_t *tvb, const guint counter)
 	return tvb_offset_from_real_beginning_counter(member, counter);
 }
 
+/* Index of the member holding abs_offset, num_members if there is none */
+static guint
+composite_find_member(const tvb_comp_t *composite, const guint abs_offset)
+{
+	guint lo = 0;
+	guint hi = composite->num_members;
+	guint mid;
+
+	/* The first member that ends after abs_offset */
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (composite->end_offsets[mid] <= abs_offset)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* The packet scope, and the copies in it, have been freed */
+static gboolean
+composite_forget_straddle(wmem_allocator_t *allocator _U_, wmem_cb_event_t event _U_, void *user_data)
+{
+	tvb_comp_t *composite = (tvb_comp_t *)user_data;
+
+	composite->last_straddle = NULL;
+	return FALSE;
+}
+
+static void *
+composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_length)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	guint8 *target = (guint8 *) _target;
+
+	guint	    i;
+	tvb_comp_t *composite;
+	tvbuff_t   *member_tvb;
+	guint	    member_offset, member_length;
+
+	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
+
+	composite = &composite_tvb->composite;
+	i = composite_find_member(composite, abs_offset);
+
+	/* special case */
+	if (i == composite->num_members) {
+		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
+		return target;
+	}
+
+	/* Copy the part that's in the first member, then carry on across
+	 * the following members until all the data has been copied.
+	 */
+	member_offset = abs_offset - composite->start_offsets[i];
+	while (abs_length > 0) {
+		DISSECTOR_ASSERT(i < composite->num_members);
+		member_tvb = composite->members[i];
+
+		member_length = member_tvb->length - member_offset;
+		if (member_length > abs_length)
+			member_length = abs_length;
+
+		tvb_memcpy(member_tvb, target, member_offset, member_length);
+		target     += member_length;
+		abs_length -= member_length;
+
+		member_offset = 0;
+		i++;
+	}
+
+	return _target;
+}
+
 static const guint8*
 composite_get_ptr(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint	    i, num_members;
+	guint	    i;
 	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
+	tvbuff_t   *member_tvb;
 	guint	    member_offset;
-	GSList	   *slist;
+	guint8	   *straddle;
 
 	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
 
 	/* Maybe the range specified by offset/length
 	 * is contiguous inside one of the member tvbuffs */
 	composite = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
-
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+	i = composite_find_member(composite, abs_offset);
 
 	/* special case */
-	if (!member_tvb) {
+	if (i == composite->num_members) {
 		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
 		return "";
 	}
 
+	member_tvb    = composite->members[i];
 	member_offset = abs_offset - composite->start_offsets[i];
 
 	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
 		/*
 		 * The range is, in fact, contiguous within member_tvb.
 		 */
-		DISSECTOR_ASSERT(!tvb->real_data);
 		return tvb_get_ptr(member_tvb, member_offset, abs_length);
 	}
-	else {
-		tvb->real_data = (guint8 *)tvb_memdup(NULL, tvb, 0, -1);
-		return tvb->real_data + abs_offset;
-	}
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	/*
+	 * The range straddles members. Copy just that range, rather than
+	 * flattening the whole composite, into packet scope, as the
+	 * caller may hang on to the pointer for the rest of the packet.
+	 */
+	if (composite->last_straddle &&
+	    abs_offset >= composite->last_straddle_offset &&
+	    abs_offset + abs_length <= composite->last_straddle_offset + composite->last_straddle_length)
+		return composite->last_straddle + (abs_offset - composite->last_straddle_offset);
+
+	straddle = (guint8 *)wmem_alloc(wmem_packet_scope(), abs_length);
+	composite_memcpy(tvb, straddle, abs_offset, abs_length);
+
+	if (!composite->last_straddle)
+		composite->last_straddle_cb_id = wmem_register_callback(wmem_packet_scope(),
+				composite_forget_straddle, composite);
+	composite->last_straddle_offset = abs_offset;
+	composite->last_straddle_length = abs_length;
+	composite->last_straddle        = straddle;
+
+	return straddle;
 }
 
-static void *
-composite_memcpy(tvbuff_t *tvb, void* _target, guint abs_offset, guint abs_length)
+/* Search member by member, rather than getting a pointer to (and so
+ * copying) the whole range */
+static gint
+composite_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
 {
 	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
-	guint8 *target = (guint8 *) _target;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvbuff_t   *member_tvb;
+	guint	    i, member_offset, member_length;
+	gint	    result;
 
-	guint	    i, num_members;
-	tvb_comp_t *composite;
-	tvbuff_t   *member_tvb = NULL;
-	guint	    member_offset, member_length;
-	GSList	   *slist;
+	i = composite_find_member(composite, abs_offset);
+	if (i == composite->num_members)
+		return -1;
 
-	/* DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops); */
+	member_offset = abs_offset - composite->start_offsets[i];
+	while (limit > 0 && i < composite->num_members) {
+		member_tvb = composite->members[i];
 
-	/* Maybe the range specified by offset/length
-	 * is contiguous inside one of the member tvbuffs */
-	composite   = &composite_tvb->composite;
-	num_members = g_slist_length(composite->tvbs);
+		member_length = member_tvb->length - member_offset;
+		if (member_length > limit)
+			member_length = limit;
 
-	for (i = 0; i < num_members; i++) {
-		if (abs_offset <= composite->end_offsets[i]) {
-			slist = g_slist_nth(composite->tvbs, i);
-			member_tvb = (tvbuff_t *)slist->data;
-			break;
-		}
-	}
+		result = tvb_find_guint8(member_tvb, member_offset, member_length, needle);
+		if (result != -1)
+			return composite->start_offsets[i] + result;
 
-	/* special case */
-	if (!member_tvb) {
-		DISSECTOR_ASSERT(abs_offset == tvb->length && abs_length == 0);
-		return target;
+		limit -= member_length;
+		member_offset = 0;
+		i++;
 	}
 
+	return -1;
+}
+
+static gint
+composite_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern *pattern, guchar *found_needle)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvbuff_t   *member_tvb;
+	guint	    i, member_offset, member_length;
+	gint	    result;
+
+	i = composite_find_member(composite, abs_offset);
+	if (i == composite->num_members)
+		return -1;
+
 	member_offset = abs_offset - composite->start_offsets[i];
+	while (limit > 0 && i < composite->num_members) {
+		member_tvb = composite->members[i];
 
-	if (tvb_bytes_exist(member_tvb, member_offset, abs_length)) {
-		DISSECTOR_ASSERT(!tvb->real_data);
-		return tvb_memcpy(member_tvb, target, member_offset, abs_length);
+		member_length = member_tvb->length - member_offset;
+		if (member_length > limit)
+			member_length = limit;
+
+		result = tvb_ws_mempbrk_pattern_guint8(member_tvb, member_offset, member_length, pattern, found_needle);
+		if (result != -1)
+			return composite->start_offsets[i] + result;
+
+		limit -= member_length;
+		member_offset = 0;
+		i++;
 	}
-	else {
-		/* The requested data is non-contiguous inside
-		 * the member tvb. We have to memcpy() the part that's in the member tvb,
-		 * then iterate across the other member tvb's, copying their portions
-		 * until we have copied all data.
-		 */
-		member_length = tvb_length_remaining(member_tvb, member_offset);
 
-		/* composite_memcpy() can't handle a member_length of zero. */
-		DISSECTOR_ASSERT(member_length > 0);
+	return -1;
+}
 
-		tvb_memcpy(member_tvb, target, member_offset, member_length);
-		abs_offset	+= member_length;
-		abs_length	-= member_length;
+static gboolean
+composite_is_contiguous(tvbuff_t *tvb, guint abs_offset, guint abs_length)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+	tvb_comp_t *composite = &composite_tvb->composite;
+	tvbuff_t   *member_tvb;
+	guint	    i, member_offset;
 
-		/* Recurse */
-		if (abs_length > 0) {
-			composite_memcpy(tvb, target + member_length, abs_offset, abs_length);
-		}
+	i = composite_find_member(composite, abs_offset);
+	if (i == composite->num_members)
+		return TRUE;
 
-		return target;
-	}
+	member_tvb    = composite->members[i];
+	member_offset = abs_offset - composite->start_offsets[i];
 
-	DISSECTOR_ASSERT_NOT_REACHED();
+	return tvb_bytes_exist(member_tvb, member_offset, abs_length) &&
+		tvb_bytes_are_contiguous(member_tvb, member_offset, abs_length);
 }
 
 static const struct tvb_ops tvb_composite_ops = {
@@ -195,9 +318,10 @@ static const struct tvb_ops tvb_composite_ops = {
 	composite_offset,     /* offset */
 	composite_get_ptr,    /* get_ptr */
 	composite_memcpy,     /* memcpy */
-	NULL,                 /* find_guint8 XXX */
-	NULL,                 /* pbrk_guint8 XXX */
+	composite_find_guint8, /* find_guint8 */
+	composite_pbrk_guint8, /* pbrk_guint8 */
 	NULL,                 /* clone */
+	composite_is_contiguous, /* is_contiguous */
 };
 
 /*
@@ -207,6 +331,9 @@ static const struct tvb_ops tvb_composite_ops = {
  *      tvb is finalized.
  *      This means that composite tvb members must all be in the same chain.
  *      ToDo: enforce this: By searching the chain?
+ *   2. Unless tvb_composite_set_owns_members() was called, in which case the
+ *      composite isn't chained to anything, and frees its members itself.
+ *      Such members must not be in any chain.
  */
 tvbuff_t *
 tvb_new_composite(void)
@@ -216,8 +343,15 @@ tvb_new_composite(void)
 	tvb_comp_t *composite = &composite_tvb->composite;
 
 	composite->tvbs		 = NULL;
+	composite->members	 = NULL;
+	composite->num_members	 = 0;
 	composite->start_offsets = NULL;
 	composite->end_offsets	 = NULL;
+	composite->last_straddle = NULL;
+	composite->last_straddle_offset = 0;
+	composite->last_straddle_length = 0;
+	composite->last_straddle_cb_id  = 0;
+	composite->owns_members	 = FALSE;
 
 	return tvb;
 }
@@ -258,6 +392,17 @@ tvb_composite_prepend(tvbuff_t *tvb, tvbuff_t *member)
 	composite->tvbs = g_slist_prepend(composite->tvbs, member);
 }
 
+void
+tvb_composite_set_owns_members(tvbuff_t *tvb)
+{
+	struct tvb_composite *composite_tvb = (struct tvb_composite *) tvb;
+
+	DISSECTOR_ASSERT(tvb && !tvb->initialized);
+	DISSECTOR_ASSERT(tvb->ops == &tvb_composite_ops);
+
+	composite_tvb->composite.owns_members = TRUE;
+}
+
 void
 tvb_composite_finalize(tvbuff_t *tvb)
 {
@@ -282,18 +427,22 @@ tvb_composite_finalize(tvbuff_t *tvb)
 	 */
 	DISSECTOR_ASSERT(num_members);
 
+	composite->num_members	 = num_members;
+	composite->members	 = g_new(tvbuff_t *, num_members);
 	composite->start_offsets = g_new(guint, num_members);
 	composite->end_offsets = g_new(guint, num_members);
 
 	for (slist = composite->tvbs; slist != NULL; slist = slist->next) {
 		DISSECTOR_ASSERT((guint) i < num_members);
 		member_tvb = (tvbuff_t *)slist->data;
+		composite->members[i] = member_tvb;
 		composite->start_offsets[i] = tvb->length;
 		tvb->length += member_tvb->length;
 		tvb->reported_length += member_tvb->reported_length;
-		composite->end_offsets[i] = tvb->length - 1;
+		composite->end_offsets[i] = tvb->length;
 		i++;
 	}
-	tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb); /* chain composite tvb to first member */
+	if (!composite->owns_members)
+		tvb_add_to_chain((tvbuff_t *)composite->tvbs->data, tvb); /* chain composite tvb to first member */
 	tvb->initialized = TRUE;
 }
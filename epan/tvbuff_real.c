@@ -68,6 +68,7 @@ static const struct tvb_ops tvb_real_ops = {
 	NULL,                 /* find_guint8 */
 	NULL,                 /* pbrk_guint8 */
 	NULL,                 /* clone */
+	NULL,                 /* is_contiguous */
 };
 
 tvbuff_t *
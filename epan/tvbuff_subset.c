@@ -79,15 +79,28 @@ subset_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
 {
 	struct tvb_subset *subset_tvb = (struct tvb_subset *) tvb;
 
-	return tvb_find_guint8(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, limit, needle);
+	gint result;
+
+	result = tvb_find_guint8(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, limit, needle);
+	if (result == -1)
+		return result;
+
+	/* Relative to the subset, not the backing tvbuff */
+	return result - subset_tvb->subset.offset;
 }
 
 static gint
-subset_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needles, guchar *found_needle)
+subset_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern *pattern, guchar *found_needle)
 {
 	struct tvb_subset *subset_tvb = (struct tvb_subset *) tvb;
 
-	return tvb_pbrk_guint8(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, limit, needles, found_needle);
+	gint result;
+
+	result = tvb_ws_mempbrk_pattern_guint8(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, limit, pattern, found_needle);
+	if (result == -1)
+		return result;
+
+	return result - subset_tvb->subset.offset;
 }
 
 static tvbuff_t *
@@ -98,6 +111,14 @@ subset_clone(tvbuff_t *tvb, guint abs_offset, guint abs_length)
 	return tvb_clone_offset_len(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, abs_length);
 }
 
+static gboolean
+subset_is_contiguous(tvbuff_t *tvb, guint abs_offset, guint abs_length)
+{
+	struct tvb_subset *subset_tvb = (struct tvb_subset *) tvb;
+
+	return tvb_bytes_are_contiguous(subset_tvb->subset.tvb, subset_tvb->subset.offset + abs_offset, abs_length);
+}
+
 static const struct tvb_ops tvb_subset_ops = {
 	sizeof(struct tvb_subset), /* size */
 
@@ -108,6 +129,7 @@ static const struct tvb_ops tvb_subset_ops = {
 	subset_find_guint8,   /* find_guint8 */
 	subset_pbrk_guint8,   /* pbrk_guint8 */
 	subset_clone,         /* clone */
+	subset_is_contiguous, /* is_contiguous */
 };
 
 static tvbuff_t *
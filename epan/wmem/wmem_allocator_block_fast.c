@@ -0,0 +1,378 @@
+/* wmem_allocator_block_fast.c
+ * Wireshark Memory Manager Fast Block Allocator
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "wmem_core.h"
+#include "wmem_allocator.h"
+#include "wmem_allocator_block_fast.h"
+
+/* This is the bump-pointer allocator the block allocator started out as (see
+ * the HISTORY in wmem_allocator_block.c), for pools whose memory is only
+ * ever released all at once, such as the nodes of a protocol tree.
+ *
+ * Allocations are served sequentially out of big OS-level blocks, each
+ * prefixed with a small chunk header holding its length so that realloc
+ * knows how much to copy. free() is a no-op, and realloc() only grows in
+ * place if the chunk happens to be the last one handed out; otherwise the
+ * old chunk is simply abandoned until the next free_all().
+ *
+ * Blocks are kept across free_all(), which just rewinds to the first block
+ * and so takes constant time; the others are re-used as allocation moves
+ * on to them again, and are only given back to the OS by gc(). Requests
+ * too big for a block are 'jumbo' allocations, malloc()ed on their own and
+ * kept on a list so that free_all() can free them.
+ */
+
+#define WMEM_BLOCK_FAST_SIZE (2 * 1024 * 1024)
+
+#define WMEM_BLOCK_FAST_ALIGN_AMOUNT 8
+#define WMEM_BLOCK_FAST_ALIGN_SIZE(SIZE) \
+    (((SIZE) + WMEM_BLOCK_FAST_ALIGN_AMOUNT - 1) & \
+     ~((size_t)WMEM_BLOCK_FAST_ALIGN_AMOUNT - 1))
+
+typedef struct _wmem_block_fast_hdr_t {
+    struct _wmem_block_fast_hdr_t *next;
+    size_t                         pos;
+} wmem_block_fast_hdr_t;
+
+typedef struct _wmem_block_fast_chunk_t {
+    guint32 len;
+    guint32 jumbo;
+} wmem_block_fast_chunk_t;
+
+typedef struct _wmem_block_fast_jumbo_t {
+    struct _wmem_block_fast_jumbo_t *prev, *next;
+    size_t                           size;
+} wmem_block_fast_jumbo_t;
+
+#define WMEM_BLOCK_FAST_HEADER_SIZE \
+    WMEM_BLOCK_FAST_ALIGN_SIZE(sizeof(wmem_block_fast_hdr_t))
+#define WMEM_BLOCK_FAST_CHUNK_HEADER_SIZE \
+    WMEM_BLOCK_FAST_ALIGN_SIZE(sizeof(wmem_block_fast_chunk_t))
+#define WMEM_BLOCK_FAST_JUMBO_HEADER_SIZE \
+    WMEM_BLOCK_FAST_ALIGN_SIZE(sizeof(wmem_block_fast_jumbo_t))
+
+#define WMEM_BLOCK_FAST_MAX_ALLOC_SIZE \
+    (WMEM_BLOCK_FAST_SIZE - WMEM_BLOCK_FAST_HEADER_SIZE - \
+     WMEM_BLOCK_FAST_CHUNK_HEADER_SIZE)
+
+#define WMEM_CHUNK_TO_DATA(CHUNK) \
+    ((void*)((guint8*)(CHUNK) + WMEM_BLOCK_FAST_CHUNK_HEADER_SIZE))
+#define WMEM_DATA_TO_CHUNK(DATA) \
+    ((wmem_block_fast_chunk_t*)((guint8*)(DATA) - \
+                                WMEM_BLOCK_FAST_CHUNK_HEADER_SIZE))
+#define WMEM_JUMBO_TO_CHUNK(JUMBO) \
+    ((wmem_block_fast_chunk_t*)((guint8*)(JUMBO) + \
+                                WMEM_BLOCK_FAST_JUMBO_HEADER_SIZE))
+#define WMEM_CHUNK_TO_JUMBO(CHUNK) \
+    ((wmem_block_fast_jumbo_t*)((guint8*)(CHUNK) - \
+                                WMEM_BLOCK_FAST_JUMBO_HEADER_SIZE))
+
+typedef struct _wmem_block_fast_allocator_t {
+    wmem_block_fast_hdr_t   *block_list;
+    wmem_block_fast_hdr_t   *current;
+    wmem_block_fast_jumbo_t *jumbo_list;
+} wmem_block_fast_allocator_t;
+
+/* Moves on to the next block, allocating it if there isn't one already */
+static void
+wmem_block_fast_next_block(wmem_block_fast_allocator_t *allocator)
+{
+    wmem_block_fast_hdr_t *block;
+
+    if (allocator->current && allocator->current->next) {
+        block = allocator->current->next;
+    }
+    else {
+        block = (wmem_block_fast_hdr_t *)wmem_alloc(NULL, WMEM_BLOCK_FAST_SIZE);
+        block->next = NULL;
+
+        if (allocator->current) {
+            allocator->current->next = block;
+        }
+        else {
+            allocator->block_list = block;
+        }
+    }
+
+    block->pos         = WMEM_BLOCK_FAST_HEADER_SIZE;
+    allocator->current = block;
+}
+
+static void
+wmem_block_fast_link_jumbo(wmem_block_fast_allocator_t *allocator,
+                           wmem_block_fast_jumbo_t *jumbo)
+{
+    jumbo->prev = NULL;
+    jumbo->next = allocator->jumbo_list;
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo;
+    }
+    allocator->jumbo_list = jumbo;
+}
+
+static void
+wmem_block_fast_unlink_jumbo(wmem_block_fast_allocator_t *allocator,
+                             wmem_block_fast_jumbo_t *jumbo)
+{
+    if (jumbo->prev) {
+        jumbo->prev->next = jumbo->next;
+    }
+    else {
+        allocator->jumbo_list = jumbo->next;
+    }
+    if (jumbo->next) {
+        jumbo->next->prev = jumbo->prev;
+    }
+}
+
+static void *
+wmem_block_fast_alloc_jumbo(wmem_block_fast_allocator_t *allocator,
+                            const size_t size)
+{
+    wmem_block_fast_jumbo_t *jumbo;
+    wmem_block_fast_chunk_t *chunk;
+
+    jumbo = (wmem_block_fast_jumbo_t *)wmem_alloc(NULL,
+            WMEM_BLOCK_FAST_JUMBO_HEADER_SIZE +
+            WMEM_BLOCK_FAST_CHUNK_HEADER_SIZE + size);
+
+    jumbo->size = size;
+    wmem_block_fast_link_jumbo(allocator, jumbo);
+
+    chunk = WMEM_JUMBO_TO_CHUNK(jumbo);
+    chunk->len   = 0;
+    chunk->jumbo = TRUE;
+
+    return WMEM_CHUNK_TO_DATA(chunk);
+}
+
+static void *
+wmem_block_fast_alloc(void *private_data, const size_t size)
+{
+    wmem_block_fast_allocator_t *allocator;
+    wmem_block_fast_chunk_t     *chunk;
+    size_t                       aligned_size;
+
+    allocator = (wmem_block_fast_allocator_t*) private_data;
+
+    if (size > WMEM_BLOCK_FAST_MAX_ALLOC_SIZE) {
+        return wmem_block_fast_alloc_jumbo(allocator, size);
+    }
+
+    aligned_size = WMEM_BLOCK_FAST_CHUNK_HEADER_SIZE +
+                   WMEM_BLOCK_FAST_ALIGN_SIZE(size);
+
+    if (allocator->current == NULL ||
+            allocator->current->pos + aligned_size > WMEM_BLOCK_FAST_SIZE) {
+        wmem_block_fast_next_block(allocator);
+    }
+
+    chunk = (wmem_block_fast_chunk_t *)
+        ((guint8 *)allocator->current + allocator->current->pos);
+    chunk->len   = (guint32) size;
+    chunk->jumbo = FALSE;
+
+    allocator->current->pos += aligned_size;
+
+    return WMEM_CHUNK_TO_DATA(chunk);
+}
+
+static void
+wmem_block_fast_free(void *private_data, void *ptr)
+{
+    wmem_block_fast_allocator_t *allocator;
+    wmem_block_fast_chunk_t     *chunk;
+    wmem_block_fast_jumbo_t     *jumbo;
+
+    allocator = (wmem_block_fast_allocator_t*) private_data;
+    chunk     = WMEM_DATA_TO_CHUNK(ptr);
+
+    /* Only jumbo allocations are given back before free_all() */
+    if (!chunk->jumbo) {
+        return;
+    }
+
+    jumbo = WMEM_CHUNK_TO_JUMBO(chunk);
+    wmem_block_fast_unlink_jumbo(allocator, jumbo);
+    wmem_free(NULL, jumbo);
+}
+
+static void *
+wmem_block_fast_realloc(void *private_data, void *ptr, const size_t size)
+{
+    wmem_block_fast_allocator_t *allocator;
+    wmem_block_fast_chunk_t     *chunk;
+    wmem_block_fast_jumbo_t     *jumbo;
+    wmem_block_fast_hdr_t       *current;
+    size_t                       offset;
+    void                        *newptr;
+
+    allocator = (wmem_block_fast_allocator_t*) private_data;
+    chunk     = WMEM_DATA_TO_CHUNK(ptr);
+
+    if (chunk->jumbo) {
+        jumbo = WMEM_CHUNK_TO_JUMBO(chunk);
+        wmem_block_fast_unlink_jumbo(allocator, jumbo);
+        jumbo = (wmem_block_fast_jumbo_t *)wmem_realloc(NULL, jumbo,
+                WMEM_BLOCK_FAST_JUMBO_HEADER_SIZE +
+                WMEM_BLOCK_FAST_CHUNK_HEADER_SIZE + size);
+
+        jumbo->size = size;
+        wmem_block_fast_link_jumbo(allocator, jumbo);
+
+        return WMEM_CHUNK_TO_DATA(WMEM_JUMBO_TO_CHUNK(jumbo));
+    }
+
+    if (size <= chunk->len) {
+        /* Shrinking; keep the length for a later grow */
+        return ptr;
+    }
+
+    /* If this was the last chunk handed out and there's room after it,
+     * just grow it in place */
+    current = allocator->current;
+    if ((guint8 *)ptr > (guint8 *)current &&
+            (guint8 *)ptr < (guint8 *)current + WMEM_BLOCK_FAST_SIZE) {
+        offset = (size_t)((guint8 *)ptr - (guint8 *)current);
+        if (offset + WMEM_BLOCK_FAST_ALIGN_SIZE(chunk->len) == current->pos &&
+                size <= WMEM_BLOCK_FAST_MAX_ALLOC_SIZE &&
+                offset + WMEM_BLOCK_FAST_ALIGN_SIZE(size) <= WMEM_BLOCK_FAST_SIZE) {
+            current->pos = offset + WMEM_BLOCK_FAST_ALIGN_SIZE(size);
+            chunk->len   = (guint32) size;
+            return ptr;
+        }
+    }
+
+    newptr = wmem_block_fast_alloc(allocator, size);
+    memcpy(newptr, ptr, chunk->len);
+
+    return newptr;
+}
+
+static void
+wmem_block_fast_free_all(void *private_data)
+{
+    wmem_block_fast_allocator_t *allocator;
+    wmem_block_fast_jumbo_t     *jumbo, *next_jumbo;
+
+    allocator = (wmem_block_fast_allocator_t*) private_data;
+
+    /* Rewind to the first block; the others have their position reset
+     * when allocation gets to them again */
+    allocator->current = allocator->block_list;
+    if (allocator->current) {
+        allocator->current->pos = WMEM_BLOCK_FAST_HEADER_SIZE;
+    }
+
+    jumbo = allocator->jumbo_list;
+    while (jumbo) {
+        next_jumbo = jumbo->next;
+        wmem_free(NULL, jumbo);
+        jumbo = next_jumbo;
+    }
+    allocator->jumbo_list = NULL;
+}
+
+static void
+wmem_block_fast_gc(void *private_data)
+{
+    wmem_block_fast_allocator_t *allocator;
+    wmem_block_fast_hdr_t       *block, *next_block;
+
+    allocator = (wmem_block_fast_allocator_t*) private_data;
+
+    /* Free the blocks past the one in use */
+    if (allocator->current == NULL) {
+        return;
+    }
+
+    block = allocator->current->next;
+    allocator->current->next = NULL;
+    while (block) {
+        next_block = block->next;
+        wmem_free(NULL, block);
+        block = next_block;
+    }
+}
+
+static void
+wmem_block_fast_allocator_cleanup(void *private_data)
+{
+    wmem_block_fast_allocator_t *allocator;
+    wmem_block_fast_hdr_t       *block, *next_block;
+
+    allocator = (wmem_block_fast_allocator_t*) private_data;
+
+    wmem_block_fast_free_all(allocator);
+
+    block = allocator->block_list;
+    while (block) {
+        next_block = block->next;
+        wmem_free(NULL, block);
+        block = next_block;
+    }
+
+    wmem_free(NULL, allocator);
+}
+
+void
+wmem_block_fast_allocator_init(wmem_allocator_t *allocator)
+{
+    wmem_block_fast_allocator_t *block_allocator;
+
+    block_allocator = wmem_new(NULL, wmem_block_fast_allocator_t);
+
+    allocator->alloc   = &wmem_block_fast_alloc;
+    allocator->realloc = &wmem_block_fast_realloc;
+    allocator->free    = &wmem_block_fast_free;
+
+    allocator->free_all = &wmem_block_fast_free_all;
+    allocator->gc       = &wmem_block_fast_gc;
+    allocator->cleanup  = &wmem_block_fast_allocator_cleanup;
+
+    allocator->private_data = (void*) block_allocator;
+
+    block_allocator->block_list = NULL;
+    block_allocator->current    = NULL;
+    block_allocator->jumbo_list = NULL;
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 4
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=4 tabstop=8 expandtab:
+ * :indentSize=4:tabSize=8:noTabs=true:
+ */
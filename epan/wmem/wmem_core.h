@@ -59,10 +59,14 @@ typedef enum _wmem_allocator_type_t {
                 memory at a time (8 MB currently) and serves allocations out of
                 those chunks. Designed for efficiency, especially in the
                 free_all operation. */
-    WMEM_ALLOCATOR_STRICT /**< An allocator that does its best to find invalid
+    WMEM_ALLOCATOR_STRICT, /**< An allocator that does its best to find invalid
                 memory usage via things like canaries and scrubbing freed
                 memory. Valgrind is the better choice on platforms that support
                 it. */
+    WMEM_ALLOCATOR_BLOCK_FAST /**< A block allocator like WMEM_ALLOCATOR_BLOCK
+                but which just bumps a pointer through its blocks: free is a
+                no-op and realloc usually copies. Faster for pools that are
+                only ever emptied by free_all, such as the protocol tree. */
 } wmem_allocator_type_t;
 
 /** Allocate the requested amount of memory in the given pool.
@@ -31,6 +31,7 @@
 #include "wmem.h"
 #include "wmem_allocator.h"
 #include "wmem_allocator_block.h"
+#include "wmem_allocator_block_fast.h"
 #include "wmem_allocator_simple.h"
 #include "wmem_allocator_strict.h"
 
@@ -329,7 +330,7 @@ wmem_time_allocator(wmem_allocator_type_t type)
 static void
 wmem_time_allocators(void)
 {
-    double simple_time, block_time;
+    double simple_time, block_time, block_fast_time;
 
     g_test_timer_start();
     wmem_time_allocator(WMEM_ALLOCATOR_SIMPLE);
@@ -339,7 +340,12 @@ wmem_time_allocators(void)
     wmem_time_allocator(WMEM_ALLOCATOR_BLOCK);
     block_time = g_test_timer_elapsed();
 
-    printf("(simple: %lf; block: %lf) ", simple_time, block_time);
+    g_test_timer_start();
+    wmem_time_allocator(WMEM_ALLOCATOR_BLOCK_FAST);
+    block_fast_time = g_test_timer_elapsed();
+
+    printf("(simple: %lf; block: %lf; block_fast: %lf) ",
+            simple_time, block_time, block_fast_time);
     g_assert(simple_time > block_time);
 }
 
@@ -349,6 +355,12 @@ wmem_test_allocator_block(void)
     wmem_test_allocator(WMEM_ALLOCATOR_BLOCK, &wmem_block_verify);
 }
 
+static void
+wmem_test_allocator_block_fast(void)
+{
+    wmem_test_allocator(WMEM_ALLOCATOR_BLOCK_FAST, NULL);
+}
+
 static void
 wmem_test_allocator_simple(void)
 {
@@ -911,6 +923,7 @@ main(int argc, char **argv)
     g_test_init(&argc, &argv, NULL);
 
     g_test_add_func("/wmem/allocator/block",     wmem_test_allocator_block);
+    g_test_add_func("/wmem/allocator/blk_fast",  wmem_test_allocator_block_fast);
     g_test_add_func("/wmem/allocator/simple",    wmem_test_allocator_simple);
     g_test_add_func("/wmem/allocator/strict",    wmem_test_allocator_strict);
     g_test_add_func("/wmem/allocator/times",     wmem_time_allocators);
@@ -1234,7 +1234,7 @@ read_packet(capture_file *cf, dfilter_t *dfcode, epan_dissect_t *edt,
             column_info *cinfo, gint64 offset)
 {
   struct wtap_pkthdr *phdr = wtap_phdr(cf->wth);
-  const guint8 *buf = wtap_buf_ptr(cf->wth);
+  const guint8 *buf = wtap_buf_ptr_const(cf->wth);
   frame_data    fdlocal;
   guint32       framenum;
   frame_data   *fdata;
@@ -1537,7 +1537,7 @@ cf_merge_files(char **out_filenamep, int in_file_count,
       phdr->presence_flags = phdr->presence_flags | WTAP_HAS_INTERFACE_ID;
     }
     if (!wtap_dump(pdh, wtap_phdr(in_file->wth),
-                   wtap_buf_ptr(in_file->wth), &write_err)) {
+                   wtap_buf_ptr_const(in_file->wth), &write_err)) {
       got_write_error = TRUE;
       break;
     }
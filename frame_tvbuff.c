@@ -137,13 +137,13 @@ frame_find_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, guint8 needle)
 }
 
 static gint
-frame_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const guint8 *needles, guchar *found_needle)
+frame_pbrk_guint8(tvbuff_t *tvb, guint abs_offset, guint limit, const ws_mempbrk_pattern *pattern, guchar *found_needle)
 {
 	struct tvb_frame *frame_tvb = (struct tvb_frame *) tvb;
 
 	frame_cache(frame_tvb);
 
-	return tvb_pbrk_guint8(tvb, abs_offset, limit, needles, found_needle);
+	return tvb_ws_mempbrk_pattern_guint8(tvb, abs_offset, limit, pattern, found_needle);
 }
 
 static guint
@@ -165,6 +165,7 @@ static const struct tvb_ops tvb_frame_ops = {
 	frame_find_guint8,    /* find_guint8 */
 	frame_pbrk_guint8,    /* pbrk_guint8 */
 	frame_clone,          /* clone */
+	NULL,                 /* is_contiguous */
 };
 
 /* based on tvb_new_real_data() */
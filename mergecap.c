@@ -136,6 +136,9 @@ usage(gboolean is_error)
   fprintf(output, "  -T <encap type>   set the output file encapsulation type;\n");
   fprintf(output, "                    default is the same as the first input file.\n");
   fprintf(output, "                    an empty \"-T\" option will list the encapsulation types.\n");
+  fprintf(output, "  -z <compression>  compress the output file with gzip, zstd or lz4;\n");
+  fprintf(output, "                    default is none.\n");
+  fprintf(output, "                    an empty \"-z\" option will list the compression types.\n");
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
   fprintf(output, "  -h                display this help and exit.\n");
@@ -209,6 +212,17 @@ list_encap_types(void) {
   g_free(encaps);
 }
 
+static void
+list_compression_types(void) {
+  GSList *names, *name;
+
+  fprintf(stderr, "mergecap: The available compression types for the \"-z\" flag are:\n");
+  names = wtap_get_compression_type_names();
+  for (name = names; name != NULL; name = g_slist_next(name))
+    fprintf(stderr, "    %s\n", (const char *)name->data);
+  g_slist_free(names);
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -223,6 +237,7 @@ main(int argc, char *argv[])
   int                 file_type          = WTAP_FILE_TYPE_SUBTYPE_PCAP; /* default to pcapng format */
 #endif
   int                 frame_type         = -2;
+  wtap_compression_type compression_type = WTAP_UNCOMPRESSED;
   int                 out_fd;
   merge_in_file_t    *in_files           = NULL, *in_file;
   int                 i;
@@ -241,7 +256,7 @@ main(int argc, char *argv[])
 #endif /* _WIN32 */
 
   /* Process the options first */
-  while ((opt = getopt(argc, argv, "aF:hs:T:vw:")) != -1) {
+  while ((opt = getopt(argc, argv, "aF:hs:T:vw:z:")) != -1) {
 
     switch (opt) {
     case 'a':
@@ -285,6 +300,15 @@ main(int argc, char *argv[])
       out_filename = optarg;
       break;
 
+    case 'z':
+      if (!wtap_name_to_compression_type(optarg, &compression_type)) {
+        fprintf(stderr, "mergecap: \"%s\" isn't a valid compression type\n",
+                optarg);
+        list_compression_types();
+        exit(1);
+      }
+      break;
+
     case '?':              /* Bad options if GNU getopt */
       switch(optopt) {
       case'F':
@@ -293,6 +317,9 @@ main(int argc, char *argv[])
       case'T':
         list_encap_types();
         break;
+      case'z':
+        list_compression_types();
+        break;
       default:
         usage(TRUE);
       }
@@ -415,11 +442,12 @@ main(int argc, char *argv[])
     shb_hdr->shb_os        = NULL;              /* NULL if not available, UTF-8 string containing the name of the operating system used to create this section. */
     shb_hdr->shb_user_appl = "mergecap";        /* NULL if not available, UTF-8 string containing the name of the application used to create this section. */
 
-    pdh = wtap_dump_fdopen_ng(out_fd, file_type, frame_type, snaplen,
-                              FALSE /* compressed */, shb_hdr, NULL /* wtapng_iface_descriptions_t *idb_inf */, &open_err);
+    pdh = wtap_dump_fdopen_compressed(out_fd, file_type, frame_type, snaplen,
+                                      compression_type, shb_hdr, NULL /* wtapng_iface_descriptions_t *idb_inf */, &open_err);
     g_string_free(comment_gstr, TRUE);
   } else {
-    pdh = wtap_dump_fdopen(out_fd, file_type, frame_type, snaplen, FALSE /* compressed */, &open_err);
+    pdh = wtap_dump_fdopen_compressed(out_fd, file_type, frame_type, snaplen,
+                                      compression_type, NULL, NULL, &open_err);
   }
   if (pdh == NULL) {
     merge_close_in_files(in_file_count, in_files);
@@ -461,7 +489,7 @@ main(int argc, char *argv[])
       phdr = &snap_phdr;
     }
 
-    if (!wtap_dump(pdh, phdr, wtap_buf_ptr(in_file->wth), &write_err)) {
+    if (!wtap_dump(pdh, phdr, wtap_buf_ptr_const(in_file->wth), &write_err)) {
       got_write_error = TRUE;
       break;
     }
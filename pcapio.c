@@ -42,6 +42,10 @@
 
 #include "config.h"
 
+#ifdef __linux__
+#define _GNU_SOURCE /* Otherwise O_DIRECT won't be defined */
+#endif
+
 #include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
@@ -49,12 +53,20 @@
 #ifdef HAVE_SYS_TIME_H
 #include <sys/time.h>
 #endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 #ifdef _WIN32
 #include <Windows.h>
 #endif
 
 #include <glib.h>
 
+#include <wsutil/file_util.h>
+
 #include "pcapio.h"
 
 /* Magic numbers in "libpcap" files.
@@ -178,20 +190,444 @@ struct option {
 #define ISB_USRDELIV      8
 #define ADD_PADDING(x) ((((x) + 3) >> 2) << 2)
 
+/*
+ * Writing out what's written to a pcapio_file_t.
+ *
+ * It's copied into a buffer, which is written out when it fills up, or
+ * when the file is flushed or closed.  With a writer thread, a full
+ * buffer is handed over to the thread, and the caller goes on filling
+ * another; only when all PCAPIO_NUM_BUFFERS of them are waiting to be
+ * written does the caller wait for the disk.
+ *
+ * With direct I/O, the buffers, and where they go in the file, are
+ * aligned to PCAPIO_ALIGN, and they're written with O_DIRECT, so that a
+ * capture, which won't be read back soon, doesn't push everything else
+ * out of the page cache.  A flush can leave a partial block at the end
+ * of a buffer; that's written through the page cache, and written again,
+ * with what follows it, from the start of the next buffer.
+ */
+#define PCAPIO_ALIGN                  4096
+#define PCAPIO_BUFFER_SIZE            (1024 * 1024)     /* with a thread */
+#define PCAPIO_NUM_BUFFERS            4
+#define PCAPIO_UNTHREADED_BUFFER_SIZE (64 * 1024)
+
+#if defined(O_DIRECT) && defined(F_SETFL) && defined(HAVE_UNISTD_H)
+#define PCAPIO_DIRECT_IO
+#endif
+
+typedef struct {
+        guint8 *mem;            /* as allocated */
+        guint8 *data;           /* mem, aligned to PCAPIO_ALIGN */
+        size_t  len;            /* bytes of data in it */
+        gint64  offset;         /* where they go in the file */
+        int     err;            /* set if writing it out failed */
+} pcapio_buffer_t;
+
+struct pcapio_file {
+        int              fd;
+        gboolean         direct_io;     /* O_DIRECT is set on fd */
+        guint64          sync_interval;
+        size_t           buf_size;
+        pcapio_buffer_t *cur;           /* the buffer being filled */
+        gboolean         unflushed;     /* something's been put in it */
+        int              err;           /* the first error the caller saw */
+
+        /* The writer's; the thread's, if there is one */
+        guint64          unsynced;      /* bytes written since the last sync */
+        int              write_err;     /* nothing's written after an error */
+
+        /* Closing */
+        pcapio_closing_cb closing_cb;   /* called before the file's closed */
+        gpointer         closing_data;
+        int              close_err;     /* set if syncing or closing it failed */
+
+        /* With a writer thread */
+        GThread         *thread;
+        GAsyncQueue     *todo;          /* buffers to be written out */
+        GAsyncQueue     *done;          /* and back from being written out */
+        pcapio_buffer_t *free_bufs[PCAPIO_NUM_BUFFERS];
+        guint            num_free;
+};
+
+/* Handed to the writer thread to make it finish */
+static pcapio_buffer_t pcapio_quit;
+
+/* Handed to the writer thread to make it close the file, and finish */
+static pcapio_buffer_t pcapio_close_file;
+
+static pcapio_buffer_t *
+pcapio_buffer_new(size_t size)
+{
+        pcapio_buffer_t *buf;
+
+        buf = g_new0(pcapio_buffer_t, 1);
+        buf->mem = (guint8 *)g_malloc(size + PCAPIO_ALIGN);
+        buf->data = (guint8 *)(((gsize)buf->mem + PCAPIO_ALIGN - 1) &
+                               ~(gsize)(PCAPIO_ALIGN - 1));
+        return buf;
+}
+
+static void
+pcapio_buffer_free(pcapio_buffer_t *buf)
+{
+        g_free(buf->mem);
+        g_free(buf);
+}
+
+static int
+sync_file(int fd)
+{
+#if defined(HAVE_FDATASYNC)
+        return fdatasync(fd);
+#elif defined(_WIN32)
+        return _commit(fd);
+#else
+        return fsync(fd);
+#endif
+}
+
+/* Write all of some data, at the given offset in the file if it's being
+   written with pwrite(); returns 0 or an errno value */
+static int
+write_all(pcapio_file_t* pfile, const guint8* data, size_t data_length,
+          gint64 offset)
+{
+        gssize nwritten;
+
+        while (data_length != 0) {
+#ifdef PCAPIO_DIRECT_IO
+                if (pfile->direct_io)
+                        nwritten = pwrite(pfile->fd, data, data_length,
+                                          (off_t)offset);
+                else
+#endif
+                        nwritten = ws_write(pfile->fd, data,
+                                            (unsigned int)data_length);
+                if (nwritten < 0) {
+                        if (errno == EINTR)
+                                continue;
+                        return errno;
+                }
+                if (nwritten == 0) {
+                        /* Not getting anywhere; about the only reason
+                           for that is a full disk */
+                        return ENOSPC;
+                }
+                data += nwritten;
+                data_length -= nwritten;
+                offset += nwritten;
+        }
+        return 0;
+}
+
+/* Write out a buffer; done by the writer thread, if there is one */
+static void
+write_buffer(pcapio_file_t* pfile, pcapio_buffer_t *buf)
+{
+        size_t aligned;
+        int    err;
+#ifdef PCAPIO_DIRECT_IO
+        int    flags;
+#endif
+
+        if (pfile->write_err != 0) {
+                buf->err = pfile->write_err;
+                return;
+        }
+
+        aligned = buf->len;
+#ifdef PCAPIO_DIRECT_IO
+        if (pfile->direct_io)
+                aligned = buf->len & ~(size_t)(PCAPIO_ALIGN - 1);
+#endif
+        err = write_all(pfile, buf->data, aligned, buf->offset);
+#ifdef PCAPIO_DIRECT_IO
+        if (err == 0 && aligned < buf->len) {
+                /* The partial block at the end can't be written directly */
+                flags = fcntl(pfile->fd, F_GETFL);
+                if (flags == -1 || fcntl(pfile->fd, F_SETFL, flags & ~O_DIRECT) == -1) {
+                        err = errno;
+                } else {
+                        err = write_all(pfile, buf->data + aligned,
+                                        buf->len - aligned,
+                                        buf->offset + aligned);
+                        if (fcntl(pfile->fd, F_SETFL, flags) == -1 && err == 0)
+                                err = errno;
+                }
+        }
+#endif
+        if (err == 0 && pfile->sync_interval != 0) {
+                pfile->unsynced += buf->len;
+                if (pfile->unsynced >= pfile->sync_interval) {
+                        if (sync_file(pfile->fd) == -1)
+                                err = errno;
+                        pfile->unsynced = 0;
+                }
+        }
+
+        pfile->write_err = err;
+        buf->err = err;
+}
+
+/* Sync and close the file, once everything's been written to it; done by
+   the writer thread, if there is one */
+static void
+close_file(pcapio_file_t* pfile)
+{
+        if (pfile->closing_cb != NULL)
+                pfile->closing_cb(pfile->fd, pfile->closing_data);
+
+        /* whatever's left since the last sync */
+        if (pfile->write_err == 0 && pfile->unsynced != 0 &&
+            sync_file(pfile->fd) == -1)
+                pfile->close_err = errno;
+        if (ws_close(pfile->fd) == -1 && pfile->close_err == 0)
+                pfile->close_err = errno;
+}
+
+static gpointer
+writer_thread(gpointer data)
+{
+        pcapio_file_t* pfile = (pcapio_file_t*)data;
+        pcapio_buffer_t *buf;
+
+        for (;;) {
+                buf = (pcapio_buffer_t *)g_async_queue_pop(pfile->todo);
+                if (buf == &pcapio_quit)
+                        break;
+                if (buf == &pcapio_close_file) {
+                        close_file(pfile);
+                        break;
+                }
+                write_buffer(pfile, buf);
+                g_async_queue_push(pfile->done, buf);
+        }
+        return NULL;
+}
+
+/* A buffer's back from the writer thread */
+static void
+buffer_returned(pcapio_file_t* pfile, pcapio_buffer_t *buf)
+{
+        if (buf->err != 0 && pfile->err == 0)
+                pfile->err = buf->err;
+        pfile->free_bufs[pfile->num_free++] = buf;
+}
+
+/* Wait for the writer thread to have written out everything it's got */
+static void
+wait_for_writer(pcapio_file_t* pfile)
+{
+        while (pfile->num_free < PCAPIO_NUM_BUFFERS - 1)
+                buffer_returned(pfile,
+                                (pcapio_buffer_t *)g_async_queue_pop(pfile->done));
+}
+
+/* Write out the buffer being filled, or hand it over to be written out,
+   and start filling another */
+static void
+hand_over(pcapio_file_t* pfile)
+{
+        pcapio_buffer_t *buf = pfile->cur;
+        pcapio_buffer_t *next;
+        size_t           keep;
+
+        /* With direct I/O, the next buffer starts with the partial block,
+           if any, at the end of this one */
+        keep = pfile->direct_io ? buf->len % PCAPIO_ALIGN : 0;
+
+        if (pfile->thread != NULL) {
+                if (pfile->num_free == 0)
+                        buffer_returned(pfile,
+                                        (pcapio_buffer_t *)g_async_queue_pop(pfile->done));
+                next = pfile->free_bufs[--pfile->num_free];
+                memcpy(next->data, buf->data + buf->len - keep, keep);
+                next->offset = buf->offset + buf->len - keep;
+                next->len = keep;
+                g_async_queue_push(pfile->todo, buf);
+        } else {
+                write_buffer(pfile, buf);
+                if (buf->err != 0 && pfile->err == 0)
+                        pfile->err = buf->err;
+                next = buf;
+                memmove(next->data, buf->data + buf->len - keep, keep);
+                next->offset = buf->offset + buf->len - keep;
+                next->len = keep;
+        }
+        pfile->cur = next;
+        pfile->unflushed = FALSE;
+}
+
+#ifdef PCAPIO_DIRECT_IO
+/* Set O_DIRECT on a file, if it's a file, and we're at an aligned offset
+   in it, and it can be set */
+static gboolean
+set_direct_io(int fd, gint64 *offset)
+{
+        int flags;
+
+        *offset = ws_lseek64(fd, 0, SEEK_CUR);
+        if (*offset == -1) {
+                /* a pipe, say */
+                *offset = 0;
+                return FALSE;
+        }
+        if (*offset % PCAPIO_ALIGN != 0)
+                return FALSE;
+        flags = fcntl(fd, F_GETFL);
+        if (flags == -1 || fcntl(fd, F_SETFL, flags | O_DIRECT) == -1)
+                return FALSE;
+        return TRUE;
+}
+#endif
+
+/* Start a writer thread for a file; if that can't be done, the caller
+   does the writes */
+static void
+start_writer_thread(pcapio_file_t* pfile)
+{
+#if !GLIB_CHECK_VERSION(2,31,0)
+        if (!g_thread_supported())
+                return;
+#endif
+        pfile->todo = g_async_queue_new();
+        pfile->done = g_async_queue_new();
+#if GLIB_CHECK_VERSION(2,31,0)
+        pfile->thread = g_thread_new("Write", writer_thread, pfile);
+#else
+        pfile->thread = g_thread_create(writer_thread, pfile, TRUE, NULL);
+#endif
+        if (pfile->thread == NULL) {
+                g_async_queue_unref(pfile->todo);
+                g_async_queue_unref(pfile->done);
+                pfile->todo = pfile->done = NULL;
+                return;
+        }
+        pfile->buf_size = PCAPIO_BUFFER_SIZE;
+        while (pfile->num_free < PCAPIO_NUM_BUFFERS - 1)
+                pfile->free_bufs[pfile->num_free++] =
+                        pcapio_buffer_new(pfile->buf_size);
+}
+
+pcapio_file_t *
+pcapio_fdopen(int fd, const pcapio_write_options_t *opts)
+{
+        pcapio_file_t* pfile;
+        gint64 offset = 0;
+
+        pfile = g_new0(pcapio_file_t, 1);
+        pfile->fd = fd;
+        pfile->buf_size = PCAPIO_UNTHREADED_BUFFER_SIZE;
+        if (opts != NULL) {
+                pfile->sync_interval = opts->sync_interval;
+#ifdef PCAPIO_DIRECT_IO
+                if (opts->direct_io)
+                        pfile->direct_io = set_direct_io(fd, &offset);
+#endif
+                if (opts->threaded)
+                        start_writer_thread(pfile);
+        }
+        pfile->cur = pcapio_buffer_new(pfile->buf_size);
+        pfile->cur->offset = offset;
+        return pfile;
+}
+
+gboolean
+pcapio_flush(pcapio_file_t* pfile, int *err)
+{
+        if (pfile->unflushed)
+                hand_over(pfile);
+        if (pfile->thread != NULL)
+                wait_for_writer(pfile);
+        if (pfile->err != 0) {
+                if (err != NULL)
+                        *err = pfile->err;
+                return FALSE;
+        }
+        return TRUE;
+}
+
+void
+pcapio_close_start(pcapio_file_t* pfile, pcapio_closing_cb cb, gpointer user_data)
+{
+        pfile->closing_cb = cb;
+        pfile->closing_data = user_data;
+
+        if (pfile->thread != NULL) {
+                /* The last buffer needn't be followed by another one */
+                if (pfile->unflushed) {
+                        g_async_queue_push(pfile->todo, pfile->cur);
+                        pfile->cur = NULL;
+                        pfile->unflushed = FALSE;
+                }
+                g_async_queue_push(pfile->todo, &pcapio_close_file);
+        } else {
+                if (pfile->unflushed)
+                        hand_over(pfile);
+                close_file(pfile);
+        }
+}
+
+gboolean
+pcapio_close_finish(pcapio_file_t* pfile, int *err)
+{
+        pcapio_buffer_t *buf;
+        guint i;
+        int file_err;
+
+        if (pfile->thread != NULL) {
+                g_thread_join(pfile->thread);
+                while ((buf = (pcapio_buffer_t *)g_async_queue_try_pop(pfile->done)) != NULL)
+                        buffer_returned(pfile, buf);
+                g_async_queue_unref(pfile->todo);
+                g_async_queue_unref(pfile->done);
+                for (i = 0; i < pfile->num_free; i++)
+                        pcapio_buffer_free(pfile->free_bufs[i]);
+        }
+        if (pfile->cur != NULL)
+                pcapio_buffer_free(pfile->cur);
+
+        file_err = pfile->err != 0 ? pfile->err : pfile->close_err;
+        g_free(pfile);
+        if (file_err != 0) {
+                if (err != NULL)
+                        *err = file_err;
+                return FALSE;
+        }
+        return TRUE;
+}
+
+gboolean
+pcapio_close(pcapio_file_t* pfile, int *err)
+{
+        pcapio_close_start(pfile, NULL, NULL);
+        return pcapio_close_finish(pfile, err);
+}
+
 /* Write to capture file */
 static gboolean
-write_to_file(FILE* pfile, const guint8* data, size_t data_length,
+write_to_file(pcapio_file_t* pfile, const guint8* data, size_t data_length,
               guint64 *bytes_written, int *err)
 {
-        size_t nwritten;
-
-        nwritten = fwrite(data, data_length, 1, pfile);
-        if (nwritten != 1) {
-                if (ferror(pfile)) {
-                        *err = errno;
-                } else {
-                        *err = 0;
+        pcapio_buffer_t *buf;
+        size_t remaining, n;
+
+        remaining = data_length;
+        while (pfile->err == 0 && remaining != 0) {
+                buf = pfile->cur;
+                if (buf->len == pfile->buf_size) {
+                        hand_over(pfile);
+                        buf = pfile->cur;
                 }
+                n = MIN(remaining, pfile->buf_size - buf->len);
+                memcpy(buf->data + buf->len, data, n);
+                buf->len += n;
+                data += n;
+                remaining -= n;
+                pfile->unflushed = TRUE;
+        }
+        if (pfile->err != 0) {
+                *err = pfile->err;
                 return FALSE;
         }
 
@@ -203,9 +639,9 @@ write_to_file(FILE* pfile, const guint8* data, size_t data_length,
 
 /* Write the file header to a dump file.
    Returns TRUE on success, FALSE on failure.
-   Sets "*err" to an error code, or 0 for a short write, on failure*/
+   Sets "*err" to an error code on failure*/
 gboolean
-libpcap_write_file_header(FILE* pfile, int linktype, int snaplen, gboolean ts_nsecs, guint64 *bytes_written, int *err)
+libpcap_write_file_header(pcapio_file_t* pfile, int linktype, int snaplen, gboolean ts_nsecs, guint64 *bytes_written, int *err)
 {
         struct pcap_hdr file_hdr;
 
@@ -224,7 +660,7 @@ libpcap_write_file_header(FILE* pfile, int linktype, int snaplen, gboolean ts_ns
 /* Write a record for a packet to a dump file.
    Returns TRUE on success, FALSE on failure. */
 gboolean
-libpcap_write_packet(FILE* pfile,
+libpcap_write_packet(pcapio_file_t* pfile,
                      time_t sec, guint32 usec,
                      guint32 caplen, guint32 len,
                      const guint8 *pd,
@@ -256,7 +692,7 @@ pcapng_count_string_option(const char *option_value)
 }
 
 static gboolean
-pcapng_write_string_option(FILE* pfile,
+pcapng_write_string_option(pcapio_file_t* pfile,
                            guint16 option_type, const char *option_value,
                            guint64 *bytes_written, int *err)
 {
@@ -287,7 +723,7 @@ pcapng_write_string_option(FILE* pfile,
 }
 
 gboolean
-pcapng_write_session_header_block(FILE* pfile,
+pcapng_write_session_header_block(pcapio_file_t* pfile,
                                   const char *comment,
                                   const char *hw,
                                   const char *os,
@@ -351,7 +787,7 @@ pcapng_write_session_header_block(FILE* pfile,
 }
 
 gboolean
-pcapng_write_interface_description_block(FILE* pfile,
+pcapng_write_interface_description_block(pcapio_file_t* pfile,
                                          const char *comment, /* OPT_COMMENT        1 */
                                          const char *name,    /* IDB_NAME           2 */
                                          const char *descr,   /* IDB_DESCRIPTION    3 */
@@ -501,7 +937,7 @@ pcapng_write_interface_description_block(FILE* pfile,
 /* Write a record for a packet to a dump file.
    Returns TRUE on success, FALSE on failure. */
 gboolean
-pcapng_write_enhanced_packet_block(FILE* pfile,
+pcapng_write_enhanced_packet_block(pcapio_file_t* pfile,
                                    const char *comment,
                                    time_t sec, guint32 usec,
                                    guint32 caplen, guint32 len,
@@ -572,7 +1008,7 @@ pcapng_write_enhanced_packet_block(FILE* pfile,
 }
 
 gboolean
-pcapng_write_interface_statistics_block(FILE* pfile,
+pcapng_write_interface_statistics_block(pcapio_file_t* pfile,
                                         guint32 interface_id,
                                         guint64 *bytes_written,
                                         const char *comment,   /* OPT_COMMENT           1 */
@@ -25,19 +25,78 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#ifndef __PCAPIO_H__
+#define __PCAPIO_H__
+
+/* Files being written */
+
+/** A file being written. What's written to it is assembled in big
+    buffers, which are written out when they fill up, or when the file is
+    flushed or closed; optionally, that's done by a thread of the file's
+    own, so that the caller can go on filling another buffer meanwhile. */
+typedef struct pcapio_file pcapio_file_t;
+
+/** How a file is written */
+typedef struct {
+        gboolean threaded;      /**< write the buffers out from a thread */
+        gboolean direct_io;     /**< bypass the page cache (O_DIRECT), where
+                                     the OS and the file allow it */
+        guint64  sync_interval; /**< fdatasync() after every this many bytes;
+                                     0 to leave it to the OS */
+} pcapio_write_options_t;
+
+/** Start writing to a file descriptor; it's closed by pcapio_close().
+    "opts" can be NULL, for the caller doing the writes itself, without
+    direct I/O or syncs. */
+extern pcapio_file_t *
+pcapio_fdopen(int fd, const pcapio_write_options_t *opts);
+
+/** Write out everything written to a file so far, and wait for that to
+   have been done.
+   Returns TRUE on success, FALSE on failure.
+   Sets "*err", if "err" isn't NULL, to an error code on failure; errors
+   from writing earlier buffers out are reported by this, or by the next
+   write, as the writes themselves may have been done later. */
+extern gboolean
+pcapio_flush(pcapio_file_t* pfile, int *err);
+
+/** Flush a file, and close it and its file descriptor.
+   Returns TRUE on success, FALSE on failure.
+   Sets "*err", if "err" isn't NULL, to an error code on failure. */
+extern gboolean
+pcapio_close(pcapio_file_t* pfile, int *err);
+
+/** Called with a file's descriptor once everything's been written to it,
+    before it's synced and closed; on the file's writer thread, if it has
+    one. */
+typedef void (*pcapio_closing_cb)(int fd, gpointer user_data);
+
+/** Start closing a file: what's been written to it is written out, and
+   it's synced and closed, by its writer thread, if it has one, without
+   waiting for that; "cb", if it isn't NULL, is called first.  Nothing
+   more can be written to the file. */
+extern void
+pcapio_close_start(pcapio_file_t* pfile, pcapio_closing_cb cb, gpointer user_data);
+
+/** Wait for a file that's being closed to have been closed, and free it.
+   Returns TRUE on success, FALSE on failure.
+   Sets "*err", if "err" isn't NULL, to an error code on failure. */
+extern gboolean
+pcapio_close_finish(pcapio_file_t* pfile, int *err);
+
 /* Writing pcap files */
 
 /** Write the file header to a dump file.
    Returns TRUE on success, FALSE on failure.
-   Sets "*err" to an error code, or 0 for a short write, on failure*/
+   Sets "*err" to an error code on failure*/
 extern gboolean
-libpcap_write_file_header(FILE* pfile, int linktype, int snaplen, 
+libpcap_write_file_header(pcapio_file_t* pfile, int linktype, int snaplen, 
                           gboolean ts_nsecs, guint64 *bytes_written, int *err);
 
 /** Write a record for a packet to a dump file.
    Returns TRUE on success, FALSE on failure. */
 extern gboolean
-libpcap_write_packet(FILE* pfile, 
+libpcap_write_packet(pcapio_file_t* pfile, 
                      time_t sec, guint32 usec,
                      guint32 caplen, guint32 len,
                      const guint8 *pd,
@@ -49,7 +108,7 @@ libpcap_write_packet(FILE* pfile,
  *
  */
 extern gboolean
-pcapng_write_session_header_block(FILE* pfile,  /**< Write information */
+pcapng_write_session_header_block(pcapio_file_t* pfile,  /**< Write information */
                                   const char *comment,  /**< Comment on the section, Optinon 1 opt_comment
                                                          * A UTF-8 string containing a comment that is associated to the current block.
                                                          */
@@ -67,7 +126,7 @@ pcapng_write_session_header_block(FILE* pfile,  /**< Write information */
                                   int *err); /**< Error type */
 
 extern gboolean
-pcapng_write_interface_description_block(FILE* pfile,
+pcapng_write_interface_description_block(pcapio_file_t* pfile,
                                          const char *comment,  /* OPT_COMMENT           1 */
                                          const char *name,     /* IDB_NAME              2 */
                                          const char *descr,    /* IDB_DESCRIPTION       3 */
@@ -81,7 +140,7 @@ pcapng_write_interface_description_block(FILE* pfile,
                                          int *err);
 
 extern gboolean
-pcapng_write_interface_statistics_block(FILE* pfile,
+pcapng_write_interface_statistics_block(pcapio_file_t* pfile,
                                         guint32 interface_id,
                                         guint64 *bytes_written,
                                         const char *comment,   /* OPT_COMMENT           1 */
@@ -92,7 +151,7 @@ pcapng_write_interface_statistics_block(FILE* pfile,
                                         int *err);
 
 extern gboolean
-pcapng_write_enhanced_packet_block(FILE* pfile,
+pcapng_write_enhanced_packet_block(pcapio_file_t* pfile,
                                    const char *comment,
                                    time_t sec, guint32 usec,
                                    guint32 caplen, guint32 len,
@@ -102,3 +161,5 @@ pcapng_write_enhanced_packet_block(FILE* pfile,
                                    guint32 flags,
                                    guint64 *bytes_written,
                                    int *err);
+
+#endif /* __PCAPIO_H__ */
@@ -44,6 +44,10 @@
 
 #include "config.h"
 
+#ifdef HAVE_FALLOCATE
+#define _GNU_SOURCE /* Otherwise fallocate() won't be declared on Linux */
+#endif
+
 #ifdef HAVE_LIBPCAP
 
 #ifdef HAVE_FCNTL_H
@@ -54,6 +58,10 @@
 #include <unistd.h>
 #endif
 
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
 #include <stdio.h>
 #include <string.h>
 #include <time.h>
@@ -66,6 +74,10 @@
 #include "ringbuffer.h"
 #include <wsutil/file_util.h>
 
+#if defined(HAVE_FALLOCATE) && defined(FALLOC_FL_KEEP_SIZE)
+#define RINGBUF_PREALLOCATE
+#endif
+
 
 /* Ringbuffer file structure */
 typedef struct _rb_file {
@@ -82,8 +94,15 @@ typedef struct _ringbuf_data {
   gboolean      unlimited;           /* TRUE if unlimited number of files */
 
   int           fd;		     /* Current ringbuffer file descriptor */
-  FILE         *pdh;
+  pcapio_file_t *pdh;
+  pcapio_file_t *closing;            /* The previous file, while it's being closed */
+#ifdef RINGBUF_PREALLOCATE
+  gchar        *spare_name;          /* The next file, made ahead of time, */
+  int           spare_fd;            /* with its space reserved, or -1 */
+#endif
+  pcapio_write_options_t write_opts; /* How the files are written */
   gboolean      group_read_access;   /* TRUE if files need to be opened with group read access */
+  guint64       file_size;           /* How big the files are expected to get (0 if unknown) */
 } ringbuf_data;
 
 static ringbuf_data rb_data;
@@ -122,6 +141,20 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
     return -1;
   }
 
+#ifdef RINGBUF_PREALLOCATE
+  /* If the file's been made ahead of time, it just needs its name */
+  if (rb_data.spare_fd != -1) {
+    if (ws_rename(rb_data.spare_name, rfile->name) == 0) {
+      rb_data.fd = rb_data.spare_fd;
+      rb_data.spare_fd = -1;
+      return rb_data.fd;
+    }
+    ws_close(rb_data.spare_fd);
+    ws_unlink(rb_data.spare_name);
+    rb_data.spare_fd = -1;
+  }
+#endif
+
   rb_data.fd = ws_open(rfile->name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT, 
                             rb_data.group_read_access ? 0640 : 0600);
 
@@ -129,14 +162,98 @@ static int ringbuf_open_file(rb_file *rfile, int *err)
     *err = errno;
   }
 
+#ifdef RINGBUF_PREALLOCATE
+  /* Reserve the disk space the file will need now, rather than having it
+     allocated bit by bit while capturing; it's kept past the end of the
+     file, so the file only grows as it's written.  It's only a hint, so
+     it doesn't matter if it can't be done. */
+  if (rb_data.fd != -1 && rb_data.file_size != 0) {
+    fallocate(rb_data.fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)rb_data.file_size);
+  }
+#endif
+
   return rb_data.fd;
 }
 
+#ifdef RINGBUF_PREALLOCATE
+/*
+ * Make the file after the current one, with its disk space reserved,
+ * so that switching to it only has to rename it
+ */
+static void ringbuf_make_spare(void)
+{
+  rb_data.spare_fd = ws_open(rb_data.spare_name, O_RDWR|O_BINARY|O_TRUNC|O_CREAT,
+                             rb_data.group_read_access ? 0640 : 0600);
+  if (rb_data.spare_fd != -1) {
+    fallocate(rb_data.spare_fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)rb_data.file_size);
+  }
+}
+
+/*
+ * Remove the file made ahead of time, if it wasn't used
+ */
+static void ringbuf_remove_spare(void)
+{
+  if (rb_data.spare_fd != -1) {
+    ws_close(rb_data.spare_fd);
+    ws_unlink(rb_data.spare_name);
+    rb_data.spare_fd = -1;
+  }
+}
+#endif
+
+/*
+ * Give back the disk space reserved past the end of a file that's being
+ * closed; called once everything's been written to it
+ */
+static void ringbuf_release_space(int fd _U_, gpointer user_data _U_)
+{
+#ifdef RINGBUF_PREALLOCATE
+  ws_statb64 statb;
+
+  /* It stays reserved until the file is truncated */
+  if (rb_data.file_size != 0 && ws_fstat64(fd, &statb) == 0 &&
+      ftruncate(fd, statb.st_size) == -1) {
+    /* Nothing to do about it; it's only disk space */
+  }
+#endif
+}
+
+/*
+ * Called on the writer thread of the file that's been switched from, as
+ * it's closed; that's also when the file after the one switched to is
+ * made, while that one's being written
+ */
+static void ringbuf_switched_from(int fd, gpointer user_data)
+{
+  ringbuf_release_space(fd, user_data);
+#ifdef RINGBUF_PREALLOCATE
+  if (rb_data.file_size != 0) {
+    ringbuf_make_spare();
+  }
+#endif
+}
+
+/*
+ * Wait for the file that's been switched from to have been closed
+ */
+static gboolean ringbuf_finish_closing(int *err)
+{
+  gboolean ret_val = TRUE;
+
+  if (rb_data.closing != NULL) {
+    ret_val = pcapio_close_finish(rb_data.closing, err);
+    rb_data.closing = NULL;
+  }
+  return ret_val;
+}
+
 /*
  * Initialize the ringbuffer data structures
  */
 int
-ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access)
+ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_access,
+             guint64 file_size)
 {
   unsigned int i;
   char        *pfx, *last_pathsep;
@@ -149,7 +266,13 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
   rb_data.unlimited = FALSE;
   rb_data.fd = -1;
   rb_data.pdh = NULL;
+  rb_data.closing = NULL;
+#ifdef RINGBUF_PREALLOCATE
+  rb_data.spare_name = NULL;
+  rb_data.spare_fd = -1;
+#endif
   rb_data.group_read_access = group_read_access;
+  rb_data.file_size = file_size;
 
   /* just to be sure ... */
   if (num_files <= RINGBUFFER_MAX_NUM_FILES) {
@@ -216,6 +339,16 @@ ringbuf_init(const char *capfile_name, guint num_files, gboolean group_read_acce
     return -1;
   }
 
+#ifdef RINGBUF_PREALLOCATE
+  /* and the second, if their space is to be reserved; after that, each
+     one's made while the one before it is being written */
+  if (rb_data.file_size != 0) {
+    rb_data.spare_name = g_strconcat(rb_data.fprefix, "_next",
+                                     rb_data.fsuffix, NULL);
+    ringbuf_make_spare();
+  }
+#endif
+
   return rb_data.fd;
 }
 
@@ -226,46 +359,39 @@ const gchar *ringbuf_current_filename(void)
 }
 
 /*
- * Calls ws_fdopen() for the current ringbuffer file
+ * Calls pcapio_fdopen() for the current ringbuffer file; the following
+ * files are written the same way
  */
-FILE *
-ringbuf_init_libpcap_fdopen(int *err)
+pcapio_file_t *
+ringbuf_init_libpcap_fdopen(const pcapio_write_options_t *opts)
 {
-  rb_data.pdh = ws_fdopen(rb_data.fd, "wb");
-  if (rb_data.pdh == NULL) {
-    if (err != NULL) {
-      *err = errno;
-    }
-  }
+  rb_data.write_opts = *opts;
+  rb_data.pdh = pcapio_fdopen(rb_data.fd, &rb_data.write_opts);
   return rb_data.pdh;
 }
 
 /*
  * Switches to the next ringbuffer file
+ *
+ * The current file is closed by its writer thread, while the next one is
+ * being written; any error in closing it is reported by the next switch,
+ * or by ringbuf_libpcap_dump_close().
  */
 gboolean
-ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
+ringbuf_switch_file(pcapio_file_t **pdh, gchar **save_file, int *save_file_fd, int *err)
 {
   int     next_file_index;
   rb_file *next_rfile = NULL;
+  pcapio_file_t *prev_pdh;
 
-  /* close current file */
-
-  if (fclose(rb_data.pdh) == EOF) {
-    if (err != NULL) {
-      *err = errno;
-    }
-    ws_close(rb_data.fd);	/* XXX - the above should have closed this already */
-    rb_data.pdh = NULL;	/* it's still closed, we just got an error while closing */
-    rb_data.fd = -1;
+  /* the previous file's been closed while the current one was written */
+  if (!ringbuf_finish_closing(err)) {
     return FALSE;
   }
 
-  rb_data.pdh = NULL;
-  rb_data.fd  = -1;
-
   /* get the next file number and open it */
 
+  prev_pdh = rb_data.pdh;
   rb_data.curr_file_num++ /* = next_file_num*/;
   next_file_index = (rb_data.curr_file_num) % rb_data.num_files;
   next_rfile = &rb_data.files[next_file_index];
@@ -274,9 +400,11 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
     return FALSE;
   }
 
-  if (ringbuf_init_libpcap_fdopen(err) == NULL) {
-    return FALSE;
-  }
+  rb_data.pdh = pcapio_fdopen(rb_data.fd, &rb_data.write_opts);
+
+  /* close the current file, in the background */
+  pcapio_close_start(prev_pdh, ringbuf_switched_from, NULL);
+  rb_data.closing = prev_pdh;
 
   /* switch to the new file */
   *save_file = next_rfile->name;
@@ -287,26 +415,29 @@ ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd, int *err)
 }
 
 /*
- * Calls fclose() for the current ringbuffer file
+ * Calls pcapio_close() for the current ringbuffer file
  */
 gboolean
 ringbuf_libpcap_dump_close(gchar **save_file, int *err)
 {
-  gboolean  ret_val = TRUE;
+  gboolean  ret_val;
+
+  ret_val = ringbuf_finish_closing(err);
 
   /* close current file, if it's open */
   if (rb_data.pdh != NULL) {
-    if (fclose(rb_data.pdh) == EOF) {
-      if (err != NULL) {
-        *err = errno;
-      }
-      ws_close(rb_data.fd);
+    pcapio_close_start(rb_data.pdh, ringbuf_release_space, NULL);
+    if (!pcapio_close_finish(rb_data.pdh, ret_val ? err : NULL)) {
       ret_val = FALSE;
     }
     rb_data.pdh = NULL;
     rb_data.fd  = -1;
   }
 
+#ifdef RINGBUF_PREALLOCATE
+  ringbuf_remove_spare();
+#endif
+
   /* set the save file name to the current file */
   *save_file = rb_data.files[rb_data.curr_file_num % rb_data.num_files].name;
   return ret_val;
@@ -338,6 +469,12 @@ ringbuf_free(void)
     g_free(rb_data.fsuffix);
     rb_data.fsuffix = NULL;
   }
+#ifdef RINGBUF_PREALLOCATE
+  if (rb_data.spare_name != NULL) {
+    g_free(rb_data.spare_name);
+    rb_data.spare_name = NULL;
+  }
+#endif
 }
 
 /*
@@ -348,11 +485,12 @@ ringbuf_error_cleanup(void)
 {
   unsigned int i;
 
-  /* try to close via wtap */
+  ringbuf_finish_closing(NULL);
+
+  /* try to close via pcapio, which closes the file descriptor, too */
   if (rb_data.pdh != NULL) {
-    if (fclose(rb_data.pdh) == 0) {
-      rb_data.fd = -1;
-    }
+    pcapio_close(rb_data.pdh, NULL);
+    rb_data.fd = -1;
     rb_data.pdh = NULL;
   }
 
@@ -362,6 +500,10 @@ ringbuf_error_cleanup(void)
     rb_data.fd = -1;
   }
 
+#ifdef RINGBUF_PREALLOCATE
+  ringbuf_remove_spare();
+#endif
+
   if (rb_data.files != NULL) {
     for (i=0; i < rb_data.num_files; i++) {
       if (rb_data.files[i].name != NULL) {
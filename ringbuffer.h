@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include "file.h"
 #include "wiretap/wtap.h"
+#include "pcapio.h"
 
 #define RINGBUFFER_UNLIMITED_FILES 0
 /* Minimum number of ringbuffer files */
@@ -38,10 +39,11 @@
 /* Maximum number for FAT filesystems */
 #define RINGBUFFER_WARN_NUM_FILES 65535
 
-int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access);
+int ringbuf_init(const char *capture_name, guint num_files, gboolean group_read_access,
+                 guint64 file_size);
 const gchar *ringbuf_current_filename(void);
-FILE *ringbuf_init_libpcap_fdopen(int *err);
-gboolean ringbuf_switch_file(FILE **pdh, gchar **save_file, int *save_file_fd,
+pcapio_file_t *ringbuf_init_libpcap_fdopen(const pcapio_write_options_t *opts);
+gboolean ringbuf_switch_file(pcapio_file_t **pdh, gchar **save_file, int *save_file_fd,
                              int *err);
 gboolean ringbuf_libpcap_dump_close(gchar **save_file, int *err);
 void ringbuf_free(void);
@@ -69,6 +69,12 @@ unittests_step_exntest() {
 	unittests_step_test
 }
 
+unittests_step_heur_test() {
+	DUT=$SOURCE_DIR/epan/heur_test
+	ARGS=
+	unittests_step_test
+}
+
 unittests_step_lua_dissector_test() {
 	if [ $HAVE_LUA -ne 0 ]; then
 		test_step_skipped
@@ -201,6 +207,7 @@ unittests_suite() {
 	test_step_set_pre unittests_cleanup_step
 	test_step_set_post unittests_cleanup_step
 	test_step_add "exntest" unittests_step_exntest
+	test_step_add "heur_test" unittests_step_heur_test
 	test_step_add "lua dissector" unittests_step_lua_dissector_test
 	test_step_add "lua int64" unittests_step_lua_int64_test
 	test_step_add "lua script arguments" unittests_step_lua_args_test
@@ -122,6 +122,10 @@
 # include <unistd.h>
 #endif
 
+#ifdef HAVE_FCNTL_H
+# include <fcntl.h>
+#endif
+
 #include <errno.h>
 #include <assert.h>
 
@@ -252,7 +256,7 @@ static const char *input_filename;
 static FILE       *input_file  = NULL;
 /* Output file */
 static const char *output_filename;
-static FILE       *output_file = NULL;
+static pcapio_file_t *output_file = NULL;
 
 /* Offset base to parse */
 static guint32 offset_base = 16;
@@ -1748,16 +1752,19 @@ parse_options (int argc, char *argv[])
     }
 
     if (strcmp(argv[optind+1], "-")) {
+        int output_fd;
+
         output_filename = g_strdup(argv[optind+1]);
-        output_file = ws_fopen(output_filename, "wb");
-        if (!output_file) {
+        output_fd = ws_open(output_filename, O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0644);
+        if (output_fd == -1) {
             fprintf(stderr, "Cannot open file [%s] for writing: %s\n",
                     output_filename, g_strerror(errno));
             exit(1);
         }
+        output_file = pcapio_fdopen(output_fd, NULL);
     } else {
         output_filename = "Standard output";
-        output_file = stdout;
+        output_file = pcapio_fdopen(1, NULL);
     }
 
     /* Some validation */
@@ -1772,7 +1779,7 @@ parse_options (int argc, char *argv[])
         input_filename = "Standard input";
     }
     if (!output_file) {
-        output_file = stdout;
+        output_file = pcapio_fdopen(1, NULL);
         output_filename = "Standard output";
     }
 
@@ -1804,6 +1811,8 @@ parse_options (int argc, char *argv[])
 int
 main(int argc, char *argv[])
 {
+    int err;
+
     parse_options(argc, argv);
 
     assert(input_file  != NULL);
@@ -1842,7 +1851,11 @@ main(int argc, char *argv[])
     write_current_packet(FALSE);
     write_file_trailer();
     fclose(input_file);
-    fclose(output_file);
+    if (!pcapio_close(output_file, &err)) {
+        fprintf(stderr, "File write error [%s] : %s\n",
+                output_filename, g_strerror(err));
+        exit(1);
+    }
     if (debug)
         fprintf(stderr, "\n-------------------------\n");
     if (!quiet) {
@@ -0,0 +1,273 @@
+# $Id$
+#
+# This program is free software; you can redistribute it and/or
+# modify it under the terms of the GNU General Public License
+# as published by the Free Software Foundation; either version 2
+# of the License, or (at your option) any later version.
+# 
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+# 
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+
+
+# The filters are run from the instruction array laid out by dfvm_link();
+# a field compared with a constant of up to 32 bits is done with the
+# ANY_*_U32 instructions, and a field that occurs more than once in a
+# packet is loaded into a register holding all of its values.
+
+from dftestlib import dftest
+
+class testDFVMRegisters(dftest.DFTest):
+    trace_file = "nfs.pcap"
+
+    # ip.addr is both the source and destination, in both packets
+    def test_any_eq_1(self):
+        dfilter = "ip.addr == 172.25.100.14"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_any_ne_1(self):
+        dfilter = "ip.addr != 172.25.100.14"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_any_gt_1(self):
+        dfilter = "ip.addr > 198.95.230.20"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_any_ge_1(self):
+        dfilter = "ip.addr >= 198.95.230.20"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_any_lt_1(self):
+        dfilter = "ip.addr < 172.25.100.14"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_any_le_1(self):
+        dfilter = "ip.addr <= 172.25.100.14"
+        self.assertDFilterCount(dfilter, 2)
+
+    # The call has a GID of 1, and auxiliary GIDs 1, 0, 2 to 9, and 12
+    def test_many_eq_1(self):
+        dfilter = "rpc.auth.gid == 12"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_many_eq_2(self):
+        dfilter = "rpc.auth.gid == 10"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_many_gt_1(self):
+        dfilter = "rpc.auth.gid > 11"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_many_gt_2(self):
+        dfilter = "rpc.auth.gid > 12"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_many_lt_1(self):
+        dfilter = "rpc.auth.gid < 1"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_many_ne_1(self):
+        dfilter = "rpc.auth.gid != 1"
+        self.assertDFilterCount(dfilter, 1)
+
+    # Two fields, neither a constant
+    def test_fields_eq_1(self):
+        dfilter = "rpc.auth.gid == rpc.auth.uid"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_fields_eq_2(self):
+        dfilter = "ip.src == ip.dst"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_fields_eq_3(self):
+        dfilter = "ip.addr == ip.src"
+        self.assertDFilterCount(dfilter, 2)
+
+    # The same register used by more than one test, and the jumps
+    def test_and_1(self):
+        dfilter = "ip.src == 172.25.100.14 and ip.dst == 198.95.230.20"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_and_2(self):
+        dfilter = "ip.src == 172.25.100.14 and ip.src == 198.95.230.20"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_or_1(self):
+        dfilter = "ip.src == 172.25.100.14 or ip.src == 198.95.230.20"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_not_1(self):
+        dfilter = "not ip.src == 172.25.100.14"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_not_2(self):
+        dfilter = "not ip.addr == 172.25.100.14"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_nested_1(self):
+        dfilter = "(ip.src == 172.25.100.14 and udp) or " \
+                "(ip.dst == 172.25.100.14 and udp.srcport == 2049)"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_nested_2(self):
+        dfilter = "(ip.src == 172.25.100.14 or udp.dstport == 2049) and " \
+                "not (rpc.auth.gid == 12)"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_range_1(self):
+        dfilter = "ip.src[0:2] == ac:19"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_range_2(self):
+        dfilter = "ip.addr[0] == c6"
+        self.assertDFilterCount(dfilter, 2)
+
+    # FT_FRAMENUM
+    def test_framenum_eq_1(self):
+        dfilter = "rpc.reqframe == 1"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_framenum_gt_1(self):
+        dfilter = "rpc.reqframe > 1"
+        self.assertDFilterCount(dfilter, 0)
+
+
+class testDFVMIPv4(dftest.DFTest):
+    trace_file = "nfs.pcap"
+
+    # Addresses with the top bit set are compared without a sign
+    def test_unsigned_gt_1(self):
+        dfilter = "ip.src > 127.255.255.255"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_unsigned_lt_1(self):
+        dfilter = "ip.src < 128.0.0.0"
+        self.assertDFilterCount(dfilter, 0)
+
+    # Only the bits in the constant's netmask count
+    def test_netmask_eq_1(self):
+        dfilter = "ip.src == 198.95.230.255/24"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_netmask_ne_1(self):
+        dfilter = "ip.dst != 172.25.100.0/24"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_netmask_gt_1(self):
+        dfilter = "ip.src > 172.25.255.255/16"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_netmask_ge_1(self):
+        dfilter = "ip.src >= 172.25.255.255/16"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_netmask_lt_1(self):
+        dfilter = "ip.src < 198.95.0.1/16"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_netmask_le_1(self):
+        dfilter = "ip.src <= 198.95.0.1/16"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_netmask_any_1(self):
+        dfilter = "ip.addr == 198.95.0.0/16"
+        self.assertDFilterCount(dfilter, 2)
+
+    def test_netmask_zero_1(self):
+        dfilter = "ip.src == 10.0.0.0/0"
+        self.assertDFilterCount(dfilter, 2)
+
+
+class testDFVMSigned(dftest.DFTest):
+    trace_file = "ntp.pcap"
+
+    # ntp.precision is an FT_INT8 of -11; the sign bit is flipped for the
+    # comparison, so that negative values are below positive ones
+    def test_flip_lt_1(self):
+        dfilter = "ntp.precision < 0"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_flip_le_1(self):
+        dfilter = "ntp.precision <= 127"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_flip_gt_1(self):
+        dfilter = "ntp.precision > 0"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_flip_gt_2(self):
+        dfilter = "ntp.precision > -128"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_flip_ge_1(self):
+        dfilter = "ntp.precision >= -128"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_flip_ge_2(self):
+        dfilter = "ntp.precision >= 1"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_flip_lt_2(self):
+        dfilter = "ntp.precision < -128"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_flip_eq_1(self):
+        dfilter = "ntp.precision == -11"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_flip_ne_1(self):
+        dfilter = "ntp.precision != -11"
+        self.assertDFilterCount(dfilter, 0)
+
+    # Unsigned, in the same packet
+    def test_unsigned_eq_1(self):
+        dfilter = "ntp.stratum == 4"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_unsigned_gt_1(self):
+        dfilter = "ntp.ppoll > 5"
+        self.assertDFilterCount(dfilter, 1)
+
+
+class testDFVMIPXNet(dftest.DFTest):
+    trace_file = "ipx_rip.pcap"
+
+    # Both networks are 0x28; ipx.net is each of them
+    def test_eq_1(self):
+        dfilter = "ipx.dst.net == 0x28"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_ne_1(self):
+        dfilter = "ipx.net != 0x28"
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_gt_1(self):
+        dfilter = "ipx.net > 0x27"
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_lt_1(self):
+        dfilter = "ipx.src.net < 0x28"
+        self.assertDFilterCount(dfilter, 0)
+
+
+class testDFVMFunction(dftest.DFTest):
+    trace_file = "http.pcap"
+
+    # A function's result is put in a register of its own
+    def test_upper_1(self):
+        dfilter = 'upper(http.request.method) == "HEAD"'
+        self.assertDFilterCount(dfilter, 1)
+
+    def test_upper_2(self):
+        dfilter = 'tcp.dstport == 80 and upper(http.request.method) == "GET"'
+        self.assertDFilterCount(dfilter, 0)
+
+    def test_lower_1(self):
+        dfilter = 'tcp.dstport == 80 and lower(http.request.method) == "head"'
+        self.assertDFilterCount(dfilter, 1)
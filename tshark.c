@@ -94,6 +94,8 @@
 #include <epan/ex-opt.h>
 
 #include "capture_opts.h"
+#include "tshark_shard.h"
+#include "tshark_index.h"
 
 #ifdef HAVE_LIBPCAP
 #include "capture_ui_utils.h"
@@ -132,6 +134,22 @@ static const char* prev_display_dissector_name = NULL;
 
 static gboolean perform_two_pass_analysis;
 
+/* See capture_opts.h for why the long options start where they do */
+#define LONGOPT_SHARD_WORKERS   (LONGOPT_NUM_CAP_COMMENT+1)
+#define LONGOPT_TWO_PASS_INDEX  (LONGOPT_NUM_CAP_COMMENT+2)
+#define LONGOPT_KEEP_SEEK_POINTS (LONGOPT_NUM_CAP_COMMENT+3)
+
+/* TRUE to keep the first pass's read filter results in an index file
+   next to the capture file, and to use them if they're there */
+static gboolean two_pass_index;
+static const char *two_pass_rfilter;
+
+#ifdef HAVE_TSHARK_SHARDS
+/* The number of processes to split the dissection of a capture file
+   between, or 0 to do it all in this one */
+static guint shard_workers;
+#endif
+
 /*
  * The way the packet decode is to be written.
  */
@@ -191,6 +209,9 @@ static gboolean process_packet(capture_file *cf, epan_dissect_t *edt, gint64 off
     guint tap_flags);
 static void show_capture_file_io_error(const char *, int, gboolean);
 static void show_print_file_io_error(int err);
+#ifdef HAVE_TSHARK_SHARDS
+static void skip_packet(capture_file *cf, gint64 offset, struct wtap_pkthdr *whdr);
+#endif
 static gboolean write_preamble(capture_file *cf);
 static gboolean print_packet(capture_file *cf, epan_dissect_t *edt);
 static gboolean write_finale(void);
@@ -354,6 +375,14 @@ print_usage(gboolean print_ver)
   fprintf(output, "  --capture-comment <comment>\n");
   fprintf(output, "                           add a capture comment to the newly created\n");
   fprintf(output, "                           output file (only for pcapng)\n");
+  fprintf(output, "  --two-pass-index         with -2 and -R, keep the read filter results in\n");
+  fprintf(output, "                           <infile>%s, and reuse them\n", TSHARK_INDEX_SUFFIX);
+  fprintf(output, "  --keep-seek-points       keep the seek points of a compressed <infile> in\n");
+  fprintf(output, "                           <infile>.fsidx, and reuse them\n");
+#ifdef HAVE_TSHARK_SHARDS
+  fprintf(output, "  --shard-workers <n>      dissect the capture file in n processes, split\n");
+  fprintf(output, "                           by flow (not with -2, -w or -z)\n");
+#endif
 
   fprintf(output, "\n");
   fprintf(output, "Miscellaneous:\n");
@@ -900,9 +929,15 @@ main(int argc, char *argv[])
   int                  opt;
   struct option     long_options[] = {
     {(char *)"capture-comment", required_argument, NULL, LONGOPT_NUM_CAP_COMMENT },
+#ifdef HAVE_TSHARK_SHARDS
+    {(char *)"shard-workers", required_argument, NULL, LONGOPT_SHARD_WORKERS },
+#endif
+    {(char *)"two-pass-index", no_argument, NULL, LONGOPT_TWO_PASS_INDEX },
+    {(char *)"keep-seek-points", no_argument, NULL, LONGOPT_KEEP_SEEK_POINTS },
     {0, 0, 0, 0 }
   };
   gboolean             arg_error = FALSE;
+  gboolean             stat_args_given = FALSE;
 
 #ifdef _WIN32
   WSADATA              wsaData;
@@ -1587,7 +1622,23 @@ main(int argc, char *argv[])
         list_stat_cmd_args();
         return 1;
       }
+      stat_args_given = TRUE;
+      break;
+    case LONGOPT_TWO_PASS_INDEX:
+      two_pass_index = TRUE;
+      break;
+    case LONGOPT_KEEP_SEEK_POINTS:
+      wtap_set_keep_seek_points(TRUE);
+      break;
+#ifdef HAVE_TSHARK_SHARDS
+    case LONGOPT_SHARD_WORKERS:
+      shard_workers = get_positive_int(optarg, "number of shard workers");
+      if (shard_workers > SHARD_MAX_WORKERS) {
+        cmdarg_err("There can be at most %u shard workers.", SHARD_MAX_WORKERS);
+        return 1;
+      }
       break;
+#endif
     default:
     case '?':        /* Bad flag - print usage message */
       switch(optopt) {
@@ -1715,6 +1766,45 @@ main(int argc, char *argv[])
     return 1;
   }
 
+  if (two_pass_index) {
+    if (!perform_two_pass_analysis) {
+      cmdarg_err("--two-pass-index requires -2.");
+      return 1;
+    }
+    two_pass_rfilter = rfilter;
+  }
+
+#ifdef HAVE_TSHARK_SHARDS
+  if (shard_workers > 1) {
+    /* The workers each see only some of the packets, so anything that
+       has to see all of them has to be done in one process */
+    if (cf_name == NULL) {
+      cmdarg_err("--shard-workers requires a capture file to be read with -r.");
+      return 1;
+    }
+    if (perform_two_pass_analysis) {
+      cmdarg_err("--shard-workers can't be used with -2.");
+      return 1;
+    }
+#ifdef HAVE_LIBPCAP
+    if (global_capture_opts.save_file != NULL) {
+      cmdarg_err("--shard-workers can't be used with -w.");
+      return 1;
+    }
+#endif
+    if (stat_args_given) {
+      cmdarg_err("--shard-workers can't be used with -z.");
+      return 1;
+    }
+    /* Which packets were displayed before this one depends on the
+       packets of the other workers */
+    if (dfilter != NULL) {
+      cmdarg_err("--shard-workers can't be used with a display filter.");
+      return 1;
+    }
+  }
+#endif
+
 #ifdef HAVE_LIBPCAP
   if (list_link_layer_types) {
     /* We're supposed to list the link-layer types for an interface;
@@ -2664,7 +2754,7 @@ capture_input_new_packets(capture_session *cap_session, int to_read)
         cf->wth = NULL;
       } else {
         ret = process_packet(cf, edt, data_offset, wtap_phdr(cf->wth),
-                             wtap_buf_ptr(cf->wth),
+                             wtap_buf_ptr_const(cf->wth),
                              tap_flags);
       }
       if (ret != FALSE) {
@@ -2837,11 +2927,13 @@ capture_cleanup(int signum _U_)
 static gboolean
 process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
                gint64 offset, struct wtap_pkthdr *whdr,
-               const guchar *pd)
+               const guchar *pd, tshark_index_t *pass_index,
+               tshark_index_writer_t *index_writer, gboolean *index_mismatch)
 {
   frame_data     fdlocal;
   guint32        framenum;
   gboolean       passed;
+  gboolean       dependent_of_displayed = FALSE;
 
   /* The frame number of this packet is one more than the count of
      frames in this packet. */
@@ -2864,8 +2956,8 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
       host_name_lookup_process();
 
     /* If we're running a read filter, prime the epan_dissect_t with that
-       filter. */
-    if (cf->rfcode)
+       filter; not if the index has its results. */
+    if (cf->rfcode && pass_index == NULL)
       epan_dissect_prime_dfilter(edt, cf->rfcode);
 
     frame_data_set_before_dissect(&fdlocal, &cf->elapsed_time,
@@ -2877,14 +2969,28 @@ process_packet_first_pass(capture_file *cf, epan_dissect_t *edt,
 
     epan_dissect_run(edt, whdr, frame_tvbuff_new(&fdlocal, pd), &fdlocal, NULL);
 
-    /* Run the read filter if we have one. */
-    if (cf->rfcode)
+    /* Run the read filter if we have one, unless the index already
+       says what it would say. */
+    if (pass_index != NULL) {
+      if (!tshark_index_next(pass_index, offset, &passed, &dependent_of_displayed)) {
+        /* The caller starts the pass again without the index */
+        *index_mismatch = TRUE;
+        epan_dissect_reset(edt);
+        frame_data_destroy(&fdlocal);
+        return FALSE;
+      }
+    } else if (cf->rfcode)
       passed = dfilter_apply_edt(cf->rfcode, edt);
   }
 
+  if (index_writer != NULL)
+    tshark_index_writer_add(index_writer, offset, passed);
+
   if (passed) {
     frame_data_set_after_dissect(&fdlocal, &cum_bytes);
     prev_cap = prev_dis = frame_data_sequence_add(cf->frames, &fdlocal);
+    if (dependent_of_displayed)
+      prev_dis->flags.dependent_of_displayed = 1;
 
     /* If we're not doing dissection then there won't be any dependent frames.
      * More importantly, edt.pi.dependent_frames won't be initialized because
@@ -3027,6 +3133,9 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   struct wtap_pkthdr phdr;
   Buffer       buf;
   epan_dissect_t *edt = NULL;
+#ifdef HAVE_TSHARK_SHARDS
+  int          shard = -1;
+#endif
 
   shb_hdr = wtap_file_get_shb_info(cf->wth);
   idb_inf = wtap_file_get_idb_info(cf->wth);
@@ -3125,16 +3234,30 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
 
   if (perform_two_pass_analysis) {
     frame_data *fdata;
+    tshark_index_t        *pass_index = NULL;
+    tshark_index_writer_t *index_writer = NULL;
+    int                    first_pass_max_packet_count;
 
     /* Allocate a frame_data_sequence for all the frames. */
     cf->frames = new_frame_data_sequence();
 
+    /* The index only saves running the read filter, so there's no
+       point in one without it */
+    if (two_pass_index && cf->rfcode) {
+      pass_index = tshark_index_open(cf->filename, two_pass_rfilter);
+      if (pass_index == NULL)
+        index_writer = tshark_index_writer_new(cf->filename, two_pass_rfilter);
+    }
+
     if (do_dissection) {
        gboolean create_proto_tree = FALSE;
 
       /* If we're going to be applying a filter, we'll need to
-         create a protocol tree against which to apply the filter. */
-      if (cf->rfcode)
+         create a protocol tree against which to apply the filter.
+         The packets are still dissected if we have the filter's
+         results in the index, for the state the second pass needs,
+         but that doesn't need a tree. */
+      if (cf->rfcode && pass_index == NULL)
         create_proto_tree = TRUE;
 
       /* We're not going to display the protocol tree on this pass,
@@ -3142,9 +3265,13 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       edt = epan_dissect_new(cf->epan, create_proto_tree, FALSE);
     }
 
+    first_pass_max_packet_count = max_packet_count;
     while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
+      gboolean index_mismatch = FALSE;
+
       if (process_packet_first_pass(cf, edt, data_offset, wtap_phdr(cf->wth),
-                         wtap_buf_ptr(cf->wth))) {
+                         wtap_buf_ptr_const(cf->wth), pass_index, index_writer,
+                         &index_mismatch)) {
         /* Stop reading if we have the maximum number of packets;
          * When the -c option has not been used, max_packet_count
          * starts at 0, which practically means, never stop reading.
@@ -3152,9 +3279,62 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
          */
         if ( (--max_packet_count == 0) || (max_byte_count != 0 && data_offset >= max_byte_count)) {
           err = 0; /* This is not an error */
+          /* An index of part of the file would be no use */
+          if (index_writer != NULL) {
+            tshark_index_writer_free(index_writer);
+            index_writer = NULL;
+          }
           break;
         }
       }
+
+      if (index_mismatch) {
+        wtap *wth;
+
+        /* The packets so far have been dissected without running the
+           read filter, so start the pass again from the beginning,
+           without the index, and write a new one. */
+        cmdarg_err("The index \"%s\" doesn't match the file \"%s\"; ignoring it.",
+                   tshark_index_filename(pass_index), cf->filename);
+        tshark_index_close(pass_index);
+        pass_index = NULL;
+
+        wth = wtap_open_offline(cf->filename, &err, &err_info, TRUE);
+        if (wth == NULL) {
+          char err_msg[2048+1];
+
+          epan_dissect_free(edt);
+          edt = NULL;
+          g_snprintf(err_msg, sizeof err_msg,
+                     cf_open_error_message(err, err_info, FALSE, cf->cd_t),
+                     cf->filename);
+          cmdarg_err("%s", err_msg);
+          goto out;
+        }
+        wtap_close(cf->wth);
+        cf->wth = wth;
+        wtap_set_cb_new_ipv4(cf->wth, add_ipv4_name);
+        wtap_set_cb_new_ipv6(cf->wth, (wtap_new_ipv6_callback_t) add_ipv6_name);
+
+        free_frame_data_sequence(cf->frames);
+        cf->frames = new_frame_data_sequence();
+        cf->count = 0;
+        cum_bytes = 0;
+        nstime_set_zero(&cf->elapsed_time);
+        ref = NULL;
+        prev_dis = NULL;
+        prev_cap = NULL;
+        max_packet_count = first_pass_max_packet_count;
+
+        /* Start the dissection state again, too, and dissect with a
+           tree for the read filter this time. */
+        epan_dissect_free(edt);
+        epan_free(cf->epan);
+        cf->epan = tshark_epan_new(cf);
+        edt = epan_dissect_new(cf->epan, TRUE, FALSE);
+
+        index_writer = tshark_index_writer_new(cf->filename, two_pass_rfilter);
+      }
     }
 
     if (edt) {
@@ -3162,6 +3342,25 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       edt = NULL;
     }
 
+    if (pass_index != NULL)
+      tshark_index_close(pass_index);
+    if (index_writer != NULL) {
+      if (err == 0) {
+        int index_err;
+
+        for (framenum = 1; framenum <= cf->count; framenum++) {
+          fdata = frame_data_sequence_find(cf->frames, framenum);
+          if (fdata->flags.dependent_of_displayed)
+            tshark_index_writer_set_dependent(index_writer, framenum);
+        }
+        /* Not being able to write it only makes the next run slower */
+        if (!tshark_index_writer_finish(index_writer, &index_err))
+          cmdarg_err("The index for \"%s\" couldn't be written: %s.",
+                     cf->filename, g_strerror(index_err));
+      } else
+        tshark_index_writer_free(index_writer);
+    }
+
     /* Close the sequential I/O side, to free up memory it requires. */
     wtap_sequential_close(cf->wth);
 
@@ -3256,6 +3455,37 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
   else {
     framenum = 0;
 
+#ifdef HAVE_TSHARK_SHARDS
+    if (shard_workers > 1) {
+      if (!shard_start_workers(shard_workers, &shard, &err)) {
+        cmdarg_err("The shard workers couldn't be started: %s.", g_strerror(err));
+        goto out;
+      }
+
+      if (shard < 0) {
+        /* We're the parent; the workers read and dissect the file, and
+           we put what they print together, in frame order. */
+        if (!shard_merge_output(stdout)) {
+          /* The workers will have said what went wrong */
+          err = WTAP_ERR_CANT_READ;
+        } else if (print_packet_info && !write_finale()) {
+          err = errno;
+          show_print_file_io_error(err);
+        }
+        goto out;
+      }
+
+      /* We're a worker; read the file from the beginning, on our own */
+      wtap_close(cf->wth);
+      cf->wth = wtap_open_offline(cf->filename, &err, &err_info, FALSE);
+      if (cf->wth == NULL) {
+        cmdarg_err("The file \"%s\" couldn't be reopened: %s.", cf->filename,
+                   wtap_strerror(err));
+        shard_worker_exit(2);
+      }
+    }
+#endif
+
     if (do_dissection) {
       gboolean create_proto_tree;
 
@@ -3275,14 +3505,22 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
     while (wtap_read(cf->wth, &err, &err_info, &data_offset)) {
       framenum++;
 
+#ifdef HAVE_TSHARK_SHARDS
+      if (shard >= 0 &&
+          shard_of_packet(wtap_phdr(cf->wth), wtap_buf_ptr_const(cf->wth),
+                          shard_workers) != (guint)shard) {
+        /* Another worker's packet */
+        skip_packet(cf, data_offset, wtap_phdr(cf->wth));
+      } else
+#endif
       if (process_packet(cf, edt, data_offset, wtap_phdr(cf->wth),
-                         wtap_buf_ptr(cf->wth),
+                         wtap_buf_ptr_const(cf->wth),
                          tap_flags)) {
         /* Either there's no read filtering or this packet passed the
            filter, so, if we're writing to a capture file, write
            this packet out. */
         if (pdh != NULL) {
-          if (!wtap_dump(pdh, wtap_phdr(cf->wth), wtap_buf_ptr(cf->wth), &err)) {
+          if (!wtap_dump(pdh, wtap_phdr(cf->wth), wtap_buf_ptr_const(cf->wth), &err)) {
             /* Error writing to a capture file */
             switch (err) {
 
@@ -3320,6 +3558,10 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
           }
         }
       }
+#ifdef HAVE_TSHARK_SHARDS
+      if (shard >= 0)
+        shard_worker_packet_done(framenum);
+#endif
       /* Stop reading if we have the maximum number of packets;
        * When the -c option has not been used, max_packet_count
        * starts at 0, which practically means, never stop reading.
@@ -3335,6 +3577,13 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
       epan_dissect_free(edt);
       edt = NULL;
     }
+
+#ifdef HAVE_TSHARK_SHARDS
+    /* The workers all read the same file, so only the first one
+       reports it if that failed */
+    if (shard > 0 || (shard == 0 && err == 0))
+      shard_worker_exit(err == 0 ? 0 : 2);
+#endif
   }
 
   if (err != 0) {
@@ -3402,6 +3651,10 @@ load_cap_file(capture_file *cf, char *save_file, int out_file_type,
                  cf->filename, wtap_strerror(err));
       break;
     }
+#ifdef HAVE_TSHARK_SHARDS
+    if (shard == 0)
+      shard_worker_exit(2);
+#endif
     if (save_file != NULL) {
       /* Now close the capture file. */
       if (!wtap_dump_close(pdh, &err))
@@ -3545,6 +3798,39 @@ process_packet(capture_file *cf, epan_dissect_t *edt, gint64 offset, struct wtap
   return passed;
 }
 
+#ifdef HAVE_TSHARK_SHARDS
+/*
+ * A packet that another shard worker dissects; it's still counted, and
+ * taken into account for the time references and cumulative byte count,
+ * as if it had been dissected and displayed, so that the packets we do
+ * dissect come out as they would have without sharding.  (There's no
+ * display filter with sharding, so every packet is displayed.)
+ */
+static void
+skip_packet(capture_file *cf, gint64 offset, struct wtap_pkthdr *whdr)
+{
+  frame_data fdata;
+
+  cf->count++;
+
+  frame_data_init(&fdata, cf->count, whdr, offset, cum_bytes);
+  frame_data_set_before_dissect(&fdata, &cf->elapsed_time,
+                                &ref, prev_dis);
+  if (ref == &fdata) {
+    ref_frame = fdata;
+    ref = &ref_frame;
+  }
+  frame_data_set_after_dissect(&fdata, &cum_bytes);
+
+  prev_dis_frame = fdata;
+  prev_dis = &prev_dis_frame;
+  prev_cap_frame = fdata;
+  prev_cap = &prev_cap_frame;
+
+  frame_data_destroy(&fdata);
+}
+#endif
+
 static gboolean
 write_preamble(capture_file *cf)
 {
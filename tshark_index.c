@@ -0,0 +1,501 @@
+/* tshark_index.c
+ * Keeping the results of TShark's first pass over a capture file
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+
+#include <glib.h>
+
+#include <epan/packet.h>
+#include <epan/prefs.h>
+#include <epan/prefs-int.h>
+#include <epan/proto.h>
+
+#include <wsutil/file_util.h>
+
+#include "tshark_index.h"
+
+#ifndef S_ISREG
+#define S_ISREG(mode)   (((mode) & S_IFMT) == S_IFREG)
+#endif
+
+/*
+ * The index is a cache on the machine that wrote it, so it's in that
+ * machine's byte order; the version number doubles as a check of that.
+ *
+ * It's a header, then the key (the version of TShark, a digest of the
+ * settings that change how packets are dissected, and the read filter),
+ * padded to a multiple of 8 bytes, then a tshark_index_frame_t
+ * for each record that passed the read filter, in order.
+ */
+#define TSHARK_INDEX_MAGIC   "TSHKIDX"
+#define TSHARK_INDEX_VERSION 1
+
+typedef struct {
+  char    magic[8];
+  guint32 version;
+  guint32 num_records;          /* records in the capture file */
+  guint32 num_frames;           /* records that passed the read filter */
+  guint32 key_len;
+  gint64  file_size;
+  gint64  file_mtime;
+} tshark_index_header_t;
+
+#define TSHARK_INDEX_DEPENDENT_OF_DISPLAYED 0x00000001
+
+typedef struct {
+  gint64  file_off;
+  guint32 record;               /* which record of the file, from 0 */
+  guint32 flags;
+} tshark_index_frame_t;
+
+#define TSHARK_INDEX_PAD(len) (((len) + 7) & ~7)
+
+struct tshark_index {
+  gchar                      *path;
+  GMappedFile                *mapped;
+  const tshark_index_frame_t *frames;
+  guint32                     num_records;
+  guint32                     num_frames;
+  guint32                     next_record;
+  guint32                     next_frame;
+};
+
+struct tshark_index_writer {
+  gchar   *path;
+  gchar   *key;
+  gint64   file_size;
+  gint64   file_mtime;
+  GArray  *frames;              /* of tshark_index_frame_t */
+  guint32  num_records;
+};
+
+/*
+ * The settings that change how packets are dissected, and so which of
+ * them pass the read filter, each as a line of text; they're sorted
+ * before being digested, as the tables they come from are hashed.
+ */
+typedef struct {
+  module_t *module;
+  GSList   *lines;
+} index_settings_t;
+
+static guint
+index_settings_pref(pref_t *pref, gpointer user_data)
+{
+  index_settings_t *settings = (index_settings_t *)user_data;
+  char             *current, *dflt;
+
+  /* Only the preferences that have a value of their own */
+  switch (pref->type) {
+
+  case PREF_UINT:
+  case PREF_BOOL:
+  case PREF_ENUM:
+  case PREF_STRING:
+  case PREF_FILENAME:
+  case PREF_DIRNAME:
+  case PREF_RANGE:
+    break;
+
+  default:
+    return 0;
+  }
+
+  current = prefs_pref_to_str(pref, pref_current);
+  dflt = prefs_pref_to_str(pref, pref_default);
+  if (strcmp(current, dflt) != 0)
+    settings->lines = g_slist_prepend(settings->lines,
+        g_strdup_printf("pref %s.%s: %s", settings->module->name, pref->name,
+                        current));
+  g_free(current);
+  g_free(dflt);
+  return 0;
+}
+
+static guint
+index_settings_module(module_t *module, gpointer user_data)
+{
+  index_settings_t *settings = (index_settings_t *)user_data;
+
+  settings->module = module;
+  return prefs_pref_foreach(module, index_settings_pref, settings);
+}
+
+static void
+index_settings_decode_as(const gchar *table_name, ftenum_t selector_type,
+                         gpointer key, gpointer value, gpointer user_data)
+{
+  index_settings_t   *settings = (index_settings_t *)user_data;
+  dissector_handle_t  handle;
+  const char         *handle_name;
+
+  handle = dtbl_entry_get_handle((dtbl_entry_t *)value);
+  handle_name = handle ? dissector_handle_get_short_name(handle) : "(none)";
+
+  switch (selector_type) {
+
+  case FT_UINT8:
+  case FT_UINT16:
+  case FT_UINT24:
+  case FT_UINT32:
+    settings->lines = g_slist_prepend(settings->lines,
+        g_strdup_printf("decode-as %s==%u,%s", table_name,
+                        GPOINTER_TO_UINT(key), handle_name));
+    break;
+
+  case FT_STRING:
+  case FT_STRINGZ:
+    settings->lines = g_slist_prepend(settings->lines,
+        g_strdup_printf("decode-as %s==%s,%s", table_name,
+                        (const char *)key, handle_name));
+    break;
+
+  default:
+    break;
+  }
+}
+
+static void
+index_settings_heur_table(const gchar *table_name, gpointer table,
+                          gpointer user_data)
+{
+  index_settings_t  *settings = (index_settings_t *)user_data;
+  GSList            *entry;
+  heur_dtbl_entry_t *dtbl_entry;
+
+  for (entry = *(heur_dissector_list_t *)table; entry != NULL;
+       entry = g_slist_next(entry)) {
+    dtbl_entry = (heur_dtbl_entry_t *)entry->data;
+    if (!dtbl_entry->enabled)
+      settings->lines = g_slist_prepend(settings->lines,
+          g_strdup_printf("heuristic %s: %s disabled", table_name,
+              proto_get_protocol_filter_name(proto_get_id(dtbl_entry->protocol))));
+  }
+}
+
+static gchar *
+index_settings_digest(void)
+{
+  index_settings_t  settings;
+  void             *cookie;
+  int               proto_id;
+  GString          *text;
+  GSList           *line;
+  gchar            *digest;
+
+  settings.module = NULL;
+  settings.lines = NULL;
+
+  prefs_modules_foreach(index_settings_module, &settings);
+  dissector_all_tables_foreach_changed(index_settings_decode_as, &settings);
+  for (proto_id = proto_get_first_protocol(&cookie); proto_id != -1;
+       proto_id = proto_get_next_protocol(&cookie)) {
+    if (!proto_is_protocol_enabled(find_protocol_by_id(proto_id)))
+      settings.lines = g_slist_prepend(settings.lines,
+          g_strdup_printf("protocol %s disabled",
+                          proto_get_protocol_filter_name(proto_id)));
+  }
+  dissector_all_heur_tables_foreach_table(index_settings_heur_table, &settings);
+
+  settings.lines = g_slist_sort(settings.lines, (GCompareFunc)strcmp);
+  text = g_string_new("");
+  for (line = settings.lines; line != NULL; line = g_slist_next(line)) {
+    g_string_append(text, (const char *)line->data);
+    g_string_append_c(text, '\n');
+    g_free(line->data);
+  }
+  g_slist_free(settings.lines);
+
+  digest = g_compute_checksum_for_string(G_CHECKSUM_SHA256, text->str,
+                                         text->len);
+  g_string_free(text, TRUE);
+  return digest;
+}
+
+static gchar *
+index_key(const char *rfilter)
+{
+  gchar *digest;
+  gchar *key;
+
+  digest = index_settings_digest();
+  key = g_strdup_printf("TShark " VERSION "\n%s\n%s", digest,
+                        rfilter ? rfilter : "");
+  g_free(digest);
+  return key;
+}
+
+static gboolean
+index_capture_file_info(const char *capture_path, gint64 *size, gint64 *mtime)
+{
+  ws_statb64 statb;
+
+  /* There's nowhere to put the index of a pipe */
+  if (strcmp(capture_path, "-") == 0)
+    return FALSE;
+  if (ws_stat64(capture_path, &statb) != 0 || !S_ISREG(statb.st_mode))
+    return FALSE;
+
+  *size = statb.st_size;
+  *mtime = statb.st_mtime;
+  return TRUE;
+}
+
+static void
+index_unmap(GMappedFile *mapped)
+{
+#if GLIB_CHECK_VERSION(2,22,0)
+  g_mapped_file_unref(mapped);
+#else
+  g_mapped_file_free(mapped);
+#endif
+}
+
+tshark_index_t *
+tshark_index_open(const char *capture_path, const char *rfilter)
+{
+  tshark_index_t              *idx;
+  const tshark_index_header_t *hdr;
+  GMappedFile                 *mapped;
+  const char                  *contents;
+  gsize                        length;
+  gchar                       *path;
+  gchar                       *key;
+  gint64                       file_size, file_mtime;
+  gsize                        frames_off;
+
+  if (!index_capture_file_info(capture_path, &file_size, &file_mtime))
+    return NULL;
+
+  path = g_strconcat(capture_path, TSHARK_INDEX_SUFFIX, NULL);
+  mapped = g_mapped_file_new(path, FALSE, NULL);
+  if (mapped == NULL) {
+    g_free(path);
+    return NULL;
+  }
+  contents = g_mapped_file_get_contents(mapped);
+  length = g_mapped_file_get_length(mapped);
+
+  /* Anything that doesn't look right means the index is for something
+     else, and it'll be written again */
+  hdr = (const tshark_index_header_t *)contents;
+  key = index_key(rfilter);
+  if (length < sizeof *hdr ||
+      memcmp(hdr->magic, TSHARK_INDEX_MAGIC, sizeof hdr->magic) != 0 ||
+      hdr->version != TSHARK_INDEX_VERSION ||
+      hdr->file_size != file_size || hdr->file_mtime != file_mtime ||
+      hdr->num_frames > hdr->num_records ||
+      hdr->key_len != strlen(key) ||
+      length - sizeof *hdr < TSHARK_INDEX_PAD(hdr->key_len) ||
+      memcmp(contents + sizeof *hdr, key, hdr->key_len) != 0) {
+    g_free(key);
+    index_unmap(mapped);
+    g_free(path);
+    return NULL;
+  }
+  g_free(key);
+
+  frames_off = sizeof *hdr + TSHARK_INDEX_PAD(hdr->key_len);
+  if ((length - frames_off) / sizeof (tshark_index_frame_t) != hdr->num_frames) {
+    index_unmap(mapped);
+    g_free(path);
+    return NULL;
+  }
+
+  idx = g_new0(tshark_index_t, 1);
+  idx->path = path;
+  idx->mapped = mapped;
+  idx->frames = (const tshark_index_frame_t *)(contents + frames_off);
+  idx->num_records = hdr->num_records;
+  idx->num_frames = hdr->num_frames;
+  return idx;
+}
+
+const char *
+tshark_index_filename(const tshark_index_t *idx)
+{
+  return idx->path;
+}
+
+gboolean
+tshark_index_next(tshark_index_t *idx, gint64 offset,
+                  gboolean *passed, gboolean *dependent_of_displayed)
+{
+  const tshark_index_frame_t *frame;
+
+  if (idx->next_record >= idx->num_records)
+    return FALSE;
+
+  *passed = FALSE;
+  *dependent_of_displayed = FALSE;
+  if (idx->next_frame < idx->num_frames) {
+    frame = &idx->frames[idx->next_frame];
+    if (frame->record == idx->next_record) {
+      if (frame->file_off != offset)
+        return FALSE;
+      *passed = TRUE;
+      *dependent_of_displayed =
+        (frame->flags & TSHARK_INDEX_DEPENDENT_OF_DISPLAYED) != 0;
+      idx->next_frame++;
+    }
+  }
+  idx->next_record++;
+  return TRUE;
+}
+
+void
+tshark_index_close(tshark_index_t *idx)
+{
+  index_unmap(idx->mapped);
+  g_free(idx->path);
+  g_free(idx);
+}
+
+tshark_index_writer_t *
+tshark_index_writer_new(const char *capture_path, const char *rfilter)
+{
+  tshark_index_writer_t *w;
+  gint64                 file_size, file_mtime;
+
+  if (!index_capture_file_info(capture_path, &file_size, &file_mtime))
+    return NULL;
+
+  w = g_new0(tshark_index_writer_t, 1);
+  w->path = g_strconcat(capture_path, TSHARK_INDEX_SUFFIX, NULL);
+  w->key = index_key(rfilter);
+  w->file_size = file_size;
+  w->file_mtime = file_mtime;
+  w->frames = g_array_new(FALSE, FALSE, sizeof (tshark_index_frame_t));
+  return w;
+}
+
+void
+tshark_index_writer_add(tshark_index_writer_t *w, gint64 offset,
+                        gboolean passed)
+{
+  tshark_index_frame_t frame;
+
+  if (passed) {
+    frame.file_off = offset;
+    frame.record = w->num_records;
+    frame.flags = 0;
+    g_array_append_val(w->frames, frame);
+  }
+  w->num_records++;
+}
+
+void
+tshark_index_writer_set_dependent(tshark_index_writer_t *w, guint32 framenum)
+{
+  if (framenum >= 1 && framenum <= w->frames->len)
+    g_array_index(w->frames, tshark_index_frame_t, framenum - 1).flags |=
+      TSHARK_INDEX_DEPENDENT_OF_DISPLAYED;
+}
+
+gboolean
+tshark_index_writer_finish(tshark_index_writer_t *w, int *err)
+{
+  tshark_index_header_t  hdr;
+  static const char      padding[8];
+  gchar                 *tmp_path;
+  FILE                  *fh;
+  gboolean               ok;
+
+  memset(&hdr, 0, sizeof hdr);
+  memcpy(hdr.magic, TSHARK_INDEX_MAGIC, sizeof hdr.magic);
+  hdr.version = TSHARK_INDEX_VERSION;
+  hdr.num_records = w->num_records;
+  hdr.num_frames = w->frames->len;
+  hdr.key_len = (guint32)strlen(w->key);
+  hdr.file_size = w->file_size;
+  hdr.file_mtime = w->file_mtime;
+
+  /* Written under another name and renamed, so that nobody sees half
+     of it */
+  tmp_path = g_strconcat(w->path, ".tmp", NULL);
+  fh = ws_fopen(tmp_path, "wb");
+  if (fh == NULL) {
+    *err = errno;
+    g_free(tmp_path);
+    tshark_index_writer_free(w);
+    return FALSE;
+  }
+
+  ok = fwrite(&hdr, sizeof hdr, 1, fh) == 1 &&
+       fwrite(w->key, 1, hdr.key_len, fh) == hdr.key_len &&
+       fwrite(padding, 1, TSHARK_INDEX_PAD(hdr.key_len) - hdr.key_len, fh) ==
+         TSHARK_INDEX_PAD(hdr.key_len) - hdr.key_len &&
+       fwrite(w->frames->data, sizeof (tshark_index_frame_t), w->frames->len, fh) ==
+         w->frames->len;
+  if (!ok)
+    *err = errno;
+  if (fclose(fh) == EOF && ok) {
+    *err = errno;
+    ok = FALSE;
+  }
+  if (ok && ws_rename(tmp_path, w->path) != 0) {
+    *err = errno;
+    ok = FALSE;
+  }
+  if (!ok)
+    ws_unlink(tmp_path);
+
+  g_free(tmp_path);
+  tshark_index_writer_free(w);
+  return ok;
+}
+
+void
+tshark_index_writer_free(tshark_index_writer_t *w)
+{
+  g_array_free(w->frames, TRUE);
+  g_free(w->key);
+  g_free(w->path);
+  g_free(w);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
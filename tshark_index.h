@@ -0,0 +1,107 @@
+/* tshark_index.h
+ * Keeping the results of TShark's first pass over a capture file
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __TSHARK_INDEX_H__
+#define __TSHARK_INDEX_H__
+
+/** @file
+ *
+ *  With -2, the first pass dissects every record of the capture file, to
+ *  build up the dissectors' state (reassembly, conversations) for the
+ *  second one, and runs the read filter on it, which needs a protocol
+ *  tree.  An index file next to the capture file keeps which records
+ *  passed the read filter, with their offsets, and which of them
+ *  displayed frames depend on, so that a later run with the same read
+ *  filter can do its first pass without building protocol trees or
+ *  running the filter.
+ *
+ *  The index is only used if the capture file's size and modification
+ *  time, the read filter and the version of TShark are the same as when
+ *  it was written.
+ */
+
+#include <glib.h>
+
+/** The suffix added to the capture file's name to get the index's */
+#define TSHARK_INDEX_SUFFIX ".tsidx"
+
+/** An index being read */
+typedef struct tshark_index tshark_index_t;
+
+/** An index being written */
+typedef struct tshark_index_writer tshark_index_writer_t;
+
+/** Map in the index of a capture file.
+ *
+ * @param capture_path the capture file's name
+ * @param rfilter the read filter being used
+ * @return the index, or NULL if there's none, or it's for something else
+ */
+tshark_index_t *tshark_index_open(const char *capture_path, const char *rfilter);
+
+/** The name of the file an index was read from */
+const char *tshark_index_filename(const tshark_index_t *idx);
+
+/** Get the results for the next record of the capture file.
+ *
+ * @param idx the index
+ * @param offset the record's offset in the capture file
+ * @param passed [out] whether it passed the read filter
+ * @param dependent_of_displayed [out] whether a displayed frame depends on it
+ * @return FALSE if the index doesn't match the capture file
+ */
+gboolean tshark_index_next(tshark_index_t *idx, gint64 offset,
+                           gboolean *passed, gboolean *dependent_of_displayed);
+
+/** Unmap an index */
+void tshark_index_close(tshark_index_t *idx);
+
+/** Start collecting the index of a capture file.
+ *
+ * @param capture_path the capture file's name
+ * @param rfilter the read filter being used
+ * @return the writer, or NULL if the capture file can't be indexed
+ */
+tshark_index_writer_t *tshark_index_writer_new(const char *capture_path,
+                                               const char *rfilter);
+
+/** Add the next record of the capture file, and whether it passed the
+ *  read filter; the ones that passed are numbered from 1 as frames. */
+void tshark_index_writer_add(tshark_index_writer_t *w, gint64 offset,
+                             gboolean passed);
+
+/** Note that a displayed frame depends on a frame */
+void tshark_index_writer_set_dependent(tshark_index_writer_t *w,
+                                       guint32 framenum);
+
+/** Write out the index and free the writer.
+ *
+ * @return FALSE, with the errno value in err, if it couldn't be written
+ */
+gboolean tshark_index_writer_finish(tshark_index_writer_t *w, int *err);
+
+/** Free a writer without writing anything */
+void tshark_index_writer_free(tshark_index_writer_t *w);
+
+#endif /* __TSHARK_INDEX_H__ */
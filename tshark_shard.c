@@ -0,0 +1,510 @@
+/* tshark_shard.c
+ * Splitting the dissection of a capture file between TShark processes
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+
+#ifdef HAVE_SYS_WAIT_H
+#include <sys/wait.h>
+#endif
+
+#include <glib.h>
+
+#include <wsutil/pint.h>
+#include <wsutil/file_util.h>
+#include <wsutil/tempfile.h>
+
+#include "tshark_shard.h"
+
+#define SHARD_ETHERTYPE_IPv4  0x0800
+#define SHARD_ETHERTYPE_IPv6  0x86dd
+#define SHARD_ETHERTYPE_VLAN  0x8100
+#define SHARD_ETHERTYPE_QINQ  0x88a8
+
+#define SHARD_IP_PROTO_TCP    6
+#define SHARD_IP_PROTO_SCTP   132
+
+/* 32-bit FNV-1a */
+#define SHARD_FNV_OFFSET      2166136261U
+#define SHARD_FNV_PRIME       16777619U
+
+static guint32
+shard_hash_endpoint(const guint8 *addr, guint addr_len, const guint8 *port)
+{
+  guint32 h = SHARD_FNV_OFFSET;
+  guint   i;
+
+  for (i = 0; i < addr_len; i++)
+    h = (h ^ addr[i]) * SHARD_FNV_PRIME;
+  if (port != NULL) {
+    h = (h ^ port[0]) * SHARD_FNV_PRIME;
+    h = (h ^ port[1]) * SHARD_FNV_PRIME;
+  }
+  return h;
+}
+
+static guint
+shard_of_flow(const guint8 *src, const guint8 *dst, guint addr_len,
+              guint8 proto, const guint8 *ports, guint num_shards)
+{
+  guint32 h;
+
+  /* Adding the endpoints' hashes makes it the same in both directions */
+  h = shard_hash_endpoint(src, addr_len, ports) +
+      shard_hash_endpoint(dst, addr_len, ports != NULL ? ports + 2 : NULL);
+  h = (h ^ proto) * SHARD_FNV_PRIME;
+
+  /* The MurmurHash3 finalizer, so that all of the bits count */
+  h ^= h >> 16;
+  h *= 0x85ebca6bU;
+  h ^= h >> 13;
+  h *= 0xc2b2ae35U;
+  h ^= h >> 16;
+
+  return h % num_shards;
+}
+
+static guint
+shard_of_ipv4(const guint8 *ip, guint32 len, guint num_shards)
+{
+  guint         hdr_len;
+  guint8        proto;
+  gboolean      fragment;
+  const guint8 *ports = NULL;
+
+  if (len < 20)
+    return 0;
+  hdr_len = (ip[0] & 0x0f) * 4;
+  proto = ip[9];
+
+  /* Only the first fragment has the ports, so all the fragments, the
+     first one included, go by the addresses and protocol only, to keep
+     them together for reassembly */
+  fragment = (pntoh16(ip + 6) & 0x3fff) != 0;   /* more fragments, or an offset */
+  if (!fragment &&
+      (proto == SHARD_IP_PROTO_TCP || proto == SHARD_IP_PROTO_SCTP) &&
+      hdr_len >= 20 && len >= hdr_len + 4)
+    ports = ip + hdr_len;
+
+  return shard_of_flow(ip + 12, ip + 16, 4, proto, ports, num_shards);
+}
+
+static guint
+shard_of_ipv6(const guint8 *ip, guint32 len, guint num_shards)
+{
+  const guint8 *ports = NULL;
+
+  if (len < 40)
+    return 0;
+
+  /* Extension headers, fragment ones included, aren't looked through;
+     those packets go by address only */
+  if ((ip[6] == SHARD_IP_PROTO_TCP || ip[6] == SHARD_IP_PROTO_SCTP) &&
+      len >= 40 + 4)
+    ports = ip + 40;
+
+  return shard_of_flow(ip + 8, ip + 24, 16, ip[6], ports, num_shards);
+}
+
+static guint16
+shard_ethertype_of_version(const guint8 *ip, guint32 len)
+{
+  if (len < 1)
+    return 0;
+  switch (ip[0] >> 4) {
+
+  case 4:
+    return SHARD_ETHERTYPE_IPv4;
+
+  case 6:
+    return SHARD_ETHERTYPE_IPv6;
+
+  default:
+    return 0;
+  }
+}
+
+guint
+shard_of_packet(const struct wtap_pkthdr *phdr, const guint8 *pd,
+                guint num_shards)
+{
+  guint32 len = phdr->caplen;
+  guint32 offset;
+  guint16 ethertype;
+
+  if (num_shards <= 1)
+    return 0;
+
+  switch (phdr->pkt_encap) {
+
+  case WTAP_ENCAP_ETHERNET:
+    if (len < 14)
+      return 0;
+    ethertype = pntoh16(pd + 12);
+    offset = 14;
+    while ((ethertype == SHARD_ETHERTYPE_VLAN || ethertype == SHARD_ETHERTYPE_QINQ) &&
+           len >= offset + 4) {
+      ethertype = pntoh16(pd + offset + 2);
+      offset += 4;
+    }
+    break;
+
+  case WTAP_ENCAP_SLL:
+    if (len < 16)
+      return 0;
+    ethertype = pntoh16(pd + 14);
+    offset = 16;
+    break;
+
+  case WTAP_ENCAP_NULL:
+    /* The address family is in host byte order of the machine that
+       captured it; the IP version says the same */
+    if (len < 4)
+      return 0;
+    offset = 4;
+    ethertype = shard_ethertype_of_version(pd + offset, len - offset);
+    break;
+
+  case WTAP_ENCAP_RAW_IP:
+  case WTAP_ENCAP_RAW_IP4:
+  case WTAP_ENCAP_RAW_IP6:
+    offset = 0;
+    ethertype = shard_ethertype_of_version(pd, len);
+    break;
+
+  default:
+    return 0;
+  }
+
+  switch (ethertype) {
+
+  case SHARD_ETHERTYPE_IPv4:
+    return shard_of_ipv4(pd + offset, len - offset, num_shards);
+
+  case SHARD_ETHERTYPE_IPv6:
+    return shard_of_ipv6(pd + offset, len - offset, num_shards);
+
+  default:
+    return 0;
+  }
+}
+
+#ifdef HAVE_TSHARK_SHARDS
+
+/*
+ * A worker sends the parent one of these for each packet it printed
+ * something for, saying how many bytes of its output file that was.
+ */
+typedef struct {
+  guint32 framenum;
+  guint32 len;
+} shard_index_t;
+
+/* Index records are sent this many at a time */
+#define SHARD_INDEX_CHUNK 256
+
+#define SHARD_COPY_SIZE   65536
+
+/* The parent's view of a worker */
+typedef struct {
+  pid_t          pid;
+  int            output_fd;     /* the worker's standard output */
+  gint64         output_read;   /* how much of it has been merged */
+  FILE          *index;         /* the read end of the index pipe */
+  gboolean       have_next;
+  shard_index_t  next;          /* its next packet, if have_next */
+} shard_worker_t;
+
+static shard_worker_t *shard_workers;
+static guint           shard_num_workers;
+
+/* In a worker */
+static int           shard_index_fd = -1;
+static gint64        shard_output_done;
+static shard_index_t shard_index_buf[SHARD_INDEX_CHUNK];
+static guint         shard_index_count;
+
+static void
+shard_close_workers(void)
+{
+  guint i;
+
+  for (i = 0; i < shard_num_workers; i++) {
+    if (shard_workers[i].index != NULL)
+      fclose(shard_workers[i].index);
+    ws_close(shard_workers[i].output_fd);
+  }
+}
+
+static gboolean
+shard_wait_workers(void)
+{
+  gboolean ok = TRUE;
+  int      status;
+  guint    i;
+
+  for (i = 0; i < shard_num_workers; i++) {
+    while (waitpid(shard_workers[i].pid, &status, 0) == -1) {
+      if (errno != EINTR) {
+        status = -1;
+        break;
+      }
+    }
+    if (status == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+      ok = FALSE;
+  }
+
+  g_free(shard_workers);
+  shard_workers = NULL;
+  shard_num_workers = 0;
+  return ok;
+}
+
+gboolean
+shard_start_workers(guint num_shards, int *shard, int *err)
+{
+  shard_worker_t *worker;
+  char           *tmpname;
+  int             index_pipe[2];
+  pid_t           pid;
+  guint           i;
+
+  *shard = -1;
+
+  /* Anything buffered would otherwise be written by every worker, too */
+  fflush(stdout);
+  fflush(stderr);
+
+  shard_workers = g_new0(shard_worker_t, num_shards);
+  shard_num_workers = 0;
+
+  for (i = 0; i < num_shards; i++) {
+    worker = &shard_workers[i];
+
+    worker->output_fd = create_tempfile(&tmpname, "tshark_shard");
+    if (worker->output_fd == -1) {
+      *err = errno;
+      goto fail;
+    }
+    /* Nobody else needs to see it, and it'll go away with us */
+    ws_unlink(tmpname);
+
+    if (pipe(index_pipe) == -1) {
+      *err = errno;
+      ws_close(worker->output_fd);
+      goto fail;
+    }
+
+    pid = fork();
+    if (pid == -1) {
+      *err = errno;
+      ws_close(index_pipe[0]);
+      ws_close(index_pipe[1]);
+      ws_close(worker->output_fd);
+      goto fail;
+    }
+
+    if (pid == 0) {
+      /* We're worker i; we don't need what the parent has of the
+         workers started before us */
+      shard_close_workers();
+      g_free(shard_workers);
+      shard_workers = NULL;
+      shard_num_workers = 0;
+
+      ws_close(index_pipe[0]);
+      if (dup2(worker->output_fd, 1) == -1)
+        _exit(2);
+      ws_close(worker->output_fd);
+
+      shard_index_fd = index_pipe[1];
+      shard_output_done = 0;
+      shard_index_count = 0;
+      *shard = (int)i;
+      return TRUE;
+    }
+
+    ws_close(index_pipe[1]);
+    worker->pid = pid;
+    worker->index = ws_fdopen(index_pipe[0], "rb");
+    shard_num_workers++;
+    if (worker->index == NULL) {
+      *err = errno;
+      ws_close(index_pipe[0]);
+      goto fail;
+    }
+  }
+
+  return TRUE;
+
+fail:
+  /* The workers we did start will die writing to the closed pipes */
+  shard_close_workers();
+  shard_wait_workers();
+  return FALSE;
+}
+
+static void
+shard_worker_flush_index(void)
+{
+  const guint8 *p = (const guint8 *)shard_index_buf;
+  size_t        left = shard_index_count * sizeof (shard_index_t);
+  ssize_t       n;
+
+  /* The output must be in the file before the parent hears about it */
+  fflush(stdout);
+
+  while (left != 0) {
+    n = write(shard_index_fd, p, left);
+    if (n == -1) {
+      if (errno == EINTR)
+        continue;
+      /* The parent has given up */
+      _exit(2);
+    }
+    p += n;
+    left -= n;
+  }
+  shard_index_count = 0;
+}
+
+void
+shard_worker_packet_done(guint32 framenum)
+{
+  gint64 pos;
+
+  /* This is where it'll be in the file; it's mostly still buffered */
+  pos = (gint64)ftello(stdout);
+  if (pos <= shard_output_done)
+    return;
+
+  shard_index_buf[shard_index_count].framenum = framenum;
+  shard_index_buf[shard_index_count].len = (guint32)(pos - shard_output_done);
+  shard_output_done = pos;
+  if (++shard_index_count == SHARD_INDEX_CHUNK)
+    shard_worker_flush_index();
+}
+
+void
+shard_worker_exit(int status)
+{
+  shard_worker_flush_index();
+  if (ferror(stdout) && status == 0)
+    status = 2;
+  ws_close(shard_index_fd);
+  _exit(status);
+}
+
+static void
+shard_read_index(shard_worker_t *worker)
+{
+  worker->have_next =
+    fread(&worker->next, sizeof worker->next, 1, worker->index) == 1;
+}
+
+static gboolean
+shard_copy_output(shard_worker_t *worker, guint32 len, guint8 *buf, FILE *out)
+{
+  ssize_t n;
+  size_t  want;
+
+  while (len != 0) {
+    want = MIN(len, SHARD_COPY_SIZE);
+    n = pread(worker->output_fd, buf, want, (off_t)worker->output_read);
+    if (n == -1 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return FALSE;
+    if (fwrite(buf, 1, n, out) != (size_t)n)
+      return FALSE;
+    worker->output_read += n;
+    len -= (guint32)n;
+  }
+  return TRUE;
+}
+
+gboolean
+shard_merge_output(FILE *out)
+{
+  shard_worker_t *worker;
+  guint8         *buf;
+  gboolean        ok = TRUE;
+  guint           i;
+
+  buf = (guint8 *)g_malloc(SHARD_COPY_SIZE);
+
+  for (i = 0; i < shard_num_workers; i++)
+    shard_read_index(&shard_workers[i]);
+
+  for (;;) {
+    /* The worker with the lowest numbered frame goes next; every
+       worker sends them in order, so that's the next one overall */
+    worker = NULL;
+    for (i = 0; i < shard_num_workers; i++) {
+      if (shard_workers[i].have_next &&
+          (worker == NULL || shard_workers[i].next.framenum < worker->next.framenum))
+        worker = &shard_workers[i];
+    }
+    if (worker == NULL)
+      break;
+
+    if (!shard_copy_output(worker, worker->next.len, buf, out)) {
+      ok = FALSE;
+      break;
+    }
+    shard_read_index(worker);
+  }
+
+  g_free(buf);
+  shard_close_workers();
+  if (!shard_wait_workers())
+    ok = FALSE;
+  return ok;
+}
+
+#endif /* HAVE_TSHARK_SHARDS */
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 2
+ * tab-width: 8
+ * indent-tabs-mode: nil
+ * End:
+ *
+ * vi: set shiftwidth=2 tabstop=8 expandtab:
+ * :indentSize=2:tabSize=8:noTabs=true:
+ */
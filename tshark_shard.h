@@ -0,0 +1,92 @@
+/* tshark_shard.h
+ * Splitting the dissection of a capture file between TShark processes
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __TSHARK_SHARD_H__
+#define __TSHARK_SHARD_H__
+
+/** @file
+ *
+ *  The dissection state in libwireshark is global, so a capture file is
+ *  dissected in parallel by forked worker processes rather than threads.
+ *  Every worker reads the whole file, but dissects only the packets of the
+ *  flows (address and, for TCP and SCTP, port pairs) that hash to it, and
+ *  skips the others after counting them; the parent then merges what the
+ *  workers printed, in frame number order.
+ */
+
+#include <stdio.h>
+
+#include <glib.h>
+
+#include <wiretap/wtap.h>
+
+/* Only where there's fork() */
+#ifndef _WIN32
+#define HAVE_TSHARK_SHARDS
+#endif
+
+/** The most worker processes that can be asked for */
+#define SHARD_MAX_WORKERS 64
+
+/** Which of num_shards workers dissects a packet. Both directions of a
+ *  flow go to the same one; packets that aren't IP all go to the first.
+ *
+ * @param phdr the packet's header
+ * @param pd the packet's data
+ * @param num_shards the number of workers
+ * @return the worker's number, from 0 to num_shards - 1
+ */
+guint shard_of_packet(const struct wtap_pkthdr *phdr, const guint8 *pd,
+                      guint num_shards);
+
+#ifdef HAVE_TSHARK_SHARDS
+
+/** Fork the worker processes. Whatever the parent has buffered on the
+ *  standard output is flushed first; the workers' standard output goes
+ *  to temporary files.
+ *
+ * @param num_shards the number of workers to fork
+ * @param shard [out] the worker's number in a worker, -1 in the parent
+ * @param err [out] the errno value if a worker couldn't be started
+ * @return TRUE if all the workers were started
+ */
+gboolean shard_start_workers(guint num_shards, int *shard, int *err);
+
+/** In a worker, note that everything it has printed since the last call
+ *  is for the given frame. */
+void shard_worker_packet_done(guint32 framenum);
+
+/** In a worker, finish and exit with the given status; doesn't return. */
+void shard_worker_exit(int status) G_GNUC_NORETURN;
+
+/** In the parent, copy the workers' output to a stream, in frame number
+ *  order, and wait for them to finish.
+ *
+ * @return TRUE if all the workers succeeded
+ */
+gboolean shard_merge_output(FILE *out);
+
+#endif /* HAVE_TSHARK_SHARDS */
+
+#endif /* __TSHARK_SHARD_H__ */
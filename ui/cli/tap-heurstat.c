@@ -0,0 +1,125 @@
+/* tap-heurstat.c
+ * How often each heuristic dissector was tried and took the packet, for tshark
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* This module lists, for each heuristic dissector list that was used, how
+ * many times each of its dissectors was tried and how many times it
+ * recognized the packet, in the order they are now being tried in. */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "epan/packet.h"
+#include <epan/tap.h>
+#include <epan/stat_cmd_args.h>
+
+void register_tap_listener_heurstat(void);
+
+typedef struct _heur_table_t {
+	const gchar *name;
+	heur_dissector_list_t *list;
+} heur_table_t;
+
+static void
+heurstat_add_table(const gchar *table_name, gpointer table, gpointer user_data)
+{
+	GArray *tables = (GArray *)user_data;
+	heur_table_t ht;
+
+	ht.name = table_name;
+	ht.list = (heur_dissector_list_t *)table;
+	g_array_append_val(tables, ht);
+}
+
+static gint
+heurstat_compare_tables(gconstpointer a, gconstpointer b)
+{
+	return strcmp(((const heur_table_t *)a)->name, ((const heur_table_t *)b)->name);
+}
+
+static void
+heurstat_draw(void *arg _U_)
+{
+	GArray *tables;
+	GSList *entry;
+	heur_dtbl_entry_t *hdtbl_entry;
+	heur_table_t *ht;
+	guint64 tries;
+	guint i;
+
+	/* Sorted by name, so the output doesn't depend on the hashing */
+	tables = g_array_new(FALSE, FALSE, sizeof(heur_table_t));
+	dissector_all_heur_tables_foreach_table(heurstat_add_table, tables);
+	g_array_sort(tables, heurstat_compare_tables);
+
+	printf("\n");
+	printf("===================================================================\n");
+	printf("Heuristic Dissector Statistics\n");
+	for (i = 0; i < tables->len; i++) {
+		ht = &g_array_index(tables, heur_table_t, i);
+
+		tries = 0;
+		for (entry = *ht->list; entry != NULL; entry = g_slist_next(entry))
+			tries += ((heur_dtbl_entry_t *)entry->data)->tries;
+		if (tries == 0)
+			continue;
+
+		printf("\n%s:\n", ht->name);
+		printf("  %-24s %12s %12s %8s\n", "Protocol", "Tries", "Accepts", "Rate");
+		for (entry = *ht->list; entry != NULL; entry = g_slist_next(entry)) {
+			hdtbl_entry = (heur_dtbl_entry_t *)entry->data;
+			printf("  %-24s %12" G_GINT64_MODIFIER "u %12" G_GINT64_MODIFIER "u %7.2f%%\n",
+			       hdtbl_entry->protocol ?
+				   proto_get_protocol_filter_name(proto_get_id(hdtbl_entry->protocol)) : "?",
+			       hdtbl_entry->tries, hdtbl_entry->accepts,
+			       hdtbl_entry->tries ? 100.0 * hdtbl_entry->accepts / hdtbl_entry->tries : 0.0);
+		}
+	}
+	printf("===================================================================\n");
+
+	g_array_free(tables, TRUE);
+}
+
+static void
+heurstat_init(const char *opt_arg _U_, void* userdata _U_)
+{
+	GString *error_string;
+
+	/* Only here to get the draw callback at the end of the run */
+	error_string=register_tap_listener("frame", &heurstat_init, NULL, 0, NULL, NULL, heurstat_draw);
+	if(error_string){
+		fprintf(stderr, "tshark: Couldn't register heur,stat tap: %s\n",
+		    error_string->str);
+		g_string_free(error_string, TRUE);
+		exit(1);
+	}
+}
+
+void
+register_tap_listener_heurstat(void)
+{
+	register_stat_cmd_arg("heur,stat", heurstat_init, NULL);
+}
@@ -0,0 +1,86 @@
+/* tap-taptiming.c
+ * What each tap listener costs, for tshark
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* This module reports, at the end of the run, how many packets each of the
+ * other tap listeners saw and how long their filters and packet callbacks
+ * took, so that the statistic slowing a run down can be found. */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "epan/packet_info.h"
+#include <epan/tap.h>
+#include <epan/stat_cmd_args.h>
+
+void register_tap_listener_taptiming(void);
+
+static void
+taptiming_print(const tap_listener_stats_t *stats, void *user_data _U_)
+{
+	printf("%-20s %12" G_GINT64_MODIFIER "u %12" G_GINT64_MODIFIER "u %10.3f%c %10.3f  %s\n",
+	       stats->tap_name ? stats->tap_name : "?",
+	       stats->tapped, stats->passed,
+	       stats->filter_time, stats->filter_shared ? '*' : ' ',
+	       stats->packet_time,
+	       stats->filter ? stats->filter : "");
+}
+
+static void
+taptiming_draw(void *arg _U_)
+{
+	printf("\n");
+	printf("===================================================================\n");
+	printf("Tap Listener Timing\n");
+	printf("%-20s %12s %12s %11s %10s  %s\n",
+	       "Tap", "Tapped", "Passed", "Filter (s)", "Packet (s)", "Filter");
+	tap_listener_stats_foreach(taptiming_print, NULL);
+	printf("\n* filter shared with other listeners, and evaluated once for all of them;\n");
+	printf("  its time is given for the first of them only\n");
+	printf("===================================================================\n");
+}
+
+static void
+taptiming_init(const char *opt_arg _U_, void* userdata _U_)
+{
+	GString *error_string;
+
+	tap_listener_timing(TRUE);
+
+	/* Only here to get the draw callback at the end of the run */
+	error_string=register_tap_listener("frame", &taptiming_init, NULL, 0, NULL, NULL, taptiming_draw);
+	if(error_string){
+		fprintf(stderr, "tshark: Couldn't register tap,timing tap: %s\n",
+		    error_string->str);
+		g_string_free(error_string, TRUE);
+		exit(1);
+	}
+}
+
+void
+register_tap_listener_taptiming(void)
+{
+	register_stat_cmd_arg("tap,timing", taptiming_init, NULL);
+}
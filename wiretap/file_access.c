@@ -155,6 +155,15 @@ static const struct file_extension_info file_type_extensions_base[] = {
 
 static const struct file_extension_info* file_type_extensions = NULL;
 
+/* TRUE to keep the seek points of compressed files in files next to them */
+static gboolean keep_seek_points = FALSE;
+
+void
+wtap_set_keep_seek_points(gboolean keep)
+{
+	keep_seek_points = keep;
+}
+
 static GArray* file_type_extensions_arr = NULL;
 
 /* initialize the extensions array if it has not been initialized yet */
@@ -728,6 +737,12 @@ wtap* wtap_open_offline(const char *filename, int *err, char **err_info,
 		file_set_random_access(wth->random_fh, TRUE, wth->fast_seek);
 	}
 
+	/* If we're keeping the seek points of compressed files, this one's
+	   may have been kept when it was read before; if not, collect them
+	   as it's read, even if it's only being read sequentially */
+	if (!use_stdin && keep_seek_points)
+		file_set_fast_seek_cache(wth->fh, filename);
+
 	/* Try all file types that support magic numbers */
 	for (i = 0; i < magic_number_open_routines_arr->len; i++) {
 		/* Seek back to the beginning of the file; the open routine
@@ -1667,7 +1682,7 @@ gboolean wtap_dump_can_open(int file_type_subtype)
 	return TRUE;
 }
 
-#ifdef HAVE_LIBZ
+#ifdef HAVE_COMPRESSED_WRITERS
 gboolean wtap_dump_can_compress(int file_type_subtype)
 {
 	/*
@@ -1711,10 +1726,10 @@ gboolean wtap_dump_supports_comment_types(int file_type_subtype, guint32 comment
 	return FALSE;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean comressed, int *err);
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err);
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err);
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err);
+					wtap_compression_type compression_type, int *err);
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, wtap_compression_type compression_type, int *err);
 
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename);
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd);
@@ -1727,13 +1742,13 @@ wtap_dumper* wtap_dump_open(const char *filename, int file_type_subtype, int enc
 }
 
 static wtap_dumper *
-wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean compressed,
+wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, wtap_compression_type compression_type,
     wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 
 	/* Allocate a data structure for the output stream. */
-	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compressed, err);
+	wdh = wtap_dump_alloc_wdh(file_type_subtype, encap, snaplen, compression_type, err);
 	if (wdh == NULL)
 		return NULL;	/* couldn't allocate it */
 
@@ -1771,24 +1786,31 @@ wtap_dump_init_dumper(int file_type_subtype, int encap, int snaplen, gboolean co
 
 wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int encap,
 				int snaplen, gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+{
+	return wtap_dump_open_compressed(filename, file_type_subtype, encap, snaplen,
+	    compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED, shb_hdr, idb_inf, err);
+}
+
+wtap_dumper* wtap_dump_open_compressed(const char *filename, int file_type_subtype, int encap,
+				int snaplen, wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdr, idb_inf, err);
 	if (wdh == NULL)
 		return NULL;
 
 	/* "-" means stdout */
 	if (strcmp(filename, "-") == 0) {
-		if (compressed) {
+		if (compression_type != WTAP_UNCOMPRESSED) {
 			*err = EINVAL;	/* XXX - return a Wiretap error code for this */
 			g_free(wdh);
 			return NULL;	/* compress won't work on stdout */
@@ -1815,7 +1837,7 @@ wtap_dumper* wtap_dump_open_ng(const char *filename, int file_type_subtype, int
 		wdh->fh = fh;
 	}
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		/* Get rid of the file we created; we couldn't finish
 		   opening it. */
 		if (wdh->fh != stdout) {
@@ -1836,17 +1858,24 @@ wtap_dumper* wtap_dump_fdopen(int fd, int file_type_subtype, int encap, int snap
 
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int snaplen,
 				gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
+{
+	return wtap_dump_fdopen_compressed(fd, file_type_subtype, encap, snaplen,
+	    compressed ? WTAP_GZIP_COMPRESSED : WTAP_UNCOMPRESSED, shb_hdr, idb_inf, err);
+}
+
+wtap_dumper* wtap_dump_fdopen_compressed(int fd, int file_type_subtype, int encap, int snaplen,
+				wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err)
 {
 	wtap_dumper *wdh;
 	WFILE_T fh;
 
 	/* Check whether we can open a capture file with that file type
 	   and that encapsulation. */
-	if (!wtap_dump_open_check(file_type_subtype, encap, compressed, err))
+	if (!wtap_dump_open_check(file_type_subtype, encap, compression_type, err))
 		return NULL;
 
 	/* Allocate and initialize a data structure for the output stream. */
-	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compressed,
+	wdh = wtap_dump_init_dumper(file_type_subtype, encap, snaplen, compression_type,
 	    shb_hdr, idb_inf, err);
 	if (wdh == NULL)
 		return NULL;
@@ -1873,7 +1902,7 @@ wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int s
 	}
 	wdh->fh = fh;
 
-	if (!wtap_dump_open_finish(wdh, file_type_subtype, compressed, err)) {
+	if (!wtap_dump_open_finish(wdh, file_type_subtype, compression_type, err)) {
 		wtap_dump_file_close(wdh);
 		g_free(wdh);
 		return NULL;
@@ -1881,7 +1910,7 @@ wtap_dumper* wtap_dump_fdopen_ng(int fd, int file_type_subtype, int encap, int s
 	return wdh;
 }
 
-static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean compressed, int *err)
+static gboolean wtap_dump_open_check(int file_type_subtype, int encap, wtap_compression_type compression_type, int *err)
 {
 	if (!wtap_dump_can_open(file_type_subtype)) {
 		/* Invalid type, or type we don't know how to write. */
@@ -1895,8 +1924,10 @@ static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean
 	if (*err != 0)
 		return FALSE;
 
-	/* if compression is wanted, do we support this for this file_type_subtype? */
-	if(compressed && !wtap_dump_can_compress(file_type_subtype)) {
+	/* if compression is wanted, do we support it, and this file_type_subtype? */
+	if (compression_type != WTAP_UNCOMPRESSED &&
+	    (!wtap_compression_type_supported(compression_type) ||
+	     !wtap_dump_can_compress(file_type_subtype))) {
 		*err = WTAP_ERR_COMPRESSION_NOT_SUPPORTED;
 		return FALSE;
 	}
@@ -1910,7 +1941,7 @@ static gboolean wtap_dump_open_check(int file_type_subtype, int encap, gboolean
 }
 
 static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int snaplen,
-					gboolean compressed, int *err)
+					wtap_compression_type compression_type, int *err)
 {
 	wtap_dumper *wdh;
 
@@ -1923,18 +1954,18 @@ static wtap_dumper* wtap_dump_alloc_wdh(int file_type_subtype, int encap, int sn
 	wdh->file_type_subtype = file_type_subtype;
 	wdh->snaplen = snaplen;
 	wdh->encap = encap;
-	wdh->compressed = compressed;
+	wdh->compression_type = compression_type;
 	return wdh;
 }
 
-static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, gboolean compressed, int *err)
+static gboolean wtap_dump_open_finish(wtap_dumper *wdh, int file_type_subtype, wtap_compression_type compression_type, int *err)
 {
 	int fd;
 	gboolean cant_seek;
 
 	/* Can we do a seek on the file descriptor?
 	   If not, note that fact. */
-	if(compressed) {
+	if(compression_type != WTAP_UNCOMPRESSED) {
 		cant_seek = TRUE;
 	} else {
 		fd = fileno((FILE *)wdh->fh);
@@ -1969,9 +2000,9 @@ gboolean wtap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
 
 void wtap_dump_flush(wtap_dumper *wdh)
 {
-#ifdef HAVE_LIBZ
-	if(wdh->compressed) {
-		gzwfile_flush((GZWFILE_T)wdh->fh);
+#ifdef HAVE_COMPRESSED_WRITERS
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		cwfile_flush((CWFILE_T)wdh->fh);
 	} else
 #endif
 	{
@@ -2031,11 +2062,11 @@ gboolean wtap_dump_set_addrinfo_list(wtap_dumper *wdh, addrinfo_lists_t *addrinf
 }
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_LIBZ
+#ifdef HAVE_COMPRESSED_WRITERS
 static WFILE_T wtap_dump_file_open(wtap_dumper *wdh, const char *filename)
 {
-	if(wdh->compressed) {
-		return gzwfile_open(filename);
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		return cwfile_open(filename, wdh->compression_type);
 	} else {
 		return ws_fopen(filename, "wb");
 	}
@@ -2048,11 +2079,11 @@ static WFILE_T wtap_dump_file_open(wtap_dumper *wdh _U_, const char *filename)
 #endif
 
 /* internally open a file for writing (compressed or not) */
-#ifdef HAVE_LIBZ
+#ifdef HAVE_COMPRESSED_WRITERS
 static WFILE_T wtap_dump_file_fdopen(wtap_dumper *wdh, int fd)
 {
-	if(wdh->compressed) {
-		return gzwfile_fdopen(fd);
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		return cwfile_fdopen(fd, wdh->compression_type);
 	} else {
 		return fdopen(fd, "wb");
 	}
@@ -2070,14 +2101,14 @@ gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
 {
 	size_t nwritten;
 
-#ifdef HAVE_LIBZ
-	if (wdh->compressed) {
-		nwritten = gzwfile_write((GZWFILE_T)wdh->fh, buf, (unsigned) bufsize);
+#ifdef HAVE_COMPRESSED_WRITERS
+	if (wdh->compression_type != WTAP_UNCOMPRESSED) {
+		nwritten = cwfile_write((CWFILE_T)wdh->fh, buf, (unsigned) bufsize);
 		/*
-		 * gzwfile_write() returns 0 on error.
+		 * cwfile_write() returns 0 on error.
 		 */
 		if (nwritten == 0) {
-			*err = gzwfile_geterr((GZWFILE_T)wdh->fh);
+			*err = cwfile_geterr((CWFILE_T)wdh->fh);
 			return FALSE;
 		}
 	} else
@@ -2102,9 +2133,9 @@ gboolean wtap_dump_file_write(wtap_dumper *wdh, const void *buf, size_t bufsize,
 /* internally close a file for writing (compressed or not) */
 static int wtap_dump_file_close(wtap_dumper *wdh)
 {
-#ifdef HAVE_LIBZ
-	if(wdh->compressed) {
-		return gzwfile_close((GZWFILE_T)wdh->fh);
+#ifdef HAVE_COMPRESSED_WRITERS
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
+		return cwfile_close((CWFILE_T)wdh->fh);
 	} else
 #endif
 	{
@@ -2114,8 +2145,8 @@ static int wtap_dump_file_close(wtap_dumper *wdh)
 
 gint64 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err)
 {
-#ifdef HAVE_LIBZ
-	if(wdh->compressed) {
+#ifdef HAVE_COMPRESSED_WRITERS
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
@@ -2133,8 +2164,8 @@ gint64 wtap_dump_file_seek(wtap_dumper *wdh, gint64 offset, int whence, int *err
 gint64 wtap_dump_file_tell(wtap_dumper *wdh, int *err)
 {
 	gint64 rval;
-#ifdef HAVE_LIBZ
-	if(wdh->compressed) {
+#ifdef HAVE_COMPRESSED_WRITERS
+	if(wdh->compression_type != WTAP_UNCOMPRESSED) {
 		*err = WTAP_ERR_CANT_SEEK_COMPRESSED;
 		return -1;
 	} else
@@ -53,6 +53,12 @@
 #include <fcntl.h>
 #endif /* HAVE_FCNTL_H */
 #include <string.h>
+#ifdef HAVE_MMAP
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif /* HAVE_SYS_TYPES_H */
+#include <sys/mman.h>
+#endif /* HAVE_MMAP */
 #include "wtap-int.h"
 #include "file_wrappers.h"
 #include <wsutil/file_util.h>
@@ -61,8 +67,37 @@
 #include <zlib.h>
 #endif /* HAVE_LIBZ */
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif /* HAVE_ZSTD */
+
+#ifdef HAVE_LZ4
+#include <lz4frame.h>
+#endif /* HAVE_LZ4 */
+
 /*
- * See RFC 1952 for a description of the gzip file format.
+ * Visual C++ on Win32 systems doesn't define this.
+ */
+#ifndef S_ISREG
+#define S_ISREG(mode)   (((mode) & S_IFMT) == S_IFREG)
+#endif
+
+/*
+ * Once a gzipped file's seek points are all known, threads can decompress
+ * the data between them ahead of the reader.  They read with pread(), so
+ * as not to move the reader's file descriptor, so it's UN*X-only.
+ */
+#if defined(HAVE_LIBZ) && defined(Z_BLOCK) && !defined(_WIN32)
+#define HAVE_PARALLEL_INFLATE
+#endif
+
+/*
+ * See RFC 1952 for a description of the gzip file format, RFC 8878 for
+ * the Zstandard format, and
+ *
+ *	https://github.com/lz4/lz4/blob/dev/doc/lz4_Frame_format.md
+ *
+ * for the LZ4 frame format.
  *
  * Some other compressed file formats we might want to support:
  *
@@ -80,6 +115,12 @@
 static const char *compressed_file_extensions[] = {
 #ifdef HAVE_LIBZ
 	"gz",
+#endif
+#ifdef HAVE_ZSTD
+	"zst",
+#endif
+#ifdef HAVE_LZ4
+	"lz4",
 #endif
 	NULL
 };
@@ -102,17 +143,87 @@ wtap_get_compressed_file_extensions(void)
 	return extensions;
 }
 
+/*
+ * Names of the compression types we can write, for command-line options.
+ */
+static const struct {
+	const char *name;
+	wtap_compression_type type;
+} compression_type_names[] = {
+	{ "none", WTAP_UNCOMPRESSED },
+#ifdef HAVE_LIBZ
+	{ "gzip", WTAP_GZIP_COMPRESSED },
+#endif
+#ifdef HAVE_ZSTD
+	{ "zstd", WTAP_ZSTD_COMPRESSED },
+#endif
+#ifdef HAVE_LZ4
+	{ "lz4", WTAP_LZ4_COMPRESSED },
+#endif
+	{ NULL, WTAP_UNCOMPRESSED }
+};
+
+gboolean
+wtap_compression_type_supported(wtap_compression_type compression_type)
+{
+	int i;
+
+	for (i = 0; compression_type_names[i].name != NULL; i++) {
+		if (compression_type_names[i].type == compression_type)
+			return TRUE;
+	}
+	return FALSE;
+}
+
+gboolean
+wtap_name_to_compression_type(const char *name,
+    wtap_compression_type *compression_type)
+{
+	int i;
+
+	for (i = 0; compression_type_names[i].name != NULL; i++) {
+		if (g_ascii_strcasecmp(compression_type_names[i].name, name) == 0) {
+			*compression_type = compression_type_names[i].type;
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+/*
+ * The data pointers all point to items in compression_type_names[],
+ * so the GSList can just be freed with g_slist_free().
+ */
+GSList *
+wtap_get_compression_type_names(void)
+{
+	GSList *names;
+	int i;
+
+	names = NULL;
+	for (i = 0; compression_type_names[i].name != NULL; i++)
+		names = g_slist_append(names, (gpointer)compression_type_names[i].name);
+	return names;
+}
+
 /* #define GZBUFSIZE 8192 */
 #define GZBUFSIZE 4096
 
-/* values for wtap_reader compression */
+/* values for wtap_reader compression; they're saved with seek points,
+   so they're the same whatever we're built with */
 typedef enum {
-	UNKNOWN,	/* unknown - look for a gzip header */
-	UNCOMPRESSED,	/* uncompressed - copy input directly */
+	UNKNOWN = 0,	/* unknown - look for a gzip, Zstandard or LZ4 header */
 #ifdef HAVE_LIBZ
-	ZLIB,		/* decompress a zlib stream */
-	GZIP_AFTER_HEADER
+	ZLIB = 2,	/* decompress a zlib stream */
+	GZIP_AFTER_HEADER = 3,
 #endif
+#ifdef HAVE_ZSTD
+	ZSTD = 4,	/* decompress a Zstandard frame */
+#endif
+#ifdef HAVE_LZ4
+	LZ4 = 5,	/* decompress an LZ4 frame */
+#endif
+	UNCOMPRESSED = 1	/* uncompressed - copy input directly */
 } compression_t;
 
 struct wtap_reader {
@@ -143,10 +254,34 @@ struct wtap_reader {
 	/* zlib inflate stream */
 	z_stream strm;             /* stream structure in-place (not a pointer) */
 	gboolean dont_check_crc;   /* TRUE if we aren't supposed to check the CRC */
+#endif
+#ifdef HAVE_ZSTD
+	ZSTD_DStream *zstd;        /* Zstandard decompression stream, or NULL */
+#endif
+#ifdef HAVE_LZ4
+	LZ4F_decompressionContext_t lz4; /* LZ4 decompression context, or NULL */
 #endif
 	/* fast seeking */
 	GPtrArray *fast_seek;
 	void *fast_seek_cur;
+	unsigned char *out_buf;    /* the output buffer we allocated; out points into the map while uncompressed data comes from there */
+#ifdef HAVE_MMAP
+	/* uncompressed files mapped in */
+	unsigned char *map;        /* the file, if it's mapped in */
+	gint64 map_len;            /* how much of it is mapped */
+	gboolean map_tried;        /* TRUE if we've tried to map it */
+	gboolean random;           /* TRUE if it's being read at random */
+#endif
+	/* seek points kept between runs */
+	gchar *fast_seek_cache;    /* where to save them when we're closed, or NULL */
+	gboolean own_fast_seek;    /* TRUE if we allocated fast_seek to load or collect them in */
+	gboolean fast_seek_complete; /* TRUE if they were loaded, and so cover the whole file */
+	gboolean read_to_end;      /* TRUE if we've read to the end of the compressed data */
+#ifdef HAVE_PARALLEL_INFLATE
+	/* decompression threads */
+	struct par_inflate *par;   /* the threads, if they're running */
+	gint64 par_resume;         /* don't start them again before this position */
+#endif
 };
 
 static int	/* gz_load */
@@ -185,6 +320,103 @@ fill_in_buffer(FILE_T state)
 	return 0;
 }
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+/* Get at least n bytes into the input buffer, keeping what's there, unless
+   the file ends first; n must be less than the buffer size. */
+static int
+fill_in_buffer_to(FILE_T state, guint n)
+{
+	guint got;
+
+	if (state->err)
+		return -1;
+	if (state->avail_in >= n || state->eof)
+		return 0;
+	if (state->avail_in != 0 && state->next_in != state->in)
+		memmove(state->in, state->next_in, state->avail_in);
+	state->next_in = state->in;
+	if (raw_read(state, state->in + state->avail_in,
+	    state->size - state->avail_in, &got) == -1)
+		return -1;
+	state->avail_in += got;
+	return 0;
+}
+#endif
+
+#ifdef HAVE_MMAP
+/*
+ * Uncompressed files that are big enough are mapped in, and read from the
+ * map, in windows no bigger than an unsigned int can count, rather than
+ * read() into the output buffer; the data can then be handed out without
+ * being copied at all, with file_read_in_place().
+ *
+ * Only what's there when the map is made is mapped; anything added to the
+ * file after that, as when it's being written by a capture, is read with
+ * read(), as are files that can't be mapped.  (If a file is cut short while
+ * it's mapped, reading what was cut off gets a SIGBUS; files being read
+ * are only appended to, not truncated.)
+ */
+#define MAP_MIN_SIZE	(1024 * 1024)
+#define MAP_WINDOW	(1024 * 1024 * 1024)
+
+static void
+map_advise(FILE_T state)
+{
+#if defined(MADV_SEQUENTIAL) && defined(MADV_RANDOM)
+	/* Sequential reads get more readahead; random ones none */
+	(void)madvise(state->map, (size_t)state->map_len,
+	    state->random ? MADV_RANDOM : MADV_SEQUENTIAL);
+#endif
+}
+
+static void
+map_file(FILE_T state)
+{
+	ws_statb64 statb;
+	void *map;
+
+	state->map_tried = TRUE;
+	if (state->is_compressed)
+		return;
+	if (ws_fstat64(state->fd, &statb) == -1 || !S_ISREG(statb.st_mode))
+		return;
+	if (statb.st_size < MAP_MIN_SIZE || (guint64)statb.st_size > G_MAXSIZE)
+		return;
+
+	map = mmap(NULL, (size_t)statb.st_size, PROT_READ, MAP_SHARED,
+	    state->fd, 0);
+	if (map == MAP_FAILED)
+		return;
+	state->map = (unsigned char *)map;
+	state->map_len = statb.st_size;
+	map_advise(state);
+}
+
+/* Hand out the next window of the map as the output buffer */
+static gboolean
+map_window(FILE_T state)
+{
+	gint64 left;
+
+	if (!state->map_tried)
+		map_file(state);
+	if (state->map == NULL || state->raw_pos >= state->map_len)
+		return FALSE;
+
+	/* The descriptor is kept where the data we've handed out ends,
+	   as file_seek() and raw_read() expect */
+	left = state->map_len - state->raw_pos;
+	if (ws_lseek64(state->fd, state->raw_pos + (left > MAP_WINDOW ? MAP_WINDOW : left), SEEK_SET) == -1)
+		return FALSE;
+
+	state->have = left > MAP_WINDOW ? MAP_WINDOW : (guint)left;
+	state->out = state->map + state->raw_pos;
+	state->next = state->out;
+	state->raw_pos += state->have;
+	return TRUE;
+}
+#endif
+
 #define ZLIB_WINSIZE 32768
 
 struct fast_seek_point {
@@ -572,10 +804,589 @@ zlib_read(FILE_T state, unsigned char *buf, unsigned int count)
 		state->compression = UNKNOWN;      /* ready for next stream, once have is 0 */
 		g_free(state->fast_seek_cur);
 		state->fast_seek_cur = NULL;
+
+		/* if that was the last of the file, the seek points cover it */
+		if (state->err == 0 && state->eof && state->avail_in == 0)
+			state->read_to_end = TRUE;
+	}
+}
+#endif
+
+#ifdef HAVE_ZSTD
+static int
+zstd_reset(FILE_T state)
+{
+	if (state->zstd == NULL) {
+		state->zstd = ZSTD_createDStream();
+		if (state->zstd == NULL) {
+			state->err = ENOMEM;
+			state->err_info = NULL;
+			return -1;
+		}
+	}
+	if (ZSTD_isError(ZSTD_initDStream(state->zstd))) {
+		/* This "shouldn't happen". */
+		state->err = WTAP_ERR_INTERNAL;
+		state->err_info = NULL;
+		return -1;
 	}
+	return 0;
+}
+
+/* Decompress up to the end of a Zstandard frame.  The decoder can hold
+   on to output after it's taken all the input, so, if we hit the end of
+   the file in the middle of a frame, we clear eof so that we get called
+   again for the rest, and only report a short read if there's no more. */
+static void
+zstd_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+	ZSTD_inBuffer input;
+	ZSTD_outBuffer output;
+	size_t ret = 1, before;
+
+	output.dst = buf;
+	output.size = count;
+	output.pos = 0;
+
+	do {
+		if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+			break;
+
+		input.src = state->next_in;
+		input.size = state->avail_in;
+		input.pos = 0;
+		before = output.pos;
+		ret = ZSTD_decompressStream(state->zstd, &output, &input);
+		state->next_in += input.pos;
+		state->avail_in -= (guint)input.pos;
+		if (ZSTD_isError(ret)) {
+			state->err = WTAP_ERR_DECOMPRESS;
+			state->err_info = ZSTD_getErrorName(ret);
+			break;
+		}
+		if (input.pos == 0 && output.pos == before) {
+			if (state->avail_in == 0 && state->eof) {
+				state->err = WTAP_ERR_SHORT_READ;
+				state->err_info = NULL;
+			}
+			break;
+		}
+	} while (output.pos < output.size && ret != 0);
+
+	state->next = buf;
+	state->have = (guint)output.pos;
+
+	if (ret == 0) {
+		state->compression = UNKNOWN;      /* ready for the next frame, once have is 0 */
+		if (state->err == 0 && state->eof && state->avail_in == 0)
+			state->read_to_end = TRUE;
+	} else if (state->err == 0 && state->eof && state->avail_in == 0)
+		state->eof = FALSE;
 }
 #endif
 
+#ifdef HAVE_LZ4
+static int
+lz4_reset(FILE_T state)
+{
+	if (state->lz4 == NULL) {
+		if (LZ4F_isError(LZ4F_createDecompressionContext(&state->lz4, LZ4F_VERSION))) {
+			state->lz4 = NULL;
+			state->err = ENOMEM;
+			state->err_info = NULL;
+			return -1;
+		}
+	} else
+		LZ4F_resetDecompressionContext(state->lz4);
+	return 0;
+}
+
+/* Decompress up to the end of an LZ4 frame; as with Zstandard, there can
+   be output left after all the input's been taken. */
+static void
+lz4_read(FILE_T state, unsigned char *buf, unsigned int count)
+{
+	size_t in_len, out_len, ret = 1;
+	unsigned int have = 0;
+
+	do {
+		if (state->avail_in == 0 && fill_in_buffer(state) == -1)
+			break;
+
+		in_len = state->avail_in;
+		out_len = count - have;
+		ret = LZ4F_decompress(state->lz4, buf + have, &out_len,
+		    state->next_in, &in_len, NULL);
+		state->next_in += in_len;
+		state->avail_in -= (guint)in_len;
+		have += (unsigned int)out_len;
+		if (LZ4F_isError(ret)) {
+			state->err = WTAP_ERR_DECOMPRESS;
+			state->err_info = LZ4F_getErrorName(ret);
+			break;
+		}
+		if (in_len == 0 && out_len == 0) {
+			if (state->avail_in == 0 && state->eof) {
+				state->err = WTAP_ERR_SHORT_READ;
+				state->err_info = NULL;
+			}
+			break;
+		}
+	} while (have < count && ret != 0);
+
+	state->next = buf;
+	state->have = have;
+
+	if (ret == 0) {
+		state->compression = UNKNOWN;      /* ready for the next frame, once have is 0 */
+		if (state->err == 0 && state->eof && state->avail_in == 0)
+			state->read_to_end = TRUE;
+	} else if (state->err == 0 && state->eof && state->avail_in == 0)
+		state->eof = FALSE;
+}
+#endif
+
+/* Go to a seek point, and arrange to skip from there to target */
+static gint64
+seek_to_point(FILE_T file, struct fast_seek_point *here, gint64 target, int *err)
+{
+	gint64 off, off2, offset;
+
+#ifdef HAVE_LIBZ
+	if (here->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+		off = here->in - (here->data.zlib.bits ? 1 : 0);
+#else
+		off = here->in;
+#endif
+		off2 = here->out;
+	} else if (here->compression == GZIP_AFTER_HEADER) {
+		off = here->in;
+		off2 = here->out;
+	} else
+#endif
+#ifdef HAVE_ZSTD
+	if (here->compression == ZSTD) {
+		off = here->in;
+		off2 = here->out;
+	} else
+#endif
+#ifdef HAVE_LZ4
+	if (here->compression == LZ4) {
+		off = here->in;
+		off2 = here->out;
+	} else
+#endif
+	{
+		off2 = target;
+		off = here->in + (off2 - here->out);
+	}
+
+	if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
+		*err = errno;
+		return -1;
+	}
+	fast_seek_reset(file);
+
+	file->raw_pos = off;
+	file->have = 0;
+	file->eof = FALSE;
+	file->seek_pending = FALSE;
+	file->err = 0;
+	file->err_info = NULL;
+	file->avail_in = 0;
+
+#ifdef HAVE_LIBZ
+	if (here->compression == ZLIB) {
+		z_stream *strm = &file->strm;
+
+		inflateReset(strm);
+		strm->adler = here->data.zlib.adler;
+		strm->total_out = here->data.zlib.total_out;
+#ifdef HAVE_INFLATEPRIME
+		if (here->data.zlib.bits) {
+			FILE_T state = file;
+			int ret = GZ_GETC();
+
+			if (ret == -1) {
+				if (state->err == 0) {
+					/* EOF */
+					*err = WTAP_ERR_SHORT_READ;
+				} else
+					*err = state->err;
+				return -1;
+			}
+			(void)inflatePrime(strm, here->data.zlib.bits, ret >> (8 - here->data.zlib.bits));
+		}
+#endif
+		(void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
+		file->compression = ZLIB;
+	} else if (here->compression == GZIP_AFTER_HEADER) {
+		z_stream *strm = &file->strm;
+
+		inflateReset(strm);
+		strm->adler = crc32(0L, Z_NULL, 0);
+		file->compression = ZLIB;
+	} else
+#endif
+#ifdef HAVE_ZSTD
+	if (here->compression == ZSTD) {
+		if (zstd_reset(file) == -1) {
+			*err = file->err;
+			return -1;
+		}
+		file->compression = ZSTD;
+	} else
+#endif
+#ifdef HAVE_LZ4
+	if (here->compression == LZ4) {
+		if (lz4_reset(file) == -1) {
+			*err = file->err;
+			return -1;
+		}
+		file->compression = LZ4;
+	} else
+#endif
+		file->compression = here->compression;
+
+	offset = target - off2;
+	file->pos = off2;
+
+	if (offset) {
+		file->seek_pending = TRUE;
+		file->skip = offset;
+	}
+	return file->pos + offset;
+}
+
+#ifdef HAVE_PARALLEL_INFLATE
+/*
+ * The data between each seek point and the next is a chunk that can be
+ * decompressed on its own, from the window saved with the seek point, so,
+ * when a file's seek points were all loaded from the cache, the sequential
+ * reader hands chunks to threads to decompress, a few ahead of where it's
+ * reading, and puts them back in order as they come back.
+ *
+ * The gzip trailers aren't checked in the chunks the threads do; they were
+ * checked when the file was read to make the seek points.
+ *
+ * The threads only do chunks up to the last seek point, or to any data
+ * after the gzip data that isn't compressed, and a seek backwards, or far
+ * forwards, stops them; in both cases we go back to decompressing it
+ * ourselves.
+ */
+#define PAR_MAX_THREADS	4
+#define PAR_INBUFSIZE	65536
+#define PAR_MAX_CHUNK	(64 * 1024 * 1024)
+
+typedef struct {
+	guint idx;                 /* the seek point it starts at */
+	unsigned char *data;
+	guint len;
+	gboolean ok;               /* TRUE if all of it was decompressed */
+} par_chunk_t;
+
+struct par_inflate {
+	int fd;
+	struct fast_seek_point **points; /* a copy of the seek points */
+	guint end;                 /* the threads do the chunks before this one */
+	guint next;                /* the next chunk to hand out */
+	guint queued;              /* the next chunk to give the threads */
+	guint window;              /* how far ahead of next the threads go */
+	par_chunk_t **ready;       /* chunks done but not handed out, by idx % window */
+	par_chunk_t *cur;          /* the chunk being handed out */
+	GAsyncQueue *todo;         /* chunks for the threads to do */
+	GAsyncQueue *done;         /* chunks they've done */
+	GThread *threads[PAR_MAX_THREADS];
+	guint num_threads;
+	volatile gint stopping;
+};
+
+/* Tells a thread to finish */
+static par_chunk_t par_quit;
+
+static void
+par_chunk_free(par_chunk_t *chunk)
+{
+	if (chunk != NULL) {
+		g_free(chunk->data);
+		g_free(chunk);
+	}
+}
+
+/* Decompress the data from one seek point to the next */
+static void
+par_inflate_chunk(struct par_inflate *par, z_streamp strm, unsigned char *in,
+    par_chunk_t *chunk)
+{
+	struct fast_seek_point *here = par->points[chunk->idx];
+	guint want = (guint)(par->points[chunk->idx + 1]->out - here->out);
+	gint64 raw_pos = here->in;
+	ssize_t n;
+	int ret = Z_OK;
+
+	chunk->data = (unsigned char *)g_try_malloc(want);
+	if (chunk->data == NULL)
+		return;
+
+	inflateReset(strm);
+	strm->avail_in = 0;
+	if (here->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+		if (here->data.zlib.bits) {
+			if (pread(par->fd, in, 1, here->in - 1) != 1)
+				return;
+			(void)inflatePrime(strm, here->data.zlib.bits, in[0] >> (8 - here->data.zlib.bits));
+		}
+#endif
+		(void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
+	}
+
+	strm->next_out = chunk->data;
+	strm->avail_out = want;
+	while (strm->avail_out != 0 && ret == Z_OK) {
+		if (strm->avail_in == 0) {
+			n = pread(par->fd, in, PAR_INBUFSIZE, raw_pos);
+			if (n <= 0)
+				break;
+			raw_pos += n;
+			strm->next_in = in;
+			strm->avail_in = (uInt)n;
+		}
+		ret = inflate(strm, Z_NO_FLUSH);
+	}
+	chunk->len = want - strm->avail_out;
+	chunk->ok = (chunk->len == want);
+}
+
+static gpointer
+par_thread(gpointer data)
+{
+	struct par_inflate *par = (struct par_inflate *)data;
+	z_stream strm;
+	gboolean strm_ok;
+	unsigned char *in;
+	par_chunk_t *chunk;
+
+	strm.zalloc = Z_NULL;
+	strm.zfree = Z_NULL;
+	strm.opaque = Z_NULL;
+	strm.avail_in = 0;
+	strm.next_in = Z_NULL;
+	strm_ok = (inflateInit2(&strm, -15) == Z_OK);    /* raw inflate */
+	in = (unsigned char *)g_try_malloc(PAR_INBUFSIZE);
+
+	for (;;) {
+		chunk = (par_chunk_t *)g_async_queue_pop(par->todo);
+		if (chunk == &par_quit)
+			break;
+		if (g_atomic_int_get(&par->stopping)) {
+			par_chunk_free(chunk);
+			continue;
+		}
+		/* if we couldn't set up, the reader will find it not ok,
+		   and decompress it itself */
+		if (strm_ok && in != NULL)
+			par_inflate_chunk(par, &strm, in, chunk);
+		g_async_queue_push(par->done, chunk);
+	}
+
+	if (strm_ok)
+		inflateEnd(&strm);
+	g_free(in);
+	return NULL;
+}
+
+/* Give the threads chunks to do, up to window ahead of the reader */
+static void
+par_queue(struct par_inflate *par)
+{
+	par_chunk_t *chunk;
+
+	while (par->queued < par->end && par->queued < par->next + par->window) {
+		chunk = g_new0(par_chunk_t, 1);
+		chunk->idx = par->queued++;
+		g_async_queue_push(par->todo, chunk);
+	}
+}
+
+static guint
+par_num_threads(void)
+{
+	long n;
+
+#if GLIB_CHECK_VERSION(2,36,0)
+	n = (long)g_get_num_processors();
+#elif defined(_SC_NPROCESSORS_ONLN)
+	n = sysconf(_SC_NPROCESSORS_ONLN);
+#else
+	n = 1;
+#endif
+	/* leave one for the reader */
+	n--;
+	if (n < 1)
+		return 0;
+	return n > PAR_MAX_THREADS ? PAR_MAX_THREADS : (guint)n;
+}
+
+/*
+ * Stop the threads; if resync is TRUE, start decompressing ourselves
+ * from where the reader has got to.
+ */
+static void
+par_stop(FILE_T state, gboolean resync)
+{
+	struct par_inflate *par = state->par;
+	par_chunk_t *chunk;
+	guint i;
+	int err;
+
+	g_atomic_int_set(&par->stopping, 1);
+	for (i = 0; i < par->num_threads; i++)
+		g_async_queue_push(par->todo, &par_quit);
+	for (i = 0; i < par->num_threads; i++)
+		g_thread_join(par->threads[i]);
+	while ((chunk = (par_chunk_t *)g_async_queue_try_pop(par->done)) != NULL)
+		par_chunk_free(chunk);
+	for (i = 0; i < par->window; i++)
+		par_chunk_free(par->ready[i]);
+	par_chunk_free(par->cur);
+	g_async_queue_unref(par->todo);
+	g_async_queue_unref(par->done);
+	g_free(par->ready);
+	g_free(par->points);
+	g_free(par);
+	state->par = NULL;
+
+	state->out = state->out_buf;
+	state->next = state->out;
+	state->have = 0;
+	state->par_resume = state->pos + 2 * SPAN;
+	if (resync &&
+	    seek_to_point(state, fast_seek_find(state, state->pos), state->pos, &err) == -1) {
+		state->err = err;
+		state->err_info = NULL;
+	}
+}
+
+static gboolean
+par_start(FILE_T state)
+{
+	struct par_inflate *par;
+	struct fast_seek_point **points;
+	guint num_points, low, high, mid, end, num_threads, i;
+
+	if (!state->fast_seek_complete || state->pos < state->par_resume)
+		return FALSE;
+#if !GLIB_CHECK_VERSION(2,31,0)
+	if (!g_thread_supported())
+		return FALSE;
+#endif
+	num_threads = par_num_threads();
+	if (num_threads == 0)
+		return FALSE;
+
+	/* find the chunk we're in */
+	points = (struct fast_seek_point **)state->fast_seek->pdata;
+	num_points = state->fast_seek->len;
+	low = 0;
+	high = num_points;
+	while (high - low > 1) {
+		mid = (low + high) / 2;
+		if (points[mid]->out <= state->pos)
+			low = mid;
+		else
+			high = mid;
+	}
+	if (num_points == 0 || points[low]->out > state->pos)
+		return FALSE;
+
+	/* and how far the threads can go from there */
+	for (end = low; end + 1 < num_points; end++) {
+		if ((points[end]->compression != ZLIB &&
+		     points[end]->compression != GZIP_AFTER_HEADER) ||
+		    points[end + 1]->out - points[end]->out > PAR_MAX_CHUNK)
+			break;
+	}
+	if (end - low < 2)
+		return FALSE;
+
+	par = g_new0(struct par_inflate, 1);
+	par->fd = state->fd;
+	par->points = (struct fast_seek_point **)g_memdup(points, (end + 1) * (guint)sizeof *points);
+	par->end = end;
+	par->next = low;
+	par->queued = low;
+	par->window = 2 * num_threads;
+	par->ready = g_new0(par_chunk_t *, par->window);
+	par->todo = g_async_queue_new();
+	par->done = g_async_queue_new();
+	for (i = 0; i < num_threads; i++) {
+#if GLIB_CHECK_VERSION(2,31,0)
+		par->threads[i] = g_thread_new("Decompress", par_thread, par);
+#else
+		par->threads[i] = g_thread_create(par_thread, par, TRUE, NULL);
+		if (par->threads[i] == NULL)
+			break;
+#endif
+		par->num_threads++;
+	}
+	state->par = par;
+	if (par->num_threads == 0) {
+		par_stop(state, FALSE);
+		return FALSE;
+	}
+	par_queue(par);
+
+	/* what we'd have read ourselves no longer matters */
+	state->eof = FALSE;
+	state->avail_in = 0;
+	return TRUE;
+}
+
+/*
+ * Hand out the next chunk as the output buffer; returns FALSE if there
+ * isn't one, and we have to decompress what comes next ourselves.
+ */
+static gboolean
+par_fill_out_buffer(FILE_T state)
+{
+	struct par_inflate *par = state->par;
+	par_chunk_t *chunk;
+	guint skip;
+
+	if (par->next == par->end) {
+		par_stop(state, TRUE);
+		return FALSE;
+	}
+
+	/* put the chunks back in order as they come back */
+	while ((chunk = par->ready[par->next % par->window]) == NULL) {
+		chunk = (par_chunk_t *)g_async_queue_pop(par->done);
+		par->ready[chunk->idx % par->window] = chunk;
+	}
+	par->ready[par->next % par->window] = NULL;
+	if (!chunk->ok) {
+		/* find out what's wrong with it ourselves */
+		par_chunk_free(chunk);
+		par_stop(state, TRUE);
+		return FALSE;
+	}
+	par_chunk_free(par->cur);
+	par->cur = chunk;
+	par->next++;
+	par_queue(par);
+
+	/* the reader can be part of the way into the first one */
+	skip = (guint)(state->pos - par->points[chunk->idx]->out);
+	state->out = chunk->data;
+	state->next = state->out + skip;
+	state->have = chunk->len - skip;
+	state->raw_pos = par->points[chunk->idx + 1]->in;
+	return TRUE;
+}
+#endif /* HAVE_PARALLEL_INFLATE */
+
 static int
 gz_head(FILE_T state)
 {
@@ -583,10 +1394,49 @@ gz_head(FILE_T state)
 	if (state->avail_in == 0) {
 		if (fill_in_buffer(state) == -1)
 			return -1;
-		if (state->avail_in == 0)
+		if (state->avail_in == 0) {
+			/* the end of the file, right after a gzip trailer
+			   or the end of a Zstandard or LZ4 frame */
+			state->read_to_end = TRUE;
 			return 0;
+		}
 	}
 
+#if defined(HAVE_ZSTD) || defined(HAVE_LZ4)
+	/* look for the magic number of a Zstandard or LZ4 frame, or of a
+	   skippable frame, which both of them have */
+	if (fill_in_buffer_to(state, 4) == -1)
+		return -1;
+	if (state->avail_in >= 4) {
+		guint32 magic = pletoh32(state->next_in);
+		compression_t compression = UNKNOWN;
+
+#ifdef HAVE_ZSTD
+		if (magic == 0xFD2FB528 || (magic & 0xFFFFFFF0) == 0x184D2A50) {
+			if (zstd_reset(state) == -1)
+				return -1;
+			compression = ZSTD;
+		}
+#endif
+#ifdef HAVE_LZ4
+		if (compression == UNKNOWN &&
+		    (magic == 0x184D2204 || (magic & 0xFFFFFFF0) == 0x184D2A50)) {
+			if (lz4_reset(state) == -1)
+				return -1;
+			compression = LZ4;
+		}
+#endif
+		if (compression != UNKNOWN) {
+			/* each frame starts afresh, so they're all seek points */
+			state->compression = compression;
+			state->is_compressed = TRUE;
+			if (state->fast_seek)
+				fast_seek_header(state, state->raw_pos - state->avail_in, state->pos, compression);
+			return 0;
+		}
+	}
+#endif
+
 	/* look for the gzip magic header bytes 31 and 139 */
 #ifdef HAVE_LIBZ
 	if (state->next_in[0] == 31) {
@@ -710,13 +1560,26 @@ gz_head(FILE_T state)
 static int /* gz_make */
 fill_out_buffer(FILE_T state)
 {
+#ifdef HAVE_PARALLEL_INFLATE
+	if (state->par != NULL ||
+	    (state->compression == ZLIB && par_start(state))) {
+		if (par_fill_out_buffer(state))
+			return 0;
+	}
+#endif
 	if (state->compression == UNKNOWN) {           /* look for gzip header */
+		state->out = state->out_buf;
 		if (gz_head(state) == -1)
 			return -1;
 		if (state->have)                /* got some data from gz_head() */
 			return 0;
 	}
 	if (state->compression == UNCOMPRESSED) {           /* straight copy */
+#ifdef HAVE_MMAP
+		if (map_window(state))
+			return 0;
+#endif
+		state->out = state->out_buf;
 		if (raw_read(state, state->out, state->size /* << 1 */, &(state->have)) == -1)
 			return -1;
 		state->next = state->out;
@@ -725,6 +1588,16 @@ fill_out_buffer(FILE_T state)
 	else if (state->compression == ZLIB) {      /* decompress */
 		zlib_read(state, state->out, state->size << 1);
 	}
+#endif
+#ifdef HAVE_ZSTD
+	else if (state->compression == ZSTD) {
+		zstd_read(state, state->out, state->size << 1);
+	}
+#endif
+#ifdef HAVE_LZ4
+	else if (state->compression == LZ4) {
+		lz4_read(state, state->out, state->size << 1);
+	}
 #endif
 	return 0;
 }
@@ -798,6 +1671,20 @@ file_fdopen(int fd)
 
 	state->fast_seek_cur = NULL;
 	state->fast_seek = NULL;
+#ifdef HAVE_MMAP
+	state->map = NULL;
+	state->map_len = 0;
+	state->map_tried = FALSE;
+	state->random = FALSE;
+#endif
+	state->fast_seek_cache = NULL;
+	state->own_fast_seek = FALSE;
+	state->fast_seek_complete = FALSE;
+	state->read_to_end = FALSE;
+#ifdef HAVE_PARALLEL_INFLATE
+	state->par = NULL;
+	state->par_resume = 0;
+#endif
 
 	/* open the file with the appropriate mode (or just use fd) */
 	state->fd = fd;
@@ -831,6 +1718,7 @@ file_fdopen(int fd)
 	/* allocate buffers */
 	state->in = (unsigned char *)g_try_malloc(want);
 	state->out = (unsigned char *)g_try_malloc(want << 1);
+	state->out_buf = state->out;
 	state->size = want;
 	if (state->in == NULL || state->out == NULL) {
 		g_free(state->out);
@@ -857,6 +1745,13 @@ file_fdopen(int fd)
 
 	/* for now, assume we should check the crc */
 	state->dont_check_crc = FALSE;
+#endif
+#ifdef HAVE_ZSTD
+	/* the decompressors are set up when we find we need them */
+	state->zstd = NULL;
+#endif
+#ifdef HAVE_LZ4
+	state->lz4 = NULL;
 #endif
 	/* return stream */
 	return state;
@@ -873,51 +1768,300 @@ file_open(const char *path)
 
 	/* open file and do correct filename conversions.
 
-	   XXX - do we need O_LARGEFILE?  On UN*X, if we need to do
-	   something special to get large file support, the configure
-	   script should have set us up with the appropriate #defines,
-	   so we should be getting a large-file-enabled file descriptor
-	   here.  Pre-Large File Summit UN*Xes, and possibly even some
-	   post-LFS UN*Xes, might require O_LARGEFILE here, though.
-	   If so, we should probably handle that in ws_open(). */
-	if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
-		return NULL;
+	   XXX - do we need O_LARGEFILE?  On UN*X, if we need to do
+	   something special to get large file support, the configure
+	   script should have set us up with the appropriate #defines,
+	   so we should be getting a large-file-enabled file descriptor
+	   here.  Pre-Large File Summit UN*Xes, and possibly even some
+	   post-LFS UN*Xes, might require O_LARGEFILE here, though.
+	   If so, we should probably handle that in ws_open(). */
+	if ((fd = ws_open(path, O_RDONLY|O_BINARY, 0000)) == -1)
+		return NULL;
+
+	/* open file handle */
+	ft = file_fdopen(fd);
+	if (ft == NULL) {
+		ws_close(fd);
+		return NULL;
+	}
+
+#ifdef HAVE_LIBZ
+	/*
+	 * If this file's name ends in ".caz", it's probably a compressed
+	 * Windows Sniffer file.  The compression is gzip, but if we
+	 * process the CRC as specified by RFC 1952, the computed CRC
+	 * doesn't match the stored CRC.
+	 *
+	 * Compressed Windows Sniffer files don't all have the same CRC
+	 * value; is it just random crap, or are they running the CRC on
+	 * a different set of data than you're supposed to (e.g., not
+	 * CRCing some of the data), or something such as that?
+	 *
+	 * For now, we just set a flag to ignore CRC errors.
+	 */
+	suffixp = strrchr(path, '.');
+	if (suffixp != NULL) {
+		if (g_ascii_strcasecmp(suffixp, ".caz") == 0)
+			ft->dont_check_crc = TRUE;
+	}
+#endif
+
+	return ft;
+}
+
+void
+file_set_random_access(FILE_T stream, gboolean random_flag, GPtrArray *seek)
+{
+	stream->fast_seek = seek;
+#ifdef HAVE_MMAP
+	stream->random = random_flag;
+	if (stream->map != NULL)
+		map_advise(stream);
+#endif
+}
+
+/*
+ * The seek points of a compressed file can be kept in a file next to it,
+ * so that the next time it's opened they don't have to be found again by
+ * reading it all, and it can be decompressed by threads.  It's a cache on
+ * the machine that wrote it, so it's in that machine's byte order; it's
+ * only used if the compressed file's size and modification time are the
+ * same as when it was written.
+ *
+ * It's a header, then, for each seek point, a fast_seek_cache_point_t,
+ * followed, for ZLIB points, by the point's window, compressed.
+ */
+#define FAST_SEEK_CACHE_SUFFIX	".fsidx"
+#define FAST_SEEK_CACHE_MAGIC	"WTFSIDX"
+#define FAST_SEEK_CACHE_VERSION	1
+
+typedef struct {
+	char magic[8];
+	guint32 version;
+	guint32 num_points;
+	gint64 file_size;
+	gint64 file_mtime;
+} fast_seek_cache_header_t;
+
+typedef struct {
+	gint64 out;
+	gint64 in;
+	guint32 compression;
+	guint32 bits;
+	guint32 adler;
+	guint32 total_out;
+	guint32 window_len;        /* length of the compressed window, or 0 */
+	guint32 pad;
+} fast_seek_cache_point_t;
+
+#ifdef HAVE_LIBZ
+static gboolean
+fast_seek_cache_key(FILE_T state, gint64 *size, gint64 *mtime)
+{
+	ws_statb64 statb;
+
+	if (ws_fstat64(state->fd, &statb) == -1 || !S_ISREG(statb.st_mode))
+		return FALSE;
+	*size = statb.st_size;
+	*mtime = statb.st_mtime;
+	return TRUE;
+}
+
+static gboolean
+fast_seek_cache_load(FILE_T state, const char *cache_path)
+{
+	fast_seek_cache_header_t hdr;
+	fast_seek_cache_point_t rec;
+	struct fast_seek_point *val;
+	gint64 file_size, file_mtime;
+	FILE *fh;
+	unsigned char *zbuf;
+	uLong zbuf_len;
+	uLongf window_len;
+	guint32 i;
+	gboolean ok = FALSE;
+
+	if (!fast_seek_cache_key(state, &file_size, &file_mtime))
+		return FALSE;
+	fh = ws_fopen(cache_path, "rb");
+	if (fh == NULL)
+		return FALSE;
+
+	zbuf_len = compressBound(ZLIB_WINSIZE);
+	zbuf = (unsigned char *)g_malloc(zbuf_len);
+
+	/* anything that doesn't look right means it's for something else,
+	   and the points will be found, and it'll be written, again */
+	if (fread(&hdr, sizeof hdr, 1, fh) != 1 ||
+	    memcmp(hdr.magic, FAST_SEEK_CACHE_MAGIC, sizeof hdr.magic) != 0 ||
+	    hdr.version != FAST_SEEK_CACHE_VERSION ||
+	    hdr.file_size != file_size || hdr.file_mtime != file_mtime ||
+	    hdr.num_points == 0)
+		goto done;
+
+	for (i = 0; i < hdr.num_points; i++) {
+		if (fread(&rec, sizeof rec, 1, fh) != 1)
+			goto done;
+		/* fast_seek_find() needs them in order */
+		if (rec.in < 0 || rec.in > file_size || rec.out < 0 ||
+		    (i != 0 && rec.out <= ((struct fast_seek_point *)state->fast_seek->pdata[i - 1])->out))
+			goto done;
+
+		val = g_new(struct fast_seek_point, 1);
+		g_ptr_array_add(state->fast_seek, val);
+		val->in = rec.in;
+		val->out = rec.out;
+		switch (rec.compression) {
+
+		case UNCOMPRESSED:
+		case GZIP_AFTER_HEADER:
+#ifdef HAVE_ZSTD
+		case ZSTD:
+#endif
+#ifdef HAVE_LZ4
+		case LZ4:
+#endif
+			if (rec.window_len != 0)
+				goto done;
+			val->compression = (compression_t)rec.compression;
+			break;
+
+		case ZLIB:
+#ifdef HAVE_INFLATEPRIME
+			if (rec.bits > 7)
+				goto done;
+			val->data.zlib.bits = rec.bits;
+#else
+			if (rec.bits != 0)
+				goto done;
+#endif
+			if (rec.window_len == 0 || rec.window_len > zbuf_len ||
+			    fread(zbuf, 1, rec.window_len, fh) != rec.window_len)
+				goto done;
+			window_len = ZLIB_WINSIZE;
+			if (uncompress(val->data.zlib.window, &window_len, zbuf, rec.window_len) != Z_OK ||
+			    window_len != ZLIB_WINSIZE)
+				goto done;
+			val->compression = ZLIB;
+			val->data.zlib.adler = rec.adler;
+			val->data.zlib.total_out = rec.total_out;
+			break;
+
+		default:
+			goto done;
+		}
+	}
+	ok = TRUE;
 
-	/* open file handle */
-	ft = file_fdopen(fd);
-	if (ft == NULL) {
-		ws_close(fd);
-		return NULL;
+done:
+	if (!ok) {
+		for (i = 0; i < state->fast_seek->len; i++)
+			g_free(state->fast_seek->pdata[i]);
+		g_ptr_array_set_size(state->fast_seek, 0);
 	}
+	g_free(zbuf);
+	fclose(fh);
+	return ok;
+}
 
-#ifdef HAVE_LIBZ
-	/*
-	 * If this file's name ends in ".caz", it's probably a compressed
-	 * Windows Sniffer file.  The compression is gzip, but if we
-	 * process the CRC as specified by RFC 1952, the computed CRC
-	 * doesn't match the stored CRC.
-	 *
-	 * Compressed Windows Sniffer files don't all have the same CRC
-	 * value; is it just random crap, or are they running the CRC on
-	 * a different set of data than you're supposed to (e.g., not
-	 * CRCing some of the data), or something such as that?
-	 *
-	 * For now, we just set a flag to ignore CRC errors.
-	 */
-	suffixp = strrchr(path, '.');
-	if (suffixp != NULL) {
-		if (g_ascii_strcasecmp(suffixp, ".caz") == 0)
-			ft->dont_check_crc = TRUE;
+static void
+fast_seek_cache_save(FILE_T state)
+{
+	fast_seek_cache_header_t hdr;
+	fast_seek_cache_point_t rec;
+	struct fast_seek_point *point;
+	gchar *tmp_path;
+	FILE *fh;
+	unsigned char *zbuf;
+	uLongf zlen;
+	guint32 i;
+	gboolean ok;
+
+	memset(&hdr, 0, sizeof hdr);
+	memcpy(hdr.magic, FAST_SEEK_CACHE_MAGIC, sizeof hdr.magic);
+	hdr.version = FAST_SEEK_CACHE_VERSION;
+	hdr.num_points = state->fast_seek->len;
+	if (hdr.num_points == 0 ||
+	    !fast_seek_cache_key(state, &hdr.file_size, &hdr.file_mtime))
+		return;
+
+	/* written under another name and renamed, so that nobody reads
+	   half of it */
+	tmp_path = g_strconcat(state->fast_seek_cache, ".tmp", NULL);
+	fh = ws_fopen(tmp_path, "wb");
+	if (fh == NULL) {
+		g_free(tmp_path);
+		return;
 	}
+	zbuf = (unsigned char *)g_malloc(compressBound(ZLIB_WINSIZE));
+
+	ok = (fwrite(&hdr, sizeof hdr, 1, fh) == 1);
+	for (i = 0; ok && i < hdr.num_points; i++) {
+		point = (struct fast_seek_point *)state->fast_seek->pdata[i];
+		memset(&rec, 0, sizeof rec);
+		rec.out = point->out;
+		rec.in = point->in;
+		rec.compression = point->compression;
+		zlen = 0;
+		if (point->compression == ZLIB) {
+#ifdef HAVE_INFLATEPRIME
+			rec.bits = point->data.zlib.bits;
 #endif
+			rec.adler = point->data.zlib.adler;
+			rec.total_out = point->data.zlib.total_out;
+			zlen = compressBound(ZLIB_WINSIZE);
+			if (compress2(zbuf, &zlen, point->data.zlib.window, ZLIB_WINSIZE, Z_BEST_SPEED) != Z_OK) {
+				ok = FALSE;
+				break;
+			}
+			rec.window_len = (guint32)zlen;
+		}
+		ok = (fwrite(&rec, sizeof rec, 1, fh) == 1 &&
+		      (zlen == 0 || fwrite(zbuf, 1, zlen, fh) == zlen));
+	}
+	if (fclose(fh) == EOF)
+		ok = FALSE;
+	if (!ok || ws_rename(tmp_path, state->fast_seek_cache) != 0)
+		ws_unlink(tmp_path);
 
-	return ft;
+	g_free(zbuf);
+	g_free(tmp_path);
 }
+#endif /* HAVE_LIBZ */
 
+/*
+ * Keep the seek points of the file being read sequentially, if it's
+ * compressed, in a file next to it: load them now, if they're there,
+ * and, if they aren't, collect them as it's read, whether or not it's
+ * also open for random access, and save them when we're closed, if
+ * we've read it all.
+ */
 void
-file_set_random_access(FILE_T stream, gboolean random_flag _U_, GPtrArray *seek)
+file_set_fast_seek_cache(FILE_T stream, const char *path)
 {
-	stream->fast_seek = seek;
+#ifdef HAVE_LIBZ
+	gchar *cache_path;
+	gboolean own;
+
+	cache_path = g_strconcat(path, FAST_SEEK_CACHE_SUFFIX, NULL);
+	own = (stream->fast_seek == NULL);
+	if (own)
+		stream->fast_seek = g_ptr_array_new();
+	else if (stream->fast_seek->len != 0) {
+		g_free(cache_path);
+		return;
+	}
+
+	stream->own_fast_seek = own;
+	if (fast_seek_cache_load(stream, cache_path)) {
+		stream->fast_seek_complete = TRUE;
+		g_free(cache_path);
+	} else
+		stream->fast_seek_cache = cache_path;
+#else
+	(void)stream;
+	(void)path;
+#endif
 }
 
 gint64
@@ -970,87 +2114,21 @@ file_seek(FILE_T file, gint64 offset, int whence, int *err)
 		}
 	}
 
-	/* XXX, profile */
-	if ((here = fast_seek_find(file, file->pos + offset)) && (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED)) {
-		gint64 off, off2;
-
-#ifdef HAVE_LIBZ
-		if (here->compression == ZLIB) {
-#ifdef HAVE_INFLATEPRIME
-			off = here->in - (here->data.zlib.bits ? 1 : 0);
-#else
-			off = here->in;
-#endif
-			off2 = here->out;
-		} else if (here->compression == GZIP_AFTER_HEADER) {
-			off = here->in;
-			off2 = here->out;
-		} else
-#endif
-		{
-			off2 = (file->pos + offset);
-			off = here->in + (off2 - here->out);
-		}
-
-		if (ws_lseek64(file->fd, off, SEEK_SET) == -1) {
-			*err = errno;
-			return -1;
-		}
-		fast_seek_reset(file);
+#ifdef HAVE_PARALLEL_INFLATE
+	/* the threads are only any use going forward, a little at a time */
+	if (file->par != NULL && (offset < 0 || offset > SPAN)) {
+		gint64 target = file->pos + offset;
 
-		file->raw_pos = off;
-		file->have = 0;
-		file->eof = FALSE;
+		par_stop(file, TRUE);
+		file->par_resume = target + 2 * SPAN;
+		offset = target - file->pos;
 		file->seek_pending = FALSE;
-		file->err = 0;
-		file->err_info = NULL;
-		file->avail_in = 0;
-
-#ifdef HAVE_LIBZ
-		if (here->compression == ZLIB) {
-			z_stream *strm = &file->strm;
-
-			inflateReset(strm);
-			strm->adler = here->data.zlib.adler;
-			strm->total_out = here->data.zlib.total_out;
-#ifdef HAVE_INFLATEPRIME
-			if (here->data.zlib.bits) {
-				FILE_T state = file;
-				int ret = GZ_GETC();
-
-				if (ret == -1) {
-					if (state->err == 0) {
-						/* EOF */
-						*err = WTAP_ERR_SHORT_READ;
-					} else
-						*err = state->err;
-					return -1;
-				}
-				(void)inflatePrime(strm, here->data.zlib.bits, ret >> (8 - here->data.zlib.bits));
-			}
-#endif
-			(void)inflateSetDictionary(strm, here->data.zlib.window, ZLIB_WINSIZE);
-			file->compression = ZLIB;
-		} else if (here->compression == GZIP_AFTER_HEADER) {
-			z_stream *strm = &file->strm;
-
-			inflateReset(strm);
-			strm->adler = crc32(0L, Z_NULL, 0);
-			file->compression = ZLIB;
-		} else
+	}
 #endif
-			file->compression = here->compression;
-
-		offset = (file->pos + offset) - off2;
-		file->pos = off2;
-		/* g_print("OK! %ld\n", offset); */
 
-		if (offset) {
-			file->seek_pending = TRUE;
-			file->skip = offset;
-		}
-		return file->pos + offset;
-	}
+	/* XXX, profile */
+	if ((here = fast_seek_find(file, file->pos + offset)) && (offset < 0 || offset > SPAN || here->compression == UNCOMPRESSED))
+		return seek_to_point(file, here, file->pos + offset, err);
 
 	/* if within raw area while reading, just go there */
 	if (file->compression == UNCOMPRESSED && file->pos + offset >= file->raw
@@ -1209,6 +2287,49 @@ file_read(void *buf, unsigned int len, FILE_T file)
 	return (int)got;
 }
 
+/*
+ * If the next len bytes are all in a map of the file, return a pointer
+ * to them there, and move past them, as file_read() would; the pointer
+ * is good until the file is closed.  Otherwise, return NULL without
+ * moving, and the data has to be copied out with file_read().
+ */
+const guint8 *
+file_read_in_place(unsigned int len, FILE_T file)
+{
+#ifdef HAVE_MMAP
+	const guint8 *data;
+
+	/* process a skip request */
+	if (file->seek_pending) {
+		file->seek_pending = FALSE;
+		if (gz_skip(file, file->skip) == -1)
+			return NULL;
+	}
+
+	/* get the next window of the map if we're at the end of this one */
+	if (file->have == 0 && file->err == 0 &&
+	    !(file->eof && file->avail_in == 0)) {
+		if (fill_out_buffer(file) == -1)
+			return NULL;
+	}
+
+	/* the data could straddle two windows, or be past the end of the
+	   map, in a file that's grown */
+	if (file->map == NULL || file->out == file->out_buf || file->have < len)
+		return NULL;
+
+	data = file->next;
+	file->next += len;
+	file->have -= len;
+	file->pos += len;
+	return data;
+#else
+	(void)len;
+	(void)file;
+	return NULL;
+#endif
+}
+
 /*
  * XXX - this gets a byte, not a character.
  */
@@ -1335,6 +2456,10 @@ file_clearerr(FILE_T stream)
 void
 file_fdclose(FILE_T file)
 {
+#ifdef HAVE_PARALLEL_INFLATE
+	if (file->par != NULL)
+		par_stop(file, TRUE);
+#endif
 	ws_close(file->fd);
 	file->fd = -1;
 }
@@ -1354,15 +2479,45 @@ void
 file_close(FILE_T file)
 {
 	int fd = file->fd;
+	guint i;
+
+#ifdef HAVE_PARALLEL_INFLATE
+	if (file->par != NULL)
+		par_stop(file, FALSE);
+#endif
+	if (file->fast_seek_cache != NULL) {
+#ifdef HAVE_LIBZ
+		if (fd != -1 && file->read_to_end && file->is_compressed)
+			fast_seek_cache_save(file);
+#endif
+		g_free(file->fast_seek_cache);
+	}
+	if (file->own_fast_seek) {
+		for (i = 0; i < file->fast_seek->len; i++)
+			g_free(file->fast_seek->pdata[i]);
+		g_ptr_array_free(file->fast_seek, TRUE);
+	}
 
 	/* free memory and close file */
 	if (file->size) {
 #ifdef HAVE_LIBZ
 		inflateEnd(&(file->strm));
 #endif
-		g_free(file->out);
+		g_free(file->out_buf);
 		g_free(file->in);
 	}
+#ifdef HAVE_MMAP
+	if (file->map != NULL)
+		munmap(file->map, (size_t)file->map_len);
+#endif
+#ifdef HAVE_ZSTD
+	if (file->zstd != NULL)
+		ZSTD_freeDStream(file->zstd);
+#endif
+#ifdef HAVE_LZ4
+	if (file->lz4 != NULL)
+		LZ4F_freeDecompressionContext(file->lz4);
+#endif
 	g_free(file->fast_seek_cur);
 	file->err = 0;
 	file->err_info = NULL;
@@ -1376,10 +2531,11 @@ file_close(FILE_T file)
 		ws_close(fd);
 }
 
-#ifdef HAVE_LIBZ
-/* internal gzip file state data structure for writing */
+#ifdef HAVE_COMPRESSED_WRITERS
+/* internal compressed file state data structure for writing */
 struct wtap_writer {
     int fd;                 /* file descriptor */
+    wtap_compression_type compression_type;
     gint64 pos;             /* current position in uncompressed data */
     guint size;          /* buffer size, zero if not allocated yet */
     guint want;          /* requested buffer size, default is GZBUFSIZE */
@@ -1389,21 +2545,40 @@ struct wtap_writer {
     int level;              /* compression level */
     int strategy;           /* compression strategy */
     int err;                /* error code */
+#ifdef HAVE_LIBZ
 	/* zlib deflate stream */
     z_stream strm;          /* stream structure in-place (not a pointer) */
+#endif
+    gint64 frame_pos;       /* uncompressed data in the current Zstandard or LZ4 frame */
+#ifdef HAVE_ZSTD
+    ZSTD_CStream *zstd;     /* Zstandard compression stream */
+#endif
+#ifdef HAVE_LZ4
+    LZ4F_compressionContext_t lz4; /* LZ4 compression context */
+    gboolean lz4_in_frame;  /* TRUE if we've started an LZ4 frame */
+#endif
 };
 
-GZWFILE_T
-gzwfile_open(const char *path)
+/*
+ * Zstandard and LZ4 files are written as a series of frames, each with
+ * SPAN bytes of uncompressed data, so that file_seek() can get to any
+ * part of the file by decompressing at most that much; a reader can start
+ * decompressing at the beginning of any frame, which is where the seek
+ * points for those files are.
+ */
+#define LZ4_CHUNK 65536         /* how much we give LZ4F_compressUpdate() at a time */
+
+CWFILE_T
+cwfile_open(const char *path, wtap_compression_type compression_type)
 {
     int fd;
-    GZWFILE_T state;
+    CWFILE_T state;
     int save_errno;
 
     fd = ws_open(path, O_BINARY|O_WRONLY|O_CREAT|O_TRUNC, 0666);
     if (fd == -1)
         return NULL;
-    state = gzwfile_fdopen(fd);
+    state = cwfile_fdopen(fd, compression_type);
     if (state == NULL) {
         save_errno = errno;
         close(fd);
@@ -1412,36 +2587,220 @@ gzwfile_open(const char *path)
     return state;
 }
 
-GZWFILE_T
-gzwfile_fdopen(int fd)
+CWFILE_T
+cwfile_fdopen(int fd, wtap_compression_type compression_type)
 {
-    GZWFILE_T state;
+    CWFILE_T state;
+#ifdef HAVE_LZ4
+    LZ4F_preferences_t prefs;
+#endif
 
     /* allocate wtap_writer structure to return */
-    state = (GZWFILE_T)g_try_malloc(sizeof *state);
+    state = (CWFILE_T)g_try_malloc(sizeof *state);
     if (state == NULL)
         return NULL;
     state->fd = fd;
+    state->compression_type = compression_type;
     state->size = 0;            /* no buffers allocated yet */
     state->want = GZBUFSIZE;    /* requested buffer size */
+    state->in = NULL;
+    state->out = NULL;
 
+#ifdef HAVE_LIBZ
     state->level = Z_DEFAULT_COMPRESSION;
     state->strategy = Z_DEFAULT_STRATEGY;
+#endif
 
     /* initialize stream */
-    state->err = Z_OK;              /* clear error */
+    state->err = 0;                 /* clear error */
     state->pos = 0;                 /* no uncompressed data yet */
+#ifdef HAVE_LIBZ
     state->strm.avail_in = 0;       /* no input data yet */
+#endif
+    state->frame_pos = 0;
+
+    switch (compression_type) {
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        state->zstd = ZSTD_createCStream();
+        state->size = (guint)ZSTD_CStreamOutSize();
+        state->out = (unsigned char *)g_try_malloc(state->size);
+        if (state->zstd == NULL || state->out == NULL) {
+            ZSTD_freeCStream(state->zstd);
+            g_free(state->out);
+            g_free(state);
+            errno = ENOMEM;
+            return NULL;
+        }
+        break;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        memset(&prefs, 0, sizeof prefs);
+        state->lz4_in_frame = FALSE;
+        state->size = (guint)LZ4F_compressBound(LZ4_CHUNK, &prefs);
+        if (state->size < LZ4F_HEADER_SIZE_MAX)
+            state->size = LZ4F_HEADER_SIZE_MAX;
+        state->out = (unsigned char *)g_try_malloc(state->size);
+        if (state->out == NULL ||
+            LZ4F_isError(LZ4F_createCompressionContext(&state->lz4, LZ4F_VERSION))) {
+            g_free(state->out);
+            g_free(state);
+            errno = ENOMEM;
+            return NULL;
+        }
+        break;
+#endif
+
+    default:
+        break;
+    }
 
     /* return stream */
     return state;
 }
 
+/* Write out len bytes of compressed data.  Return -1, and set state->err,
+   on failure; return 0 on success. */
+static int
+cw_write_out(CWFILE_T state, const unsigned char *buf, size_t len)
+{
+    ssize_t got;
+
+    while (len) {
+        got = write(state->fd, buf, (unsigned int)len);
+        if (got < 0) {
+            state->err = errno;
+            return -1;
+        }
+        if (got == 0) {
+            state->err = WTAP_ERR_SHORT_WRITE;
+            return -1;
+        }
+        buf += got;
+        len -= (size_t)got;
+    }
+    return 0;
+}
+
+#ifdef HAVE_ZSTD
+/* Compress what's in input and write it out, then, if mode is ZSTD_e_flush
+   or ZSTD_e_end, flush or end the frame.  Return -1, and set state->err, on
+   failure; return 0 on success. */
+static int
+zstd_comp(CWFILE_T state, ZSTD_inBuffer *input, ZSTD_EndDirective mode)
+{
+    ZSTD_outBuffer output;
+    size_t ret;
+
+    do {
+        output.dst = state->out;
+        output.size = state->size;
+        output.pos = 0;
+        ret = ZSTD_compressStream2(state->zstd, &output, input, mode);
+        if (ZSTD_isError(ret)) {
+            /* This "shouldn't happen". */
+            state->err = WTAP_ERR_INTERNAL;
+            return -1;
+        }
+        if (cw_write_out(state, state->out, output.pos) == -1)
+            return -1;
+    } while (mode == ZSTD_e_continue ? input->pos < input->size : ret != 0);
+    return 0;
+}
+
+static guint
+zstd_write(CWFILE_T state, const void *buf, guint len)
+{
+    ZSTD_inBuffer input;
+    gint64 n;
+
+    while (len) {
+        /* no more than what's left of the frame */
+        n = SPAN - state->frame_pos;
+        if (n > len)
+            n = len;
+        input.src = buf;
+        input.size = (size_t)n;
+        input.pos = 0;
+        state->frame_pos += n;
+        if (zstd_comp(state, &input,
+                      state->frame_pos == SPAN ? ZSTD_e_end : ZSTD_e_continue) == -1)
+            return 0;
+        if (state->frame_pos == SPAN)
+            state->frame_pos = 0;
+        state->pos += n;
+        buf = (const char *)buf + n;
+        len -= (guint)n;
+    }
+    return 1;
+}
+#endif
+
+#ifdef HAVE_LZ4
+static guint
+lz4_write(CWFILE_T state, const void *buf, guint len)
+{
+    size_t ret;
+    gint64 n;
+
+    while (len) {
+        if (!state->lz4_in_frame) {
+            ret = LZ4F_compressBegin(state->lz4, state->out, state->size, NULL);
+            if (LZ4F_isError(ret)) {
+                /* This "shouldn't happen". */
+                state->err = WTAP_ERR_INTERNAL;
+                return 0;
+            }
+            if (cw_write_out(state, state->out, ret) == -1)
+                return 0;
+            state->lz4_in_frame = TRUE;
+        }
+
+        /* no more than what's left of the frame, or fits in out */
+        n = SPAN - state->frame_pos;
+        if (n > LZ4_CHUNK)
+            n = LZ4_CHUNK;
+        if (n > len)
+            n = len;
+        ret = LZ4F_compressUpdate(state->lz4, state->out, state->size,
+                                  buf, (size_t)n, NULL);
+        if (LZ4F_isError(ret)) {
+            state->err = WTAP_ERR_INTERNAL;
+            return 0;
+        }
+        if (cw_write_out(state, state->out, ret) == -1)
+            return 0;
+        state->frame_pos += n;
+
+        if (state->frame_pos == SPAN) {
+            ret = LZ4F_compressEnd(state->lz4, state->out, state->size, NULL);
+            if (LZ4F_isError(ret)) {
+                state->err = WTAP_ERR_INTERNAL;
+                return 0;
+            }
+            if (cw_write_out(state, state->out, ret) == -1)
+                return 0;
+            state->lz4_in_frame = FALSE;
+            state->frame_pos = 0;
+        }
+        state->pos += n;
+        buf = (const char *)buf + n;
+        len -= (guint)n;
+    }
+    return 1;
+}
+#endif
+
+#ifdef HAVE_LIBZ
+
 /* Initialize state for writing a gzip file.  Mark initialization by setting
    state->size to non-zero.  Return -1, and set state->err, on failure;
    return 0 on success. */
 static int
-gz_init(GZWFILE_T state)
+gz_init(CWFILE_T state)
 {
     int ret;
     z_streamp strm = &(state->strm);
@@ -1491,7 +2850,7 @@ gz_init(GZWFILE_T state)
    flush is assumed to be a valid deflate() flush value.  If flush is Z_FINISH,
    then the deflate() state is reset to start a new gzip stream. */
 static int
-gz_comp(GZWFILE_T state, int flush)
+gz_comp(CWFILE_T state, int flush)
 {
     int ret;
     ssize_t got;
@@ -1547,11 +2906,8 @@ gz_comp(GZWFILE_T state, int flush)
     return 0;
 }
 
-/* Write out len bytes from buf.  Return 0, and set state->err, on
-   failure or on an attempt to write 0 bytes (in which case state->err
-   is Z_OK); return the number of bytes written on success. */
-unsigned
-gzwfile_write(GZWFILE_T state, const void *buf, guint len)
+static guint
+gz_write(CWFILE_T state, const void *buf, guint len)
 {
     guint put = len;
     guint n;
@@ -1559,14 +2915,6 @@ gzwfile_write(GZWFILE_T state, const void *buf, guint len)
 
     strm = &(state->strm);
 
-    /* check that there's no error */
-    if (state->err != Z_OK)
-        return 0;
-
-    /* if len is zero, avoid unnecessary operations */
-    if (len == 0)
-        return 0;
-
     /* allocate memory if this is the first time through */
     if (state->size == 0 && gz_init(state) == -1)
         return 0;
@@ -1606,18 +2954,96 @@ gzwfile_write(GZWFILE_T state, const void *buf, guint len)
     return (int)put;
 }
 
+#endif /* HAVE_LIBZ */
+
+/* Write out len bytes from buf.  Return 0, and set state->err, on
+   failure or on an attempt to write 0 bytes (in which case state->err
+   is 0); return the number of bytes written on success. */
+unsigned
+cwfile_write(CWFILE_T state, const void *buf, guint len)
+{
+    /* check that there's no error */
+    if (state->err != 0)
+        return 0;
+
+    /* if len is zero, avoid unnecessary operations */
+    if (len == 0)
+        return 0;
+
+    switch (state->compression_type) {
+
+#ifdef HAVE_LIBZ
+    case WTAP_GZIP_COMPRESSED:
+        return gz_write(state, buf, len);
+#endif
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        return zstd_write(state, buf, len) ? len : 0;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        return lz4_write(state, buf, len) ? len : 0;
+#endif
+
+    default:
+        /* This "shouldn't happen". */
+        state->err = WTAP_ERR_INTERNAL;
+        return 0;
+    }
+}
+
 /* Flush out what we've written so far.  Returns -1, and sets state->err,
    on failure; returns 0 on success. */
 int
-gzwfile_flush(GZWFILE_T state)
+cwfile_flush(CWFILE_T state)
 {
+#ifdef HAVE_ZSTD
+    ZSTD_inBuffer input;
+#endif
+#ifdef HAVE_LZ4
+    size_t ret;
+#endif
+
     /* check that there's no error */
-    if (state->err != Z_OK)
+    if (state->err != 0)
         return -1;
 
-    /* compress remaining data with Z_SYNC_FLUSH */
-    gz_comp(state, Z_SYNC_FLUSH);
-    if (state->err != Z_OK)
+    switch (state->compression_type) {
+
+#ifdef HAVE_LIBZ
+    case WTAP_GZIP_COMPRESSED:
+        /* compress remaining data with Z_SYNC_FLUSH */
+        gz_comp(state, Z_SYNC_FLUSH);
+        break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        input.src = NULL;
+        input.size = 0;
+        input.pos = 0;
+        zstd_comp(state, &input, ZSTD_e_flush);
+        break;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        if (state->lz4_in_frame) {
+            ret = LZ4F_flush(state->lz4, state->out, state->size, NULL);
+            if (LZ4F_isError(ret))
+                state->err = WTAP_ERR_INTERNAL;
+            else
+                cw_write_out(state, state->out, ret);
+        }
+        break;
+#endif
+
+    default:
+        break;
+    }
+    if (state->err != 0)
         return -1;
     return 0;
 }
@@ -1625,17 +3051,69 @@ gzwfile_flush(GZWFILE_T state)
 /* Flush out all data written, and close the file.  Returns a Wiretap
    error on failure; returns 0 on success. */
 int
-gzwfile_close(GZWFILE_T state)
+cwfile_close(CWFILE_T state)
 {
     int ret = 0;
+#ifdef HAVE_ZSTD
+    ZSTD_inBuffer input;
+#endif
+#ifdef HAVE_LZ4
+    size_t len;
+#endif
 
     /* flush, free memory, and close file */
-    if (gz_comp(state, Z_FINISH) == -1 && ret == 0)
-        ret = state->err;
-    (void)deflateEnd(&(state->strm));
+    switch (state->compression_type) {
+
+#ifdef HAVE_LIBZ
+    case WTAP_GZIP_COMPRESSED:
+        if (gz_comp(state, Z_FINISH) == -1 && ret == 0)
+            ret = state->err;
+        (void)deflateEnd(&(state->strm));
+        g_free(state->in);
+        break;
+#endif
+
+#ifdef HAVE_ZSTD
+    case WTAP_ZSTD_COMPRESSED:
+        /* finish the last frame; an empty file gets one empty frame */
+        if (state->err == 0 && (state->frame_pos != 0 || state->pos == 0)) {
+            input.src = NULL;
+            input.size = 0;
+            input.pos = 0;
+            if (zstd_comp(state, &input, ZSTD_e_end) == -1)
+                ret = state->err;
+        }
+        ZSTD_freeCStream(state->zstd);
+        break;
+#endif
+
+#ifdef HAVE_LZ4
+    case WTAP_LZ4_COMPRESSED:
+        if (state->err == 0 && !state->lz4_in_frame && state->pos == 0) {
+            len = LZ4F_compressBegin(state->lz4, state->out, state->size, NULL);
+            if (LZ4F_isError(len))
+                state->err = WTAP_ERR_INTERNAL;
+            else if (cw_write_out(state, state->out, len) == 0)
+                state->lz4_in_frame = TRUE;
+        }
+        if (state->err == 0 && state->lz4_in_frame) {
+            len = LZ4F_compressEnd(state->lz4, state->out, state->size, NULL);
+            if (LZ4F_isError(len))
+                state->err = WTAP_ERR_INTERNAL;
+            else
+                cw_write_out(state, state->out, len);
+        }
+        if (state->err != 0)
+            ret = state->err;
+        LZ4F_freeCompressionContext(state->lz4);
+        break;
+#endif
+
+    default:
+        break;
+    }
     g_free(state->out);
-    g_free(state->in);
-    state->err = Z_OK;
+    state->err = 0;
     if (close(state->fd) == -1 && ret == 0)
         ret = errno;
     g_free(state);
@@ -1643,8 +3121,8 @@ gzwfile_close(GZWFILE_T state)
 }
 
 int
-gzwfile_geterr(GZWFILE_T state)
+cwfile_geterr(CWFILE_T state)
 {
     return state->err;
 }
-#endif
+#endif /* HAVE_COMPRESSED_WRITERS */
@@ -73,7 +73,8 @@ static int libpcap_read_header(wtap *wth, FILE_T fh, int *err, gchar **err_info,
     struct pcaprec_ss990915_hdr *hdr);
 static void adjust_header(wtap *wth, struct pcaprec_hdr *hdr);
 static gboolean libpcap_read_packet(wtap *wth, FILE_T fh,
-    struct wtap_pkthdr *phdr, Buffer *buf, int *err, gchar **err_info);
+    struct wtap_pkthdr *phdr, Buffer *buf, const guint8 **data_ptr,
+    int *err, gchar **err_info);
 static gboolean libpcap_dump(wtap_dumper *wdh, const struct wtap_pkthdr *phdr,
     const guint8 *pd, int *err);
 
@@ -598,7 +599,7 @@ static gboolean libpcap_read(wtap *wth, int *err, gchar **err_info,
 	*data_offset = file_tell(wth->fh);
 
 	return libpcap_read_packet(wth, wth->fh, &wth->phdr,
-	    wth->frame_buffer, err, err_info);
+	    wth->frame_buffer, &wth->frame_ptr, err, err_info);
 }
 
 static gboolean
@@ -608,7 +609,7 @@ libpcap_seek_read(wtap *wth, gint64 seek_off, struct wtap_pkthdr *phdr,
 	if (file_seek(wth->random_fh, seek_off, SEEK_SET, err) == -1)
 		return FALSE;
 
-	if (!libpcap_read_packet(wth, wth->random_fh, phdr, buf, err,
+	if (!libpcap_read_packet(wth, wth->random_fh, phdr, buf, NULL, err,
 	    err_info)) {
 		if (*err == 0)
 			*err = WTAP_ERR_SHORT_READ;
@@ -617,9 +618,13 @@ libpcap_seek_read(wtap *wth, gint64 seek_off, struct wtap_pkthdr *phdr,
 	return TRUE;
 }
 
+/*
+ * Read a packet; if data_ptr isn't NULL, the data can be left in a map of
+ * the file, with *data_ptr pointing to it, rather than read into buf.
+ */
 static gboolean
 libpcap_read_packet(wtap *wth, FILE_T fh, struct wtap_pkthdr *phdr,
-    Buffer *buf, int *err, gchar **err_info)
+    Buffer *buf, const guint8 **data_ptr, int *err, gchar **err_info)
 {
 	struct pcaprec_ss990915_hdr hdr;
 	guint packet_size;
@@ -691,12 +696,20 @@ libpcap_read_packet(wtap *wth, FILE_T fh, struct wtap_pkthdr *phdr,
 	/*
 	 * Read the packet data.
 	 */
-	if (!wtap_read_packet_bytes(fh, buf, packet_size, err, err_info))
+	libpcap = (libpcap_t *)wth->priv;
+	if (data_ptr != NULL &&
+	    pcap_read_post_process_changes_data(wth->file_encap,
+	      libpcap->byte_swapped))
+		data_ptr = NULL;
+	if (!wtap_read_packet_bytes_in_place(fh, buf, data_ptr, packet_size,
+	    err, err_info))
 		return FALSE;	/* failed */
 
-	libpcap = (libpcap_t *)wth->priv;
+	/* The data isn't changed if it's left in place */
 	pcap_read_post_process(wth->file_type_subtype, wth->file_encap,
-	    phdr, buffer_start_ptr(buf), libpcap->byte_swapped, -1);
+	    phdr, data_ptr != NULL && *data_ptr != NULL ?
+	      (guint8 *)*data_ptr : buffer_start_ptr(buf),
+	    libpcap->byte_swapped, -1);
 	return TRUE;
 }
 
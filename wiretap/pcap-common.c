@@ -1841,6 +1841,20 @@ pcap_read_post_process(int file_type, int wtap_encap,
 	}
 }
 
+gboolean
+pcap_read_post_process_changes_data(int wtap_encap, gboolean bytes_swapped)
+{
+	switch (wtap_encap) {
+
+	case WTAP_ENCAP_USB_LINUX:
+	case WTAP_ENCAP_USB_LINUX_MMAPPED:
+		return bytes_swapped;
+
+	default:
+		return FALSE;
+	}
+}
+
 int
 pcap_get_phdr_size(int encap, const union wtap_pseudo_header *pseudo_header)
 {
@@ -356,6 +356,7 @@ typedef struct wtapng_block_s {
          */
         struct wtap_pkthdr *packet_header;
         Buffer *frame_buffer;
+        const guint8 **frame_ptr;       /* if not NULL, packet data can be left in a map of the file, pointed to by this */
         int *file_encap;
 } wtapng_block_t;
 
@@ -952,6 +953,7 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
         int pseudo_header_len;
         char *option_content = NULL; /* Allocate as large as the options block */
         int fcslen;
+        const guint8 **frame_ptr;
 
         /* Don't try to allocate memory for a huge number of options, as
            that might fail and, even if it succeeds, it might not leave
@@ -1154,7 +1156,9 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
 
         /* "(Enhanced) Packet Block" read capture data */
         errno = WTAP_ERR_CANT_READ;
-	if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+        frame_ptr = pcap_read_post_process_changes_data(int_data.wtap_encap, pn->byte_swapped) ?
+            NULL : wblock->frame_ptr;
+	if (!wtap_read_packet_bytes_in_place(fh, wblock->frame_buffer, frame_ptr,
 	    packet.cap_len - pseudo_header_len, err, err_info))
 		return 0;
         block_read += packet.cap_len - pseudo_header_len;
@@ -1271,8 +1275,11 @@ pcapng_read_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *pn, wta
 
         g_free(option_content);
 
+        /* The data isn't changed if it was left in place */
         pcap_read_post_process(WTAP_FILE_TYPE_SUBTYPE_PCAPNG, int_data.wtap_encap,
-            wblock->packet_header, buffer_start_ptr(wblock->frame_buffer),
+            wblock->packet_header,
+            frame_ptr != NULL && *frame_ptr != NULL ?
+              (guint8 *)*frame_ptr : buffer_start_ptr(wblock->frame_buffer),
             pn->byte_swapped, fcslen);
         return block_read;
 }
@@ -1290,6 +1297,7 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
         guint32 block_total_length;
         guint32 padding;
         int pseudo_header_len;
+        const guint8 **frame_ptr;
 
         /*
          * Is this block long enough to be an SPB?
@@ -1431,7 +1439,9 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
 
         /* "Simple Packet Block" read capture data */
         errno = WTAP_ERR_CANT_READ;
-	if (!wtap_read_packet_bytes(fh, wblock->frame_buffer,
+        frame_ptr = pcap_read_post_process_changes_data(int_data.wtap_encap, pn->byte_swapped) ?
+            NULL : wblock->frame_ptr;
+	if (!wtap_read_packet_bytes_in_place(fh, wblock->frame_buffer, frame_ptr,
 	    simple_packet.cap_len, err, err_info))
 		return 0;
         block_read += simple_packet.cap_len;
@@ -1448,7 +1458,9 @@ pcapng_read_simple_packet_block(FILE_T fh, pcapng_block_header_t *bh, pcapng_t *
         }
 
         pcap_read_post_process(WTAP_FILE_TYPE_SUBTYPE_PCAPNG, int_data.wtap_encap,
-            wblock->packet_header, buffer_start_ptr(wblock->frame_buffer),
+            wblock->packet_header,
+            frame_ptr != NULL && *frame_ptr != NULL ?
+              (guint8 *)*frame_ptr : buffer_start_ptr(wblock->frame_buffer),
             pn->byte_swapped, pn->if_fcslen);
         return block_read;
 }
@@ -2168,6 +2180,7 @@ pcapng_open(wtap *wth, int *err, gchar **err_info)
 
         /* we don't expect any packet blocks yet */
         wblock.frame_buffer = NULL;
+        wblock.frame_ptr = NULL;
         wblock.packet_header = NULL;
         wblock.file_encap = &wth->file_encap;
 
@@ -2285,6 +2298,7 @@ pcapng_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
         pcapng_debug1("pcapng_read: data_offset is initially %" G_GINT64_MODIFIER "d", *data_offset);
 
         wblock.frame_buffer  = wth->frame_buffer;
+        wblock.frame_ptr     = &wth->frame_ptr;
         wblock.packet_header = &wth->phdr;
         wblock.file_encap    = &wth->file_encap;
 
@@ -2400,6 +2414,7 @@ pcapng_seek_read(wtap *wth, gint64 seek_off,
         pcapng_debug1("pcapng_seek_read: reading at offset %" G_GINT64_MODIFIER "u", seek_off);
 
         wblock.frame_buffer = buf;
+        wblock.frame_ptr = NULL;
         wblock.packet_header = phdr;
         wblock.file_encap = &wth->file_encap;
 
@@ -3710,6 +3725,7 @@ pcapng_dump_open(wtap_dumper *wdh, int *err)
 
                 /* write the interface description block */
                 wblock.frame_buffer            = NULL;
+                wblock.frame_ptr               = NULL;
                 wblock.pseudo_header           = NULL;
                 wblock.packet_header           = NULL;
                 wblock.file_encap              = NULL;
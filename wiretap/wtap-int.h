@@ -55,6 +55,7 @@ struct wtap {
     int                         file_type_subtype;
     guint                       snapshot_length;
     struct Buffer               *frame_buffer;
+    const guint8                *frame_ptr;             /**< The packet data, if it was left in a map of the file rather than copied to frame_buffer */
     struct wtap_pkthdr          phdr;
     struct wtapng_section_s     shb_hdr;
     guint                       number_of_interfaces;   /**< The number of interfaces a capture was made on, number of IDB:s in a pcapng file or equivalent(?)*/
@@ -96,7 +97,7 @@ struct wtap_dumper {
     int                     file_type_subtype;
     int                     snaplen;
     int                     encap;
-    gboolean                compressed;
+    wtap_compression_type   compression_type;
     gint64                  bytes_dumped;
 
     void                    *priv;
@@ -286,6 +287,17 @@ gboolean
 wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
     gchar **err_info);
 
+/*
+ * The same, but if data_ptr isn't NULL and the data is in a map of the
+ * file, leave it there, and point *data_ptr to it; otherwise, read it
+ * into the Buffer and set *data_ptr to NULL.  The read routines pass
+ * &wth->frame_ptr when reading sequentially into wth->frame_buffer, and
+ * then mustn't change the data.
+ */
+gboolean
+wtap_read_packet_bytes_in_place(FILE_T fh, Buffer *buf,
+    const guint8 **data_ptr, guint length, int *err, gchar **err_info);
+
 #endif /* __WTAP_INT_H__ */
 
 /*
@@ -845,6 +845,7 @@ wtap_sequential_close(wtap *wth)
 		g_free(wth->frame_buffer);
 		wth->frame_buffer = NULL;
 	}
+	wth->frame_ptr = NULL;
 }
 
 static void
@@ -955,6 +956,9 @@ wtap_read(wtap *wth, int *err, gchar **err_info, gint64 *data_offset)
 	 */
 	wth->phdr.pkt_encap = wth->file_encap;
 
+	/* The data is in the buffer unless the read routine says otherwise */
+	wth->frame_ptr = NULL;
+
 	if (!wth->subtype_read(wth, err, err_info, data_offset)) {
 		/*
 		 * If we didn't get an error indication, we read
@@ -1016,6 +1020,18 @@ wtap_read_packet_bytes(FILE_T fh, Buffer *buf, guint length, int *err,
 	return TRUE;
 }
 
+gboolean
+wtap_read_packet_bytes_in_place(FILE_T fh, Buffer *buf,
+    const guint8 **data_ptr, guint length, int *err, gchar **err_info)
+{
+	if (data_ptr != NULL) {
+		*data_ptr = file_read_in_place(length, fh);
+		if (*data_ptr != NULL)
+			return TRUE;
+	}
+	return wtap_read_packet_bytes(fh, buf, length, err, err_info);
+}
+
 /*
  * Return an approximation of the amount of data we've read sequentially
  * from the file so far.  (gint64, in case that's 64 bits.)
@@ -1035,6 +1051,21 @@ wtap_phdr(wtap *wth)
 guint8 *
 wtap_buf_ptr(wtap *wth)
 {
+	/* The caller can change the data, which it can't do in the map */
+	if (wth->frame_ptr != NULL) {
+		buffer_assure_space(wth->frame_buffer, wth->phdr.caplen);
+		memcpy(buffer_start_ptr(wth->frame_buffer), wth->frame_ptr,
+		    wth->phdr.caplen);
+		wth->frame_ptr = NULL;
+	}
+	return buffer_start_ptr(wth->frame_buffer);
+}
+
+const guint8 *
+wtap_buf_ptr_const(wtap *wth)
+{
+	if (wth->frame_ptr != NULL)
+		return wth->frame_ptr;
 	return buffer_start_ptr(wth->frame_buffer);
 }
 
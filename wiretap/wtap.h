@@ -1258,6 +1258,18 @@ WS_DLL_PUBLIC
 struct wtap* wtap_open_offline(const char *filename, int *err,
     gchar **err_info, gboolean do_random);
 
+/**
+ * Keep the seek points of compressed files that are read all the way
+ * through in a file next to them, named after them with ".fsidx" added,
+ * and load them from there when the files are opened again.  Off unless
+ * this is called; the files are written next to the capture files, which
+ * might not be ours to write to.
+ *
+ * @param keep TRUE to keep them
+ */
+WS_DLL_PUBLIC
+void wtap_set_keep_seek_points(gboolean keep);
+
 /**
  * If we were compiled with zlib and we're at EOF, unset EOF so that
  * wtap_read/gzread has a chance to succeed. This is necessary if
@@ -1294,6 +1306,10 @@ WS_DLL_PUBLIC
 struct wtap_pkthdr *wtap_phdr(wtap *wth);
 WS_DLL_PUBLIC
 guint8 *wtap_buf_ptr(wtap *wth);
+/** The same, for callers that don't change the data; if the file is
+ *  mapped in, this points into the map, and the data isn't copied. */
+WS_DLL_PUBLIC
+const guint8 *wtap_buf_ptr_const(wtap *wth);
 
 /*** get various information snippets about the current file ***/
 
@@ -1338,6 +1354,36 @@ void wtap_close(wtap *wth);
 WS_DLL_PUBLIC
 gboolean wtap_dump_can_open(int filetype);
 
+/** The ways a capture file can be compressed when it's written */
+typedef enum {
+    WTAP_UNCOMPRESSED,
+    WTAP_GZIP_COMPRESSED,
+    WTAP_ZSTD_COMPRESSED,
+    WTAP_LZ4_COMPRESSED
+} wtap_compression_type;
+
+/**
+ * Return TRUE if we were built with support for writing files
+ * compressed this way, FALSE if not.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_compression_type_supported(wtap_compression_type compression_type);
+
+/**
+ * Look up a compression type by its name ("none", "gzip", "zstd" or
+ * "lz4"); return FALSE if there's no supported type with that name.
+ */
+WS_DLL_PUBLIC
+gboolean wtap_name_to_compression_type(const char *name,
+    wtap_compression_type *compression_type);
+
+/**
+ * Get a GSList of the names of the supported compression types; free it
+ * with g_slist_free(), but not the names.
+ */
+WS_DLL_PUBLIC
+GSList *wtap_get_compression_type_names(void);
+
 /**
  * Given a GArray of WTAP_ENCAP_ types, return the per-file encapsulation
  * type that would be needed to write out a file with those types.
@@ -1382,6 +1428,13 @@ WS_DLL_PUBLIC
 wtap_dumper* wtap_dump_fdopen_ng(int fd, int filetype, int encap, int snaplen,
                 gboolean compressed, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
 
+WS_DLL_PUBLIC
+wtap_dumper* wtap_dump_open_compressed(const char *filename, int filetype, int encap,
+    int snaplen, wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
+
+WS_DLL_PUBLIC
+wtap_dumper* wtap_dump_fdopen_compressed(int fd, int filetype, int encap, int snaplen,
+    wtap_compression_type compression_type, wtapng_section_t *shb_hdr, wtapng_iface_descriptions_t *idb_inf, int *err);
 
 WS_DLL_PUBLIC
 gboolean wtap_dump(wtap_dumper *, const struct wtap_pkthdr *, const guint8 *, int *err);
@@ -0,0 +1,623 @@
+/*
+ *  FIPS-180-2 compliant SHA-256 implementation
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2001-2003  Christophe Devine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ *  Derived from sha1.c, using the same context layout and calling
+ *  conventions.
+ *  References: http://csrc.nist.gov/publications/fips/fips180-2/fips180-2.pdf
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <glib.h>
+
+#include "sha2.h"
+#include "ws_cpuid.h"
+
+/*
+ * Whole blocks are hashed with the SHA extensions' instructions if the
+ * processor has them (which is checked at run time), as they're several
+ * times faster than the portable code.  Without them, sha256d_batch()
+ * hashes up to eight messages side by side in the lanes of AVX2 vectors,
+ * if the processor has AVX2; a single message can't be hashed that way,
+ * as each of its blocks depends on the one before.
+ */
+#if defined(HAVE_WS_CPUID) && defined(__GNUC__) && \
+    ((defined(__clang__) && __clang_major__ >= 4) || \
+     (!defined(__clang__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define HAVE_SHA256_SHA_NI
+#define HAVE_SHA256_AVX2
+#include <immintrin.h>
+#endif
+
+#define GET_UINT32(n,b,i)                       \
+{                                               \
+    (n) = ( (guint32) (b)[(i)    ] << 24 )       \
+        | ( (guint32) (b)[(i) + 1] << 16 )       \
+        | ( (guint32) (b)[(i) + 2] <<  8 )       \
+        | ( (guint32) (b)[(i) + 3]       );      \
+}
+
+#define PUT_UINT32(n,b,i)                       \
+{                                               \
+    (b)[(i)    ] = (guint8) ( (n) >> 24 );       \
+    (b)[(i) + 1] = (guint8) ( (n) >> 16 );       \
+    (b)[(i) + 2] = (guint8) ( (n) >>  8 );       \
+    (b)[(i) + 3] = (guint8) ( (n)       );       \
+}
+
+static const guint32 sha256_h0[8] =
+{
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+    0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+void sha256_starts( sha256_context *ctx )
+{
+    ctx->total[0] = 0;
+    ctx->total[1] = 0;
+
+    memcpy( ctx->state, sha256_h0, sizeof( ctx->state ) );
+}
+
+static const guint32 sha256_k[64] =
+{
+    0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5,
+    0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+    0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3,
+    0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+    0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC,
+    0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+    0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7,
+    0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+    0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13,
+    0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+    0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3,
+    0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+    0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5,
+    0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+    0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208,
+    0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+};
+
+static void sha256_process( guint32 state[8], const guint8 data[64] )
+{
+    guint32 temp1, temp2, W[64];
+    guint32 A, B, C, D, E, F, G, H;
+    int i;
+
+#define SHR(x,n) ((x & 0xFFFFFFFF) >> n)
+#define ROTR(x,n) (SHR(x,n) | (x << (32 - n)))
+
+#define S0(x) (ROTR(x, 7) ^ ROTR(x,18) ^  SHR(x, 3))
+#define S1(x) (ROTR(x,17) ^ ROTR(x,19) ^  SHR(x,10))
+
+#define S2(x) (ROTR(x, 2) ^ ROTR(x,13) ^ ROTR(x,22))
+#define S3(x) (ROTR(x, 6) ^ ROTR(x,11) ^ ROTR(x,25))
+
+#define F0(x,y,z) ((x & y) | (z & (x | y)))
+#define F1(x,y,z) (z ^ (x & (y ^ z)))
+
+#define P(a,b,c,d,e,f,g,h,x,K)                  \
+{                                               \
+    temp1 = h + S3(e) + F1(e,f,g) + K + x;      \
+    temp2 = S2(a) + F0(a,b,c);                  \
+    d += temp1; h = temp1 + temp2;              \
+}
+
+    for( i = 0; i < 16; i++ )
+    {
+        GET_UINT32( W[i], data, 4 * i );
+    }
+
+    for( ; i < 64; i++ )
+    {
+        W[i] = S1(W[i -  2]) + W[i -  7] +
+               S0(W[i - 15]) + W[i - 16];
+    }
+
+    A = state[0];
+    B = state[1];
+    C = state[2];
+    D = state[3];
+    E = state[4];
+    F = state[5];
+    G = state[6];
+    H = state[7];
+
+    for( i = 0; i < 64; i += 8 )
+    {
+        P( A, B, C, D, E, F, G, H, W[i    ], sha256_k[i    ] );
+        P( H, A, B, C, D, E, F, G, W[i + 1], sha256_k[i + 1] );
+        P( G, H, A, B, C, D, E, F, W[i + 2], sha256_k[i + 2] );
+        P( F, G, H, A, B, C, D, E, W[i + 3], sha256_k[i + 3] );
+        P( E, F, G, H, A, B, C, D, W[i + 4], sha256_k[i + 4] );
+        P( D, E, F, G, H, A, B, C, W[i + 5], sha256_k[i + 5] );
+        P( C, D, E, F, G, H, A, B, W[i + 6], sha256_k[i + 6] );
+        P( B, C, D, E, F, G, H, A, W[i + 7], sha256_k[i + 7] );
+    }
+
+#undef P
+#undef F1
+#undef F0
+#undef S3
+#undef S2
+#undef S1
+#undef S0
+#undef ROTR
+#undef SHR
+
+    state[0] += A;
+    state[1] += B;
+    state[2] += C;
+    state[3] += D;
+    state[4] += E;
+    state[5] += F;
+    state[6] += G;
+    state[7] += H;
+}
+
+static void sha256_blocks_portable( guint32 state[8], const guint8 *data, guint32 num_blocks )
+{
+    while( num_blocks-- )
+    {
+        sha256_process( state, data );
+        data += 64;
+    }
+}
+
+#ifdef HAVE_SHA256_SHA_NI
+/*
+ * The SHA extensions keep the state as ABEF and CDGH, and do two rounds
+ * at a time, with the message schedule done four words at a time.
+ */
+__attribute__((target("sha,ssse3,sse4.1")))
+static void sha256_blocks_sha_ni( guint32 state[8], const guint8 *data, guint32 num_blocks )
+{
+    const __m128i bswap = _mm_set_epi64x( 0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL );
+    __m128i state0, state1, abef_save, cdgh_save;
+    __m128i msg[4], wk, tmp;
+    int i;
+
+    tmp    = _mm_loadu_si128( (const __m128i *) &state[0] );
+    state1 = _mm_loadu_si128( (const __m128i *) &state[4] );
+
+    tmp    = _mm_shuffle_epi32( tmp, 0xB1 );            /* CDAB */
+    state1 = _mm_shuffle_epi32( state1, 0x1B );         /* EFGH */
+    state0 = _mm_alignr_epi8( tmp, state1, 8 );         /* ABEF */
+    state1 = _mm_blend_epi16( state1, tmp, 0xF0 );      /* CDGH */
+
+    while( num_blocks-- )
+    {
+        abef_save = state0;
+        cdgh_save = state1;
+
+        for( i = 0; i < 4; i++ )
+        {
+            msg[i] = _mm_shuffle_epi8(
+                _mm_loadu_si128( (const __m128i *) ( data + 16 * i ) ), bswap );
+        }
+
+        /* msg[i & 3] holds W[4i] to W[4i + 3] */
+        for( i = 0; i < 16; i++ )
+        {
+            if( i >= 4 )
+            {
+                tmp = _mm_sha256msg1_epu32( msg[i & 3], msg[( i + 1 ) & 3] );
+                tmp = _mm_add_epi32( tmp,
+                    _mm_alignr_epi8( msg[( i + 3 ) & 3], msg[( i + 2 ) & 3], 4 ) );
+                msg[i & 3] = _mm_sha256msg2_epu32( tmp, msg[( i + 3 ) & 3] );
+            }
+
+            wk = _mm_add_epi32( msg[i & 3],
+                _mm_loadu_si128( (const __m128i *) &sha256_k[4 * i] ) );
+            state1 = _mm_sha256rnds2_epu32( state1, state0, wk );
+            wk = _mm_shuffle_epi32( wk, 0x0E );
+            state0 = _mm_sha256rnds2_epu32( state0, state1, wk );
+        }
+
+        state0 = _mm_add_epi32( state0, abef_save );
+        state1 = _mm_add_epi32( state1, cdgh_save );
+        data += 64;
+    }
+
+    tmp    = _mm_shuffle_epi32( state0, 0x1B );         /* FEBA */
+    state1 = _mm_shuffle_epi32( state1, 0xB1 );         /* DCHG */
+    state0 = _mm_blend_epi16( tmp, state1, 0xF0 );      /* DCBA */
+    state1 = _mm_alignr_epi8( state1, tmp, 8 );         /* HGFE */
+
+    _mm_storeu_si128( (__m128i *) &state[0], state0 );
+    _mm_storeu_si128( (__m128i *) &state[4], state1 );
+}
+#endif
+
+#ifdef HAVE_SHA256_AVX2
+#define SHA256_LANES 8
+
+/*
+ * One block of each of eight messages; state[i][lane] is word i of the
+ * state of the message in that lane.
+ */
+__attribute__((target("avx2")))
+static void sha256_lanes_process_avx2( guint32 state[8][SHA256_LANES],
+                                       const guint8 *const blocks[SHA256_LANES] )
+{
+    __m256i W[16], temp1, temp2;
+    __m256i A, B, C, D, E, F, G, H;
+    guint32 words[SHA256_LANES];
+    int i, lane;
+
+#define ADD(x,y) _mm256_add_epi32(x, y)
+#define AND(x,y) _mm256_and_si256(x, y)
+#define OR(x,y)  _mm256_or_si256(x, y)
+#define XOR(x,y) _mm256_xor_si256(x, y)
+#define SHR(x,n) _mm256_srli_epi32(x, n)
+#define ROTR(x,n) OR(SHR(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+#define S0(x) XOR(XOR(ROTR(x, 7), ROTR(x,18)), SHR(x, 3))
+#define S1(x) XOR(XOR(ROTR(x,17), ROTR(x,19)), SHR(x,10))
+
+#define S2(x) XOR(XOR(ROTR(x, 2), ROTR(x,13)), ROTR(x,22))
+#define S3(x) XOR(XOR(ROTR(x, 6), ROTR(x,11)), ROTR(x,25))
+
+#define F0(x,y,z) OR(AND(x, y), AND(z, OR(x, y)))
+#define F1(x,y,z) XOR(z, AND(x, XOR(y, z)))
+
+    for( i = 0; i < 16; i++ )
+    {
+        for( lane = 0; lane < SHA256_LANES; lane++ )
+        {
+            GET_UINT32( words[lane], blocks[lane], 4 * i );
+        }
+        W[i] = _mm256_loadu_si256( (const __m256i *) words );
+    }
+
+    A = _mm256_loadu_si256( (const __m256i *) state[0] );
+    B = _mm256_loadu_si256( (const __m256i *) state[1] );
+    C = _mm256_loadu_si256( (const __m256i *) state[2] );
+    D = _mm256_loadu_si256( (const __m256i *) state[3] );
+    E = _mm256_loadu_si256( (const __m256i *) state[4] );
+    F = _mm256_loadu_si256( (const __m256i *) state[5] );
+    G = _mm256_loadu_si256( (const __m256i *) state[6] );
+    H = _mm256_loadu_si256( (const __m256i *) state[7] );
+
+    for( i = 0; i < 64; i++ )
+    {
+        /* W[] is a ring of the last 16 words of the schedule */
+        if( i >= 16 )
+        {
+            W[i & 15] = ADD( ADD( S1(W[( i - 2 ) & 15]), W[( i - 7 ) & 15] ),
+                             ADD( S0(W[( i - 15 ) & 15]), W[i & 15] ) );
+        }
+
+        temp1 = ADD( ADD( H, S3(E) ),
+                     ADD( F1(E, F, G),
+                          ADD( _mm256_set1_epi32( (int) sha256_k[i] ), W[i & 15] ) ) );
+        temp2 = ADD( S2(A), F0(A, B, C) );
+
+        H = G;
+        G = F;
+        F = E;
+        E = ADD( D, temp1 );
+        D = C;
+        C = B;
+        B = A;
+        A = ADD( temp1, temp2 );
+    }
+
+#undef F1
+#undef F0
+#undef S3
+#undef S2
+#undef S1
+#undef S0
+#undef ROTR
+#undef SHR
+#undef XOR
+#undef OR
+#undef AND
+#undef ADD
+
+#define ADD_STATE(i,x)                                                  \
+    _mm256_storeu_si256( (__m256i *) state[i],                          \
+        _mm256_add_epi32( _mm256_loadu_si256( (const __m256i *) state[i] ), x ) )
+
+    ADD_STATE( 0, A );
+    ADD_STATE( 1, B );
+    ADD_STATE( 2, C );
+    ADD_STATE( 3, D );
+    ADD_STATE( 4, E );
+    ADD_STATE( 5, F );
+    ADD_STATE( 6, G );
+    ADD_STATE( 7, H );
+
+#undef ADD_STATE
+}
+#endif
+
+typedef void (*sha256_blocks_func)( guint32 state[8], const guint8 *data, guint32 num_blocks );
+
+/* Set on first use; every thread would pick the same ones anyway */
+static sha256_blocks_func sha256_blocks = NULL;
+static gboolean sha256_use_lanes = FALSE;
+
+static void sha256_select( void )
+{
+#ifdef HAVE_SHA256_SHA_NI
+    if( ws_cpuid_sha_ni() )
+    {
+        sha256_blocks = sha256_blocks_sha_ni;
+        return;
+    }
+#endif
+#ifdef HAVE_SHA256_AVX2
+    sha256_use_lanes = ws_cpuid_avx2();
+#endif
+    sha256_blocks = sha256_blocks_portable;
+}
+
+void sha256_update( sha256_context *ctx, const guint8 *input, guint32 length )
+{
+    guint32 left, fill;
+
+    if( ! length ) return;
+
+    left = ctx->total[0] & 0x3F;
+    fill = 64 - left;
+
+    ctx->total[0] += length;
+    ctx->total[0] &= 0xFFFFFFFF;
+
+    if( ctx->total[0] < length )
+        ctx->total[1]++;
+
+    if( G_UNLIKELY( sha256_blocks == NULL ) )
+        sha256_select();
+
+    if( left && length >= fill )
+    {
+        memcpy( (void *) (ctx->buffer + left),
+                (const void *) input, fill );
+        sha256_blocks( ctx->state, ctx->buffer, 1 );
+        length -= fill;
+        input  += fill;
+        left = 0;
+    }
+
+    if( length >= 64 )
+    {
+        sha256_blocks( ctx->state, input, length >> 6 );
+        input  += length & ~0x3F;
+        length &= 0x3F;
+    }
+
+    if( length )
+    {
+        memcpy( (void *) (ctx->buffer + left),
+                (const void *) input, length );
+    }
+}
+
+static const guint8 sha256_padding[64] =
+{
+ 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+void sha256_finish( sha256_context *ctx, guint8 digest[SHA256_DIGEST_LEN] )
+{
+    guint32 last, padn;
+    guint32 high, low;
+    guint8 msglen[8];
+
+    high = ( ctx->total[0] >> 29 )
+         | ( ctx->total[1] <<  3 );
+    low  = ( ctx->total[0] <<  3 );
+
+    PUT_UINT32( high, msglen, 0 );
+    PUT_UINT32( low,  msglen, 4 );
+
+    last = ctx->total[0] & 0x3F;
+    padn = ( last < 56 ) ? ( 56 - last ) : ( 120 - last );
+
+    sha256_update( ctx, sha256_padding, padn );
+    sha256_update( ctx, msglen, 8 );
+
+    PUT_UINT32( ctx->state[0], digest,  0 );
+    PUT_UINT32( ctx->state[1], digest,  4 );
+    PUT_UINT32( ctx->state[2], digest,  8 );
+    PUT_UINT32( ctx->state[3], digest, 12 );
+    PUT_UINT32( ctx->state[4], digest, 16 );
+    PUT_UINT32( ctx->state[5], digest, 20 );
+    PUT_UINT32( ctx->state[6], digest, 24 );
+    PUT_UINT32( ctx->state[7], digest, 28 );
+}
+
+void sha256( const guint8 *input, guint32 length, guint8 digest[SHA256_DIGEST_LEN] )
+{
+    sha256_context ctx;
+
+    sha256_starts( &ctx );
+    sha256_update( &ctx, input, length );
+    sha256_finish( &ctx, digest );
+}
+
+void sha256d( const guint8 *input, guint32 length, guint8 digest[SHA256_DIGEST_LEN] )
+{
+    guint8 tmpbuf[SHA256_DIGEST_LEN];
+
+    sha256( input, length, tmpbuf );
+    sha256( tmpbuf, SHA256_DIGEST_LEN, digest );
+}
+
+#ifdef HAVE_SHA256_AVX2
+/* A message in a lane: its whole blocks, then the rest of it padded */
+typedef struct
+{
+    const guint8 *data;
+    guint32 data_blocks;
+    guint32 num_blocks;
+    guint8 tail[128];
+}
+sha256_lane;
+
+static void sha256_lane_init( sha256_lane *lane, const guint8 *input, guint32 length )
+{
+    guint32 rest = length & 0x3F;
+    guint32 tail_len = ( rest < 56 ) ? 64 : 128;
+
+    lane->data = input;
+    lane->data_blocks = length >> 6;
+    lane->num_blocks = lane->data_blocks + tail_len / 64;
+
+    memset( lane->tail, 0, tail_len );
+    if( rest )
+        memcpy( lane->tail, input + ( length & ~0x3F ), rest );
+    lane->tail[rest] = 0x80;
+    PUT_UINT32( length >> 29, lane->tail, tail_len - 8 );
+    PUT_UINT32( length <<  3, lane->tail, tail_len - 4 );
+}
+
+static const guint8 *sha256_lane_block( const sha256_lane *lane, guint32 block )
+{
+    if( block < lane->data_blocks )
+        return lane->data + 64 * block;
+    return lane->tail + 64 * ( block - lane->data_blocks );
+}
+
+/*
+ * SHA-256 of up to SHA256_LANES messages at once.  Lanes whose message
+ * has ended go on hashing a dummy block, which is ignored; once only one
+ * message is left, it's finished on its own.
+ */
+static void sha256_lanes( const guint8 *const inputs[], const guint32 lengths[],
+                          guint count, guint8 digests[][SHA256_DIGEST_LEN] )
+{
+    sha256_lane lanes[SHA256_LANES];
+    guint32 state[8][SHA256_LANES];
+    const guint8 *blocks[SHA256_LANES];
+    guint32 lane_state[8];
+    guint32 max_blocks = 0, block;
+    guint lane, active;
+    int i;
+
+    for( lane = 0; lane < count; lane++ )
+    {
+        sha256_lane_init( &lanes[lane], inputs[lane], lengths[lane] );
+        if( lanes[lane].num_blocks > max_blocks )
+            max_blocks = lanes[lane].num_blocks;
+    }
+
+    for( i = 0; i < 8; i++ )
+    {
+        for( lane = 0; lane < SHA256_LANES; lane++ )
+            state[i][lane] = sha256_h0[i];
+    }
+
+    for( block = 0; block < max_blocks; block++ )
+    {
+        active = 0;
+        for( lane = 0; lane < SHA256_LANES; lane++ )
+        {
+            if( lane < count && block < lanes[lane].num_blocks )
+            {
+                blocks[lane] = sha256_lane_block( &lanes[lane], block );
+                active++;
+            }
+            else
+                blocks[lane] = sha256_padding;
+        }
+
+        if( active == 1 )
+            break;
+
+        sha256_lanes_process_avx2( state, blocks );
+
+        for( lane = 0; lane < count; lane++ )
+        {
+            if( block + 1 == lanes[lane].num_blocks )
+            {
+                for( i = 0; i < 8; i++ )
+                    PUT_UINT32( state[i][lane], digests[lane], 4 * i );
+            }
+        }
+    }
+
+    if( block == max_blocks )
+        return;
+
+    /* The last message left */
+    for( lane = 0; block >= lanes[lane].num_blocks; lane++ )
+        ;
+    for( i = 0; i < 8; i++ )
+        lane_state[i] = state[i][lane];
+    if( block < lanes[lane].data_blocks )
+    {
+        sha256_blocks( lane_state, lanes[lane].data + 64 * block,
+                       lanes[lane].data_blocks - block );
+        block = lanes[lane].data_blocks;
+    }
+    sha256_blocks( lane_state, sha256_lane_block( &lanes[lane], block ),
+                   lanes[lane].num_blocks - block );
+    for( i = 0; i < 8; i++ )
+        PUT_UINT32( lane_state[i], digests[lane], 4 * i );
+}
+#endif
+
+void sha256d_batch( const guint8 *const inputs[], const guint32 lengths[],
+                    guint count, guint8 digests[][SHA256_DIGEST_LEN] )
+{
+#ifdef HAVE_SHA256_AVX2
+    const guint8 *inner_inputs[SHA256_LANES];
+    guint32 inner_lengths[SHA256_LANES];
+    guint8 inner[SHA256_LANES][SHA256_DIGEST_LEN];
+    guint n, lane;
+#endif
+    guint i;
+
+    if( G_UNLIKELY( sha256_blocks == NULL ) )
+        sha256_select();
+
+#ifdef HAVE_SHA256_AVX2
+    while( sha256_use_lanes && count >= 2 )
+    {
+        n = MIN( count, SHA256_LANES );
+
+        sha256_lanes( inputs, lengths, n, inner );
+        for( lane = 0; lane < n; lane++ )
+        {
+            inner_inputs[lane] = inner[lane];
+            inner_lengths[lane] = SHA256_DIGEST_LEN;
+        }
+        sha256_lanes( inner_inputs, inner_lengths, n, digests );
+
+        inputs  += n;
+        lengths += n;
+        digests += n;
+        count   -= n;
+    }
+#endif
+
+    for( i = 0; i < count; i++ )
+        sha256d( inputs[i], lengths[i], digests[i] );
+}
@@ -0,0 +1,63 @@
+/*
+ *  FIPS-180-2 compliant SHA-256 implementation
+ *
+ *  $Id$
+ *
+ *  Copyright (C) 2001-2003  Christophe Devine
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ *  Derived from sha1.c, using the same context layout and calling
+ *  conventions.
+ *  References: http://csrc.nist.gov/publications/fips/fips180-2/fips180-2.pdf
+ */
+
+#ifndef _SHA2_H
+#define _SHA2_H
+
+#include "ws_symbol_export.h"
+
+#define SHA256_DIGEST_LEN 32
+
+typedef struct
+{
+    guint32 total[2];
+    guint32 state[8];
+    guint8 buffer[64];
+}
+sha256_context;
+
+WS_DLL_PUBLIC
+void sha256_starts( sha256_context *ctx );
+WS_DLL_PUBLIC
+void sha256_update( sha256_context *ctx, const guint8 *input, guint32 length );
+WS_DLL_PUBLIC
+void sha256_finish( sha256_context *ctx, guint8 digest[SHA256_DIGEST_LEN] );
+
+/* One-shot SHA-256 of a buffer */
+WS_DLL_PUBLIC
+void sha256( const guint8 *input, guint32 length, guint8 digest[SHA256_DIGEST_LEN] );
+
+/* SHA-256 of the SHA-256 of a buffer, as used by Bitcoin and friends */
+WS_DLL_PUBLIC
+void sha256d( const guint8 *input, guint32 length, guint8 digest[SHA256_DIGEST_LEN] );
+
+/* sha256d() of each of "count" buffers, several at a time where the
+   processor can do that */
+WS_DLL_PUBLIC
+void sha256d_batch( const guint8 *const inputs[], const guint32 lengths[],
+                    guint count, guint8 digests[][SHA256_DIGEST_LEN] );
+
+#endif /* sha2.h */
@@ -0,0 +1,145 @@
+/*
+ * ws_cpuid.h
+ * Get the CPU info on x86 processors that support it
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef __WSUTIL_WS_CPUID_H__
+#define __WSUTIL_WS_CPUID_H__
+
+#include <glib.h>
+
+/*
+ * Get CPU info on platforms where the cpuid instruction can be used;
+ * as in version_info.c, 32-bit x86 is skipped for GCC, as older
+ * processors may not have it.
+ * ws_cpuid() returns FALSE if the information isn't available.
+ */
+
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>
+
+static inline gboolean
+ws_cpuid(guint32 *CPUInfo, guint32 selector)
+{
+	__cpuidex((int *) CPUInfo, selector, 0);
+	return TRUE;
+}
+
+static inline guint64
+ws_xgetbv(guint32 xcr)
+{
+	return _xgetbv(xcr);
+}
+
+#define HAVE_WS_CPUID
+
+#elif defined(__GNUC__) && defined(__x86_64__)
+
+static inline gboolean
+ws_cpuid(guint32 *CPUInfo, guint32 selector)
+{
+	__asm__ __volatile__("cpuid"
+			     : "=a" (CPUInfo[0]),
+			       "=b" (CPUInfo[1]),
+			       "=c" (CPUInfo[2]),
+			       "=d" (CPUInfo[3])
+			     : "a" (selector), "c" (0));
+	return TRUE;
+}
+
+static inline guint64
+ws_xgetbv(guint32 xcr)
+{
+	guint32 eax, edx;
+
+	/* xgetbv, spelled out for assemblers that don't know it */
+	__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0"
+			     : "=a" (eax), "=d" (edx)
+			     : "c" (xcr));
+	return ((guint64) edx << 32) | eax;
+}
+
+#define HAVE_WS_CPUID
+
+#else
+
+static inline gboolean
+ws_cpuid(guint32 *CPUInfo, guint32 selector)
+{
+	(void) selector;
+	CPUInfo[0] = CPUInfo[1] = CPUInfo[2] = CPUInfo[3] = 0;
+	return FALSE;
+}
+
+#endif
+
+/* Whether the processor supports AVX2, and the OS saves the AVX state */
+static inline gboolean
+ws_cpuid_avx2(void)
+{
+#ifdef HAVE_WS_CPUID
+	guint32 CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 0) || CPUInfo[0] < 7)
+		return FALSE;
+
+	/* OSXSAVE and AVX */
+	ws_cpuid(CPUInfo, 1);
+	if ((CPUInfo[2] & ((1 << 27) | (1 << 28))) != ((1 << 27) | (1 << 28)))
+		return FALSE;
+
+	/* The OS has enabled the XMM and YMM state */
+	if ((ws_xgetbv(0) & 0x6) != 0x6)
+		return FALSE;
+
+	ws_cpuid(CPUInfo, 7);
+	return (CPUInfo[1] & (1 << 5)) != 0;
+#else
+	return FALSE;
+#endif
+}
+
+/* Whether the processor has the SHA extensions, and the SSSE3 and SSE4.1
+   instructions that go with them */
+static inline gboolean
+ws_cpuid_sha_ni(void)
+{
+#ifdef HAVE_WS_CPUID
+	guint32 CPUInfo[4];
+
+	if (!ws_cpuid(CPUInfo, 0) || CPUInfo[0] < 7)
+		return FALSE;
+
+	/* SSSE3 and SSE4.1 */
+	ws_cpuid(CPUInfo, 1);
+	if ((CPUInfo[2] & ((1 << 9) | (1 << 19))) != ((1 << 9) | (1 << 19)))
+		return FALSE;
+
+	ws_cpuid(CPUInfo, 7);
+	return (CPUInfo[1] & (1 << 29)) != 0;
+#else
+	return FALSE;
+#endif
+}
+
+#endif /* __WSUTIL_WS_CPUID_H__ */
@@ -0,0 +1,206 @@
+/* ws_mempbrk.c
+ * Finding the first of a set of bytes in a buffer
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib.h>
+
+#include "ws_mempbrk.h"
+#include "ws_cpuid.h"
+#include "bits_ctz.h"
+
+/*
+ * Small needle sets, such as the "\r\n" of line ends, are searched for by
+ * comparing a vector of the haystack against each needle in turn, 16 bytes
+ * at a time with SSE2 (which every x86-64 processor has) and 32 bytes at a
+ * time with AVX2 (if the processor has it, which is checked at run time).
+ * Anything else uses the table, one byte at a time.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAVE_MEMPBRK_SSE2
+#include <emmintrin.h>
+#endif
+
+/* Compilers that can build AVX2 code into a single function */
+#if defined(HAVE_MEMPBRK_SSE2) && defined(HAVE_WS_CPUID) && defined(__GNUC__) && \
+    ((defined(__clang__) && __clang_major__ >= 4) || \
+     (!defined(__clang__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define HAVE_MEMPBRK_AVX2
+#include <immintrin.h>
+#endif
+
+void
+ws_mempbrk_compile(ws_mempbrk_pattern *pattern, const gchar *needles)
+{
+	memset(pattern->patt, 0, sizeof(pattern->patt));
+	pattern->num_needles = 0;
+
+	while (*needles) {
+		guint8 needle = (guint8) *needles++;
+
+		if (pattern->patt[needle])
+			continue;
+		pattern->patt[needle] = 1;
+
+		if (pattern->num_needles < WS_MEMPBRK_MAX_VECTOR_NEEDLES)
+			pattern->needles[pattern->num_needles] = needle;
+		pattern->num_needles++;
+	}
+
+	/* Too many for the vector compares to be any faster */
+	if (pattern->num_needles > WS_MEMPBRK_MAX_VECTOR_NEEDLES)
+		pattern->num_needles = 0;
+}
+
+const guint8 *
+ws_mempbrk_portable_exec(const guint8 *haystack, size_t haystacklen, const ws_mempbrk_pattern *pattern, guchar *found_needle)
+{
+	const guint8 *haystack_end = haystack + haystacklen;
+
+	while (haystack < haystack_end) {
+		if (pattern->patt[*haystack]) {
+			if (found_needle)
+				*found_needle = *haystack;
+			return haystack;
+		}
+		haystack++;
+	}
+
+	return NULL;
+}
+
+#ifdef HAVE_MEMPBRK_SSE2
+static const guint8 *
+mempbrk_sse2(const guint8 *haystack, size_t haystacklen, const ws_mempbrk_pattern *pattern, guchar *found_needle)
+{
+	__m128i       needles[WS_MEMPBRK_MAX_VECTOR_NEEDLES];
+	__m128i       data, hits;
+	const guint8 *haystack_end = haystack + haystacklen;
+	guint         num_needles = pattern->num_needles;
+	guint         i;
+	int           mask;
+
+	for (i = 0; i < num_needles; i++)
+		needles[i] = _mm_set1_epi8((char) pattern->needles[i]);
+
+	while (haystack_end - haystack >= 16) {
+		data = _mm_loadu_si128((const __m128i *) haystack);
+		hits = _mm_cmpeq_epi8(data, needles[0]);
+		for (i = 1; i < num_needles; i++)
+			hits = _mm_or_si128(hits, _mm_cmpeq_epi8(data, needles[i]));
+
+		mask = _mm_movemask_epi8(hits);
+		if (mask) {
+			haystack += ws_ctz(mask);
+			if (found_needle)
+				*found_needle = *haystack;
+			return haystack;
+		}
+		haystack += 16;
+	}
+
+	return ws_mempbrk_portable_exec(haystack, haystack_end - haystack, pattern, found_needle);
+}
+#endif
+
+#ifdef HAVE_MEMPBRK_AVX2
+__attribute__((target("avx2")))
+static const guint8 *
+mempbrk_avx2(const guint8 *haystack, size_t haystacklen, const ws_mempbrk_pattern *pattern, guchar *found_needle)
+{
+	__m256i       needles[WS_MEMPBRK_MAX_VECTOR_NEEDLES];
+	__m256i       data, hits;
+	const guint8 *haystack_end = haystack + haystacklen;
+	guint         num_needles = pattern->num_needles;
+	guint         i;
+	guint32       mask;
+
+	for (i = 0; i < num_needles; i++)
+		needles[i] = _mm256_set1_epi8((char) pattern->needles[i]);
+
+	while (haystack_end - haystack >= 32) {
+		data = _mm256_loadu_si256((const __m256i *) haystack);
+		hits = _mm256_cmpeq_epi8(data, needles[0]);
+		for (i = 1; i < num_needles; i++)
+			hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(data, needles[i]));
+
+		mask = (guint32) _mm256_movemask_epi8(hits);
+		if (mask) {
+			haystack += ws_ctz(mask);
+			if (found_needle)
+				*found_needle = *haystack;
+			return haystack;
+		}
+		haystack += 32;
+	}
+
+	return mempbrk_sse2(haystack, haystack_end - haystack, pattern, found_needle);
+}
+#endif
+
+#ifdef HAVE_MEMPBRK_SSE2
+typedef const guint8 *(*mempbrk_func)(const guint8 *, size_t, const ws_mempbrk_pattern *, guchar *);
+
+/* Set on first use; every thread would pick the same one anyway */
+static mempbrk_func mempbrk_vector = NULL;
+
+static mempbrk_func
+mempbrk_select(void)
+{
+#ifdef HAVE_MEMPBRK_AVX2
+	if (ws_cpuid_avx2())
+		return mempbrk_avx2;
+#endif
+	return mempbrk_sse2;
+}
+#endif
+
+const guint8 *
+ws_mempbrk_exec(const guint8 *haystack, size_t haystacklen, const ws_mempbrk_pattern *pattern, guchar *found_needle)
+{
+#ifdef HAVE_MEMPBRK_SSE2
+	if (pattern->num_needles != 0 && haystacklen >= 16) {
+		if (G_UNLIKELY(mempbrk_vector == NULL))
+			mempbrk_vector = mempbrk_select();
+		return mempbrk_vector(haystack, haystacklen, pattern, found_needle);
+	}
+#endif
+
+	return ws_mempbrk_portable_exec(haystack, haystacklen, pattern, found_needle);
+}
+
+/*
+ * Editor modelines  -  http://www.wireshark.org/tools/modelines.html
+ *
+ * Local variables:
+ * c-basic-offset: 8
+ * tab-width: 8
+ * indent-tabs-mode: t
+ * End:
+ *
+ * vi: set shiftwidth=8 tabstop=8 noexpandtab:
+ * :indentSize=8:tabSize=8:noTabs=false:
+ */
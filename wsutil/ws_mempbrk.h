@@ -0,0 +1,58 @@
+/* ws_mempbrk.h
+ * Finding the first of a set of bytes in a buffer
+ *
+ * $Id$
+ *
+ * Wireshark - Network traffic analyzer
+ * By Gerald Combs <gerald@wireshark.org>
+ * Copyright 1998 Gerald Combs
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef __WS_MEMPBRK_H__
+#define __WS_MEMPBRK_H__
+
+#include <glib.h>
+
+#include "ws_symbol_export.h"
+
+/* Up to this many distinct needles are searched for with vector
+ * compares, where the processor has them; larger sets use the table */
+#define WS_MEMPBRK_MAX_VECTOR_NEEDLES 8
+
+/** A set of needles, compiled by ws_mempbrk_compile() */
+typedef struct {
+	gchar  patt[256];		/**< non-zero for the needles */
+	guint8 needles[WS_MEMPBRK_MAX_VECTOR_NEEDLES];
+	guint  num_needles;		/**< 0 if there are too many for the vector compares */
+} ws_mempbrk_pattern;
+
+/** Compile a NUL-terminated set of needles for ws_mempbrk_exec(). Compile
+ * sets that are searched for often once, into a static pattern.
+ * (NUL itself can't be one of the needles.) */
+WS_DLL_PUBLIC void ws_mempbrk_compile(ws_mempbrk_pattern *pattern, const gchar *needles);
+
+/** Find the first occurrence of any of the needles of a compiled pattern
+ * in a buffer, like strpbrk(). Returns a pointer to it, and the needle
+ * found in found_needle if it isn't NULL; returns NULL if there is none. */
+WS_DLL_PUBLIC const guint8 *ws_mempbrk_exec(const guint8 *haystack, size_t haystacklen,
+    const ws_mempbrk_pattern *pattern, guchar *found_needle);
+
+/** The same without vector compares, for testing and benchmarking them */
+WS_DLL_PUBLIC const guint8 *ws_mempbrk_portable_exec(const guint8 *haystack, size_t haystacklen,
+    const ws_mempbrk_pattern *pattern, guchar *found_needle);
+
+#endif /* __WS_MEMPBRK_H__ */